@@ -0,0 +1,40 @@
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "AstArena.h"
+
+AstArena *AstArena::currentArena = nullptr;
+
+AstArena::AstArena(size_t chunkSize)
+        : chunkSize(chunkSize), next(nullptr), limit(nullptr), allocated(0), reserved(0) {
+}
+
+AstArena::~AstArena() {
+    for (size_t i = 0; i < chunks.size(); i++)
+        free(chunks[i]);
+    if (currentArena == this)
+        currentArena = nullptr;
+}
+
+void *AstArena::allocate(size_t size, size_t align) {
+    uintptr_t p = (reinterpret_cast<uintptr_t>(next) + align - 1) & ~(uintptr_t)(align - 1);
+    if (next == nullptr || p + size > reinterpret_cast<uintptr_t>(limit)) {
+        // oversized requests get a chunk of their own so the current chunk stays usable
+        size_t bytes = size + align > chunkSize / 4 ? size + align : chunkSize;
+        char *chunk = static_cast<char *>(malloc(bytes));
+        if (chunk == nullptr)
+            throw bad_alloc();
+        chunks.push_back(chunk);
+        reserved += bytes;
+        p = (reinterpret_cast<uintptr_t>(chunk) + align - 1) & ~(uintptr_t)(align - 1);
+        if (bytes != chunkSize) {
+            allocated += size;
+            return reinterpret_cast<void *>(p);
+        }
+        limit = chunk + bytes;
+    }
+    next = reinterpret_cast<char *>(p + size);
+    allocated += size;
+    return reinterpret_cast<void *>(p);
+}
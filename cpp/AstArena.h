@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Region allocator for the AST of one compilation unit.
+//
+// Every Expr, Stmt, LValue and Pattern created with makeAst() while an
+// AstArena::Scope is open is carved out of that arena together with its
+// shared_ptr control block, so a node costs one pointer bump instead of a
+// heap allocation. Nodes are still passed around as shared_ptr so the
+// passes did not have to change, but dropping the last reference only runs
+// the destructor: the memory is returned in one shot when the arena dies.
+//
+// Ownership:
+//  - processBSVFile() opens one arena per package before GenerateAst runs.
+//  - GenerateAst, SimplifyAst, Inliner and Stmt/Expr::rename allocate into
+//    the current arena. Their results share unchanged subtrees with their
+//    inputs, so no tree may be mutated in place once a pass has seen it.
+//  - No reference to a node may outlive the arena. TypeChecker, BSVType and
+//    Declaration survive across packages and must never hold one.
+//
+// With no arena open, makeAst() falls back to make_shared().
+class AstArena {
+public:
+    AstArena(size_t chunkSize = 64 * 1024);
+    ~AstArena();
+
+    void *allocate(size_t size, size_t align);
+
+    size_t bytesAllocated() const { return allocated; }
+    size_t bytesReserved() const { return reserved; }
+
+    static AstArena *current() { return currentArena; }
+
+    // makes arena the current arena until the end of the enclosing block
+    class Scope {
+        AstArena *saved;
+    public:
+        Scope(AstArena &arena) : saved(currentArena) { currentArena = &arena; }
+        ~Scope() { currentArena = saved; }
+    };
+
+private:
+    const size_t chunkSize;
+    vector<char *> chunks;
+    char *next;
+    char *limit;
+    size_t allocated;
+    size_t reserved;
+
+    static AstArena *currentArena;
+
+    AstArena(const AstArena &) = delete;
+    AstArena &operator=(const AstArena &) = delete;
+};
+
+template <typename T>
+class AstArenaAllocator {
+public:
+    typedef T value_type;
+
+    AstArena *arena;
+
+    AstArenaAllocator(AstArena *arena) : arena(arena) {}
+    template <typename U>
+    AstArenaAllocator(const AstArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T *, size_t) {}
+};
+
+template <typename T, typename U>
+bool operator==(const AstArenaAllocator<T> &a, const AstArenaAllocator<U> &b) { return a.arena == b.arena; }
+template <typename T, typename U>
+bool operator!=(const AstArenaAllocator<T> &a, const AstArenaAllocator<U> &b) { return a.arena != b.arena; }
+
+template <typename T, typename... Args>
+shared_ptr<T> makeAst(Args &&... args) {
+    AstArena *arena = AstArena::current();
+    if (arena)
+        return allocate_shared<T>(AstArenaAllocator<T>(arena), std::forward<Args>(args)...);
+    return make_shared<T>(std::forward<Args>(args)...);
+}
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <memory>
+
+#include "Expr.h"
+#include "LValue.h"
+#include "Pattern.h"
+#include "Stmt.h"
+
+using namespace std;
+
+// Compile-time dispatch over the AST node type tags.
+//
+// A pass derives from the dispatchers it needs, naming itself as Derived:
+//
+//   class GenerateIR : public StmtDispatcher<GenerateIR, void, int> { ... };
+//
+// dispatchStmt() switches on stmtType and calls Derived::visitXxxStmt() with
+// the node already cast to its concrete type, so there are no virtual calls
+// and no probing through the stmt->xxxStmt() downcast accessors. Result and
+// Args are the return type and extra arguments shared by all the handlers.
+// Node types the derived class does not handle go to defaultStmt(), which
+// the derived class may hide to supply its own fallback.
+//
+// ExprDispatcher, LValueDispatcher and PatternDispatcher work the same way
+// over exprType, lvalueType and patternType.
+
+template <typename Derived, typename Result = void, typename... Args>
+class StmtDispatcher {
+public:
+    Result dispatchStmt(const shared_ptr<Stmt> &stmt, Args... args) {
+        Derived *derived = static_cast<Derived *>(this);
+        switch (stmt->stmtType) {
+            case ActionBindingStmtType:
+                return derived->visitActionBindingStmt(static_pointer_cast<ActionBindingStmt>(stmt), args...);
+            case BlockStmtType:
+                return derived->visitBlockStmt(static_pointer_cast<BlockStmt>(stmt), args...);
+            case CallStmtType:
+                return derived->visitCallStmt(static_pointer_cast<CallStmt>(stmt), args...);
+            case ExprStmtType:
+                return derived->visitExprStmt(static_pointer_cast<ExprStmt>(stmt), args...);
+            case FunctionDefStmtType:
+                return derived->visitFunctionDefStmt(static_pointer_cast<FunctionDefStmt>(stmt), args...);
+            case InterfaceDeclStmtType:
+                return derived->visitInterfaceDeclStmt(static_pointer_cast<InterfaceDeclStmt>(stmt), args...);
+            case InterfaceDefStmtType:
+                return derived->visitInterfaceDefStmt(static_pointer_cast<InterfaceDefStmt>(stmt), args...);
+            case IfStmtType:
+                return derived->visitIfStmt(static_pointer_cast<IfStmt>(stmt), args...);
+            case ImportStmtType:
+                return derived->visitImportStmt(static_pointer_cast<ImportStmt>(stmt), args...);
+            case MethodDeclStmtType:
+                return derived->visitMethodDeclStmt(static_pointer_cast<MethodDeclStmt>(stmt), args...);
+            case MethodDefStmtType:
+                return derived->visitMethodDefStmt(static_pointer_cast<MethodDefStmt>(stmt), args...);
+            case ModuleDefStmtType:
+                return derived->visitModuleDefStmt(static_pointer_cast<ModuleDefStmt>(stmt), args...);
+            case ModuleInstStmtType:
+                return derived->visitModuleInstStmt(static_pointer_cast<ModuleInstStmt>(stmt), args...);
+            case PackageDefStmtType:
+                return derived->visitPackageDefStmt(static_pointer_cast<PackageDefStmt>(stmt), args...);
+            case PatternMatchStmtType:
+                return derived->visitPatternMatchStmt(static_pointer_cast<PatternMatchStmt>(stmt), args...);
+            case RegisterStmtType:
+                return derived->visitRegisterStmt(static_pointer_cast<RegisterStmt>(stmt), args...);
+            case RegReadStmtType:
+                return derived->visitRegReadStmt(static_pointer_cast<RegReadStmt>(stmt), args...);
+            case RegWriteStmtType:
+                return derived->visitRegWriteStmt(static_pointer_cast<RegWriteStmt>(stmt), args...);
+            case ReturnStmtType:
+                return derived->visitReturnStmt(static_pointer_cast<ReturnStmt>(stmt), args...);
+            case TypedefEnumStmtType:
+                return derived->visitTypedefEnumStmt(static_pointer_cast<TypedefEnumStmt>(stmt), args...);
+            case TypedefStructStmtType:
+                return derived->visitTypedefStructStmt(static_pointer_cast<TypedefStructStmt>(stmt), args...);
+            case TypedefSynonymStmtType:
+                return derived->visitTypedefSynonymStmt(static_pointer_cast<TypedefSynonymStmt>(stmt), args...);
+            case VarBindingStmtType:
+                return derived->visitVarBindingStmt(static_pointer_cast<VarBindingStmt>(stmt), args...);
+            case VarAssignStmtType:
+                return derived->visitVarAssignStmt(static_pointer_cast<VarAssignStmt>(stmt), args...);
+            case RuleDefStmtType:
+                return derived->visitRuleDefStmt(static_pointer_cast<RuleDefStmt>(stmt), args...);
+            case ForStmtType:
+                return derived->visitForStmt(static_pointer_cast<ForStmt>(stmt), args...);
+            case WhileStmtType:
+                return derived->visitWhileStmt(static_pointer_cast<WhileStmt>(stmt), args...);
+            default:
+                break;
+        }
+        return derived->defaultStmt(stmt, args...);
+    }
+
+    // called for node types the derived class has no handler for
+    Result defaultStmt(const shared_ptr<Stmt> &stmt, Args... args) { return Result(); }
+
+    Result visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitBlockStmt(const shared_ptr<BlockStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitCallStmt(const shared_ptr<CallStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitExprStmt(const shared_ptr<ExprStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitFunctionDefStmt(const shared_ptr<FunctionDefStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitInterfaceDeclStmt(const shared_ptr<InterfaceDeclStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitInterfaceDefStmt(const shared_ptr<InterfaceDefStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitIfStmt(const shared_ptr<IfStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitImportStmt(const shared_ptr<ImportStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitMethodDeclStmt(const shared_ptr<MethodDeclStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitMethodDefStmt(const shared_ptr<MethodDefStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitModuleDefStmt(const shared_ptr<ModuleDefStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitModuleInstStmt(const shared_ptr<ModuleInstStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitPackageDefStmt(const shared_ptr<PackageDefStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitPatternMatchStmt(const shared_ptr<PatternMatchStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitRegisterStmt(const shared_ptr<RegisterStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitRegReadStmt(const shared_ptr<RegReadStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitReturnStmt(const shared_ptr<ReturnStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitTypedefEnumStmt(const shared_ptr<TypedefEnumStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitTypedefStructStmt(const shared_ptr<TypedefStructStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitTypedefSynonymStmt(const shared_ptr<TypedefSynonymStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitRuleDefStmt(const shared_ptr<RuleDefStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitForStmt(const shared_ptr<ForStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+    Result visitWhileStmt(const shared_ptr<WhileStmt> &stmt, Args... args) {
+        return static_cast<Derived *>(this)->defaultStmt(stmt, args...);
+    }
+};
+
+template <typename Derived, typename Result = void, typename... Args>
+class ExprDispatcher {
+public:
+    Result dispatchExpr(const shared_ptr<Expr> &expr, Args... args) {
+        Derived *derived = static_cast<Derived *>(this);
+        switch (expr->exprType) {
+            case ArraySubExprType:
+                return derived->visitArraySubExpr(static_pointer_cast<ArraySubExpr>(expr), args...);
+            case BitConcatExprType:
+                return derived->visitBitConcatExpr(static_pointer_cast<BitConcatExpr>(expr), args...);
+            case BitSelExprType:
+                return derived->visitBitSelExpr(static_pointer_cast<BitSelExpr>(expr), args...);
+            case VarExprType:
+                return derived->visitVarExpr(static_pointer_cast<VarExpr>(expr), args...);
+            case IntConstType:
+                return derived->visitIntConst(static_pointer_cast<IntConst>(expr), args...);
+            case InterfaceExprType:
+                return derived->visitInterfaceExpr(static_pointer_cast<InterfaceExpr>(expr), args...);
+            case SubinterfaceExprType:
+                return derived->visitSubinterfaceExpr(static_pointer_cast<SubinterfaceExpr>(expr), args...);
+            case StringConstType:
+                return derived->visitStringConst(static_pointer_cast<StringConst>(expr), args...);
+            case OperatorExprType:
+                return derived->visitOperatorExpr(static_pointer_cast<OperatorExpr>(expr), args...);
+            case CallExprType:
+                return derived->visitCallExpr(static_pointer_cast<CallExpr>(expr), args...);
+            case CaseExprType:
+                return derived->visitCaseExpr(static_pointer_cast<CaseExpr>(expr), args...);
+            case FieldExprType:
+                return derived->visitFieldExpr(static_pointer_cast<FieldExpr>(expr), args...);
+            case CondExprType:
+                return derived->visitCondExpr(static_pointer_cast<CondExpr>(expr), args...);
+            case EnumUnionStructExprType:
+                return derived->visitEnumUnionStructExpr(static_pointer_cast<EnumUnionStructExpr>(expr), args...);
+            case MatchesExprType:
+                return derived->visitMatchesExpr(static_pointer_cast<MatchesExpr>(expr), args...);
+            case MethodExprType:
+                return derived->visitMethodExpr(static_pointer_cast<MethodExpr>(expr), args...);
+            case ValueofExprType:
+                return derived->visitValueofExpr(static_pointer_cast<ValueofExpr>(expr), args...);
+            default:
+                break;
+        }
+        return derived->defaultExpr(expr, args...);
+    }
+
+    // called for node types the derived class has no handler for
+    Result defaultExpr(const shared_ptr<Expr> &expr, Args... args) { return Result(); }
+
+    Result visitArraySubExpr(const shared_ptr<ArraySubExpr> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+    Result visitBitConcatExpr(const shared_ptr<BitConcatExpr> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+    Result visitBitSelExpr(const shared_ptr<BitSelExpr> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+    Result visitVarExpr(const shared_ptr<VarExpr> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+    Result visitIntConst(const shared_ptr<IntConst> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+    Result visitInterfaceExpr(const shared_ptr<InterfaceExpr> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+    Result visitSubinterfaceExpr(const shared_ptr<SubinterfaceExpr> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+    Result visitStringConst(const shared_ptr<StringConst> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+    Result visitOperatorExpr(const shared_ptr<OperatorExpr> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+    Result visitCallExpr(const shared_ptr<CallExpr> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+    Result visitCaseExpr(const shared_ptr<CaseExpr> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+    Result visitFieldExpr(const shared_ptr<FieldExpr> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+    Result visitCondExpr(const shared_ptr<CondExpr> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+    Result visitEnumUnionStructExpr(const shared_ptr<EnumUnionStructExpr> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+    Result visitMatchesExpr(const shared_ptr<MatchesExpr> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+    Result visitMethodExpr(const shared_ptr<MethodExpr> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+    Result visitValueofExpr(const shared_ptr<ValueofExpr> &expr, Args... args) {
+        return static_cast<Derived *>(this)->defaultExpr(expr, args...);
+    }
+};
+
+template <typename Derived, typename Result = void, typename... Args>
+class LValueDispatcher {
+public:
+    Result dispatchLValue(const shared_ptr<LValue> &lvalue, Args... args) {
+        Derived *derived = static_cast<Derived *>(this);
+        switch (lvalue->lvalueType) {
+            case ArraySubLValueType:
+                return derived->visitArraySubLValue(static_pointer_cast<ArraySubLValue>(lvalue), args...);
+            case FieldLValueType:
+                return derived->visitFieldLValue(static_pointer_cast<FieldLValue>(lvalue), args...);
+            case VarLValueType:
+                return derived->visitVarLValue(static_pointer_cast<VarLValue>(lvalue), args...);
+            case RangeSelLValueType:
+                return derived->visitRangeSelLValue(static_pointer_cast<RangeSelLValue>(lvalue), args...);
+            default:
+                break;
+        }
+        return derived->defaultLValue(lvalue, args...);
+    }
+
+    // called for node types the derived class has no handler for
+    Result defaultLValue(const shared_ptr<LValue> &lvalue, Args... args) { return Result(); }
+
+    Result visitArraySubLValue(const shared_ptr<ArraySubLValue> &lvalue, Args... args) {
+        return static_cast<Derived *>(this)->defaultLValue(lvalue, args...);
+    }
+    Result visitFieldLValue(const shared_ptr<FieldLValue> &lvalue, Args... args) {
+        return static_cast<Derived *>(this)->defaultLValue(lvalue, args...);
+    }
+    Result visitVarLValue(const shared_ptr<VarLValue> &lvalue, Args... args) {
+        return static_cast<Derived *>(this)->defaultLValue(lvalue, args...);
+    }
+    Result visitRangeSelLValue(const shared_ptr<RangeSelLValue> &lvalue, Args... args) {
+        return static_cast<Derived *>(this)->defaultLValue(lvalue, args...);
+    }
+};
+
+template <typename Derived, typename Result = void, typename... Args>
+class PatternDispatcher {
+public:
+    Result dispatchPattern(const shared_ptr<Pattern> &pattern, Args... args) {
+        Derived *derived = static_cast<Derived *>(this);
+        switch (pattern->patternType) {
+            case IntPatternType:
+                return derived->visitIntPattern(static_pointer_cast<IntPattern>(pattern), args...);
+            case TaggedPatternType:
+                return derived->visitTaggedPattern(static_pointer_cast<TaggedPattern>(pattern), args...);
+            case TuplePatternType:
+                return derived->visitTuplePattern(static_pointer_cast<TuplePattern>(pattern), args...);
+            case VarPatternType:
+                return derived->visitVarPattern(static_pointer_cast<VarPattern>(pattern), args...);
+            case WildcardPatternType:
+                return derived->visitWildcardPattern(static_pointer_cast<WildcardPattern>(pattern), args...);
+            default:
+                break;
+        }
+        return derived->defaultPattern(pattern, args...);
+    }
+
+    // called for node types the derived class has no handler for
+    Result defaultPattern(const shared_ptr<Pattern> &pattern, Args... args) { return Result(); }
+
+    Result visitIntPattern(const shared_ptr<IntPattern> &pattern, Args... args) {
+        return static_cast<Derived *>(this)->defaultPattern(pattern, args...);
+    }
+    Result visitTaggedPattern(const shared_ptr<TaggedPattern> &pattern, Args... args) {
+        return static_cast<Derived *>(this)->defaultPattern(pattern, args...);
+    }
+    Result visitTuplePattern(const shared_ptr<TuplePattern> &pattern, Args... args) {
+        return static_cast<Derived *>(this)->defaultPattern(pattern, args...);
+    }
+    Result visitVarPattern(const shared_ptr<VarPattern> &pattern, Args... args) {
+        return static_cast<Derived *>(this)->defaultPattern(pattern, args...);
+    }
+    Result visitWildcardPattern(const shared_ptr<WildcardPattern> &pattern, Args... args) {
+        return static_cast<Derived *>(this)->defaultPattern(pattern, args...);
+    }
+};
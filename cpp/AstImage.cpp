@@ -0,0 +1,619 @@
+#include <algorithm>
+#include <fcntl.h>
+#include <iostream>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "AstImage.h"
+
+static const char imageMagic[] = "BSVIMG01";
+// the magic followed by size, package name, file name, stmts and declarations
+static const uint32_t headerSize = 8 + 5 * 4;
+
+bool AstImageWriter::open(const string &filename) {
+    this->filename = filename;
+    output.open(filename, ios::out | ios::trunc | ios::binary);
+    output.write(imageMagic, 8);
+    offset = 8;
+    tooLarge = false;
+    // patched by close()
+    write(vector<uint32_t>(5, 0));
+    identifierOffsets.clear();
+    filenameOffsets.clear();
+    typeOffsets.clear();
+    packageName = packageFilename = 0;
+    stmtOffsets.clear();
+    declarations.clear();
+    return output.good();
+}
+
+void AstImageWriter::addPackage(const string &name, const string &filename) {
+    packageName = writeString(name);
+    packageFilename = writeString(filename);
+}
+
+void AstImageWriter::addStmt(const bsvproto::Stmt &stmt_proto, const string &declarationName,
+                             const bsvproto::AstIndex &tables) {
+    this->tables = &tables;
+    identifierOffsets.resize(tables.identifier_size(), 0);
+    filenameOffsets.resize(tables.filename_size(), 0);
+    typeOffsets.resize(tables.type_size(), 0);
+    uint32_t stmtOffset = stmt(stmt_proto);
+    stmtOffsets.push_back(stmtOffset);
+    if (declarationName.size())
+        declarations.push_back(make_pair(declarationName, stmtOffset));
+    this->tables = nullptr;
+}
+
+bool AstImageWriter::close() {
+    uint32_t stmtList = list(stmtOffsets);
+    stable_sort(declarations.begin(), declarations.end(),
+                [](const pair<string, uint32_t> &a, const pair<string, uint32_t> &b) { return a.first < b.first; });
+    vector<uint32_t> names;
+    for (size_t i = 0; i < declarations.size(); i++)
+        names.push_back(writeString(declarations[i].first));
+    vector<uint32_t> declarationWords{(uint32_t)declarations.size()};
+    for (size_t i = 0; i < declarations.size(); i++) {
+        declarationWords.push_back(names[i]);
+        declarationWords.push_back(declarations[i].second);
+    }
+    uint32_t declarationTable = write(declarationWords);
+
+    if (tooLarge) {
+        output.close();
+        ::unlink(filename.c_str());
+        cerr << "AstImageWriter: " << filename << " would not fit in 4 GiB and is not written" << endl;
+        return false;
+    }
+    uint32_t size = (uint32_t)offset;
+    output.seekp(8);
+    write(vector<uint32_t>{size, packageName, packageFilename, stmtList, declarationTable});
+    output.close();
+    return !output.fail();
+}
+
+uint32_t AstImageWriter::write(const vector<uint32_t> &words) {
+    if (!fits(4 * words.size()))
+        return 0;
+    uint32_t start = (uint32_t)offset;
+    string bytes;
+    bytes.reserve(4 * words.size());
+    for (size_t i = 0; i < words.size(); i++)
+        for (int b = 0; b < 4; b++)
+            bytes.push_back((char)(words[i] >> (8 * b)));
+    output.write(bytes.data(), bytes.size());
+    offset += bytes.size();
+    return start;
+}
+
+uint32_t AstImageWriter::writeString(const string &value) {
+    if (!fits(4 + value.size() + 4))
+        return 0;
+    uint32_t start = write(vector<uint32_t>{(uint32_t)value.size()});
+    string bytes(value);
+    do {
+        bytes.push_back('\0');
+    } while (bytes.size() % 4);
+    output.write(bytes.data(), bytes.size());
+    offset += bytes.size();
+    return start;
+}
+
+// whether size more bytes keep every offset within 32 bits; once one does not, nothing more is written
+bool AstImageWriter::fits(uint64_t size) {
+    if (!tooLarge && offset + size > UINT32_MAX)
+        tooLarge = true;
+    return !tooLarge;
+}
+
+uint32_t AstImageWriter::list(const vector<uint32_t> &items) {
+    if (items.empty())
+        return 0;
+    vector<uint32_t> words{(uint32_t)items.size()};
+    words.insert(words.end(), items.cbegin(), items.cend());
+    return write(words);
+}
+
+uint32_t AstImageWriter::node(AstImageNodeClass nodeClass, uint32_t kind, const bsvproto::SourcePos &sourcePos,
+                              const vector<uint32_t> &slots) {
+    uint32_t filename = 0;
+    uint32_t index = sourcePos.filename();
+    if (index && index < filenameOffsets.size()) {
+        if (!filenameOffsets[index])
+            filenameOffsets[index] = writeString(tables->filename(index));
+        filename = filenameOffsets[index];
+    }
+    vector<uint32_t> words{(uint32_t)nodeClass | kind << 8 | (uint32_t)slots.size() << 16, filename,
+                           sourcePos.linenumber()};
+    words.insert(words.end(), slots.cbegin(), slots.cend());
+    return write(words);
+}
+
+uint32_t AstImageWriter::identifier(uint32_t index) {
+    if (!index || index >= identifierOffsets.size())
+        return 0;
+    if (!identifierOffsets[index])
+        identifierOffsets[index] = writeString(tables->identifier(index));
+    return identifierOffsets[index];
+}
+
+uint32_t AstImageWriter::identifiers(const google::protobuf::RepeatedField<uint32_t> &indices) {
+    vector<uint32_t> items;
+    for (int i = 0; i < indices.size(); i++)
+        items.push_back(identifier(indices.Get(i)));
+    return list(items);
+}
+
+uint32_t AstImageWriter::type(uint32_t index) {
+    if (!index || index >= typeOffsets.size())
+        return 0;
+    if (!typeOffsets[index]) {
+        const bsvproto::BSVType &type_proto = tables->type(index);
+        uint32_t name = identifier(type_proto.name());
+        uint32_t params = types(type_proto.param());
+        uint32_t flags = (type_proto.kind() == bsvproto::Numeric ? 1 : 0) | (type_proto.isvar() ? 1 << 16 : 0);
+        typeOffsets[index] = write(vector<uint32_t>{name, flags, params});
+    }
+    return typeOffsets[index];
+}
+
+uint32_t AstImageWriter::types(const google::protobuf::RepeatedField<uint32_t> &indices) {
+    vector<uint32_t> items;
+    for (int i = 0; i < indices.size(); i++)
+        items.push_back(type(indices.Get(i)));
+    return list(items);
+}
+
+uint32_t AstImageWriter::stmts(const google::protobuf::RepeatedPtrField<bsvproto::Stmt> &stmt_protos) {
+    vector<uint32_t> items;
+    for (int i = 0; i < stmt_protos.size(); i++)
+        items.push_back(stmt(stmt_protos.Get(i)));
+    return list(items);
+}
+
+uint32_t AstImageWriter::exprs(const google::protobuf::RepeatedPtrField<bsvproto::Expr> &expr_protos) {
+    vector<uint32_t> items;
+    for (int i = 0; i < expr_protos.size(); i++)
+        items.push_back(expr(expr_protos.Get(i)));
+    return list(items);
+}
+
+uint32_t AstImageWriter::stmt(const bsvproto::Stmt &stmt_proto) {
+    const bsvproto::SourcePos *outerSourcePos = stmtSourcePos;
+    uint32_t result = writeStmt(stmt_proto);
+    stmtSourcePos = outerSourcePos;
+    return result;
+}
+
+// the slots are the fields after sourcePos, see AstImage.h
+uint32_t AstImageWriter::writeStmt(const bsvproto::Stmt &stmt_proto) {
+    uint32_t kind = stmt_proto.stmt_case();
+    switch (stmt_proto.stmt_case()) {
+        case bsvproto::Stmt::kActionBindingStmt: {
+            const bsvproto::ActionBindingStmt &p = enclosingStmt(stmt_proto.actionbindingstmt());
+            return node(StmtImageNode, kind, p.sourcepos(), {type(p.bsvtype()), identifier(p.name()), expr(p.rhs())});
+        }
+        case bsvproto::Stmt::kBlockStmt: {
+            const bsvproto::BlockStmt &p = enclosingStmt(stmt_proto.blockstmt());
+            return node(StmtImageNode, kind, p.sourcepos(), {stmts(p.stmt())});
+        }
+        case bsvproto::Stmt::kCallStmt: {
+            const bsvproto::CallStmt &p = enclosingStmt(stmt_proto.callstmt());
+            return node(StmtImageNode, kind, p.sourcepos(), {identifier(p.name()), type(p.vartype()), expr(p.rhs())});
+        }
+        case bsvproto::Stmt::kExprStmt: {
+            const bsvproto::ExprStmt &p = enclosingStmt(stmt_proto.exprstmt());
+            return node(StmtImageNode, kind, p.sourcepos(), {expr(p.expr())});
+        }
+        case bsvproto::Stmt::kForStmt: {
+            const bsvproto::ForStmt &p = enclosingStmt(stmt_proto.forstmt());
+            return node(StmtImageNode, kind, p.sourcepos(),
+                        {stmts(p.init()), expr(p.test()), stmts(p.incr()), stmt(p.body())});
+        }
+        case bsvproto::Stmt::kFunctionDefStmt: {
+            const bsvproto::FunctionDefStmt &p = enclosingStmt(stmt_proto.functiondefstmt());
+            return node(StmtImageNode, kind, p.sourcepos(),
+                        {identifier(p.package()), identifier(p.name()), type(p.returntype()), types(p.paramtype()),
+                         identifiers(p.paramname()), expr(p.guard()), stmts(p.stmt())});
+        }
+        case bsvproto::Stmt::kIfStmt: {
+            const bsvproto::IfStmt &p = enclosingStmt(stmt_proto.ifstmt());
+            return node(StmtImageNode, kind, p.sourcepos(),
+                        {expr(p.condition()), stmt(p.thenstmt()), stmt(p.elsestmt())});
+        }
+        case bsvproto::Stmt::kImportStmt: {
+            const bsvproto::ImportStmt &p = enclosingStmt(stmt_proto.importstmt());
+            return node(StmtImageNode, kind, p.sourcepos(), {identifier(p.name())});
+        }
+        case bsvproto::Stmt::kInterfaceDeclStmt: {
+            const bsvproto::InterfaceDeclStmt &p = enclosingStmt(stmt_proto.interfacedeclstmt());
+            return node(StmtImageNode, kind, p.sourcepos(),
+                        {identifier(p.package()), identifier(p.name()), type(p.interfacetype()), stmts(p.decl())});
+        }
+        case bsvproto::Stmt::kInterfaceDefStmt: {
+            const bsvproto::InterfaceDefStmt &p = enclosingStmt(stmt_proto.interfacedefstmt());
+            return node(StmtImageNode, kind, p.sourcepos(),
+                        {identifier(p.package()), identifier(p.name()), type(p.interfacetype()), stmts(p.def())});
+        }
+        case bsvproto::Stmt::kMethodDeclStmt: {
+            const bsvproto::MethodDeclStmt &p = enclosingStmt(stmt_proto.methoddeclstmt());
+            return node(StmtImageNode, kind, p.sourcepos(),
+                        {identifier(p.name()), type(p.returntype()), types(p.paramtype()), identifiers(p.paramname())});
+        }
+        case bsvproto::Stmt::kMethodDefStmt: {
+            const bsvproto::MethodDefStmt &p = enclosingStmt(stmt_proto.methoddefstmt());
+            return node(StmtImageNode, kind, p.sourcepos(),
+                        {identifier(p.name()), type(p.returntype()), types(p.paramtype()), identifiers(p.paramname()),
+                         expr(p.guard()), stmts(p.stmt())});
+        }
+        case bsvproto::Stmt::kModuleDefStmt: {
+            const bsvproto::ModuleDefStmt &p = enclosingStmt(stmt_proto.moduledefstmt());
+            return node(StmtImageNode, kind, p.sourcepos(),
+                        {identifier(p.package()), identifier(p.name()), type(p.returntype()), types(p.paramtype()),
+                         identifiers(p.paramname()), stmts(p.stmt())});
+        }
+        case bsvproto::Stmt::kModuleInstStmt: {
+            const bsvproto::ModuleInstStmt &p = enclosingStmt(stmt_proto.moduleinststmt());
+            return node(StmtImageNode, kind, p.sourcepos(), {identifier(p.name()), type(p.vartype()), expr(p.rhs())});
+        }
+        case bsvproto::Stmt::kPatternMatchStmt: {
+            const bsvproto::PatternMatchStmt &p = enclosingStmt(stmt_proto.patternmatchstmt());
+            return node(StmtImageNode, kind, p.sourcepos(), {pattern(p.pattern()), (uint32_t)p.op(), expr(p.expr())});
+        }
+        case bsvproto::Stmt::kRegisterStmt: {
+            const bsvproto::RegisterStmt &p = enclosingStmt(stmt_proto.registerstmt());
+            return node(StmtImageNode, kind, p.sourcepos(), {identifier(p.regname()), type(p.elementtype())});
+        }
+        case bsvproto::Stmt::kRegReadStmt: {
+            const bsvproto::RegReadStmt &p = enclosingStmt(stmt_proto.regreadstmt());
+            return node(StmtImageNode, kind, p.sourcepos(),
+                        {identifier(p.regname()), identifier(p.varname()), type(p.elementtype())});
+        }
+        case bsvproto::Stmt::kRegWriteStmt: {
+            const bsvproto::RegWriteStmt &p = enclosingStmt(stmt_proto.regwritestmt());
+            return node(StmtImageNode, kind, p.sourcepos(),
+                        {identifier(p.regname()), type(p.elementtype()), expr(p.rhs())});
+        }
+        case bsvproto::Stmt::kReturnStmt: {
+            const bsvproto::ReturnStmt &p = enclosingStmt(stmt_proto.returnstmt());
+            return node(StmtImageNode, kind, p.sourcepos(), {type(p.returntype()), expr(p.returnexpr())});
+        }
+        case bsvproto::Stmt::kRuleDefStmt: {
+            const bsvproto::RuleDefStmt &p = enclosingStmt(stmt_proto.ruledefstmt());
+            return node(StmtImageNode, kind, p.sourcepos(), {identifier(p.name()), expr(p.guard()), stmts(p.stmt())});
+        }
+        case bsvproto::Stmt::kTypedefEnumStmt: {
+            const bsvproto::TypedefEnumStmt &p = enclosingStmt(stmt_proto.typedefenumstmt());
+            return node(StmtImageNode, kind, p.sourcepos(),
+                        {identifier(p.package()), identifier(p.name()), type(p.enumtype()), identifiers(p.member())});
+        }
+        case bsvproto::Stmt::kTypedefStructStmt: {
+            const bsvproto::TypedefStructStmt &p = enclosingStmt(stmt_proto.typedefstructstmt());
+            return node(StmtImageNode, kind, p.sourcepos(),
+                        {identifier(p.package()), identifier(p.name()), type(p.structtype()), identifiers(p.member()),
+                         types(p.membertype())});
+        }
+        case bsvproto::Stmt::kTypedefSynonymStmt: {
+            const bsvproto::TypedefSynonymStmt &p = enclosingStmt(stmt_proto.typedefsynonymstmt());
+            return node(StmtImageNode, kind, p.sourcepos(),
+                        {identifier(p.package()), identifier(p.name()), type(p.synonymtype()), type(p.type())});
+        }
+        case bsvproto::Stmt::kVarBindingStmt: {
+            const bsvproto::VarBindingStmt &p = enclosingStmt(stmt_proto.varbindingstmt());
+            return node(StmtImageNode, kind, p.sourcepos(),
+                        {identifier(p.package()), type(p.bsvtype()), identifier(p.name()), (uint32_t)p.op(),
+                         expr(p.rhs())});
+        }
+        case bsvproto::Stmt::kVarAssignStmt: {
+            const bsvproto::VarAssignStmt &p = enclosingStmt(stmt_proto.varassignstmt());
+            return node(StmtImageNode, kind, p.sourcepos(), {lvalue(p.lvalue()), (uint32_t)p.op(), expr(p.rhs())});
+        }
+        case bsvproto::Stmt::kWhileStmt: {
+            const bsvproto::WhileStmt &p = enclosingStmt(stmt_proto.whilestmt());
+            return node(StmtImageNode, kind, p.sourcepos(), {expr(p.test()), stmt(p.body())});
+        }
+        case bsvproto::Stmt::STMT_NOT_SET:
+            break;
+    }
+    return 0;
+}
+
+uint32_t AstImageWriter::expr(const bsvproto::Expr &expr_proto) {
+    uint32_t kind = expr_proto.expr_case();
+    switch (expr_proto.expr_case()) {
+        case bsvproto::Expr::kFieldExpr: {
+            const bsvproto::FieldExpr &p = expr_proto.fieldexpr();
+            return node(ExprImageNode, kind, exprSourcePos(p),
+                        {type(p.bsvtype()), expr(p.object()), identifier(p.fieldname())});
+        }
+        case bsvproto::Expr::kVarExpr: {
+            const bsvproto::VarExpr &p = expr_proto.varexpr();
+            return node(ExprImageNode, kind, exprSourcePos(p),
+                        {type(p.bsvtype()), identifier(p.sourcename()), identifier(p.uniquename())});
+        }
+        case bsvproto::Expr::kBitConcatExpr: {
+            const bsvproto::BitConcatExpr &p = expr_proto.bitconcatexpr();
+            return node(ExprImageNode, kind, exprSourcePos(p), {type(p.bsvtype()), exprs(p.value())});
+        }
+        case bsvproto::Expr::kBitSelExpr: {
+            const bsvproto::BitSelExpr &p = expr_proto.bitselexpr();
+            return node(ExprImageNode, kind, exprSourcePos(p),
+                        {type(p.bsvtype()), expr(p.value()), expr(p.msb()), expr(p.lsb())});
+        }
+        case bsvproto::Expr::kCallExpr: {
+            const bsvproto::CallExpr &p = expr_proto.callexpr();
+            return node(ExprImageNode, kind, exprSourcePos(p), {type(p.bsvtype()), expr(p.function()), exprs(p.arg())});
+        }
+        case bsvproto::Expr::kCaseExpr: {
+            const bsvproto::CaseExpr &p = expr_proto.caseexpr();
+            vector<uint32_t> items;
+            for (int i = 0; i < p.expritem_size(); i++)
+                items.push_back(caseExprItem(p.expritem(i)));
+            return node(ExprImageNode, kind, exprSourcePos(p), {type(p.bsvtype()), expr(p.matchvalue()), list(items)});
+        }
+        case bsvproto::Expr::kCondExpr: {
+            const bsvproto::CondExpr &p = expr_proto.condexpr();
+            return node(ExprImageNode, kind, exprSourcePos(p),
+                        {type(p.bsvtype()), expr(p.cond()), expr(p.thenexpr()), expr(p.elseexpr())});
+        }
+        case bsvproto::Expr::kIntConst: {
+            const bsvproto::IntConst &p = expr_proto.intconst();
+            return node(ExprImageNode, kind, exprSourcePos(p),
+                        {type(p.bsvtype()), p.value(), p.base(), p.width(), identifier(p.repr())});
+        }
+        case bsvproto::Expr::kInterfaceExpr: {
+            const bsvproto::InterfaceExpr &p = expr_proto.interfaceexpr();
+            return node(ExprImageNode, kind, exprSourcePos(p), {type(p.bsvtype())});
+        }
+        case bsvproto::Expr::kStringConst: {
+            const bsvproto::StringConst &p = expr_proto.stringconst();
+            return node(ExprImageNode, kind, exprSourcePos(p), {type(p.bsvtype()), identifier(p.value())});
+        }
+        case bsvproto::Expr::kMatchesExpr: {
+            const bsvproto::MatchesExpr &p = expr_proto.matchesexpr();
+            return node(ExprImageNode, kind, exprSourcePos(p),
+                        {type(p.bsvtype()), expr(p.expr()), pattern(p.pattern()), exprs(p.patterncond())});
+        }
+        case bsvproto::Expr::kMethodExpr: {
+            const bsvproto::MethodExpr &p = expr_proto.methodexpr();
+            return node(ExprImageNode, kind, exprSourcePos(p),
+                        {type(p.bsvtype()), expr(p.object()), identifier(p.methodname())});
+        }
+        case bsvproto::Expr::kOperatorExpr: {
+            const bsvproto::OperatorExpr &p = expr_proto.operatorexpr();
+            return node(ExprImageNode, kind, exprSourcePos(p),
+                        {type(p.bsvtype()), identifier(p.op()), expr(p.lhs()), expr(p.rhs())});
+        }
+        case bsvproto::Expr::kArraySubExpr: {
+            const bsvproto::ArraySubExpr &p = expr_proto.arraysubexpr();
+            return node(ExprImageNode, kind, exprSourcePos(p), {type(p.bsvtype()), expr(p.array()), expr(p.index())});
+        }
+        case bsvproto::Expr::kEnumUnionStructExpr: {
+            const bsvproto::EnumUnionStructExpr &p = expr_proto.enumunionstructexpr();
+            return node(ExprImageNode, kind, exprSourcePos(p),
+                        {type(p.bsvtype()), identifier(p.tag()), identifiers(p.key()), exprs(p.val())});
+        }
+        case bsvproto::Expr::kSubinterfaceExpr: {
+            const bsvproto::SubinterfaceExpr &p = expr_proto.subinterfaceexpr();
+            return node(ExprImageNode, kind, exprSourcePos(p),
+                        {type(p.bsvtype()), expr(p.object()), identifier(p.subinterfacename())});
+        }
+        case bsvproto::Expr::kValueofExpr: {
+            const bsvproto::ValueofExpr &p = expr_proto.valueofexpr();
+            return node(ExprImageNode, kind, exprSourcePos(p), {type(p.bsvtype()), type(p.argtype())});
+        }
+        case bsvproto::Expr::EXPR_NOT_SET:
+            break;
+    }
+    return 0;
+}
+
+uint32_t AstImageWriter::caseExprItem(const bsvproto::CaseExprItem &item_proto) {
+    return node(CaseExprItemImageNode, 0, exprSourcePos(item_proto),
+                {exprs(item_proto.exprmatch()), item_proto.has_patternmatch() ? pattern(item_proto.patternmatch()) : 0,
+                 exprs(item_proto.patterncond()), expr(item_proto.expr())});
+}
+
+uint32_t AstImageWriter::lvalue(const bsvproto::LValue &lvalue_proto) {
+    uint32_t kind = lvalue_proto.lvalue_case();
+    switch (lvalue_proto.lvalue_case()) {
+        case bsvproto::LValue::kArray: {
+            const bsvproto::ArraySubLValue &p = lvalue_proto.array();
+            return node(LValueImageNode, kind, p.sourcepos(), {expr(p.array()), expr(p.index())});
+        }
+        case bsvproto::LValue::kField: {
+            const bsvproto::FieldLValue &p = lvalue_proto.field();
+            return node(LValueImageNode, kind, p.sourcepos(), {expr(p.obj()), identifier(p.field())});
+        }
+        case bsvproto::LValue::kVar: {
+            const bsvproto::VarLValue &p = lvalue_proto.var();
+            return node(LValueImageNode, kind, p.sourcepos(), {identifier(p.name()), type(p.bsvtype())});
+        }
+        case bsvproto::LValue::kRange: {
+            const bsvproto::RangeSelLValue &p = lvalue_proto.range();
+            return node(LValueImageNode, kind, p.sourcepos(), {expr(p.array()), expr(p.lsb()), expr(p.msb())});
+        }
+        case bsvproto::LValue::LVALUE_NOT_SET:
+            break;
+    }
+    return 0;
+}
+
+uint32_t AstImageWriter::pattern(const bsvproto::Pattern &pattern_proto) {
+    if (pattern_proto.has_intpattern()) {
+        const bsvproto::IntPattern &p = pattern_proto.intpattern();
+        return node(PatternImageNode, 1, p.sourcepos(), {p.value()});
+    } else if (pattern_proto.has_taggedpattern()) {
+        const bsvproto::TaggedPattern &p = pattern_proto.taggedpattern();
+        return node(PatternImageNode, 2, p.sourcepos(),
+                    {identifier(p.name()), p.has_pattern() ? pattern(p.pattern()) : 0});
+    } else if (pattern_proto.has_tuplepattern()) {
+        const bsvproto::TuplePattern &p = pattern_proto.tuplepattern();
+        vector<uint32_t> items;
+        for (int i = 0; i < p.subpattern_size(); i++)
+            items.push_back(pattern(p.subpattern(i)));
+        return node(PatternImageNode, 3, p.sourcepos(), {list(items)});
+    } else if (pattern_proto.has_varpattern()) {
+        const bsvproto::VarPattern &p = pattern_proto.varpattern();
+        return node(PatternImageNode, 4, p.sourcepos(), {identifier(p.name())});
+    } else if (pattern_proto.has_wildcardpattern()) {
+        return node(PatternImageNode, 5, pattern_proto.wildcardpattern().sourcepos(), {});
+    }
+    return 0;
+}
+
+bool AstImage::open(const string &filename) {
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cerr << "AstImage: cannot open " << filename << endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < headerSize) {
+        cerr << "AstImage: " << filename << " is too short" << endl;
+        ::close(fd);
+        return false;
+    }
+    void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        cerr << "AstImage: cannot map " << filename << endl;
+        return false;
+    }
+    base = (const char *)mapped;
+    size = st.st_size;
+    if (memcmp(base, imageMagic, 8) != 0 || word(8) != size) {
+        cerr << "AstImage: " << filename << " is not an AST image" << endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void AstImage::close() {
+    if (base)
+        munmap((void *)base, size);
+    base = nullptr;
+    size = 0;
+}
+
+uint32_t AstImage::word(uint32_t offset) const {
+    if (!base || !offset || offset % 4 || (size_t)offset + 4 > size)
+        return 0;
+    const unsigned char *p = (const unsigned char *)base + offset;
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+const char *AstImage::text(uint32_t offset) const {
+    uint32_t length = word(offset);
+    if (!offset || (size_t)offset + 4 + length >= size)
+        return "";
+    return base + offset + 4;
+}
+
+const char *AstImage::packageName() const { return text(word(12)); }
+
+const char *AstImage::filename() const { return text(word(16)); }
+
+uint32_t AstImage::numStmts() const { return word(word(20)); }
+
+AstImageNode AstImage::stmt(uint32_t i) const {
+    uint32_t stmts = word(20);
+    if (i >= word(stmts))
+        return AstImageNode();
+    return AstImageNode(this, word(stmts + 4 + 4 * i));
+}
+
+uint32_t AstImage::numDeclarations() const { return word(word(24)); }
+
+const char *AstImage::declarationName(uint32_t i) const {
+    uint32_t declarations = word(24);
+    if (i >= word(declarations))
+        return "";
+    return text(word(declarations + 4 + 8 * i));
+}
+
+AstImageNode AstImage::declaration(uint32_t i) const {
+    uint32_t declarations = word(24);
+    if (i >= word(declarations))
+        return AstImageNode();
+    return AstImageNode(this, word(declarations + 8 + 8 * i));
+}
+
+AstImageNode AstImage::lookup(const string &name) const {
+    uint32_t lo = 0, hi = numDeclarations();
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (strcmp(declarationName(mid), name.c_str()) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < numDeclarations() && name == declarationName(lo))
+        return declaration(lo);
+    return AstImageNode();
+}
+
+uint32_t AstImageNode::header() const { return image ? image->word(offset) : 0; }
+
+const char *AstImageNode::filename() const { return image ? image->text(image->word(offset + 4)) : ""; }
+
+uint32_t AstImageNode::line() const { return image ? image->word(offset + 8) : 0; }
+
+uint32_t AstImageNode::slot(uint32_t i) const {
+    if (i >= numSlots())
+        return 0;
+    return image->word(offset + 12 + 4 * i);
+}
+
+AstImageNode AstImageNode::child(uint32_t i) const { return AstImageNode(image, slot(i)); }
+
+const char *AstImageNode::text(uint32_t i) const { return image ? image->text(slot(i)) : ""; }
+
+AstImageType AstImageNode::type(uint32_t i) const { return AstImageType(image, slot(i)); }
+
+uint32_t AstImageNode::listSize(uint32_t i) const { return image ? image->word(slot(i)) : 0; }
+
+uint32_t AstImageNode::listItem(uint32_t i, uint32_t j) const {
+    uint32_t list = slot(i);
+    if (j >= listSize(i))
+        return 0;
+    return image->word(list + 4 + 4 * j);
+}
+
+AstImageNode AstImageNode::listChild(uint32_t i, uint32_t j) const { return AstImageNode(image, listItem(i, j)); }
+
+const char *AstImageNode::listText(uint32_t i, uint32_t j) const { return image ? image->text(listItem(i, j)) : ""; }
+
+AstImageType AstImageNode::listType(uint32_t i, uint32_t j) const { return AstImageType(image, listItem(i, j)); }
+
+const char *AstImageType::name() const { return image ? image->text(image->word(offset)) : ""; }
+
+bool AstImageType::isNumeric() const { return image && (image->word(offset + 4) & 0xffff) == 1; }
+
+bool AstImageType::isVar() const { return image && (image->word(offset + 4) >> 16) != 0; }
+
+uint32_t AstImageType::numParams() const { return image ? image->word(image->word(offset + 8)) : 0; }
+
+AstImageType AstImageType::param(uint32_t i) const {
+    if (i >= numParams())
+        return AstImageType();
+    return AstImageType(image, image->word(image->word(offset + 8) + 4 + 4 * i));
+}
+
+string AstImageType::to_string() const {
+    string result(name());
+    if (numParams()) {
+        result += "#(";
+        for (uint32_t i = 0; i < numParams(); i++) {
+            if (i)
+                result += ", ";
+            result += param(i).to_string();
+        }
+        result += ")";
+    }
+    return result;
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "expr.pb.h"
+#include "lvalue.pb.h"
+#include "pattern.pb.h"
+#include "stmt.pb.h"
+
+using namespace std;
+
+// A flat, position-independent image of a package, for tools that only look at a few
+// declarations. The file is mmapped and read in place, so opening it costs nothing and
+// only the pages that are traversed are read.
+//
+// The image has the node model of the .ast files: the kind of a node is the field number
+// of its case in the Stmt, Expr or LValue oneof, or of its field in Pattern, and slot i
+// of a node holds field i + 2 of the message of that kind, field 1 being the source
+// position. CaseExprItem, which has its source position last, keeps its fields 1 to 4 in
+// slots 0 to 3. A slot holds
+//  - for identifiers and other strings, the offset of the string,
+//  - for types, the offset of the type,
+//  - for nodes, the offset of the node,
+//  - for repeated fields, the offset of a list,
+//  - numbers and BindingOps as they are.
+// Offset 0 stands for the empty string, the missing type or node and the empty list.
+//
+// Everything is made of little-endian uint32s, 4-byte aligned, and every offset is from
+// the start of the file:
+//   header:      "BSVIMG01", size, package name, file name, stmts, declarations
+//   string:      size, the bytes, '\0', padding
+//   type:        name, kind (0 symbolic, 1 numeric) | isVar << 16, params
+//   list:        count, items
+//   node:        class | kind << 8 | numSlots << 16, file name, line, slots
+//   declarations: count, then a (name, stmt) pair per top-level declaration, sorted by name
+// Children are written before their parents, so the image can be streamed out as the
+// AstWriter converts each top-level statement.
+enum AstImageNodeClass {
+    InvalidImageNode,
+    StmtImageNode,
+    ExprImageNode,
+    LValueImageNode,
+    PatternImageNode,
+    CaseExprItemImageNode
+};
+
+// Written by AstWriter next to the .ast file, see AstWriter::setImageWriter.
+class AstImageWriter {
+private:
+    ofstream output;
+    string filename;
+    // kept wide to notice an image outgrowing its 32-bit offsets
+    uint64_t offset = 0;
+    bool tooLarge = false;
+    const bsvproto::AstIndex *tables = nullptr;
+    // offsets of the entries of the tables of the .ast file that are already written
+    vector<uint32_t> identifierOffsets;
+    vector<uint32_t> filenameOffsets;
+    vector<uint32_t> typeOffsets;
+    uint32_t packageName = 0;
+    uint32_t packageFilename = 0;
+    vector<uint32_t> stmtOffsets;
+    vector<pair<string, uint32_t>> declarations;
+    // position of the statement being written, for the expressions that share it
+    const bsvproto::SourcePos *stmtSourcePos = nullptr;
+
+    bool fits(uint64_t size);
+    uint32_t write(const vector<uint32_t> &words);
+    uint32_t writeString(const string &value);
+    uint32_t list(const vector<uint32_t> &items);
+    uint32_t node(AstImageNodeClass nodeClass, uint32_t kind, const bsvproto::SourcePos &sourcePos,
+                  const vector<uint32_t> &slots);
+
+    uint32_t identifier(uint32_t index);
+    uint32_t identifiers(const google::protobuf::RepeatedField<uint32_t> &indices);
+    uint32_t type(uint32_t index);
+    uint32_t types(const google::protobuf::RepeatedField<uint32_t> &indices);
+    uint32_t stmt(const bsvproto::Stmt &stmt_proto);
+    uint32_t writeStmt(const bsvproto::Stmt &stmt_proto);
+    uint32_t stmts(const google::protobuf::RepeatedPtrField<bsvproto::Stmt> &stmt_protos);
+    uint32_t expr(const bsvproto::Expr &expr_proto);
+    uint32_t exprs(const google::protobuf::RepeatedPtrField<bsvproto::Expr> &expr_protos);
+    uint32_t caseExprItem(const bsvproto::CaseExprItem &item_proto);
+
+    template <typename StmtProto>
+    const StmtProto &enclosingStmt(const StmtProto &proto) {
+        stmtSourcePos = &proto.sourcepos();
+        return proto;
+    }
+
+    template <typename ExprProto>
+    const bsvproto::SourcePos &exprSourcePos(const ExprProto &proto) {
+        return proto.has_sourcepos() || !stmtSourcePos ? proto.sourcepos() : *stmtSourcePos;
+    }
+    uint32_t lvalue(const bsvproto::LValue &lvalue_proto);
+    uint32_t pattern(const bsvproto::Pattern &pattern_proto);
+
+public:
+    AstImageWriter() {}
+    ~AstImageWriter() {}
+
+    bool open(const string &filename);
+
+    void addPackage(const string &name, const string &filename);
+
+    // tables are those of the .ast file the statement was converted for
+    void addStmt(const bsvproto::Stmt &stmt_proto, const string &declarationName, const bsvproto::AstIndex &tables);
+
+    // writes the declarations and the header; an image past 4 GiB is removed instead
+    bool close();
+};
+
+class AstImage;
+
+class AstImageType {
+    const AstImage *image;
+    uint32_t offset;
+public:
+    AstImageType(const AstImage *image = nullptr, uint32_t offset = 0) : image(image), offset(offset) {}
+
+    explicit operator bool() const { return offset != 0; }
+    const char *name() const;
+    bool isNumeric() const;
+    bool isVar() const;
+    uint32_t numParams() const;
+    AstImageType param(uint32_t i) const;
+    string to_string() const;
+};
+
+// A node of a mapped image, valid as long as the image stays open.
+class AstImageNode {
+    const AstImage *image;
+    uint32_t offset;
+
+    uint32_t header() const;
+public:
+    AstImageNode(const AstImage *image = nullptr, uint32_t offset = 0) : image(image), offset(offset) {}
+
+    explicit operator bool() const { return offset != 0; }
+    uint32_t position() const { return offset; }
+    AstImageNodeClass nodeClass() const { return (AstImageNodeClass)(header() & 0xff); }
+    uint32_t kind() const { return (header() >> 8) & 0xff; }
+    uint32_t numSlots() const { return header() >> 16; }
+    const char *filename() const;
+    uint32_t line() const;
+
+    // the raw slot, a number or an offset
+    uint32_t slot(uint32_t i) const;
+    AstImageNode child(uint32_t i) const;
+    const char *text(uint32_t i) const;
+    AstImageType type(uint32_t i) const;
+    // for slots holding lists
+    uint32_t listSize(uint32_t i) const;
+    uint32_t listItem(uint32_t i, uint32_t j) const;
+    AstImageNode listChild(uint32_t i, uint32_t j) const;
+    const char *listText(uint32_t i, uint32_t j) const;
+    AstImageType listType(uint32_t i, uint32_t j) const;
+};
+
+// A read-only mapping of an image. Offsets are checked against the size of the file, a
+// bad one reading as 0.
+class AstImage {
+    const char *base = nullptr;
+    size_t size = 0;
+
+public:
+    AstImage() {}
+    ~AstImage() { close(); }
+
+    bool open(const string &filename);
+    void close();
+
+    const char *packageName() const;
+    const char *filename() const;
+
+    // the top-level statements, in package order
+    uint32_t numStmts() const;
+    AstImageNode stmt(uint32_t i) const;
+
+    uint32_t numDeclarations() const;
+    const char *declarationName(uint32_t i) const;
+    AstImageNode declaration(uint32_t i) const;
+    // the first declaration of name, by binary search
+    AstImageNode lookup(const string &name) const;
+
+    uint32_t word(uint32_t offset) const;
+    const char *text(uint32_t offset) const;
+
+private:
+    AstImage(const AstImage &) = delete;
+    AstImage &operator=(const AstImage &) = delete;
+};
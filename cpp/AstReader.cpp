@@ -0,0 +1,464 @@
+#include <iostream>
+
+#include "AstReader.h"
+
+AstReader::AstReader() {}
+
+AstReader::~AstReader() {}
+
+bool AstReader::open(const std::string &filename) {
+    this->filename = filename;
+    input.open(filename, ios::in | ios::binary);
+    if (!input.good()) {
+        cerr << "AstReader: cannot open " << filename << endl;
+        return false;
+    }
+    input.seekg(0, ios::end);
+    fileSize = (uint64_t)input.tellg();
+    input.seekg(0);
+    char magic[8];
+    input.read(magic, sizeof(magic));
+    if (!input.good() || string(magic, sizeof(magic)) != "BSVAST02") {
+        cerr << "AstReader: " << filename << " is not an AST file" << endl;
+        return false;
+    }
+    if (!readRecord(&packagedef_proto)) {
+        cerr << "AstReader: " << filename << " has no package header" << endl;
+        return false;
+    }
+
+    char trailer[16];
+    input.seekg(-(int)sizeof(trailer), ios::end);
+    input.read(trailer, sizeof(trailer));
+    if (!input.good() || string(trailer + 8, 8) != "BSVASTIX") {
+        cerr << "AstReader: " << filename << " has no index" << endl;
+        return false;
+    }
+    uint64_t indexOffset = 0;
+    for (int i = 0; i < 8; i++)
+        indexOffset |= (uint64_t)(unsigned char)trailer[i] << (8 * i);
+    if (indexOffset < fileSize)
+        input.seekg(indexOffset);
+    if (indexOffset >= fileSize || !readRecord(&index_proto)) {
+        cerr << "AstReader: cannot read the index of " << filename << endl;
+        return false;
+    }
+    types.assign(index_proto.type_size(), shared_ptr<BSVType>());
+    return true;
+}
+
+void AstReader::close() {
+    input.close();
+}
+
+// a varint length followed by the serialized message, see AstWriter::writeRecord;
+// the length is checked against the rest of the file before allocating the record
+bool AstReader::readRecord(google::protobuf::MessageLite *message) {
+    uint64_t size = 0;
+    int shift = 0;
+    while (true) {
+        int c = input.get();
+        if (c == EOF || shift > 63)
+            return false;
+        size |= (uint64_t)(c & 0x7f) << shift;
+        shift += 7;
+        if (!(c & 0x80))
+            break;
+    }
+    streamoff position = input.tellg();
+    if (position < 0 || size > fileSize - (uint64_t)position)
+        return false;
+    string record(size, '\0');
+    input.read(&record[0], size);
+    if (!input.good())
+        return false;
+    return message->ParseFromString(record);
+}
+
+shared_ptr<PackageDefStmt> AstReader::readPackageDef() {
+    vector<shared_ptr<Stmt>> package_stmts;
+    for (int i = 0; i < index_proto.entry_size(); i++) {
+        const bsvproto::AstIndexEntry &entry_proto = index_proto.entry(i);
+        bsvproto::Stmt stmt_proto;
+        input.seekg(entry_proto.offset());
+        if (!readRecord(&stmt_proto)) {
+            cerr << "AstReader: cannot read statement " << i << " of " << filename << endl;
+            return shared_ptr<PackageDefStmt>();
+        }
+        package_stmts.push_back(stmt(stmt_proto));
+    }
+    return makeAst<PackageDefStmt>(packagedef_proto.name(), package_stmts, sourcePos(packagedef_proto.sourcepos()));
+}
+
+vector<shared_ptr<Stmt>> AstReader::readDeclarations(const std::string &name) {
+    vector<shared_ptr<Stmt>> decls;
+    for (int i = 0; i < index_proto.entry_size(); i++) {
+        const bsvproto::AstIndexEntry &entry_proto = index_proto.entry(i);
+        if (entry_proto.name() != name)
+            continue;
+        bsvproto::Stmt stmt_proto;
+        input.seekg(entry_proto.offset());
+        if (readRecord(&stmt_proto))
+            decls.push_back(stmt(stmt_proto));
+    }
+    return decls;
+}
+
+shared_ptr<Stmt> AstReader::stmt(const bsvproto::Stmt &stmt_proto) {
+    const bsvproto::SourcePos *outerSourcePos = stmtSourcePos;
+    shared_ptr<Stmt> result = readStmt(stmt_proto);
+    stmtSourcePos = outerSourcePos;
+    return result;
+}
+
+shared_ptr<Stmt> AstReader::readStmt(const bsvproto::Stmt &stmt_proto) {
+    switch (stmt_proto.stmt_case()) {
+        case bsvproto::Stmt::kActionBindingStmt: {
+            const bsvproto::ActionBindingStmt &proto = enclosingStmt(stmt_proto.actionbindingstmt());
+            return makeAst<ActionBindingStmt>(bsvtype(proto.bsvtype()), identifier(proto.name()), expr(proto.rhs()),
+                                              sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kBlockStmt: {
+            const bsvproto::BlockStmt &proto = enclosingStmt(stmt_proto.blockstmt());
+            return makeAst<BlockStmt>(stmts(proto.stmt()), sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kCallStmt: {
+            const bsvproto::CallStmt &proto = enclosingStmt(stmt_proto.callstmt());
+            return makeAst<CallStmt>(identifier(proto.name()), bsvtype(proto.vartype()), expr(proto.rhs()),
+                                     sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kExprStmt: {
+            const bsvproto::ExprStmt &proto = enclosingStmt(stmt_proto.exprstmt());
+            return makeAst<ExprStmt>(expr(proto.expr()), sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kForStmt: {
+            const bsvproto::ForStmt &proto = enclosingStmt(stmt_proto.forstmt());
+            return makeAst<ForStmt>(stmts(proto.init()), expr(proto.test()), stmts(proto.incr()), stmt(proto.body()),
+                                    sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kFunctionDefStmt: {
+            const bsvproto::FunctionDefStmt &proto = enclosingStmt(stmt_proto.functiondefstmt());
+            return makeAst<FunctionDefStmt>(identifier(proto.package()), identifier(proto.name()),
+                                            bsvtype(proto.returntype()),
+                                            identifiers(proto.paramname()), bsvtypes(proto.paramtype()),
+                                            expr(proto.guard()), stmts(proto.stmt()), sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kIfStmt: {
+            const bsvproto::IfStmt &proto = enclosingStmt(stmt_proto.ifstmt());
+            return makeAst<IfStmt>(expr(proto.condition()), stmt(proto.thenstmt()), stmt(proto.elsestmt()),
+                                   sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kImportStmt: {
+            const bsvproto::ImportStmt &proto = enclosingStmt(stmt_proto.importstmt());
+            return makeAst<ImportStmt>(identifier(proto.name()), sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kInterfaceDeclStmt: {
+            const bsvproto::InterfaceDeclStmt &proto = enclosingStmt(stmt_proto.interfacedeclstmt());
+            return makeAst<InterfaceDeclStmt>(identifier(proto.package()), identifier(proto.name()),
+                                              bsvtype(proto.interfacetype()), stmts(proto.decl()),
+                                              sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kInterfaceDefStmt: {
+            const bsvproto::InterfaceDefStmt &proto = enclosingStmt(stmt_proto.interfacedefstmt());
+            return makeAst<InterfaceDefStmt>(identifier(proto.package()), identifier(proto.name()),
+                                             bsvtype(proto.interfacetype()), stmts(proto.def()),
+                                             sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kMethodDeclStmt: {
+            const bsvproto::MethodDeclStmt &proto = enclosingStmt(stmt_proto.methoddeclstmt());
+            return makeAst<MethodDeclStmt>(identifier(proto.name()), bsvtype(proto.returntype()),
+                                           identifiers(proto.paramname()), bsvtypes(proto.paramtype()),
+                                           sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kMethodDefStmt: {
+            const bsvproto::MethodDefStmt &proto = enclosingStmt(stmt_proto.methoddefstmt());
+            return makeAst<MethodDefStmt>(identifier(proto.name()), bsvtype(proto.returntype()),
+                                          identifiers(proto.paramname()), bsvtypes(proto.paramtype()),
+                                          expr(proto.guard()), stmts(proto.stmt()), sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kModuleDefStmt: {
+            const bsvproto::ModuleDefStmt &proto = enclosingStmt(stmt_proto.moduledefstmt());
+            return makeAst<ModuleDefStmt>(identifier(proto.package()), identifier(proto.name()),
+                                          bsvtype(proto.returntype()),
+                                          identifiers(proto.paramname()), bsvtypes(proto.paramtype()),
+                                          stmts(proto.stmt()), sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kModuleInstStmt: {
+            const bsvproto::ModuleInstStmt &proto = enclosingStmt(stmt_proto.moduleinststmt());
+            return makeAst<ModuleInstStmt>(identifier(proto.name()), bsvtype(proto.vartype()), expr(proto.rhs()),
+                                           sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kPatternMatchStmt: {
+            const bsvproto::PatternMatchStmt &proto = enclosingStmt(stmt_proto.patternmatchstmt());
+            return makeAst<PatternMatchStmt>(pattern(proto.pattern()), bindingOp(proto.op()), expr(proto.expr()),
+                                             sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kRegisterStmt: {
+            const bsvproto::RegisterStmt &proto = enclosingStmt(stmt_proto.registerstmt());
+            return makeAst<RegisterStmt>(identifier(proto.regname()), bsvtype(proto.elementtype()),
+                                         sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kRegReadStmt: {
+            const bsvproto::RegReadStmt &proto = enclosingStmt(stmt_proto.regreadstmt());
+            return makeAst<RegReadStmt>(identifier(proto.regname()), identifier(proto.varname()),
+                                        bsvtype(proto.elementtype()), sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kRegWriteStmt: {
+            const bsvproto::RegWriteStmt &proto = enclosingStmt(stmt_proto.regwritestmt());
+            return makeAst<RegWriteStmt>(identifier(proto.regname()), bsvtype(proto.elementtype()),
+                                         expr(proto.rhs()), sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kReturnStmt: {
+            const bsvproto::ReturnStmt &proto = enclosingStmt(stmt_proto.returnstmt());
+            return makeAst<ReturnStmt>(expr(proto.returnexpr()), sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kRuleDefStmt: {
+            const bsvproto::RuleDefStmt &proto = enclosingStmt(stmt_proto.ruledefstmt());
+            return makeAst<RuleDefStmt>(identifier(proto.name()), expr(proto.guard()), stmts(proto.stmt()),
+                                        sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kTypedefEnumStmt: {
+            const bsvproto::TypedefEnumStmt &proto = enclosingStmt(stmt_proto.typedefenumstmt());
+            return makeAst<TypedefEnumStmt>(identifier(proto.package()), identifier(proto.name()),
+                                            bsvtype(proto.enumtype()), identifiers(proto.member()),
+                                            sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kTypedefStructStmt: {
+            const bsvproto::TypedefStructStmt &proto = enclosingStmt(stmt_proto.typedefstructstmt());
+            return makeAst<TypedefStructStmt>(identifier(proto.package()), identifier(proto.name()),
+                                              bsvtype(proto.structtype()), identifiers(proto.member()),
+                                              bsvtypes(proto.membertype()), sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kTypedefSynonymStmt: {
+            const bsvproto::TypedefSynonymStmt &proto = enclosingStmt(stmt_proto.typedefsynonymstmt());
+            return makeAst<TypedefSynonymStmt>(identifier(proto.package()), bsvtype(proto.synonymtype()),
+                                               bsvtype(proto.type()), sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kVarBindingStmt: {
+            const bsvproto::VarBindingStmt &proto = enclosingStmt(stmt_proto.varbindingstmt());
+            return makeAst<VarBindingStmt>(bsvtype(proto.bsvtype()), identifier(proto.name()), expr(proto.rhs()),
+                                           sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kVarAssignStmt: {
+            const bsvproto::VarAssignStmt &proto = enclosingStmt(stmt_proto.varassignstmt());
+            return makeAst<VarAssignStmt>(lvalue(proto.lvalue()), bindingOp(proto.op()), expr(proto.rhs()),
+                                          sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::kWhileStmt: {
+            const bsvproto::WhileStmt &proto = enclosingStmt(stmt_proto.whilestmt());
+            return makeAst<WhileStmt>(expr(proto.test()), stmt(proto.body()), sourcePos(proto.sourcepos()));
+        }
+        case bsvproto::Stmt::STMT_NOT_SET:
+            break;
+    }
+    return shared_ptr<Stmt>();
+}
+
+shared_ptr<Expr> AstReader::expr(const bsvproto::Expr &expr_proto) {
+    switch (expr_proto.expr_case()) {
+        case bsvproto::Expr::kFieldExpr: {
+            const bsvproto::FieldExpr &proto = expr_proto.fieldexpr();
+            return makeAst<FieldExpr>(expr(proto.object()), identifier(proto.fieldname()), bsvtype(proto.bsvtype()),
+                                      exprSourcePos(proto));
+        }
+        case bsvproto::Expr::kVarExpr: {
+            const bsvproto::VarExpr &proto = expr_proto.varexpr();
+            return makeAst<VarExpr>(identifier(proto.uniquename()), bsvtype(proto.bsvtype()),
+                                    exprSourcePos(proto));
+        }
+        case bsvproto::Expr::kBitConcatExpr: {
+            const bsvproto::BitConcatExpr &proto = expr_proto.bitconcatexpr();
+            return makeAst<BitConcatExpr>(exprs(proto.value()), bsvtype(proto.bsvtype()), exprSourcePos(proto));
+        }
+        case bsvproto::Expr::kBitSelExpr: {
+            const bsvproto::BitSelExpr &proto = expr_proto.bitselexpr();
+            return makeAst<BitSelExpr>(expr(proto.value()), expr(proto.msb()), expr(proto.lsb()),
+                                       exprSourcePos(proto));
+        }
+        case bsvproto::Expr::kCallExpr: {
+            const bsvproto::CallExpr &proto = expr_proto.callexpr();
+            return makeAst<CallExpr>(expr(proto.function()), exprs(proto.arg()), exprSourcePos(proto));
+        }
+        case bsvproto::Expr::kCaseExpr: {
+            const bsvproto::CaseExpr &proto = expr_proto.caseexpr();
+            vector<shared_ptr<CaseExprItem>> items;
+            for (int i = 0; i < proto.expritem_size(); i++) {
+                const bsvproto::CaseExprItem &item_proto = proto.expritem(i);
+                if (item_proto.has_patternmatch())
+                    items.push_back(make_shared<CaseExprItem>(pattern(item_proto.patternmatch()),
+                                                              exprs(item_proto.patterncond()),
+                                                              expr(item_proto.expr()),
+                                                              exprSourcePos(item_proto)));
+                else
+                    items.push_back(make_shared<CaseExprItem>(exprs(item_proto.exprmatch()), expr(item_proto.expr()),
+                                                              exprSourcePos(item_proto)));
+            }
+            return makeAst<CaseExpr>(expr(proto.matchvalue()), items, bsvtype(proto.bsvtype()),
+                                     exprSourcePos(proto));
+        }
+        case bsvproto::Expr::kCondExpr: {
+            const bsvproto::CondExpr &proto = expr_proto.condexpr();
+            return makeAst<CondExpr>(expr(proto.cond()), expr(proto.thenexpr()), expr(proto.elseexpr()),
+                                     exprSourcePos(proto));
+        }
+        case bsvproto::Expr::kIntConst: {
+            const bsvproto::IntConst &proto = expr_proto.intconst();
+            string repr = identifier(proto.repr());
+            if (repr.empty())
+                repr = to_string(proto.value());
+            return makeAst<IntConst>(repr, exprSourcePos(proto));
+        }
+        case bsvproto::Expr::kInterfaceExpr: {
+            const bsvproto::InterfaceExpr &proto = expr_proto.interfaceexpr();
+            return makeAst<InterfaceExpr>(bsvtype(proto.bsvtype()), exprSourcePos(proto));
+        }
+        case bsvproto::Expr::kStringConst: {
+            const bsvproto::StringConst &proto = expr_proto.stringconst();
+            return makeAst<StringConst>(identifier(proto.value()), exprSourcePos(proto));
+        }
+        case bsvproto::Expr::kMatchesExpr: {
+            const bsvproto::MatchesExpr &proto = expr_proto.matchesexpr();
+            return makeAst<MatchesExpr>(expr(proto.expr()), pattern(proto.pattern()), exprs(proto.patterncond()),
+                                        exprSourcePos(proto));
+        }
+        case bsvproto::Expr::kMethodExpr: {
+            const bsvproto::MethodExpr &proto = expr_proto.methodexpr();
+            return makeAst<MethodExpr>(expr(proto.object()), identifier(proto.methodname()), bsvtype(proto.bsvtype()),
+                                       exprSourcePos(proto));
+        }
+        case bsvproto::Expr::kOperatorExpr: {
+            const bsvproto::OperatorExpr &proto = expr_proto.operatorexpr();
+            return makeAst<OperatorExpr>(identifier(proto.op()), expr(proto.lhs()), expr(proto.rhs()),
+                                         exprSourcePos(proto));
+        }
+        case bsvproto::Expr::kArraySubExpr: {
+            const bsvproto::ArraySubExpr &proto = expr_proto.arraysubexpr();
+            return makeAst<ArraySubExpr>(expr(proto.array()), expr(proto.index()), exprSourcePos(proto));
+        }
+        case bsvproto::Expr::kEnumUnionStructExpr: {
+            const bsvproto::EnumUnionStructExpr &proto = expr_proto.enumunionstructexpr();
+            return makeAst<EnumUnionStructExpr>(identifier(proto.tag()), identifiers(proto.key()), exprs(proto.val()),
+                                                bsvtype(proto.bsvtype()), exprSourcePos(proto));
+        }
+        case bsvproto::Expr::kSubinterfaceExpr: {
+            const bsvproto::SubinterfaceExpr &proto = expr_proto.subinterfaceexpr();
+            return makeAst<SubinterfaceExpr>(expr(proto.object()), identifier(proto.subinterfacename()),
+                                             bsvtype(proto.bsvtype()), exprSourcePos(proto));
+        }
+        case bsvproto::Expr::kValueofExpr: {
+            const bsvproto::ValueofExpr &proto = expr_proto.valueofexpr();
+            return makeAst<ValueofExpr>(bsvtype(proto.argtype()), exprSourcePos(proto));
+        }
+        case bsvproto::Expr::EXPR_NOT_SET:
+            break;
+    }
+    return shared_ptr<Expr>();
+}
+
+shared_ptr<LValue> AstReader::lvalue(const bsvproto::LValue &lvalue_proto) {
+    switch (lvalue_proto.lvalue_case()) {
+        case bsvproto::LValue::kArray:
+            return makeAst<ArraySubLValue>(expr(lvalue_proto.array().array()), expr(lvalue_proto.array().index()));
+        case bsvproto::LValue::kField:
+            return makeAst<FieldLValue>(expr(lvalue_proto.field().obj()), identifier(lvalue_proto.field().field()));
+        case bsvproto::LValue::kVar:
+            return makeAst<VarLValue>(identifier(lvalue_proto.var().name()), bsvtype(lvalue_proto.var().bsvtype()));
+        case bsvproto::LValue::kRange:
+            return makeAst<RangeSelLValue>(expr(lvalue_proto.range().array()), expr(lvalue_proto.range().msb()),
+                                           expr(lvalue_proto.range().lsb()));
+        case bsvproto::LValue::LVALUE_NOT_SET:
+            break;
+    }
+    return shared_ptr<LValue>();
+}
+
+// Pattern is not a oneof, the writer sets one of its fields
+shared_ptr<Pattern> AstReader::pattern(const bsvproto::Pattern &pattern_proto) {
+    if (pattern_proto.has_intpattern()) {
+        return makeAst<IntPattern>((int)pattern_proto.intpattern().value());
+    } else if (pattern_proto.has_taggedpattern()) {
+        const bsvproto::TaggedPattern &proto = pattern_proto.taggedpattern();
+        return makeAst<TaggedPattern>(identifier(proto.name()), pattern(proto.pattern()));
+    } else if (pattern_proto.has_tuplepattern()) {
+        vector<shared_ptr<Pattern>> subpatterns;
+        for (int i = 0; i < pattern_proto.tuplepattern().subpattern_size(); i++)
+            subpatterns.push_back(pattern(pattern_proto.tuplepattern().subpattern(i)));
+        return makeAst<TuplePattern>(subpatterns);
+    } else if (pattern_proto.has_varpattern()) {
+        return makeAst<VarPattern>(identifier(pattern_proto.varpattern().name()));
+    } else if (pattern_proto.has_wildcardpattern()) {
+        return makeAst<WildcardPattern>();
+    }
+    return shared_ptr<Pattern>();
+}
+
+shared_ptr<BSVType> AstReader::bsvtype(uint32_t index) {
+    if (index == 0 || index >= types.size()) {
+        if (index)
+            cerr << "AstReader: type " << index << " out of range in " << filename << endl;
+        return shared_ptr<BSVType>();
+    }
+    if (!types[index]) {
+        const bsvproto::BSVType &bsvtype_proto = index_proto.type(index);
+        vector<shared_ptr<BSVType>> params = bsvtypes(bsvtype_proto.param());
+        types[index] = make_shared<BSVType>(identifier(bsvtype_proto.name()),
+                                            bsvtype_proto.kind() == bsvproto::Numeric ? BSVType_Numeric
+                                                                                      : BSVType_Symbolic,
+                                            bsvtype_proto.isvar(), params);
+    }
+    return types[index];
+}
+
+const std::string &AstReader::identifier(uint32_t index) {
+    if (index >= (uint32_t)index_proto.identifier_size()) {
+        cerr << "AstReader: identifier " << index << " out of range in " << filename << endl;
+        index = 0;
+    }
+    return index_proto.identifier(index);
+}
+
+SourcePos AstReader::sourcePos(const bsvproto::SourcePos &sourcePos_proto) {
+    uint32_t index = sourcePos_proto.filename();
+    if (index >= (uint32_t)index_proto.filename_size())
+        index = 0;
+    return SourcePos(index_proto.filename(index), sourcePos_proto.linenumber(), 0);
+}
+
+std::string AstReader::bindingOp(bsvproto::BindingOp op) {
+    switch (op) {
+        case bsvproto::ACTION:
+            return "<-";
+        case bsvproto::WRITE:
+            return "<=";
+        default:
+            return "=";
+    }
+}
+
+vector<shared_ptr<Stmt>> AstReader::stmts(const google::protobuf::RepeatedPtrField<bsvproto::Stmt> &stmt_protos) {
+    vector<shared_ptr<Stmt>> result;
+    for (int i = 0; i < stmt_protos.size(); i++)
+        result.push_back(stmt(stmt_protos.Get(i)));
+    return result;
+}
+
+vector<shared_ptr<Expr>> AstReader::exprs(const google::protobuf::RepeatedPtrField<bsvproto::Expr> &expr_protos) {
+    vector<shared_ptr<Expr>> result;
+    for (int i = 0; i < expr_protos.size(); i++)
+        result.push_back(expr(expr_protos.Get(i)));
+    return result;
+}
+
+vector<string> AstReader::identifiers(const google::protobuf::RepeatedField<uint32_t> &indices) {
+    vector<string> result;
+    for (int i = 0; i < indices.size(); i++)
+        result.push_back(identifier(indices.Get(i)));
+    return result;
+}
+
+vector<shared_ptr<BSVType>> AstReader::bsvtypes(const google::protobuf::RepeatedField<uint32_t> &indices) {
+    vector<shared_ptr<BSVType>> result;
+    for (int i = 0; i < indices.size(); i++)
+        result.push_back(bsvtype(indices.Get(i)));
+    return result;
+}
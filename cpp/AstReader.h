@@ -0,0 +1,97 @@
+#pragma once
+
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/message_lite.h>
+
+#include "Expr.h"
+#include "LValue.h"
+#include "Pattern.h"
+#include "Stmt.h"
+#include "source_pos.pb.h"
+#include "expr.pb.h"
+#include "pattern.pb.h"
+#include "lvalue.pb.h"
+#include "stmt.pb.h"
+
+// Reads back a package written by AstWriter, so that the passes after type
+// checking can start from a .ast file instead of preprocessing, parsing and
+// type checking the BSV source again. Nodes are created with makeAst(), in
+// the current AstArena if one is open. Types are shared by all the nodes
+// that refer to the same entry of the type table.
+class AstReader {
+private:
+    std::ifstream input;
+    std::string filename;
+    // records may not claim more than this
+    uint64_t fileSize = 0;
+    bsvproto::PackageDef packagedef_proto;
+    bsvproto::AstIndex index_proto;
+    // converted entries of the type table, null until first used
+    vector<shared_ptr<BSVType>> types;
+    // position of the statement being read, which its expressions share unless they have their own
+    const bsvproto::SourcePos *stmtSourcePos = nullptr;
+
+    bool readRecord(google::protobuf::MessageLite *message);
+public:
+    AstReader();
+
+    ~AstReader();
+
+    // checks the file and reads its header and index
+    bool open(const std::string &filename);
+
+    void close();
+
+    // reads every top-level statement
+    shared_ptr<PackageDefStmt> readPackageDef();
+
+    // reads the top-level statements declaring name
+    vector<shared_ptr<Stmt>> readDeclarations(const std::string &name);
+
+    const bsvproto::AstIndex &index() const { return index_proto; }
+
+    shared_ptr<Stmt> stmt(const bsvproto::Stmt &stmt_proto);
+
+    shared_ptr<Expr> expr(const bsvproto::Expr &expr_proto);
+
+    shared_ptr<LValue> lvalue(const bsvproto::LValue &lvalue_proto);
+
+    shared_ptr<Pattern> pattern(const bsvproto::Pattern &pattern_proto);
+
+    // entries of the tables of the index
+    shared_ptr<BSVType> bsvtype(uint32_t index);
+
+    const std::string &identifier(uint32_t index);
+
+    SourcePos sourcePos(const bsvproto::SourcePos &sourcePos_proto);
+
+    static std::string bindingOp(bsvproto::BindingOp op);
+
+private:
+    shared_ptr<Stmt> readStmt(const bsvproto::Stmt &stmt_proto);
+
+    template <typename StmtProto>
+    const StmtProto &enclosingStmt(const StmtProto &proto) {
+        stmtSourcePos = &proto.sourcepos();
+        return proto;
+    }
+
+    template <typename ExprProto>
+    SourcePos exprSourcePos(const ExprProto &proto) {
+        if (proto.has_sourcepos() || !stmtSourcePos)
+            return sourcePos(proto.sourcepos());
+        return sourcePos(*stmtSourcePos);
+    }
+
+    vector<shared_ptr<Stmt>> stmts(const google::protobuf::RepeatedPtrField<bsvproto::Stmt> &stmt_protos);
+
+    vector<shared_ptr<Expr>> exprs(const google::protobuf::RepeatedPtrField<bsvproto::Expr> &expr_protos);
+
+    vector<string> identifiers(const google::protobuf::RepeatedField<uint32_t> &indices);
+
+    vector<shared_ptr<BSVType>> bsvtypes(const google::protobuf::RepeatedField<uint32_t> &indices);
+};
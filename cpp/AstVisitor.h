@@ -5,100 +5,277 @@
 #ifndef BSV_PARSER_ASTVISITOR_H
 #define BSV_PARSER_ASTVISITOR_H
 
+#include "AstDispatch.h"
 #include "Stmt.h"
 #include "Expr.h"
 #include "BSVType.h"
 
-class AstVisitor {
+// Walks the whole tree. Derived classes hide the visitXxx methods for the
+// node types they are interested in and call the AstVisitor<Derived>
+// version to continue the traversal into the children.
+template <typename Derived>
+class AstVisitor : public StmtDispatcher<Derived>,
+                   public ExprDispatcher<Derived>,
+                   public LValueDispatcher<Derived>,
+                   public PatternDispatcher<Derived> {
 public:
-    AstVisitor() {}
-    virtual ~AstVisitor() {}
-
-    void visit(const shared_ptr<Stmt> &stmt);
-
-    void visit(const shared_ptr<Expr> &expr);
-
-    void visit(const shared_ptr<BSVType> &bsvtype);
-
-    virtual void visitModuleDef(const shared_ptr<ModuleDefStmt> &sharedPtr);
-
-    virtual void visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &sharedPtr);
-
-    virtual void visitBlockStmt(const shared_ptr<BlockStmt> sharedPtr);
-
-    virtual void visitCallStmt(const shared_ptr<CallStmt> sharedPtr);
-
-    virtual void visitExprStmt(const shared_ptr<ExprStmt> sharedPtr);
-
-    virtual void visitFunctionDefStmt(const shared_ptr<FunctionDefStmt> sharedPtr);
-
-    virtual void visitInterfaceDeclStmt(const shared_ptr<InterfaceDeclStmt> sharedPtr);
-
-    virtual void visitIfStmt(const shared_ptr<IfStmt> sharedPtr);
-
-    virtual void visitImportStmt(const shared_ptr<ImportStmt> sharedPtr);
-
-    virtual void visitMethodDeclStmt(const shared_ptr<MethodDeclStmt> sharedPtr);
-
-    virtual void visitModuleInstStmt(const shared_ptr<ModuleInstStmt> sharedPtr);
-
-    virtual void visitPackageDefStmt(const shared_ptr<PackageDefStmt> sharedPtr);
-
-    virtual void visitPatternMatchStmt(const shared_ptr<PatternMatchStmt> sharedPtr);
-
-    virtual void visitRegisterStmt(const shared_ptr<RegisterStmt> sharedPtr);
-
-    virtual void visitRegReadStmt(const shared_ptr<RegReadStmt> sharedPtr);
-
-    virtual void visitRegWriteStmt(const shared_ptr<RegWriteStmt> sharedPtr);
-
-    virtual void visitReturnStmt(const shared_ptr<ReturnStmt> sharedPtr);
-
-    virtual void visitTypedefEnumStmt(const shared_ptr<TypedefEnumStmt> sharedPtr);
-
-    virtual void visitTypedefStructStmt(const shared_ptr<TypedefStructStmt> sharedPtr);
-
-    virtual void visitTypedefSynonymStmt(const shared_ptr<TypedefSynonymStmt> sharedPtr);
-
-    virtual void visitVarBindingStmt(const shared_ptr<VarBindingStmt> sharedPtr);
-
-    virtual void visitVarAssignStmt(const shared_ptr<VarAssignStmt> sharedPtr);
-
-    virtual void visitRuleDefStmt(const shared_ptr<RuleDefStmt> sharedPtr);
-
-    virtual void visitArraySubExpr(const shared_ptr<ArraySubExpr> sharedPtr);
-
-    virtual void visitBitConcatExpr(const shared_ptr<BitConcatExpr> sharedPtr);
-
-    virtual void visitBitSelExpr(const shared_ptr<BitSelExpr> sharedPtr);
-
-    virtual void visitVarExpr(const shared_ptr<VarExpr> sharedPtr);
-
-    virtual void visitIntConst(const shared_ptr<IntConst> sharedPtr);
-
-    virtual void visitInterfaceExpr(const shared_ptr<InterfaceExpr> sharedPtr);
-
-    virtual void visitSubinterfaceExpr(const shared_ptr<SubinterfaceExpr> sharedPtr);
-
-    virtual void visitStringConst(const shared_ptr<StringConst> sharedPtr);
-
-    virtual void visitOperatorExpr(const shared_ptr<OperatorExpr> sharedPtr);
-
-    virtual void visitCallExpr(const shared_ptr<CallExpr> sharedPtr);
-
-    virtual void visitFieldExpr(const shared_ptr<FieldExpr> sharedPtr);
-
-    virtual void visitCondExpr(const shared_ptr<CondExpr> sharedPtr);
-
-    virtual void visitCaseExpr(const shared_ptr<CaseExpr> sharedPtr);
-
-    virtual void visitEnumUnionStructExpr(const shared_ptr<EnumUnionStructExpr> sharedPtr);
-
-    virtual void visitMatchesExpr(const shared_ptr<MatchesExpr> sharedPtr);
-
-    virtual void visitMethodExpr(const shared_ptr<MethodExpr> sharedPtr);
-
-    virtual void visitValueofExpr(const shared_ptr<ValueofExpr> sharedPtr);
+    void visit(const shared_ptr<Stmt> &stmt) {
+        if (stmt)
+            this->dispatchStmt(stmt);
+    }
+
+    void visit(const shared_ptr<Expr> &expr) {
+        if (expr)
+            this->dispatchExpr(expr);
+    }
+
+    void visit(const shared_ptr<LValue> &lvalue) {
+        if (lvalue)
+            this->dispatchLValue(lvalue);
+    }
+
+    void visit(const shared_ptr<Pattern> &pattern) {
+        if (pattern)
+            this->dispatchPattern(pattern);
+    }
+
+    void visit(const vector<shared_ptr<Stmt>> &stmts) {
+        for (size_t i = 0; i < stmts.size(); i++)
+            visit(stmts[i]);
+    }
+
+    void visit(const vector<shared_ptr<Expr>> &exprs) {
+        for (size_t i = 0; i < exprs.size(); i++)
+            visit(exprs[i]);
+    }
+
+    void visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt) {
+        visit(stmt->rhs);
+    }
+
+    void visitBlockStmt(const shared_ptr<BlockStmt> &stmt) {
+        visit(stmt->stmts);
+    }
+
+    void visitCallStmt(const shared_ptr<CallStmt> &stmt) {
+        visit(stmt->rhs);
+    }
+
+    void visitExprStmt(const shared_ptr<ExprStmt> &stmt) {
+        visit(stmt->expr);
+    }
+
+    void visitFunctionDefStmt(const shared_ptr<FunctionDefStmt> &stmt) {
+        visit(stmt->guard);
+        visit(stmt->stmts);
+    }
+
+    void visitInterfaceDeclStmt(const shared_ptr<InterfaceDeclStmt> &stmt) {
+        visit(stmt->decls);
+    }
+
+    void visitInterfaceDefStmt(const shared_ptr<InterfaceDefStmt> &stmt) {
+        visit(stmt->defs);
+    }
+
+    void visitIfStmt(const shared_ptr<IfStmt> &stmt) {
+        visit(stmt->condition);
+        visit(stmt->thenStmt);
+        visit(stmt->elseStmt);
+    }
+
+    void visitImportStmt(const shared_ptr<ImportStmt> &stmt) {
+    }
+
+    void visitMethodDeclStmt(const shared_ptr<MethodDeclStmt> &stmt) {
+    }
+
+    void visitMethodDefStmt(const shared_ptr<MethodDefStmt> &stmt) {
+        visit(stmt->guard);
+        visit(stmt->stmts);
+    }
+
+    void visitModuleDefStmt(const shared_ptr<ModuleDefStmt> &stmt) {
+        visit(stmt->stmts);
+    }
+
+    void visitModuleInstStmt(const shared_ptr<ModuleInstStmt> &stmt) {
+        visit(stmt->rhs);
+    }
+
+    void visitPackageDefStmt(const shared_ptr<PackageDefStmt> &stmt) {
+        visit(stmt->stmts);
+    }
+
+    void visitPatternMatchStmt(const shared_ptr<PatternMatchStmt> &stmt) {
+        visit(stmt->pattern);
+        visit(stmt->rhs);
+    }
+
+    void visitRegisterStmt(const shared_ptr<RegisterStmt> &stmt) {
+    }
+
+    void visitRegReadStmt(const shared_ptr<RegReadStmt> &stmt) {
+    }
+
+    void visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt) {
+        visit(stmt->rhs);
+    }
+
+    void visitReturnStmt(const shared_ptr<ReturnStmt> &stmt) {
+        visit(stmt->value);
+    }
+
+    void visitTypedefEnumStmt(const shared_ptr<TypedefEnumStmt> &stmt) {
+    }
+
+    void visitTypedefStructStmt(const shared_ptr<TypedefStructStmt> &stmt) {
+    }
+
+    void visitTypedefSynonymStmt(const shared_ptr<TypedefSynonymStmt> &stmt) {
+    }
+
+    void visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt) {
+        visit(stmt->rhs);
+    }
+
+    void visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt) {
+        visit(stmt->lhs);
+        visit(stmt->rhs);
+    }
+
+    void visitRuleDefStmt(const shared_ptr<RuleDefStmt> &stmt) {
+        visit(stmt->guard);
+        visit(stmt->stmts);
+    }
+
+    void visitForStmt(const shared_ptr<ForStmt> &stmt) {
+        visit(stmt->init);
+        visit(stmt->test);
+        visit(stmt->incr);
+        visit(stmt->body);
+    }
+
+    void visitWhileStmt(const shared_ptr<WhileStmt> &stmt) {
+        visit(stmt->test);
+        visit(stmt->body);
+    }
+
+    void visitArraySubExpr(const shared_ptr<ArraySubExpr> &expr) {
+        visit(expr->array);
+        visit(expr->index);
+    }
+
+    void visitBitConcatExpr(const shared_ptr<BitConcatExpr> &expr) {
+        visit(expr->values);
+    }
+
+    void visitBitSelExpr(const shared_ptr<BitSelExpr> &expr) {
+        visit(expr->value);
+        visit(expr->msb);
+        visit(expr->lsb);
+    }
+
+    void visitVarExpr(const shared_ptr<VarExpr> &expr) {
+    }
+
+    void visitIntConst(const shared_ptr<IntConst> &expr) {
+    }
+
+    void visitInterfaceExpr(const shared_ptr<InterfaceExpr> &expr) {
+        visit(expr->stmts);
+    }
+
+    void visitSubinterfaceExpr(const shared_ptr<SubinterfaceExpr> &expr) {
+        visit(expr->object);
+    }
+
+    void visitStringConst(const shared_ptr<StringConst> &expr) {
+    }
+
+    void visitOperatorExpr(const shared_ptr<OperatorExpr> &expr) {
+        visit(expr->lhs);
+        visit(expr->rhs);
+    }
+
+    void visitCallExpr(const shared_ptr<CallExpr> &expr) {
+        visit(expr->function);
+        visit(expr->args);
+    }
+
+    void visitFieldExpr(const shared_ptr<FieldExpr> &expr) {
+        visit(expr->object);
+    }
+
+    void visitCondExpr(const shared_ptr<CondExpr> &expr) {
+        visit(expr->cond);
+        visit(expr->thenExpr);
+        visit(expr->elseExpr);
+    }
+
+    void visitCaseExpr(const shared_ptr<CaseExpr> &expr) {
+        visit(expr->matchValue);
+        for (size_t i = 0; i < expr->exprItems.size(); i++) {
+            shared_ptr<CaseExprItem> item = expr->exprItems[i];
+            visit(item->exprMatch);
+            visit(item->patternMatch);
+            visit(item->patternCond);
+            visit(item->expr);
+        }
+    }
+
+    void visitEnumUnionStructExpr(const shared_ptr<EnumUnionStructExpr> &expr) {
+        visit(expr->vals);
+    }
+
+    void visitMatchesExpr(const shared_ptr<MatchesExpr> &expr) {
+        visit(expr->expr);
+        visit(expr->pattern);
+        visit(expr->patterncond);
+    }
+
+    void visitMethodExpr(const shared_ptr<MethodExpr> &expr) {
+        visit(expr->object);
+    }
+
+    void visitValueofExpr(const shared_ptr<ValueofExpr> &expr) {
+    }
+
+    void visitArraySubLValue(const shared_ptr<ArraySubLValue> &lvalue) {
+        visit(lvalue->array);
+        visit(lvalue->index);
+    }
+
+    void visitFieldLValue(const shared_ptr<FieldLValue> &lvalue) {
+        visit(lvalue->obj);
+    }
+
+    void visitVarLValue(const shared_ptr<VarLValue> &lvalue) {
+    }
+
+    void visitRangeSelLValue(const shared_ptr<RangeSelLValue> &lvalue) {
+        visit(lvalue->bitarray);
+        visit(lvalue->msb);
+        visit(lvalue->lsb);
+    }
+
+    void visitIntPattern(const shared_ptr<IntPattern> &pattern) {
+    }
+
+    void visitTaggedPattern(const shared_ptr<TaggedPattern> &pattern) {
+        visit(pattern->pattern);
+    }
+
+    void visitTuplePattern(const shared_ptr<TuplePattern> &pattern) {
+        for (size_t i = 0; i < pattern->subpatterns.size(); i++)
+            visit(pattern->subpatterns[i]);
+    }
+
+    void visitVarPattern(const shared_ptr<VarPattern> &pattern) {
+    }
+
+    void visitWildcardPattern(const shared_ptr<WildcardPattern> &pattern) {
+    }
 };
 
 
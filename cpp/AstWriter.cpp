@@ -7,741 +7,724 @@
 
 #include "AstWriter.h"
 
-AstWriter::AstWriter() {}
+AstWriter::AstWriter() : arenaBlock(64 * 1024), arena(arenaOptions(arenaBlock)) {}
 
 AstWriter::~AstWriter() noexcept {}
 
+google::protobuf::ArenaOptions AstWriter::arenaOptions(std::vector<char> &block) {
+    google::protobuf::ArenaOptions options;
+    options.initial_block = block.data();
+    options.initial_block_size = block.size();
+    options.max_block_size = block.size();
+    return options;
+}
+
 void AstWriter::visit(const shared_ptr <Stmt> &stmt, bsvproto::Stmt *stmt_proto) {
+    if (!stmt)
+        return;
     cerr << "AstWriter::visit stmt " << stmt->stmtType << endl;
-    switch (stmt->stmtType) {
-        case InvalidStmtType:
-            break;
-        case ActionBindingStmtType:
-            visitActionBindingStmt(stmt->actionBindingStmt(), stmt_proto);
-            break;
-        case BlockStmtType:
-            visitBlockStmt(stmt->blockStmt(), stmt_proto);
-            break;
-        case CallStmtType:
-            visitCallStmt(stmt->callStmt(), stmt_proto);
-            break;
-        case ExprStmtType:
-            visitExprStmt(stmt->exprStmt(), stmt_proto);
-            break;
-        case FunctionDefStmtType:
-            visitFunctionDefStmt(stmt->functionDefStmt(), stmt_proto);
-            break;
-        case InterfaceDeclStmtType:
-            visitInterfaceDeclStmt(stmt->interfaceDeclStmt(), stmt_proto);
-            break;
-        case InterfaceDefStmtType:
-            visitInterfaceDefStmt(stmt->interfaceDefStmt(), stmt_proto);
-            break;
-        case IfStmtType:
-            visitIfStmt(stmt->ifStmt(), stmt_proto);
-            break;
-        case ImportStmtType:
-            visitImportStmt(stmt->importStmt(), stmt_proto);
-            break;
-        case MethodDeclStmtType:
-            visitMethodDeclStmt(stmt->methodDeclStmt(), stmt_proto);
-            break;
-        case MethodDefStmtType:
-            visitMethodDefStmt(stmt->methodDefStmt(), stmt_proto);
-            break;
-        case ModuleDefStmtType:
-            visitModuleDefStmt(stmt->moduleDefStmt(), stmt_proto);
-            break;
-        case ModuleInstStmtType:
-            visitModuleInstStmt(stmt->moduleInstStmt(), stmt_proto);
-            break;
-        case PackageDefStmtType:
-            // stmt_proto is null
-            visitPackageDefStmt(stmt->packageDefStmt());
-            break;
-        case PatternMatchStmtType:
-            visitPatternMatchStmt(stmt->patternMatchStmt(), stmt_proto);
-            break;
-        case RegisterStmtType:
-            visitRegisterStmt(stmt->registerStmt(), stmt_proto);
-            break;
-        case RegReadStmtType:
-            visitRegReadStmt(stmt->regReadStmt(), stmt_proto);
-            break;
-        case RegWriteStmtType:
-            visitRegWriteStmt(stmt->regWriteStmt(), stmt_proto);
-            break;
-        case ReturnStmtType:
-            visitReturnStmt(stmt->returnStmt(), stmt_proto);
-            break;
-        case TypedefEnumStmtType:
-            visitTypedefEnumStmt(stmt->typedefEnumStmt(), stmt_proto);
-            break;
-        case TypedefStructStmtType:
-            visitTypedefStructStmt(stmt->typedefStructStmt(), stmt_proto);
-            break;
-        case TypedefSynonymStmtType:
-            visitTypedefSynonymStmt(stmt->typedefSynonymStmt(), stmt_proto);
-            break;
-        case VarBindingStmtType:
-            visitVarBindingStmt(stmt->varBindingStmt(), stmt_proto);
-            break;
-        case VarAssignStmtType:
-            visitVarAssignStmt(stmt->varAssignStmt(), stmt_proto);
-            break;
-        case RuleDefStmtType:
-            visitRuleDefStmt(stmt->ruleDefStmt(), stmt_proto);
-            break;
-    }
+    const SourcePos *outerSourcePos = stmtSourcePos;
+    stmtSourcePos = &stmt->sourcePos;
+    dispatchStmt(stmt, stmt_proto);
+    stmtSourcePos = outerSourcePos;
 }
 
 void AstWriter::visitModuleDefStmt(const shared_ptr <ModuleDefStmt> &moduledef, bsvproto::Stmt *stmt_proto) {
     cerr << "visitModuleDefStmt" << endl;
-    bsvproto::ModuleDefStmt moduledef_proto;
-    visit(moduledef->sourcePos, moduledef_proto.mutable_sourcepos());
-    moduledef_proto.set_name(moduledef->name);
-    moduledef_proto.set_package(moduledef->package);
-    visit(moduledef->interfaceType, moduledef_proto.mutable_returntype());
+    bsvproto::ModuleDefStmt *moduledef_proto = stmt_proto->mutable_moduledefstmt();
+    visit(moduledef->sourcePos, moduledef_proto->mutable_sourcepos());
+    moduledef_proto->set_name(identifierIndex(moduledef->name));
+    moduledef_proto->set_package(identifierIndex(moduledef->package));
+    moduledef_proto->set_returntype(typeIndex(moduledef->interfaceType));
     for (int i = 0; i < moduledef->params.size(); i++) {
-        moduledef_proto.add_paramname(moduledef->params[i]);
-        visit(moduledef->paramTypes[i], moduledef_proto.add_paramtype());
+        moduledef_proto->add_paramname(identifierIndex(moduledef->params[i]));
+        moduledef_proto->add_paramtype(typeIndex(moduledef->paramTypes[i]));
     }
     for (int i = 0; i < moduledef->stmts.size(); i++) {
-        bsvproto::Stmt *substmt_proto = moduledef_proto.add_stmt();
+        bsvproto::Stmt *substmt_proto = moduledef_proto->add_stmt();
         visit(moduledef->stmts[i], substmt_proto);
     }
-
-    *stmt_proto->mutable_moduledefstmt() = moduledef_proto;
 }
 
-void AstWriter::visitPackageDefStmt(const shared_ptr <PackageDefStmt> packageDef) {
+void AstWriter::visitPackageDefStmt(const shared_ptr <PackageDefStmt> packageDef, bsvproto::Stmt *stmt_proto) {
     cerr << "visitPackageDefStmt" << endl;
+    bsvproto::PackageDef packagedef_proto;
     packagedef_proto.set_name(packageDef->name);
     packagedef_proto.set_filename(packageDef->sourcePos.sourceName);
     visit(packageDef->sourcePos, packagedef_proto.mutable_sourcepos());
+    writeRecord(packagedef_proto);
+    if (imageWriter)
+        imageWriter->addPackage(packageDef->name, packageDef->sourcePos.sourceName);
     for (int i = 0; i < packageDef->stmts.size(); i++) {
-        bsvproto::Stmt *substmt_proto = packagedef_proto.add_stmt();
+        bsvproto::Stmt *substmt_proto = google::protobuf::Arena::CreateMessage<bsvproto::Stmt>(&arena);
         visit(packageDef->stmts[i], substmt_proto);
+        bsvproto::AstIndexEntry *entry_proto = index_proto.add_entry();
+        entry_proto->set_name(declarationName(packageDef->stmts[i]));
+        entry_proto->set_stmtkind(substmt_proto->stmt_case());
+        entry_proto->set_offset(offset);
+        writeRecord(*substmt_proto);
+        entry_proto->set_size(offset - entry_proto->offset());
+        if (imageWriter)
+            imageWriter->addStmt(*substmt_proto, entry_proto->name(), index_proto);
+        arena.Reset();
     }
 }
 
-bsvproto::SourcePos *AstWriter::newSourcePos(const SourcePos &sourcePos) {
-    bsvproto::SourcePos *sourcePos_proto = new bsvproto::SourcePos();
-    sourcePos_proto->set_filename(sourcePos.sourceName);
-    sourcePos_proto->set_linenumber(sourcePos.line);
-    return sourcePos_proto;
-}
-
-bool AstWriter::writeAst(std::string filename) {
-    ofstream output(filename, ios::out | ios::trunc | ios::binary);
-    output << packagedef_proto.SerializeAsString();
+bool AstWriter::open(const std::string &filename) {
+    output.open(filename, ios::out | ios::trunc | ios::binary);
+    output << "BSVAST02";
+    offset = 8;
+    index_proto.Clear();
+    identifiers.clear();
+    filenames.clear();
+    typeIndices.clear();
+    typeEntries.clear();
+    // entry 0 of each table stands for the empty string or the missing type
+    identifierIndex(std::string());
+    filenameIndex(std::string());
+    *index_proto.add_type() = bsvproto::BSVType();
+    return output.good();
+}
+
+bool AstWriter::close() {
+    uint64_t indexOffset = offset;
+    writeRecord(index_proto);
+    char trailer[8];
+    for (int i = 0; i < 8; i++)
+        trailer[i] = (char)(indexOffset >> (8 * i));
+    output.write(trailer, sizeof(trailer));
+    output << "BSVASTIX";
+    offset += 16;
     output.close();
-    return true;
+    return !output.fail();
+}
+
+// a varint length followed by the serialized message, serialized into a buffer that keeps its capacity
+void AstWriter::writeRecord(const google::protobuf::MessageLite &message) {
+    message.SerializeToString(&record);
+    char length[10];
+    int n = 0;
+    uint64_t value = record.size();
+    do {
+        length[n] = (char)(value & 0x7f);
+        value >>= 7;
+        if (value)
+            length[n] |= 0x80;
+        n++;
+    } while (value);
+    output.write(length, n);
+    output.write(record.data(), record.size());
+    offset += n + record.size();
+}
+
+bsvproto::BindingOp AstWriter::bindingOp(const std::string &op) {
+    if (op == "<-")
+        return bsvproto::ACTION;
+    else if (op == "<=")
+        return bsvproto::WRITE;
+    return bsvproto::VALUE;
+}
+
+std::string AstWriter::declarationName(const shared_ptr<Stmt> &stmt) {
+    switch (stmt->stmtType) {
+        case FunctionDefStmtType:
+            return stmt->functionDefStmt()->name;
+        case ImportStmtType:
+            return stmt->importStmt()->name;
+        case InterfaceDeclStmtType:
+            return stmt->interfaceDeclStmt()->name;
+        case ModuleDefStmtType:
+            return stmt->moduleDefStmt()->name;
+        case TypedefEnumStmtType:
+            return stmt->typedefEnumStmt()->name;
+        case TypedefStructStmtType:
+            return stmt->typedefStructStmt()->name;
+        case TypedefSynonymStmtType:
+            return stmt->typedefSynonymStmt()->typedeftype->name;
+        case VarBindingStmtType:
+            return stmt->varBindingStmt()->name;
+        default:
+            return std::string();
+    }
 }
 
 void AstWriter::visitActionBindingStmt(shared_ptr <ActionBindingStmt> actionBindingStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitActionBindingStmt " << actionBindingStmt->name << endl;
-    bsvproto::ActionBindingStmt actionBindingStmt_proto;
-    actionBindingStmt_proto.set_name(actionBindingStmt->name);
-    visit(actionBindingStmt->sourcePos, actionBindingStmt_proto.mutable_sourcepos());
-    visit(actionBindingStmt->bsvtype, actionBindingStmt_proto.mutable_bsvtype());
-    visit(actionBindingStmt->rhs, actionBindingStmt_proto.mutable_rhs());
-
-    *stmt_proto->mutable_actionbindingstmt() = actionBindingStmt_proto;
+    bsvproto::ActionBindingStmt *actionBindingStmt_proto = stmt_proto->mutable_actionbindingstmt();
+    actionBindingStmt_proto->set_name(identifierIndex(actionBindingStmt->name));
+    visit(actionBindingStmt->sourcePos, actionBindingStmt_proto->mutable_sourcepos());
+    actionBindingStmt_proto->set_bsvtype(typeIndex(actionBindingStmt->bsvtype));
+    visit(actionBindingStmt->rhs, actionBindingStmt_proto->mutable_rhs());
 }
 
 void AstWriter::visitBlockStmt(shared_ptr <BlockStmt> blockStmt, bsvproto::Stmt *stmt_proto) {
-    bsvproto::BlockStmt blockStmt_proto;
+    bsvproto::BlockStmt *blockStmt_proto = stmt_proto->mutable_blockstmt();
+    visit(blockStmt->sourcePos, blockStmt_proto->mutable_sourcepos());
     for (int i = 0; i < blockStmt->stmts.size(); i++) {
-        bsvproto::Stmt *substmt_proto = blockStmt_proto.add_stmt();
+        bsvproto::Stmt *substmt_proto = blockStmt_proto->add_stmt();
         visit(blockStmt->stmts[i], substmt_proto);
     }
-
-    *stmt_proto->mutable_blockstmt() = blockStmt_proto;
 }
 
 void AstWriter::visitCallStmt(shared_ptr <CallStmt> callStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitCallStmt" << endl;
-    bsvproto::CallStmt callStmt_proto;
-    callStmt_proto.set_name(callStmt->name);
-    visit(callStmt->interfaceType, callStmt_proto.mutable_vartype());
-    visit(callStmt->rhs, callStmt_proto.mutable_rhs());
-
-    *stmt_proto->mutable_callstmt() = callStmt_proto;
+    bsvproto::CallStmt *callStmt_proto = stmt_proto->mutable_callstmt();
+    visit(callStmt->sourcePos, callStmt_proto->mutable_sourcepos());
+    callStmt_proto->set_name(identifierIndex(callStmt->name));
+    callStmt_proto->set_vartype(typeIndex(callStmt->interfaceType));
+    visit(callStmt->rhs, callStmt_proto->mutable_rhs());
 }
 
 void AstWriter::visitExprStmt(shared_ptr <ExprStmt> exprStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitExprStmt" << endl;
-    bsvproto::ExprStmt exprStmt_proto;
-    visit(exprStmt->sourcePos, exprStmt_proto.mutable_sourcepos());
-    bsvproto::Expr *expr_proto = exprStmt_proto.mutable_expr();
+    bsvproto::ExprStmt *exprStmt_proto = stmt_proto->mutable_exprstmt();
+    visit(exprStmt->sourcePos, exprStmt_proto->mutable_sourcepos());
+    bsvproto::Expr *expr_proto = exprStmt_proto->mutable_expr();
     visit(exprStmt->expr, expr_proto);
-
-    *stmt_proto->mutable_exprstmt() = exprStmt_proto;
 }
 
 void AstWriter::visitFunctionDefStmt(shared_ptr <FunctionDefStmt> functionDefStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitFunctionDefStmt" << endl;
-    bsvproto::FunctionDefStmt functionDefStmt_proto;
-    visit(functionDefStmt->sourcePos, functionDefStmt_proto.mutable_sourcepos());
-    functionDefStmt_proto.set_package(functionDefStmt->package);
-    functionDefStmt_proto.set_name(functionDefStmt->name);
-    visit(functionDefStmt->returnType, functionDefStmt_proto.mutable_returntype());
+    bsvproto::FunctionDefStmt *functionDefStmt_proto = stmt_proto->mutable_functiondefstmt();
+    visit(functionDefStmt->sourcePos, functionDefStmt_proto->mutable_sourcepos());
+    functionDefStmt_proto->set_package(identifierIndex(functionDefStmt->package));
+    functionDefStmt_proto->set_name(identifierIndex(functionDefStmt->name));
+    functionDefStmt_proto->set_returntype(typeIndex(functionDefStmt->returnType));
     for (int i = 0; i < functionDefStmt->params.size(); i++) {
-        functionDefStmt_proto.add_paramname(functionDefStmt->params[i]);
-        visit(functionDefStmt->paramTypes[i], functionDefStmt_proto.add_paramtype());
+        functionDefStmt_proto->add_paramname(identifierIndex(functionDefStmt->params[i]));
+        functionDefStmt_proto->add_paramtype(typeIndex(functionDefStmt->paramTypes[i]));
     }
     for (int i = 0; i < functionDefStmt->stmts.size(); i++) {
-        visit(functionDefStmt->stmts[i], functionDefStmt_proto.add_stmt());
+        visit(functionDefStmt->stmts[i], functionDefStmt_proto->add_stmt());
     }
     if (functionDefStmt->guard) {
-        visit(functionDefStmt->guard, functionDefStmt_proto.mutable_guard());
+        visit(functionDefStmt->guard, functionDefStmt_proto->mutable_guard());
     }
 
-    *stmt_proto->mutable_functiondefstmt() = functionDefStmt_proto;
-
 }
 
 void AstWriter::visitInterfaceDeclStmt(shared_ptr <InterfaceDeclStmt> interfaceDeclStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitInterfaceDeclStmt" << endl;
-    bsvproto::InterfaceDeclStmt interfaceDeclStmt_proto;
-    visit(interfaceDeclStmt->sourcePos, interfaceDeclStmt_proto.mutable_sourcepos());
-    interfaceDeclStmt_proto.set_name(interfaceDeclStmt->name);
-    interfaceDeclStmt_proto.set_package(interfaceDeclStmt->package);
-    //FIXME: more fields
-
-    *stmt_proto->mutable_interfacedeclstmt() = interfaceDeclStmt_proto;
+    bsvproto::InterfaceDeclStmt *interfaceDeclStmt_proto = stmt_proto->mutable_interfacedeclstmt();
+    visit(interfaceDeclStmt->sourcePos, interfaceDeclStmt_proto->mutable_sourcepos());
+    interfaceDeclStmt_proto->set_name(identifierIndex(interfaceDeclStmt->name));
+    interfaceDeclStmt_proto->set_package(identifierIndex(interfaceDeclStmt->package));
+    interfaceDeclStmt_proto->set_interfacetype(typeIndex(interfaceDeclStmt->interfaceType));
+    for (int i = 0; i < interfaceDeclStmt->decls.size(); i++) {
+        visit(interfaceDeclStmt->decls[i], interfaceDeclStmt_proto->add_decl());
+    }
 }
 
 void AstWriter::visitInterfaceDefStmt(shared_ptr <InterfaceDefStmt> interfaceDefStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitInterfaceDefStmt " << interfaceDefStmt->name << endl;
-    bsvproto::InterfaceDefStmt interfaceDefStmt_proto;
-    visit(interfaceDefStmt->sourcePos, interfaceDefStmt_proto.mutable_sourcepos());
-    //FIXME: more fields
-
-    *stmt_proto->mutable_interfacedefstmt() = interfaceDefStmt_proto;
+    bsvproto::InterfaceDefStmt *interfaceDefStmt_proto = stmt_proto->mutable_interfacedefstmt();
+    visit(interfaceDefStmt->sourcePos, interfaceDefStmt_proto->mutable_sourcepos());
+    interfaceDefStmt_proto->set_name(identifierIndex(interfaceDefStmt->name));
+    interfaceDefStmt_proto->set_package(identifierIndex(interfaceDefStmt->package));
+    interfaceDefStmt_proto->set_interfacetype(typeIndex(interfaceDefStmt->interfaceType));
+    for (int i = 0; i < interfaceDefStmt->defs.size(); i++) {
+        visit(interfaceDefStmt->defs[i], interfaceDefStmt_proto->add_def());
+    }
 }
 
 void AstWriter::visitIfStmt(shared_ptr <IfStmt> ifStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitIfStmt" << endl;
-    bsvproto::IfStmt ifStmt_proto;
-    visit(ifStmt->sourcePos, ifStmt_proto.mutable_sourcepos());
-    visit(ifStmt->condition, ifStmt_proto.mutable_condition());
-    visit(ifStmt->thenStmt, ifStmt_proto.mutable_thenstmt());
-    visit(ifStmt->elseStmt, ifStmt_proto.mutable_elsestmt());
-
-    *stmt_proto->mutable_ifstmt() = ifStmt_proto;
+    bsvproto::IfStmt *ifStmt_proto = stmt_proto->mutable_ifstmt();
+    visit(ifStmt->sourcePos, ifStmt_proto->mutable_sourcepos());
+    visit(ifStmt->condition, ifStmt_proto->mutable_condition());
+    visit(ifStmt->thenStmt, ifStmt_proto->mutable_thenstmt());
+    if (ifStmt->elseStmt)
+        visit(ifStmt->elseStmt, ifStmt_proto->mutable_elsestmt());
 }
 
 void AstWriter::visitImportStmt(shared_ptr <ImportStmt> importStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitImportStmt" << endl;
-    bsvproto::ImportStmt importStmt_proto;
-    visit(importStmt->sourcePos, importStmt_proto.mutable_sourcepos());
-    importStmt_proto.set_name(importStmt->name);
-
-    *stmt_proto->mutable_importstmt() = importStmt_proto;
+    bsvproto::ImportStmt *importStmt_proto = stmt_proto->mutable_importstmt();
+    visit(importStmt->sourcePos, importStmt_proto->mutable_sourcepos());
+    importStmt_proto->set_name(identifierIndex(importStmt->name));
 }
 
 void AstWriter::visitMethodDeclStmt(shared_ptr <MethodDeclStmt> methodDeclStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitMethodDefStmt" << endl;
-    bsvproto::MethodDeclStmt methodDeclStmt_proto;
-    visit(methodDeclStmt->sourcePos, methodDeclStmt_proto.mutable_sourcepos());
-    methodDeclStmt_proto.set_name(methodDeclStmt->name);
-    visit(methodDeclStmt->returnType, methodDeclStmt_proto.mutable_returntype());
+    bsvproto::MethodDeclStmt *methodDeclStmt_proto = stmt_proto->mutable_methoddeclstmt();
+    visit(methodDeclStmt->sourcePos, methodDeclStmt_proto->mutable_sourcepos());
+    methodDeclStmt_proto->set_name(identifierIndex(methodDeclStmt->name));
+    methodDeclStmt_proto->set_returntype(typeIndex(methodDeclStmt->returnType));
     for (int i = 0; i < methodDeclStmt->params.size(); i++) {
-        methodDeclStmt_proto.add_paramname(methodDeclStmt->params[i]);
-        visit(methodDeclStmt->paramTypes[i], methodDeclStmt_proto.add_paramtype());
+        methodDeclStmt_proto->add_paramname(identifierIndex(methodDeclStmt->params[i]));
+        methodDeclStmt_proto->add_paramtype(typeIndex(methodDeclStmt->paramTypes[i]));
     }
-
-    *stmt_proto->mutable_methoddeclstmt() = methodDeclStmt_proto;
 }
 
 void AstWriter::visitMethodDefStmt(shared_ptr <MethodDefStmt> methodDefStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitMethodDefStmt" << endl;
-    bsvproto::MethodDefStmt methodDefStmt_proto;
-    visit(methodDefStmt->sourcePos, methodDefStmt_proto.mutable_sourcepos());
-    methodDefStmt_proto.set_name(methodDefStmt->name);
-    visit(methodDefStmt->returnType, methodDefStmt_proto.mutable_returntype());
+    bsvproto::MethodDefStmt *methodDefStmt_proto = stmt_proto->mutable_methoddefstmt();
+    visit(methodDefStmt->sourcePos, methodDefStmt_proto->mutable_sourcepos());
+    methodDefStmt_proto->set_name(identifierIndex(methodDefStmt->name));
+    methodDefStmt_proto->set_returntype(typeIndex(methodDefStmt->returnType));
     for (int i = 0; i < methodDefStmt->params.size(); i++) {
-        methodDefStmt_proto.add_paramname(methodDefStmt->params[i]);
-        visit(methodDefStmt->paramTypes[i], methodDefStmt_proto.add_paramtype());
+        methodDefStmt_proto->add_paramname(identifierIndex(methodDefStmt->params[i]));
+        methodDefStmt_proto->add_paramtype(typeIndex(methodDefStmt->paramTypes[i]));
+    }
+    if (methodDefStmt->guard)
+        visit(methodDefStmt->guard, methodDefStmt_proto->mutable_guard());
+    for (int i = 0; i < methodDefStmt->stmts.size(); i++) {
+        visit(methodDefStmt->stmts[i], methodDefStmt_proto->add_stmt());
     }
-    visit(methodDefStmt->guard, methodDefStmt_proto.mutable_guard());
-
-    *stmt_proto->mutable_methoddefstmt() = methodDefStmt_proto;
 }
 
 void AstWriter::visitModuleInstStmt(shared_ptr <ModuleInstStmt> moduleInstStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitModuleInstStmt" << endl;
-    bsvproto::ModuleInstStmt moduleInstStmt_proto;
-    moduleInstStmt_proto.set_name(moduleInstStmt->name);
-    visit(moduleInstStmt->sourcePos, moduleInstStmt_proto.mutable_sourcepos());
-    visit(moduleInstStmt->interfaceType, moduleInstStmt_proto.mutable_vartype());
-    visit(moduleInstStmt->rhs, moduleInstStmt_proto.mutable_rhs());
-    *stmt_proto->mutable_moduleinststmt() = moduleInstStmt_proto;
+    bsvproto::ModuleInstStmt *moduleInstStmt_proto = stmt_proto->mutable_moduleinststmt();
+    moduleInstStmt_proto->set_name(identifierIndex(moduleInstStmt->name));
+    visit(moduleInstStmt->sourcePos, moduleInstStmt_proto->mutable_sourcepos());
+    moduleInstStmt_proto->set_vartype(typeIndex(moduleInstStmt->interfaceType));
+    visit(moduleInstStmt->rhs, moduleInstStmt_proto->mutable_rhs());
 }
 
 void AstWriter::visitPatternMatchStmt(shared_ptr <PatternMatchStmt> patternMatchStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitPatternMatchStmt" << endl;
-    bsvproto::PatternMatchStmt patternMatchStmt_proto;
-    visit(patternMatchStmt->sourcePos, patternMatchStmt_proto.mutable_sourcepos());
-    visit(patternMatchStmt->pattern, patternMatchStmt_proto.mutable_pattern());
-
-    *stmt_proto->mutable_patternmatchstmt() = patternMatchStmt_proto;
+    bsvproto::PatternMatchStmt *patternMatchStmt_proto = stmt_proto->mutable_patternmatchstmt();
+    visit(patternMatchStmt->sourcePos, patternMatchStmt_proto->mutable_sourcepos());
+    visit(patternMatchStmt->pattern, patternMatchStmt_proto->mutable_pattern());
+    patternMatchStmt_proto->set_op(bindingOp(patternMatchStmt->op));
+    visit(patternMatchStmt->rhs, patternMatchStmt_proto->mutable_expr());
 }
 
-void AstWriter::visitRegisterStmt(shared_ptr <RegisterStmt> sharedPtr, bsvproto::Stmt *stmt_proto) {
+void AstWriter::visitRegisterStmt(shared_ptr <RegisterStmt> registerStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitRegisterStmt" << endl;
-    //FIXME
+    bsvproto::RegisterStmt *registerStmt_proto = stmt_proto->mutable_registerstmt();
+    visit(registerStmt->sourcePos, registerStmt_proto->mutable_sourcepos());
+    registerStmt_proto->set_regname(identifierIndex(registerStmt->regName));
+    registerStmt_proto->set_elementtype(typeIndex(registerStmt->elementType));
 }
 
-void AstWriter::visitRegReadStmt(shared_ptr <RegReadStmt> sharedPtr, bsvproto::Stmt *stmt_proto) {
+void AstWriter::visitRegReadStmt(shared_ptr <RegReadStmt> regReadStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitRegReadStmt" << endl;
-    //FIXME
+    bsvproto::RegReadStmt *regReadStmt_proto = stmt_proto->mutable_regreadstmt();
+    visit(regReadStmt->sourcePos, regReadStmt_proto->mutable_sourcepos());
+    regReadStmt_proto->set_regname(identifierIndex(regReadStmt->regName));
+    regReadStmt_proto->set_varname(identifierIndex(regReadStmt->var));
+    regReadStmt_proto->set_elementtype(typeIndex(regReadStmt->varType));
 }
 
 void AstWriter::visitRegWriteStmt(shared_ptr <RegWriteStmt> regWriteStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitRegWriteStmt" << endl;
-    //FIXME
+    bsvproto::RegWriteStmt *regWriteStmt_proto = stmt_proto->mutable_regwritestmt();
+    visit(regWriteStmt->sourcePos, regWriteStmt_proto->mutable_sourcepos());
+    regWriteStmt_proto->set_regname(identifierIndex(regWriteStmt->regName));
+    regWriteStmt_proto->set_elementtype(typeIndex(regWriteStmt->elementType));
+    visit(regWriteStmt->rhs, regWriteStmt_proto->mutable_rhs());
 }
 
 void AstWriter::visitReturnStmt(shared_ptr <ReturnStmt> returnStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitReturnStmt" << endl;
-    bsvproto::ReturnStmt returnStmt_proto;
-    visit(returnStmt->sourcePos, returnStmt_proto.mutable_sourcepos());
-    visit(returnStmt->value, returnStmt_proto.mutable_returnexpr());
+    bsvproto::ReturnStmt *returnStmt_proto = stmt_proto->mutable_returnstmt();
+    visit(returnStmt->sourcePos, returnStmt_proto->mutable_sourcepos());
+    visit(returnStmt->value, returnStmt_proto->mutable_returnexpr());
     if (returnStmt->value)
-        visit(returnStmt->value->bsvtype, returnStmt_proto.mutable_returntype());
-
-    *stmt_proto->mutable_returnstmt() = returnStmt_proto;
+        returnStmt_proto->set_returntype(typeIndex(returnStmt->value->bsvtype));
 }
 
 void AstWriter::visitTypedefEnumStmt(shared_ptr <TypedefEnumStmt> typedefEnumStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitTypedefEnumStmt" << endl;
-    bsvproto::TypedefEnumStmt typedefEnumStmt_proto;
-    visit(typedefEnumStmt->sourcePos, typedefEnumStmt_proto.mutable_sourcepos());
-    typedefEnumStmt_proto.set_name(typedefEnumStmt->name);
-    typedefEnumStmt_proto.set_package(typedefEnumStmt->package);
-    visit(typedefEnumStmt->enumType, typedefEnumStmt_proto.mutable_enumtype());
+    bsvproto::TypedefEnumStmt *typedefEnumStmt_proto = stmt_proto->mutable_typedefenumstmt();
+    visit(typedefEnumStmt->sourcePos, typedefEnumStmt_proto->mutable_sourcepos());
+    typedefEnumStmt_proto->set_name(identifierIndex(typedefEnumStmt->name));
+    typedefEnumStmt_proto->set_package(identifierIndex(typedefEnumStmt->package));
+    typedefEnumStmt_proto->set_enumtype(typeIndex(typedefEnumStmt->enumType));
     for (int i = 0; i < typedefEnumStmt->members.size(); i++) {
-        typedefEnumStmt_proto.add_member(typedefEnumStmt->members[i]);
+        typedefEnumStmt_proto->add_member(identifierIndex(typedefEnumStmt->members[i]));
     }
-    *stmt_proto->mutable_typedefenumstmt() = typedefEnumStmt_proto;
 }
 
 void AstWriter::visitTypedefStructStmt(shared_ptr <TypedefStructStmt> typedefStructStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitTypedefStructStmt" << endl;
-    bsvproto::TypedefStructStmt typedefStructStmt_proto;
-    visit(typedefStructStmt->sourcePos, typedefStructStmt_proto.mutable_sourcepos());
-    typedefStructStmt_proto.set_name(typedefStructStmt->name);
-    typedefStructStmt_proto.set_package(typedefStructStmt->package);
-    visit(typedefStructStmt->structType, typedefStructStmt_proto.mutable_structtype());
+    bsvproto::TypedefStructStmt *typedefStructStmt_proto = stmt_proto->mutable_typedefstructstmt();
+    visit(typedefStructStmt->sourcePos, typedefStructStmt_proto->mutable_sourcepos());
+    typedefStructStmt_proto->set_name(identifierIndex(typedefStructStmt->name));
+    typedefStructStmt_proto->set_package(identifierIndex(typedefStructStmt->package));
+    typedefStructStmt_proto->set_structtype(typeIndex(typedefStructStmt->structType));
     for (int i = 0; i < typedefStructStmt->members.size(); i++) {
-        typedefStructStmt_proto.add_member(typedefStructStmt->members[i]);
-        visit(typedefStructStmt->memberTypes[i], typedefStructStmt_proto.add_membertype());
+        typedefStructStmt_proto->add_member(identifierIndex(typedefStructStmt->members[i]));
+        typedefStructStmt_proto->add_membertype(typeIndex(typedefStructStmt->memberTypes[i]));
     }
-    *stmt_proto->mutable_typedefstructstmt() = typedefStructStmt_proto;
 }
 
 void
 AstWriter::visitTypedefSynonymStmt(shared_ptr <TypedefSynonymStmt> typedefSynonymStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitTypedefSynonymStmt" << endl;
-    bsvproto::TypedefSynonymStmt typedefSynonymStmt_proto;
-    visit(typedefSynonymStmt->sourcePos, typedefSynonymStmt_proto.mutable_sourcepos());
-    typedefSynonymStmt_proto.set_name(typedefSynonymStmt->typedeftype->name);
-    typedefSynonymStmt_proto.set_package(typedefSynonymStmt->package);
-    visit(typedefSynonymStmt->typedeftype, typedefSynonymStmt_proto.mutable_synonymtype());
-    visit(typedefSynonymStmt->type, typedefSynonymStmt_proto.mutable_type());
-
-    *stmt_proto->mutable_typedefsynonymstmt() = typedefSynonymStmt_proto;
+    bsvproto::TypedefSynonymStmt *typedefSynonymStmt_proto = stmt_proto->mutable_typedefsynonymstmt();
+    visit(typedefSynonymStmt->sourcePos, typedefSynonymStmt_proto->mutable_sourcepos());
+    typedefSynonymStmt_proto->set_name(identifierIndex(typedefSynonymStmt->typedeftype->name));
+    typedefSynonymStmt_proto->set_package(identifierIndex(typedefSynonymStmt->package));
+    typedefSynonymStmt_proto->set_synonymtype(typeIndex(typedefSynonymStmt->typedeftype));
+    typedefSynonymStmt_proto->set_type(typeIndex(typedefSynonymStmt->type));
 }
 
 void AstWriter::visitVarBindingStmt(shared_ptr <VarBindingStmt> varBindingStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitVarBindingStmt" << endl;
-    bsvproto::VarBindingStmt varBindingStmt_proto;
-    visit(varBindingStmt->sourcePos, varBindingStmt_proto.mutable_sourcepos());
-    varBindingStmt_proto.set_package(varBindingStmt->package);
-    visit(varBindingStmt->bsvtype, varBindingStmt_proto.mutable_bsvtype());
-    varBindingStmt_proto.set_name(varBindingStmt->name);
-    varBindingStmt_proto.set_op(bsvproto::VALUE);
-    visit(varBindingStmt->rhs, varBindingStmt_proto.mutable_rhs());
-
-    *stmt_proto->mutable_varbindingstmt() = varBindingStmt_proto;
+    bsvproto::VarBindingStmt *varBindingStmt_proto = stmt_proto->mutable_varbindingstmt();
+    visit(varBindingStmt->sourcePos, varBindingStmt_proto->mutable_sourcepos());
+    varBindingStmt_proto->set_package(identifierIndex(varBindingStmt->package));
+    varBindingStmt_proto->set_bsvtype(typeIndex(varBindingStmt->bsvtype));
+    varBindingStmt_proto->set_name(identifierIndex(varBindingStmt->name));
+    varBindingStmt_proto->set_op(bsvproto::VALUE);
+    visit(varBindingStmt->rhs, varBindingStmt_proto->mutable_rhs());
 }
 
 void AstWriter::visitVarAssignStmt(shared_ptr <VarAssignStmt> varAssignStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitVarAssignStmt" << endl;
-    bsvproto::VarAssignStmt varAssignStmt_proto;
-    visit(varAssignStmt->sourcePos, varAssignStmt_proto.mutable_sourcepos());
-    visit(varAssignStmt->lhs, varAssignStmt_proto.mutable_lvalue());
-    varAssignStmt_proto.set_op(varAssignStmt->op == "<-" ? bsvproto::ACTION : bsvproto::VALUE);
-    visit(varAssignStmt->rhs, varAssignStmt_proto.mutable_rhs());
-
-    *stmt_proto->mutable_varassignstmt() = varAssignStmt_proto;
+    bsvproto::VarAssignStmt *varAssignStmt_proto = stmt_proto->mutable_varassignstmt();
+    visit(varAssignStmt->sourcePos, varAssignStmt_proto->mutable_sourcepos());
+    visit(varAssignStmt->lhs, varAssignStmt_proto->mutable_lvalue());
+    varAssignStmt_proto->set_op(bindingOp(varAssignStmt->op));
+    visit(varAssignStmt->rhs, varAssignStmt_proto->mutable_rhs());
 }
 
 void AstWriter::visitRuleDefStmt(shared_ptr <RuleDefStmt> ruleDefStmt, bsvproto::Stmt *stmt_proto) {
     cerr << "visitRuleDefStmt" << endl;
-    bsvproto::RuleDefStmt ruleDefStmt_proto;
-    visit(ruleDefStmt->sourcePos, ruleDefStmt_proto.mutable_sourcepos());
-    ruleDefStmt_proto.set_name(ruleDefStmt->name);
+    bsvproto::RuleDefStmt *ruleDefStmt_proto = stmt_proto->mutable_ruledefstmt();
+    visit(ruleDefStmt->sourcePos, ruleDefStmt_proto->mutable_sourcepos());
+    ruleDefStmt_proto->set_name(identifierIndex(ruleDefStmt->name));
     if (ruleDefStmt->guard) {
-        visit(ruleDefStmt->guard, ruleDefStmt_proto.mutable_guard());
+        visit(ruleDefStmt->guard, ruleDefStmt_proto->mutable_guard());
     }
     for (int i = 0; i < ruleDefStmt->stmts.size(); i++) {
-        bsvproto::Stmt *substmt_proto = ruleDefStmt_proto.add_stmt();
+        bsvproto::Stmt *substmt_proto = ruleDefStmt_proto->add_stmt();
         visit(ruleDefStmt->stmts[i], substmt_proto);
     }
+}
+
+void AstWriter::visitForStmt(shared_ptr <ForStmt> forStmt, bsvproto::Stmt *stmt_proto) {
+    cerr << "visitForStmt" << endl;
+    bsvproto::ForStmt *forStmt_proto = stmt_proto->mutable_forstmt();
+    visit(forStmt->sourcePos, forStmt_proto->mutable_sourcepos());
+    for (int i = 0; i < forStmt->init.size(); i++) {
+        visit(forStmt->init[i], forStmt_proto->add_init());
+    }
+    visit(forStmt->test, forStmt_proto->mutable_test());
+    for (int i = 0; i < forStmt->incr.size(); i++) {
+        visit(forStmt->incr[i], forStmt_proto->add_incr());
+    }
+    visit(forStmt->body, forStmt_proto->mutable_body());
+}
 
-    *stmt_proto->mutable_ruledefstmt() = ruleDefStmt_proto;
+void AstWriter::visitWhileStmt(shared_ptr <WhileStmt> whileStmt, bsvproto::Stmt *stmt_proto) {
+    cerr << "visitWhileStmt" << endl;
+    bsvproto::WhileStmt *whileStmt_proto = stmt_proto->mutable_whilestmt();
+    visit(whileStmt->sourcePos, whileStmt_proto->mutable_sourcepos());
+    visit(whileStmt->test, whileStmt_proto->mutable_test());
+    visit(whileStmt->body, whileStmt_proto->mutable_body());
 }
 
 void AstWriter::visit(const shared_ptr <Expr> &expr, bsvproto::Expr *expr_proto) {
+    if (!expr)
+        return;
     cerr << "visit expr " << expr->exprType << endl;
-    switch (expr->exprType) {
-        case InvalidExprType:
-            //visitInvalidExpr(expr->invalidExpr(), expr_proto);
-            break;
-        case ArraySubExprType:
-            visitArraySubExpr(expr->arraySubExpr(), expr_proto);
-            break;
-        case BitConcatExprType:
-            visitBitConcatExpr(expr->bitConcatExpr(), expr_proto);
-            break;
-        case BitSelExprType:
-            visitBitSelExpr(expr->bitSelExpr(), expr_proto);
-            break;
-        case VarExprType:
-            visitVarExpr(expr->varExpr(), expr_proto);
-            break;
-        case IntConstType:
-            visitIntConst(expr->intConst(), expr_proto);
-            break;
-        case InterfaceExprType:
-            visitInterfaceExpr(expr->interfaceExpr(), expr_proto);
-            break;
-        case SubinterfaceExprType:
-            visitSubinterfaceExpr(expr->subinterfaceExpr(), expr_proto);
-            break;
-        case StringConstType:
-            visitStringConst(expr->stringConst(), expr_proto);
-            break;
-        case OperatorExprType:
-            visitOperatorExpr(expr->operatorExpr(), expr_proto);
-            break;
-        case CallExprType:
-            visitCallExpr(expr->callExpr(), expr_proto);
-            break;
-        case CaseExprType:
-            visitCaseExpr(expr->caseExpr(), expr_proto);
-            break;
-        case FieldExprType:
-            visitFieldExpr(expr->fieldExpr(), expr_proto);
-            break;
-        case CondExprType:
-            visitCondExpr(expr->condExpr(), expr_proto);
-            break;
-        case EnumUnionStructExprType:
-            visitEnumUnionStructExpr(expr->enumUnionStructExpr(), expr_proto);
-            break;
-        case MatchesExprType:
-            visitMatchesExpr(expr->matchesExpr(), expr_proto);
-            break;
-        case MethodExprType:
-            visitMethodExpr(expr->methodExpr(), expr_proto);
-            break;
-        case ValueofExprType:
-            visitValueofExpr(expr->valueofExpr(), expr_proto);
-            break;
-    }
-
+    dispatchExpr(expr, expr_proto);
 }
 
 void AstWriter::visitArraySubExpr(shared_ptr <ArraySubExpr> arraySubExpr, bsvproto::Expr *expr_proto) {
     cerr << "visitArraySubExpr" << endl;
-    bsvproto::ArraySubExpr arraySubExpr_proto;
-    visit(arraySubExpr->bsvtype, arraySubExpr_proto.mutable_bsvtype());
-    visit(arraySubExpr->array, arraySubExpr_proto.mutable_array());
-    visit(arraySubExpr->index, arraySubExpr_proto.mutable_index());
-
-    *expr_proto->mutable_arraysubexpr() = arraySubExpr_proto;
+    bsvproto::ArraySubExpr *arraySubExpr_proto = expr_proto->mutable_arraysubexpr();
+    visitExprSourcePos(arraySubExpr->sourcePos, arraySubExpr_proto);
+    arraySubExpr_proto->set_bsvtype(typeIndex(arraySubExpr->bsvtype));
+    visit(arraySubExpr->array, arraySubExpr_proto->mutable_array());
+    visit(arraySubExpr->index, arraySubExpr_proto->mutable_index());
 }
 
 void AstWriter::visitBitConcatExpr(shared_ptr <BitConcatExpr> bitConcatExpr, bsvproto::Expr *expr_proto) {
     cerr << "visitBitConcatExpr" << endl;
-    bsvproto::BitConcatExpr bitConcatExpr_proto;
-    visit(bitConcatExpr->bsvtype, bitConcatExpr_proto.mutable_bsvtype());
+    bsvproto::BitConcatExpr *bitConcatExpr_proto = expr_proto->mutable_bitconcatexpr();
+    visitExprSourcePos(bitConcatExpr->sourcePos, bitConcatExpr_proto);
+    bitConcatExpr_proto->set_bsvtype(typeIndex(bitConcatExpr->bsvtype));
     for (int i = 0; i < bitConcatExpr->values.size(); i++) {
-        visit(bitConcatExpr->values[i], bitConcatExpr_proto.add_value());
+        visit(bitConcatExpr->values[i], bitConcatExpr_proto->add_value());
     }
-
-    *expr_proto->mutable_bitconcatexpr() = bitConcatExpr_proto;
 }
 
 void AstWriter::visitBitSelExpr(shared_ptr <BitSelExpr> bitSelExpr, bsvproto::Expr *expr_proto) {
     cerr << "visitBitSelExpr" << endl;
 
-    bsvproto::BitSelExpr bitSelExpr_proto;
-    visit(bitSelExpr->bsvtype, bitSelExpr_proto.mutable_bsvtype());
-    visit(bitSelExpr->value, bitSelExpr_proto.mutable_value());
-    visit(bitSelExpr->msb, bitSelExpr_proto.mutable_msb());
+    bsvproto::BitSelExpr *bitSelExpr_proto = expr_proto->mutable_bitselexpr();
+    visitExprSourcePos(bitSelExpr->sourcePos, bitSelExpr_proto);
+    bitSelExpr_proto->set_bsvtype(typeIndex(bitSelExpr->bsvtype));
+    visit(bitSelExpr->value, bitSelExpr_proto->mutable_value());
+    visit(bitSelExpr->msb, bitSelExpr_proto->mutable_msb());
     if (bitSelExpr->lsb)
-        visit(bitSelExpr->lsb, bitSelExpr_proto.mutable_lsb());
-
-    *expr_proto->mutable_bitselexpr() = bitSelExpr_proto;
+        visit(bitSelExpr->lsb, bitSelExpr_proto->mutable_lsb());
 }
 
 void AstWriter::visitVarExpr(shared_ptr <VarExpr> varExpr, bsvproto::Expr *expr_proto) {
     cerr << "visitVarExpr " << varExpr->sourceName << endl;
-    bsvproto::VarExpr varExpr_proto;
-    varExpr_proto.set_sourcename(varExpr->sourceName);
-    varExpr_proto.set_uniquename(varExpr->name);
-    visit(varExpr->bsvtype, varExpr_proto.mutable_bsvtype());
-
-    *expr_proto->mutable_varexpr() = varExpr_proto;
+    bsvproto::VarExpr *varExpr_proto = expr_proto->mutable_varexpr();
+    visitExprSourcePos(varExpr->sourcePos, varExpr_proto);
+    varExpr_proto->set_sourcename(identifierIndex(varExpr->sourceName));
+    varExpr_proto->set_uniquename(identifierIndex(varExpr->name));
+    varExpr_proto->set_bsvtype(typeIndex(varExpr->bsvtype));
 }
 
 void AstWriter::visitIntConst(shared_ptr <IntConst> intConst, bsvproto::Expr *expr_proto) {
-    bsvproto::IntConst intConst_proto;
-    intConst_proto.set_value(intConst->value);
-    intConst_proto.set_base(intConst->base);
-    intConst_proto.set_width(intConst->width);
-
-    *expr_proto->mutable_intconst() = intConst_proto;
+    bsvproto::IntConst *intConst_proto = expr_proto->mutable_intconst();
+    visitExprSourcePos(intConst->sourcePos, intConst_proto);
+    intConst_proto->set_value(intConst->value);
+    intConst_proto->set_base(intConst->base);
+    intConst_proto->set_width(intConst->width);
+    intConst_proto->set_repr(identifierIndex(intConst->repr));
 }
 
 void AstWriter::visitInterfaceExpr(shared_ptr <InterfaceExpr> interfaceExpr, bsvproto::Expr *expr_proto) {
-    cerr << "FIXME visitInterfaceExpr" << endl;
+    bsvproto::InterfaceExpr *interfaceExpr_proto = expr_proto->mutable_interfaceexpr();
+    visitExprSourcePos(interfaceExpr->sourcePos, interfaceExpr_proto);
+    interfaceExpr_proto->set_bsvtype(typeIndex(interfaceExpr->bsvtype));
+    if (interfaceExpr->stmts.size())
+        cerr << "AstWriter: the stmts of interface expressions are not written" << endl;
 }
 
 void AstWriter::visitSubinterfaceExpr(shared_ptr <SubinterfaceExpr> subinterfaceExpr, bsvproto::Expr *expr_proto) {
-    cerr << "FIXME visitSubinterfaceExpr" << endl;
-
+    bsvproto::SubinterfaceExpr *subinterfaceExpr_proto = expr_proto->mutable_subinterfaceexpr();
+    visitExprSourcePos(subinterfaceExpr->sourcePos, subinterfaceExpr_proto);
+    subinterfaceExpr_proto->set_bsvtype(typeIndex(subinterfaceExpr->bsvtype));
+    visit(subinterfaceExpr->object, subinterfaceExpr_proto->mutable_object());
+    subinterfaceExpr_proto->set_subinterfacename(identifierIndex(subinterfaceExpr->subinterfaceName));
 }
 
 void AstWriter::visitStringConst(shared_ptr <StringConst> stringConst, bsvproto::Expr *expr_proto) {
-    bsvproto::StringConst stringConst_proto;
-    stringConst_proto.set_value(stringConst->repr);
-
-    *expr_proto->mutable_stringconst() = stringConst_proto;
+    bsvproto::StringConst *stringConst_proto = expr_proto->mutable_stringconst();
+    visitExprSourcePos(stringConst->sourcePos, stringConst_proto);
+    stringConst_proto->set_value(identifierIndex(stringConst->repr));
 }
 
 void AstWriter::visitOperatorExpr(shared_ptr <OperatorExpr> operatorExpr, bsvproto::Expr *expr_proto) {
     cerr << "visitOperatorExpr " << operatorExpr->op << endl;
-    bsvproto::OperatorExpr operatorExpr_proto;
+    bsvproto::OperatorExpr *operatorExpr_proto = expr_proto->mutable_operatorexpr();
+    visitExprSourcePos(operatorExpr->sourcePos, operatorExpr_proto);
     if (operatorExpr->bsvtype)
-        visit(operatorExpr->bsvtype, operatorExpr_proto.mutable_bsvtype());
-    operatorExpr_proto.set_op(operatorExpr->op);
-    visit(operatorExpr->lhs, operatorExpr_proto.mutable_lhs());
-    visit(operatorExpr->rhs, operatorExpr_proto.mutable_rhs());
-
-    *expr_proto->mutable_operatorexpr() = operatorExpr_proto;
+        operatorExpr_proto->set_bsvtype(typeIndex(operatorExpr->bsvtype));
+    operatorExpr_proto->set_op(identifierIndex(operatorExpr->op));
+    visit(operatorExpr->lhs, operatorExpr_proto->mutable_lhs());
+    visit(operatorExpr->rhs, operatorExpr_proto->mutable_rhs());
 }
 
 void AstWriter::visitCallExpr(shared_ptr <CallExpr> callExpr, bsvproto::Expr *expr_proto) {
     cerr << "visitCallExpr " << endl;
-    bsvproto::CallExpr callExpr_proto;
+    bsvproto::CallExpr *callExpr_proto = expr_proto->mutable_callexpr();
+    visitExprSourcePos(callExpr->sourcePos, callExpr_proto);
     if (callExpr->bsvtype)
-        visit(callExpr->bsvtype, callExpr_proto.mutable_bsvtype());
-    visit(callExpr->function, callExpr_proto.mutable_function());
+        callExpr_proto->set_bsvtype(typeIndex(callExpr->bsvtype));
+    visit(callExpr->function, callExpr_proto->mutable_function());
     for (int i = 0; i < callExpr->args.size(); i++) {
-        visit(callExpr->args[i], callExpr_proto.add_arg());
+        visit(callExpr->args[i], callExpr_proto->add_arg());
     }
-
-    *expr_proto->mutable_callexpr() = callExpr_proto;
 }
 
 void AstWriter::visitCaseExpr(shared_ptr<CaseExpr> caseExpr, bsvproto::Expr *expr_proto) {
     cerr << "visitCaseExpr " << endl;
-    bsvproto::CaseExpr caseExpr_proto;
-    visit(caseExpr->sourcePos, caseExpr_proto.mutable_sourcepos());
+    bsvproto::CaseExpr *caseExpr_proto = expr_proto->mutable_caseexpr();
+    visitExprSourcePos(caseExpr->sourcePos, caseExpr_proto);
     if (caseExpr->bsvtype)
-        visit(caseExpr->bsvtype, caseExpr_proto.mutable_bsvtype());
-    visit(caseExpr->matchValue, caseExpr_proto.mutable_matchvalue());
-
-    *expr_proto->mutable_caseexpr() = caseExpr_proto;
+        caseExpr_proto->set_bsvtype(typeIndex(caseExpr->bsvtype));
+    visit(caseExpr->matchValue, caseExpr_proto->mutable_matchvalue());
+    for (int i = 0; i < caseExpr->exprItems.size(); i++) {
+        const shared_ptr<CaseExprItem> &item = caseExpr->exprItems[i];
+        bsvproto::CaseExprItem *item_proto = caseExpr_proto->add_expritem();
+        visitExprSourcePos(item->sourcePos, item_proto);
+        for (int j = 0; j < item->exprMatch.size(); j++) {
+            visit(item->exprMatch[j], item_proto->add_exprmatch());
+        }
+        if (item->patternMatch)
+            visit(item->patternMatch, item_proto->mutable_patternmatch());
+        for (int j = 0; j < item->patternCond.size(); j++) {
+            visit(item->patternCond[j], item_proto->add_patterncond());
+        }
+        visit(item->expr, item_proto->mutable_expr());
+    }
 }
 
 void AstWriter::visitFieldExpr(shared_ptr <FieldExpr> fieldExpr, bsvproto::Expr *expr_proto) {
-    bsvproto::FieldExpr fieldExpr_proto;
+    bsvproto::FieldExpr *fieldExpr_proto = expr_proto->mutable_fieldexpr();
+    visitExprSourcePos(fieldExpr->sourcePos, fieldExpr_proto);
     if (fieldExpr->bsvtype)
-        visit(fieldExpr->bsvtype, fieldExpr_proto.mutable_bsvtype());
-    visit(fieldExpr->object, fieldExpr_proto.mutable_object());
-    fieldExpr_proto.set_fieldname(fieldExpr->fieldName);
-
-    *expr_proto->mutable_fieldexpr() = fieldExpr_proto;
+        fieldExpr_proto->set_bsvtype(typeIndex(fieldExpr->bsvtype));
+    visit(fieldExpr->object, fieldExpr_proto->mutable_object());
+    fieldExpr_proto->set_fieldname(identifierIndex(fieldExpr->fieldName));
 }
 
 void AstWriter::visitCondExpr(shared_ptr <CondExpr> condExpr, bsvproto::Expr *expr_proto) {
-    bsvproto::CondExpr condExpr_proto;
+    bsvproto::CondExpr *condExpr_proto = expr_proto->mutable_condexpr();
+    visitExprSourcePos(condExpr->sourcePos, condExpr_proto);
     if (condExpr->bsvtype)
-        visit(condExpr->bsvtype, condExpr_proto.mutable_bsvtype());
-    visit(condExpr->cond, condExpr_proto.mutable_cond());
-    visit(condExpr->thenExpr, condExpr_proto.mutable_thenexpr());
-    visit(condExpr->elseExpr, condExpr_proto.mutable_elseexpr());
-
-    *expr_proto->mutable_condexpr() = condExpr_proto;
+        condExpr_proto->set_bsvtype(typeIndex(condExpr->bsvtype));
+    visit(condExpr->cond, condExpr_proto->mutable_cond());
+    visit(condExpr->thenExpr, condExpr_proto->mutable_thenexpr());
+    visit(condExpr->elseExpr, condExpr_proto->mutable_elseexpr());
 }
 
 void
 AstWriter::visitEnumUnionStructExpr(shared_ptr <EnumUnionStructExpr> enumUnionStructExpr, bsvproto::Expr *expr_proto) {
-    cerr << "FIXME: visitEnumUnionStructExpr" << endl;
-    //FIXME tagged expr
+    bsvproto::EnumUnionStructExpr *enumUnionStructExpr_proto = expr_proto->mutable_enumunionstructexpr();
+    visitExprSourcePos(enumUnionStructExpr->sourcePos, enumUnionStructExpr_proto);
+    enumUnionStructExpr_proto->set_bsvtype(typeIndex(enumUnionStructExpr->bsvtype));
+    enumUnionStructExpr_proto->set_tag(identifierIndex(enumUnionStructExpr->tag));
+    for (int i = 0; i < enumUnionStructExpr->keys.size(); i++) {
+        enumUnionStructExpr_proto->add_key(identifierIndex(enumUnionStructExpr->keys[i]));
+        visit(enumUnionStructExpr->vals[i], enumUnionStructExpr_proto->add_val());
+    }
 }
 
 void AstWriter::visitMatchesExpr(shared_ptr <MatchesExpr> matchesExpr, bsvproto::Expr *expr_proto) {
-    bsvproto::MatchesExpr matchesExpr_proto;
+    bsvproto::MatchesExpr *matchesExpr_proto = expr_proto->mutable_matchesexpr();
+    visitExprSourcePos(matchesExpr->sourcePos, matchesExpr_proto);
     if (matchesExpr->bsvtype)
-        visit(matchesExpr->bsvtype, matchesExpr_proto.mutable_bsvtype());
-    visit(matchesExpr->expr, matchesExpr_proto.mutable_expr());
-    visit(matchesExpr->pattern, matchesExpr_proto.mutable_pattern());
+        matchesExpr_proto->set_bsvtype(typeIndex(matchesExpr->bsvtype));
+    visit(matchesExpr->expr, matchesExpr_proto->mutable_expr());
+    visit(matchesExpr->pattern, matchesExpr_proto->mutable_pattern());
     for (int i = 0; i < matchesExpr->patterncond.size(); i++) {
-        visit(matchesExpr->patterncond[i], matchesExpr_proto.add_patterncond());
+        visit(matchesExpr->patterncond[i], matchesExpr_proto->add_patterncond());
     }
-    *expr_proto->mutable_matchesexpr() = matchesExpr_proto;
 }
 
 void AstWriter::visitMethodExpr(shared_ptr <MethodExpr> methodExpr, bsvproto::Expr *expr_proto) {
-    cerr << "FIXME: visitMethodExpr" << endl;
+    bsvproto::MethodExpr *methodExpr_proto = expr_proto->mutable_methodexpr();
+    visitExprSourcePos(methodExpr->sourcePos, methodExpr_proto);
+    methodExpr_proto->set_bsvtype(typeIndex(methodExpr->bsvtype));
+    visit(methodExpr->object, methodExpr_proto->mutable_object());
+    methodExpr_proto->set_methodname(identifierIndex(methodExpr->methodName));
 }
 
 void AstWriter::visitValueofExpr(shared_ptr <ValueofExpr> valueofExpr, bsvproto::Expr *expr_proto) {
-    bsvproto::ValueofExpr valueofExpr_proto;
+    bsvproto::ValueofExpr *valueofExpr_proto = expr_proto->mutable_valueofexpr();
+    visitExprSourcePos(valueofExpr->sourcePos, valueofExpr_proto);
     if (valueofExpr->bsvtype)
-        visit(valueofExpr->bsvtype, valueofExpr_proto.mutable_bsvtype());
-    visit(valueofExpr->argtype, valueofExpr_proto.mutable_argtype());
+        valueofExpr_proto->set_bsvtype(typeIndex(valueofExpr->bsvtype));
+    valueofExpr_proto->set_argtype(typeIndex(valueofExpr->argtype));
+}
+
+uint32_t AstWriter::typeIndex(const shared_ptr<BSVType> &bsvtype) {
+    if (!bsvtype)
+        return 0;
+    auto it = typeIndices.find(bsvtype);
+    if (it != typeIndices.cend())
+        return it->second;
+    bsvproto::BSVType bsvtype_proto;
+    bsvtype_proto.set_name(identifierIndex(bsvtype->name));
+    bsvtype_proto.set_isvar(bsvtype->isVar);
+    bsvtype_proto.set_kind(bsvtype->kind == BSVType_Symbolic ? bsvproto::Symbolic : bsvproto::Numeric);
+    for (int i = 0; i < bsvtype->params.size(); i++) {
+        bsvtype_proto.add_param(typeIndex(bsvtype->params[i]));
+    }
+    // structurally equal types share an entry
+    string key = bsvtype_proto.SerializeAsString();
+    auto entry = typeEntries.find(key);
+    uint32_t index;
+    if (entry != typeEntries.cend()) {
+        index = entry->second;
+    } else {
+        index = index_proto.type_size();
+        *index_proto.add_type() = bsvtype_proto;
+        typeEntries[key] = index;
+    }
+    typeIndices[bsvtype] = index;
+    return index;
+}
 
-    *expr_proto->mutable_valueofexpr() = valueofExpr_proto;
+uint32_t AstWriter::identifierIndex(const std::string &name) {
+    auto it = identifiers.find(name);
+    if (it != identifiers.cend())
+        return it->second;
+    uint32_t index = index_proto.identifier_size();
+    index_proto.add_identifier(name);
+    identifiers[name] = index;
+    return index;
 }
 
-void AstWriter::visit(const shared_ptr <BSVType> &bsvtype, bsvproto::BSVType *bsvtype_proto) {
-    cerr << "visit bsvtype " << bsvtype->name << endl;
-    bsvtype_proto->set_name(bsvtype->name);
-    bsvtype_proto->set_isvar(bsvtype->isVar);
-    bsvtype_proto->set_kind(bsvtype->kind == BSVType_Symbolic ? bsvproto::Symbolic : bsvproto::Numeric);
-    for (int i = 0; i < bsvtype->params.size(); i++) {
-        visit(bsvtype->params[i], bsvtype_proto->add_param());
-    }
+uint32_t AstWriter::filenameIndex(const std::string &name) {
+    auto it = filenames.find(name);
+    if (it != filenames.cend())
+        return it->second;
+    uint32_t index = index_proto.filename_size();
+    index_proto.add_filename(name);
+    filenames[name] = index;
+    return index;
 }
 
 void AstWriter::visit(const SourcePos &sourcePos, bsvproto::SourcePos *sourcePos_proto) {
-    sourcePos_proto->set_filename(sourcePos.sourceName);
+    sourcePos_proto->set_filename(filenameIndex(sourcePos.sourceName));
     sourcePos_proto->set_linenumber(sourcePos.line);
 }
 
 void AstWriter::visit(const shared_ptr <Pattern> &pattern, bsvproto::Pattern *pattern_proto) {
+    if (!pattern)
+        return;
     cerr << "visitPattern " << endl;
-    switch (pattern->patternType) {
-        case InvalidPatternType:
-            cerr << "InvalidPatternType" << endl;
-            break;
-        case IntPatternType:
-            visitIntPattern(pattern->intPattern(), pattern_proto);
-            break;
-        case TaggedPatternType:
-            visitTaggedPattern(pattern->taggedPattern(), pattern_proto);
-            break;
-        case TuplePatternType:
-            visitTuplePattern(pattern->tuplePattern(), pattern_proto);
-            break;
-        case VarPatternType:
-            visitVarPattern(pattern->varPattern(), pattern_proto);
-            break;
-        case WildcardPatternType:
-            visitWildcardPattern(pattern->wildcardPattern(), pattern_proto);
-            break;
-    }
+    if (pattern->patternType == InvalidPatternType)
+        cerr << "InvalidPatternType" << endl;
+    dispatchPattern(pattern, pattern_proto);
 }
 
 
 void AstWriter::visitIntPattern(const shared_ptr <IntPattern> &intPattern, bsvproto::Pattern *pattern_proto) {
-    bsvproto::IntPattern intPattern_proto;
-    intPattern_proto.set_value(intPattern->value);
-
-    *pattern_proto->mutable_intpattern() = intPattern_proto;
+    bsvproto::IntPattern *intPattern_proto = pattern_proto->mutable_intpattern();
+    intPattern_proto->set_value(intPattern->value);
 }
 
 void AstWriter::visitTaggedPattern(const shared_ptr <TaggedPattern> &taggedPattern,
                                    bsvproto::Pattern *pattern_proto) {
-    bsvproto::TaggedPattern taggedPattern_proto;
-    taggedPattern_proto.set_name(taggedPattern->value);
+    bsvproto::TaggedPattern *taggedPattern_proto = pattern_proto->mutable_taggedpattern();
+    taggedPattern_proto->set_name(identifierIndex(taggedPattern->value));
     if (taggedPattern->pattern)
-        visit(taggedPattern->pattern, taggedPattern_proto.mutable_pattern());
-
-    *pattern_proto->mutable_taggedpattern() = taggedPattern_proto;
+        visit(taggedPattern->pattern, taggedPattern_proto->mutable_pattern());
 }
 
 void
 AstWriter::visitTuplePattern(const shared_ptr <TuplePattern> &tuplePattern, bsvproto::Pattern *pattern_proto) {
-    bsvproto::TuplePattern tuplePattern_proto;
+    bsvproto::TuplePattern *tuplePattern_proto = pattern_proto->mutable_tuplepattern();
     for (int i = 0; i < tuplePattern->subpatterns.size(); i++) {
-        visit(tuplePattern->subpatterns[i], tuplePattern_proto.add_subpattern());
+        visit(tuplePattern->subpatterns[i], tuplePattern_proto->add_subpattern());
     }
-    *pattern_proto->mutable_tuplepattern() = tuplePattern_proto;
 }
 
 void AstWriter::visitVarPattern(const shared_ptr <VarPattern> &varPattern, bsvproto::Pattern *pattern_proto) {
-    bsvproto::VarPattern varPattern_proto;
-    varPattern_proto.set_name(varPattern->value);
-    *pattern_proto->mutable_varpattern() = varPattern_proto;
+    bsvproto::VarPattern *varPattern_proto = pattern_proto->mutable_varpattern();
+    varPattern_proto->set_name(identifierIndex(varPattern->value));
 }
 
 void AstWriter::visitWildcardPattern(const shared_ptr <WildcardPattern> &wildcardPattern,
                                      bsvproto::Pattern *pattern_proto) {
-    bsvproto::WildcardPattern wildcardPattern_proto;
-    *pattern_proto->mutable_wildcardpattern() = wildcardPattern_proto;
+    // the empty message only selects the case
+    pattern_proto->mutable_wildcardpattern();
 }
 
 void AstWriter::visit(const shared_ptr <LValue> &lvalue, bsvproto::LValue *lvalue_proto) {
+    if (!lvalue)
+        return;
     cerr << "visit LValue " << lvalue->lvalueType << endl;
-    switch (lvalue->lvalueType) {
-        case InvalidLValueType:
-            break;
-        case ArraySubLValueType:
-            visitArraySubLValue(lvalue->arraySubLValue(), lvalue_proto);
-            break;
-        case FieldLValueType:
-            visitFieldLValue(lvalue->fieldLValue(), lvalue_proto);
-            break;
-        case VarLValueType:
-            visitVarLValue(lvalue->varLValue(), lvalue_proto);
-            break;
-        case RangeSelLValueType:
-            visitRangeSelLValue(lvalue->rangeSelLValue(), lvalue_proto);
-            break;
-    }
+    dispatchLValue(lvalue, lvalue_proto);
 }
 
 void AstWriter::visitArraySubLValue(const shared_ptr<ArraySubLValue> &arraySubLValue, bsvproto::LValue *lvalue_proto) {
-    bsvproto::ArraySubLValue arraySubLValue_proto;
-    visit(arraySubLValue->array, arraySubLValue_proto.mutable_array());
-    visit(arraySubLValue->index, arraySubLValue_proto.mutable_index());
-
-    *lvalue_proto->mutable_array() = arraySubLValue_proto;
+    bsvproto::ArraySubLValue *arraySubLValue_proto = lvalue_proto->mutable_array();
+    visit(arraySubLValue->array, arraySubLValue_proto->mutable_array());
+    visit(arraySubLValue->index, arraySubLValue_proto->mutable_index());
 }
 
 void AstWriter::visitFieldLValue(const shared_ptr<FieldLValue> &fieldLValue, bsvproto::LValue *lvalue_proto) {
-    bsvproto::FieldLValue fieldLValue_proto;
-    visit(fieldLValue->obj, fieldLValue_proto.mutable_obj());
-    fieldLValue_proto.set_field(fieldLValue->field);
-
-    *lvalue_proto->mutable_field() = fieldLValue_proto;
+    bsvproto::FieldLValue *fieldLValue_proto = lvalue_proto->mutable_field();
+    visit(fieldLValue->obj, fieldLValue_proto->mutable_obj());
+    fieldLValue_proto->set_field(identifierIndex(fieldLValue->field));
 }
 
 void AstWriter::visitVarLValue(const shared_ptr<VarLValue> &varLValue, bsvproto::LValue *lvalue_proto) {
-    bsvproto::VarLValue varLValue_proto;
-    varLValue_proto.set_name(varLValue->name);
+    bsvproto::VarLValue *varLValue_proto = lvalue_proto->mutable_var();
+    varLValue_proto->set_name(identifierIndex(varLValue->name));
     if (varLValue->bsvtype)
-        visit(varLValue->bsvtype, varLValue_proto.mutable_bsvtype());
-
-    *lvalue_proto->mutable_var() = varLValue_proto;
+        varLValue_proto->set_bsvtype(typeIndex(varLValue->bsvtype));
 }
 
 void AstWriter::visitRangeSelLValue(const shared_ptr<RangeSelLValue> &rangeSelLValue, bsvproto::LValue *lvalue_proto) {
-    bsvproto::RangeSelLValue rangeSelLValue_proto;
-    visit(rangeSelLValue->bitarray, rangeSelLValue_proto.mutable_array());
-    visit(rangeSelLValue->lsb, rangeSelLValue_proto.mutable_lsb());
-    visit(rangeSelLValue->msb, rangeSelLValue_proto.mutable_msb());
-
-    *lvalue_proto->mutable_range() = rangeSelLValue_proto;
+    bsvproto::RangeSelLValue *rangeSelLValue_proto = lvalue_proto->mutable_range();
+    visit(rangeSelLValue->bitarray, rangeSelLValue_proto->mutable_array());
+    visit(rangeSelLValue->lsb, rangeSelLValue_proto->mutable_lsb());
+    visit(rangeSelLValue->msb, rangeSelLValue_proto->mutable_msb());
 }
@@ -4,29 +4,77 @@
 
 #pragma once
 
+#include <fstream>
+#include <map>
+#include <stdint.h>
 #include <string>
-#include "AstVisitor.h"
+#include <vector>
+#include <google/protobuf/arena.h>
+#include "AstDispatch.h"
+#include "AstImage.h"
 #include "source_pos.pb.h"
 #include "expr.pb.h"
 #include "pattern.pb.h"
 #include "lvalue.pb.h"
 #include "stmt.pb.h"
 
-class AstWriter {
+// Writes a package to a .ast file, one length-delimited Stmt record per
+// top-level statement as soon as it has been converted, followed by an
+// index of the records by declaration name and the tables of the
+// identifiers, file names and types the records refer to. See AstIndex in stmt.proto for
+// the layout.
+class AstWriter : public StmtDispatcher<AstWriter, void, bsvproto::Stmt *>,
+                  public ExprDispatcher<AstWriter, void, bsvproto::Expr *>,
+                  public LValueDispatcher<AstWriter, void, bsvproto::LValue *>,
+                  public PatternDispatcher<AstWriter, void, bsvproto::Pattern *> {
 private:
-    bsvproto::PackageDef packagedef_proto;
+    std::ofstream output;
+    uint64_t offset = 0;
+    bsvproto::AstIndex index_proto;
+    map<std::string, uint32_t> identifiers;
+    map<std::string, uint32_t> filenames;
+    map<shared_ptr<BSVType>, uint32_t> typeIndices;
+    // serialized entries of the type table
+    map<std::string, uint32_t> typeEntries;
+    // position of the statement being written, which its expressions share unless they have their own
+    const SourcePos *stmtSourcePos = nullptr;
+    AstImageWriter *imageWriter = nullptr;
+    // each top-level statement is built on the arena, which is reset after its record is
+    // written, so its first block is reused by every record of every package
+    std::vector<char> arenaBlock;
+    google::protobuf::Arena arena;
+    std::string record;
+
+    static google::protobuf::ArenaOptions arenaOptions(std::vector<char> &block);
+
+    void writeRecord(const google::protobuf::MessageLite &message);
 public:
     AstWriter();
 
     virtual ~AstWriter() noexcept;
 
-    bool writeAst(std::string filename);
+    bool open(const std::string &filename);
+
+    // writes the index
+    bool close();
+
+    // also streams each top-level statement to imageWriter, which the caller opens and closes
+    void setImageWriter(AstImageWriter *imageWriter) { this->imageWriter = imageWriter; }
+
+    static std::string declarationName(const shared_ptr<Stmt> &stmt);
+
+    static bsvproto::BindingOp bindingOp(const std::string &op);
 
     void visit(const shared_ptr<Stmt> &stmt, bsvproto::Stmt *stmt_proto = nullptr);
 
     void visit(const shared_ptr<Expr> &expr, bsvproto::Expr *expr_proto);
 
-    void visit(const shared_ptr<BSVType> &bsvtype, bsvproto::BSVType *bsvtype_proto);
+    // indices in the tables of the index
+    uint32_t typeIndex(const shared_ptr<BSVType> &bsvtype);
+
+    uint32_t identifierIndex(const std::string &name);
+
+    uint32_t filenameIndex(const std::string &name);
 
     void visit(const shared_ptr<LValue> &lvalue, bsvproto::LValue *lvalue_proto);
 
@@ -34,10 +82,15 @@ public:
 
     void visit(const SourcePos &sourcePos, bsvproto::SourcePos *sourcePos_proto);
 
+    // leaves out the position of an expression or case item that is on the line of its statement
+    template <typename ExprProto>
+    void visitExprSourcePos(const SourcePos &sourcePos, ExprProto *expr_proto) {
+        if (!stmtSourcePos || sourcePos.line != stmtSourcePos->line || sourcePos.sourceName != stmtSourcePos->sourceName)
+            visit(sourcePos, expr_proto->mutable_sourcepos());
+    }
 
-    void visitPackageDefStmt(const shared_ptr<PackageDefStmt> packageDef);
 
-    static bsvproto::SourcePos *newSourcePos(const SourcePos &sourcePos);
+    void visitPackageDefStmt(const shared_ptr<PackageDefStmt> packageDef, bsvproto::Stmt *stmt_proto = nullptr);
 
     void visitActionBindingStmt(shared_ptr<ActionBindingStmt> stmt, bsvproto::Stmt *stmt_proto);
 
@@ -87,6 +140,10 @@ public:
 
     void visitRuleDefStmt(shared_ptr<RuleDefStmt> ruleDefStmt, bsvproto::Stmt *stmt_proto);
 
+    void visitForStmt(shared_ptr<ForStmt> forStmt, bsvproto::Stmt *stmt_proto);
+
+    void visitWhileStmt(shared_ptr<WhileStmt> whileStmt, bsvproto::Stmt *stmt_proto);
+
     void visitArraySubExpr(shared_ptr<ArraySubExpr> arraySubExprType, bsvproto::Expr *expr_proto);
 
     void visitBitConcatExpr(shared_ptr<BitConcatExpr> bitConcatExprType, bsvproto::Expr *expr_proto);
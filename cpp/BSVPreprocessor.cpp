@@ -10,9 +10,10 @@
 #include <stdio.h>
 #include "BSVLexer.h"
 #include "BSVPreprocessor.h"
+#include "MappedCharStream.h"
 
 BSVPreprocessor::BSVPreprocessor(string inputFileName) {
-    shared_ptr<ANTLRFileStream> inputStream(new ANTLRFileStream(inputFileName));
+    shared_ptr<MappedCharStream> inputStream(new MappedCharStream(inputFileName));
     shared_ptr<BSVLexer> lexer(new BSVLexer(inputStream.get()));
     inputStreams.push_back(inputStream);
     tokenSources.push_back(lexer);
@@ -14,7 +14,7 @@ using namespace antlr4;
 using namespace std;
 
 class BSVPreprocessor : public TokenSource {
-    vector<shared_ptr<ANTLRInputStream>> inputStreams;
+    vector<shared_ptr<CharStream>> inputStreams;
     vector<shared_ptr<BSVLexer>> tokenSources;
     vector<bool> condStack;
     vector<bool> validStack;
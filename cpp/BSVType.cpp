@@ -80,6 +80,15 @@ long BSVType::numericValue() const {
     }
 }
 
+int BSVType::bitWidth() const {
+    if (params.size() != 1 || (name != "Bit" && name != "Int" && name != "UInt"))
+        return 0;
+    const shared_ptr<BSVType> &width = params[0];
+    if (!width->isNumeric() || width->name.empty() || width->name.find_first_not_of("0123456789") != string::npos)
+        return 0;
+    return (int)width->numericValue();
+}
+
 void BSVType::prettyPrint(ostream &out, int depth) const {
     out << name;
     if (params.size()) {
@@ -48,6 +48,8 @@ public:
 
     bool isConstant() const;
     long numericValue() const;
+    // n for Bit#(n), Int#(n) and UInt#(n) with a constant n, otherwise 0
+    int bitWidth() const;
 
     virtual void prettyPrint(ostream &out, int depth = 0) const;
 
@@ -0,0 +1,434 @@
+#include <assert.h>
+#include <ctype.h>
+#include <algorithm>
+
+#include "BitVector.h"
+
+typedef unsigned __int128 uint128_t;
+
+BitVector::BitVector(int width, uint64_t value) {
+    resize(width);
+    if (width) {
+        words()[0] = value;
+        clearUnusedBits();
+    }
+}
+
+void BitVector::resize(int newWidth) {
+    width = newWidth;
+    small[0] = small[1] = 0;
+    if (width > inlineWords * wordBits)
+        large.assign(numWords(), 0);
+    else
+        large.clear();
+}
+
+void BitVector::clearUnusedBits() {
+    int usedBits = width % wordBits;
+    if (usedBits)
+        words()[numWords() - 1] &= (1ul << usedBits) - 1;
+}
+
+// w = w * mul + add, truncated to n words
+static void mulAdd(uint64_t *w, int n, uint64_t mul, uint64_t add) {
+    uint64_t carry = add;
+    for (int i = 0; i < n; i++) {
+        uint128_t t = (uint128_t)w[i] * mul + carry;
+        w[i] = (uint64_t)t;
+        carry = (uint64_t)(t >> 64);
+    }
+}
+
+// w = w / div, returns the remainder
+static uint64_t divRem(uint64_t *w, int n, uint64_t div) {
+    uint128_t rem = 0;
+    for (int i = n - 1; i >= 0; i--) {
+        uint128_t t = (rem << 64) | w[i];
+        w[i] = (uint64_t)(t / div);
+        rem = t % div;
+    }
+    return (uint64_t)rem;
+}
+
+BitVector BitVector::fromString(const string &repr, int defaultWidth) {
+    size_t pos = 0;
+    int width = 0;
+    while (pos < repr.size() && isdigit(repr[pos]))
+        width = width * 10 + (repr[pos++] - '0');
+    int base = 10;
+    if (pos < repr.size() && repr[pos] == '\'') {
+        pos++;
+        if (pos == 1)
+            width = defaultWidth;
+        if (pos < repr.size() && (repr[pos] == 's' || repr[pos] == 'S'))
+            pos++;
+        if (pos < repr.size()) {
+            switch (tolower(repr[pos])) {
+                case 'b': base = 2; pos++; break;
+                case 'o': base = 8; pos++; break;
+                case 'd': base = 10; pos++; break;
+                case 'h': base = 16; pos++; break;
+                case '1':
+                    // '1 sets all of the bits
+                    return ~BitVector(width);
+                default:
+                    break;
+            }
+        }
+    } else {
+        // an unsized decimal literal
+        width = defaultWidth;
+        pos = 0;
+    }
+
+    BitVector result(width);
+    uint64_t *w = result.words();
+    int n = result.numWords();
+    for (; pos < repr.size(); pos++) {
+        char c = tolower(repr[pos]);
+        if (c == '_')
+            continue;
+        int digit = isdigit(c) ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : base;
+        if (digit >= base)
+            break;
+        mulAdd(w, n, base, digit);
+    }
+    result.clearUnusedBits();
+    return result;
+}
+
+bool BitVector::bit(int index) const {
+    return (words()[index / wordBits] >> (index % wordBits)) & 1;
+}
+
+bool BitVector::isZero() const {
+    const uint64_t *w = words();
+    uint64_t bits = 0;
+    for (int i = 0; i < numWords(); i++)
+        bits |= w[i];
+    return bits == 0;
+}
+
+int64_t BitVector::toInt64() const {
+    if (width == 0)
+        return 0;
+    uint64_t value = words()[0];
+    if (width < wordBits && isNegative())
+        value |= ~0ul << width;
+    return (int64_t)value;
+}
+
+string BitVector::toString(int base) const {
+    static const char digits[] = "0123456789abcdef";
+    string str;
+    if (base == 10) {
+        BitVector quotient(*this);
+        uint64_t *w = quotient.words();
+        int n = numWords();
+        do {
+            str += digits[divRem(w, n, 10)];
+        } while (!quotient.isZero());
+    } else {
+        int digitBits = base == 2 ? 1 : base == 8 ? 3 : 4;
+        for (int lsb = 0; lsb < width || str.empty(); lsb += digitBits) {
+            int digit = 0;
+            for (int i = 0; i < digitBits && lsb + i < width; i++)
+                digit |= bit(lsb + i) << i;
+            str += digits[digit];
+        }
+        while (str.size() > 1 && str.back() == '0')
+            str.pop_back();
+    }
+    reverse(str.begin(), str.end());
+    return str;
+}
+
+BitVector BitVector::operator~() const {
+    BitVector result(width);
+    const uint64_t *a = words();
+    uint64_t *r = result.words();
+    for (int i = 0; i < numWords(); i++)
+        r[i] = ~a[i];
+    result.clearUnusedBits();
+    return result;
+}
+
+BitVector BitVector::operator-() const {
+    return BitVector(width) - *this;
+}
+
+BitVector BitVector::operator&(const BitVector &other) const {
+    assert(width == other.width);
+    BitVector result(width);
+    const uint64_t *a = words();
+    const uint64_t *b = other.words();
+    uint64_t *r = result.words();
+    for (int i = 0; i < numWords(); i++)
+        r[i] = a[i] & b[i];
+    return result;
+}
+
+BitVector BitVector::operator|(const BitVector &other) const {
+    assert(width == other.width);
+    BitVector result(width);
+    const uint64_t *a = words();
+    const uint64_t *b = other.words();
+    uint64_t *r = result.words();
+    for (int i = 0; i < numWords(); i++)
+        r[i] = a[i] | b[i];
+    return result;
+}
+
+BitVector BitVector::operator^(const BitVector &other) const {
+    assert(width == other.width);
+    BitVector result(width);
+    const uint64_t *a = words();
+    const uint64_t *b = other.words();
+    uint64_t *r = result.words();
+    for (int i = 0; i < numWords(); i++)
+        r[i] = a[i] ^ b[i];
+    return result;
+}
+
+BitVector BitVector::operator+(const BitVector &other) const {
+    assert(width == other.width);
+    BitVector result(width);
+    const uint64_t *a = words();
+    const uint64_t *b = other.words();
+    uint64_t *r = result.words();
+    uint64_t carry = 0;
+    for (int i = 0; i < numWords(); i++) {
+        uint128_t sum = (uint128_t)a[i] + b[i] + carry;
+        r[i] = (uint64_t)sum;
+        carry = (uint64_t)(sum >> 64);
+    }
+    result.clearUnusedBits();
+    return result;
+}
+
+BitVector BitVector::operator-(const BitVector &other) const {
+    assert(width == other.width);
+    BitVector result(width);
+    const uint64_t *a = words();
+    const uint64_t *b = other.words();
+    uint64_t *r = result.words();
+    uint64_t borrow = 0;
+    for (int i = 0; i < numWords(); i++) {
+        uint128_t diff = (uint128_t)a[i] - b[i] - borrow;
+        r[i] = (uint64_t)diff;
+        borrow = (uint64_t)(diff >> 64) & 1;
+    }
+    result.clearUnusedBits();
+    return result;
+}
+
+BitVector BitVector::operator*(const BitVector &other) const {
+    assert(width == other.width);
+    BitVector result(width);
+    const uint64_t *a = words();
+    const uint64_t *b = other.words();
+    uint64_t *r = result.words();
+    int n = numWords();
+    // the product is truncated to the width, so only the partial products
+    // that land in the low n words are computed
+    for (int i = 0; i < n; i++) {
+        if (!a[i])
+            continue;
+        uint64_t carry = 0;
+        for (int j = 0; i + j < n; j++) {
+            uint128_t t = (uint128_t)a[i] * b[j] + r[i + j] + carry;
+            r[i + j] = (uint64_t)t;
+            carry = (uint64_t)(t >> 64);
+        }
+    }
+    result.clearUnusedBits();
+    return result;
+}
+
+BitVector BitVector::operator<<(int shift) const {
+    BitVector result(width);
+    if (shift >= width)
+        return result;
+    const uint64_t *a = words();
+    uint64_t *r = result.words();
+    int wordShift = shift / wordBits;
+    int bitShift = shift % wordBits;
+    for (int i = numWords() - 1; i >= wordShift; i--) {
+        uint64_t word = a[i - wordShift] << bitShift;
+        if (bitShift && i - wordShift - 1 >= 0)
+            word |= a[i - wordShift - 1] >> (wordBits - bitShift);
+        r[i] = word;
+    }
+    result.clearUnusedBits();
+    return result;
+}
+
+BitVector BitVector::operator>>(int shift) const {
+    BitVector result(width);
+    if (shift >= width)
+        return result;
+    const uint64_t *a = words();
+    uint64_t *r = result.words();
+    int n = numWords();
+    int wordShift = shift / wordBits;
+    int bitShift = shift % wordBits;
+    for (int i = 0; i + wordShift < n; i++) {
+        uint64_t word = a[i + wordShift] >> bitShift;
+        if (bitShift && i + wordShift + 1 < n)
+            word |= a[i + wordShift + 1] << (wordBits - bitShift);
+        r[i] = word;
+    }
+    return result;
+}
+
+BitVector BitVector::ashr(int shift) const {
+    if (!isNegative())
+        return *this >> shift;
+    BitVector ones = ~BitVector(width);
+    if (shift >= width)
+        return ones;
+    return (*this >> shift) | ~(ones >> shift);
+}
+
+BitVector BitVector::udiv(const BitVector &divisor, BitVector *remainder) const {
+    assert(width == divisor.width);
+    if (divisor.isZero()) {
+        if (remainder)
+            *remainder = *this;
+        return ~BitVector(width);
+    }
+    if (numWords() <= inlineWords) {
+        uint128_t a = words()[0];
+        uint128_t b = divisor.words()[0];
+        if (numWords() == inlineWords) {
+            a |= (uint128_t)words()[1] << 64;
+            b |= (uint128_t)divisor.words()[1] << 64;
+        }
+        BitVector quotient(width);
+        quotient.small[0] = (uint64_t)(a / b);
+        quotient.small[1] = (uint64_t)((a / b) >> 64);
+        if (remainder) {
+            *remainder = BitVector(width);
+            remainder->small[0] = (uint64_t)(a % b);
+            remainder->small[1] = (uint64_t)((a % b) >> 64);
+        }
+        return quotient;
+    }
+    int n = numWords();
+    const uint64_t *d = divisor.words();
+    int divisorWords = n;
+    while (divisorWords > 1 && !d[divisorWords - 1])
+        divisorWords--;
+    if (divisorWords == 1) {
+        BitVector quotient(*this);
+        uint64_t rem = divRem(quotient.words(), n, d[0]);
+        if (remainder)
+            *remainder = BitVector(width, rem);
+        return quotient;
+    }
+
+    // shift and subtract in place, starting from the most significant set bit
+    BitVector quotient(width);
+    BitVector rem(width);
+    uint64_t *q = quotient.words();
+    uint64_t *r = rem.words();
+    int msb = width - 1;
+    while (msb >= 0 && !bit(msb))
+        msb--;
+    for (int i = msb; i >= 0; i--) {
+        uint64_t carry = bit(i);
+        for (int j = 0; j < n; j++) {
+            uint64_t word = r[j];
+            r[j] = (word << 1) | carry;
+            carry = word >> (wordBits - 1);
+        }
+        // the remainder stays below the divisor, so carry is zero here
+        bool less = false;
+        for (int j = n - 1; j >= 0; j--) {
+            if (r[j] != d[j]) {
+                less = r[j] < d[j];
+                break;
+            }
+        }
+        if (!less) {
+            uint64_t borrow = 0;
+            for (int j = 0; j < n; j++) {
+                uint128_t diff = (uint128_t)r[j] - d[j] - borrow;
+                r[j] = (uint64_t)diff;
+                borrow = (uint64_t)(diff >> 64) & 1;
+            }
+            q[i / wordBits] |= 1ul << (i % wordBits);
+        }
+    }
+    if (remainder)
+        *remainder = rem;
+    return quotient;
+}
+
+BitVector BitVector::sdiv(const BitVector &divisor, BitVector *remainder) const {
+    bool negativeDividend = isNegative();
+    bool negativeDivisor = divisor.isNegative();
+    BitVector a = negativeDividend ? -*this : *this;
+    BitVector b = negativeDivisor ? -divisor : divisor;
+    // rounds towards zero, the remainder has the sign of the dividend
+    BitVector quotient = a.udiv(b, remainder);
+    if (remainder && negativeDividend)
+        *remainder = -*remainder;
+    return (negativeDividend != negativeDivisor) ? -quotient : quotient;
+}
+
+bool BitVector::operator==(const BitVector &other) const {
+    assert(width == other.width);
+    const uint64_t *a = words();
+    const uint64_t *b = other.words();
+    uint64_t diff = 0;
+    for (int i = 0; i < numWords(); i++)
+        diff |= a[i] ^ b[i];
+    return diff == 0;
+}
+
+bool BitVector::ult(const BitVector &other) const {
+    assert(width == other.width);
+    const uint64_t *a = words();
+    const uint64_t *b = other.words();
+    for (int i = numWords() - 1; i >= 0; i--) {
+        if (a[i] != b[i])
+            return a[i] < b[i];
+    }
+    return false;
+}
+
+bool BitVector::slt(const BitVector &other) const {
+    bool negative = isNegative();
+    if (negative != other.isNegative())
+        return negative;
+    return ult(other);
+}
+
+BitVector BitVector::extract(int msb, int lsb) const {
+    assert(lsb >= 0 && msb >= lsb - 1 && msb < width);
+    return (*this >> lsb).zeroExtend(msb - lsb + 1);
+}
+
+BitVector BitVector::concat(const BitVector &low) const {
+    int resultWidth = width + low.width;
+    return (zeroExtend(resultWidth) << low.width) | low.zeroExtend(resultWidth);
+}
+
+BitVector BitVector::zeroExtend(int newWidth) const {
+    BitVector result(newWidth);
+    const uint64_t *a = words();
+    uint64_t *r = result.words();
+    int n = min(numWords(), result.numWords());
+    for (int i = 0; i < n; i++)
+        r[i] = a[i];
+    result.clearUnusedBits();
+    return result;
+}
+
+BitVector BitVector::signExtend(int newWidth) const {
+    BitVector result = zeroExtend(newWidth);
+    if (newWidth > width && isNegative())
+        result = result | (~BitVector(newWidth) << width);
+    return result;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Fixed width two's complement bit vector for the values of Bit#(n),
+// Int#(n) and UInt#(n).
+//
+// Values of up to 128 bits are stored inline, wider ones in a word array.
+// The bits above the width in the most significant word are always zero,
+// so that words can be compared and combined without masking. Operations
+// work a word at a time with loops over the word arrays that the compiler
+// can vectorize; the operands of binary operations must have the same width.
+class BitVector {
+public:
+    static const int wordBits = 64;
+    static const int inlineWords = 2;
+
+    BitVector() : width(0) {
+        small[0] = small[1] = 0;
+    }
+
+    // zero extended or truncated to width
+    explicit BitVector(int width, uint64_t value = 0);
+
+    // parses Verilog style literals such as 42, 'h2a or 8'b1010_1010, with
+    // the given width if the literal is not sized
+    static BitVector fromString(const string &repr, int defaultWidth = 64);
+
+    int getWidth() const { return width; }
+    int numWords() const { return (width + wordBits - 1) / wordBits; }
+    uint64_t *words() { return width > inlineWords * wordBits ? large.data() : small; }
+    const uint64_t *words() const { return width > inlineWords * wordBits ? large.data() : small; }
+
+    bool bit(int index) const;
+    bool isZero() const;
+    bool isNegative() const { return width > 0 && bit(width - 1); }
+    // the low 64 bits
+    uint64_t toUInt64() const { return width ? words()[0] : 0; }
+    // the low 64 bits, sign extended if the vector is narrower
+    int64_t toInt64() const;
+    // base 2, 8, 10 or 16, without prefix
+    string toString(int base = 10) const;
+
+    BitVector operator~() const;
+    BitVector operator-() const;
+    BitVector operator&(const BitVector &other) const;
+    BitVector operator|(const BitVector &other) const;
+    BitVector operator^(const BitVector &other) const;
+    BitVector operator+(const BitVector &other) const;
+    BitVector operator-(const BitVector &other) const;
+    BitVector operator*(const BitVector &other) const;
+    BitVector operator<<(int shift) const;
+    // logical shift right
+    BitVector operator>>(int shift) const;
+    BitVector ashr(int shift) const;
+    // the remainder is stored in remainder if it is not null; division by
+    // zero yields all ones and leaves the dividend as the remainder
+    BitVector udiv(const BitVector &divisor, BitVector *remainder = 0) const;
+    BitVector sdiv(const BitVector &divisor, BitVector *remainder = 0) const;
+
+    bool operator==(const BitVector &other) const;
+    bool operator!=(const BitVector &other) const { return !(*this == other); }
+    bool ult(const BitVector &other) const;
+    bool slt(const BitVector &other) const;
+    bool ule(const BitVector &other) const { return !other.ult(*this); }
+    bool sle(const BitVector &other) const { return !other.slt(*this); }
+
+    // bits msb down to lsb
+    BitVector extract(int msb, int lsb) const;
+    // this vector in the high bits, low in the low bits
+    BitVector concat(const BitVector &low) const;
+    BitVector zeroExtend(int newWidth) const;
+    BitVector signExtend(int newWidth) const;
+    BitVector truncate(int newWidth) const { return extract(newWidth - 1, 0); }
+
+private:
+    int width;
+    uint64_t small[inlineWords];
+    vector<uint64_t> large;
+
+    // clears the bits above width
+    void clearUnusedBits();
+    void resize(int newWidth);
+};
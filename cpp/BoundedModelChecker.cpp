@@ -0,0 +1,750 @@
+#include <chrono>
+#include <set>
+
+#include "BitVector.h"
+#include "BoundedModelChecker.h"
+
+// loops that do not end after this many iterations cannot be encoded
+static const int maxLoopIterations = 1 << 16;
+static const int maxCallDepth = 64;
+
+static bool isSigned(const shared_ptr<BSVType> &bsvtype) {
+    return bsvtype && (bsvtype->name == "Int" || bsvtype->name == "Integer");
+}
+
+static unsigned bitWidth(const shared_ptr<BSVType> &bsvtype) {
+    if (!bsvtype)
+        return 0;
+    if (bsvtype->name == "Integer")
+        return 64;
+    return bsvtype->bitWidth();
+}
+
+// registers written anywhere in stmt
+static void collectRegisterWrites(const shared_ptr<Stmt> &stmt, set<string> &regNames) {
+    if (!stmt)
+        return;
+    switch (stmt->stmtType) {
+        case RegWriteStmtType:
+            regNames.insert(static_pointer_cast<RegWriteStmt>(stmt)->regName);
+            break;
+        case BlockStmtType: {
+            shared_ptr<BlockStmt> blockStmt = static_pointer_cast<BlockStmt>(stmt);
+            for (size_t i = 0; i < blockStmt->stmts.size(); i++)
+                collectRegisterWrites(blockStmt->stmts[i], regNames);
+        }
+            break;
+        case IfStmtType:
+            collectRegisterWrites(static_pointer_cast<IfStmt>(stmt)->thenStmt, regNames);
+            collectRegisterWrites(static_pointer_cast<IfStmt>(stmt)->elseStmt, regNames);
+            break;
+        case ForStmtType:
+            collectRegisterWrites(static_pointer_cast<ForStmt>(stmt)->body, regNames);
+            break;
+        case WhileStmtType:
+            collectRegisterWrites(static_pointer_cast<WhileStmt>(stmt)->body, regNames);
+            break;
+        default:
+            break;
+    }
+}
+
+// functions called as statements, or for the value bound by one, anywhere in stmt
+static void collectCalls(const shared_ptr<Stmt> &stmt, set<string> &functionNames) {
+    if (!stmt)
+        return;
+    shared_ptr<Expr> expr;
+    switch (stmt->stmtType) {
+        case ExprStmtType:
+            expr = static_pointer_cast<ExprStmt>(stmt)->expr;
+            break;
+        case CallStmtType:
+            expr = static_pointer_cast<CallStmt>(stmt)->rhs;
+            break;
+        case ActionBindingStmtType:
+            expr = static_pointer_cast<ActionBindingStmt>(stmt)->rhs;
+            break;
+        case VarBindingStmtType:
+            expr = static_pointer_cast<VarBindingStmt>(stmt)->rhs;
+            break;
+        case BlockStmtType: {
+            shared_ptr<BlockStmt> blockStmt = static_pointer_cast<BlockStmt>(stmt);
+            for (size_t i = 0; i < blockStmt->stmts.size(); i++)
+                collectCalls(blockStmt->stmts[i], functionNames);
+        }
+            break;
+        case IfStmtType:
+            collectCalls(static_pointer_cast<IfStmt>(stmt)->thenStmt, functionNames);
+            collectCalls(static_pointer_cast<IfStmt>(stmt)->elseStmt, functionNames);
+            break;
+        case ForStmtType:
+            collectCalls(static_pointer_cast<ForStmt>(stmt)->body, functionNames);
+            break;
+        case WhileStmtType:
+            collectCalls(static_pointer_cast<WhileStmt>(stmt)->body, functionNames);
+            break;
+        default:
+            break;
+    }
+    shared_ptr<CallExpr> callExpr = expr ? expr->callExpr() : shared_ptr<CallExpr>();
+    shared_ptr<VarExpr> function = callExpr ? callExpr->function->varExpr() : shared_ptr<VarExpr>();
+    if (function)
+        functionNames.insert(function->name);
+}
+
+BoundedModelChecker::BoundedModelChecker(const vector<shared_ptr<Stmt>> &packageStmts, ostream &out)
+        : out(out), solver(ctx), current(ctx), havocs(ctx), pathCondition(ctx.bool_val(true)),
+          returned(ctx.bool_val(false)), returnValue(ctx.bool_val(false)), next(ctx),
+          finishes(ctx.bool_val(false)) {
+    for (size_t i = 0; i < packageStmts.size(); i++) {
+        shared_ptr<Stmt> stmt = packageStmts[i];
+        if (!stmt)
+            continue;
+        if (shared_ptr<ModuleDefStmt> moduleDef = stmt->moduleDefStmt())
+            moduleDefs[moduleDef->name] = moduleDef;
+        else if (shared_ptr<FunctionDefStmt> functionDef = stmt->functionDefStmt())
+            functionDefs[functionDef->name] = functionDef;
+        else if (shared_ptr<VarBindingStmt> varBinding = stmt->varBindingStmt())
+            moduleEnv.emplace(varBinding->name, fit(eval(varBinding->rhs), varBinding->bsvtype, false));
+    }
+}
+
+bool BoundedModelChecker::load(const string &moduleName) {
+    auto it = moduleDefs.find(moduleName);
+    if (it == moduleDefs.cend()) {
+        cerr << "BoundedModelChecker: no module " << moduleName << endl;
+        return false;
+    }
+    this->moduleName = moduleName;
+    shared_ptr<ModuleDefStmt> moduleDef = it->second;
+    vector<shared_ptr<RuleDefStmt>> ruleDefs;
+    for (size_t i = 0; i < moduleDef->stmts.size(); i++) {
+        shared_ptr<Stmt> stmt = moduleDef->stmts[i];
+        switch (stmt->stmtType) {
+            case RegisterStmtType: {
+                shared_ptr<RegisterStmt> registerStmt = static_pointer_cast<RegisterStmt>(stmt);
+                unsigned width = bitWidth(registerStmt->elementType);
+                bool isBool = registerStmt->elementType && registerStmt->elementType->name == "Bool";
+                if (!isBool && !width) {
+                    cerr << "BoundedModelChecker: register " << registerStmt->regName << " of type "
+                         << registerStmt->elementType->to_string() << " is not checked" << endl;
+                    break;
+                }
+                registerIndex[registerStmt->regName] = (int)registerNames.size();
+                registerNames.push_back(registerStmt->regName);
+                registerTypes.push_back(registerStmt->elementType);
+                current.push_back(isBool ? ctx.bool_const(registerStmt->regName.c_str())
+                                         : ctx.bv_const(registerStmt->regName.c_str(), width));
+            }
+                break;
+            case RuleDefStmtType:
+                ruleDefs.push_back(static_pointer_cast<RuleDefStmt>(stmt));
+                break;
+            case VarBindingStmtType: {
+                // parameters of inlined instances
+                shared_ptr<VarBindingStmt> varBinding = static_pointer_cast<VarBindingStmt>(stmt);
+                z3::expr value = fit(eval(varBinding->rhs), varBinding->bsvtype, false);
+                moduleEnv.erase(varBinding->name);
+                moduleEnv.emplace(varBinding->name, value);
+            }
+                break;
+            default:
+                break;
+        }
+    }
+    current.push_back(ctx.bool_const("$finished"));
+    for (size_t i = 0; i < ruleDefs.size(); i++)
+        encodeRule(ruleDefs[i]);
+    if (!numAssertions && uncheckedRules.empty())
+        cerr << "BoundedModelChecker: no assertions in " << moduleName << endl;
+    return numAssertions > 0 || !uncheckedRules.empty();
+}
+
+bool BoundedModelChecker::encodeRule(const shared_ptr<RuleDefStmt> &ruleDef) {
+    env.clear();
+    pathCondition = ctx.bool_val(true);
+    returned = ctx.bool_val(false);
+    next = z3::expr_vector(ctx);
+    for (size_t i = 0; i < registerNames.size(); i++)
+        next.push_back(current[(int)i]);
+    finishes = ctx.bool_val(false);
+    assertions.clear();
+    z3::expr guard = ruleDef->guard ? toBool(eval(ruleDef->guard)) : ctx.bool_val(true);
+    env.clear();
+    bool encoded = true;
+    for (size_t i = 0; encoded && i < ruleDef->stmts.size(); i++)
+        encoded = execute(ruleDef->stmts[i]);
+    if (!encoded) {
+        // the rule still fires when its guard holds, writing any values to
+        // its registers, so that no run is missed; traces through it may be spurious
+        cerr << "BoundedModelChecker: rule " << ruleDef->name
+             << " is not encoded, the registers it writes are unconstrained" << endl;
+        set<string> regNames, functionNames;
+        for (size_t i = 0; i < ruleDef->stmts.size(); i++) {
+            collectRegisterWrites(ruleDef->stmts[i], regNames);
+            collectCalls(ruleDef->stmts[i], functionNames);
+        }
+        next = z3::expr_vector(ctx);
+        for (size_t i = 0; i < registerNames.size(); i++) {
+            if (regNames.count(registerNames[i]))
+                next.push_back(havoc(registerTypes[i]));
+            else
+                next.push_back(current[(int)i]);
+        }
+        // it may or may not call $finish, and its assertions cannot be checked
+        z3::expr mayFinish = functionNames.count("$finish") ? havoc(BSVType::create("Bool")) : ctx.bool_val(false);
+        if (functionNames.count("dynamicAssert")) {
+            cerr << "BoundedModelChecker: the assertions of rule " << ruleDef->name << " are not checked" << endl;
+            uncheckedRules.push_back(ruleDef->name);
+        }
+        rules.push_back(RuleEncoding{ruleDef, guard, next, mayFinish, vector<Assertion>(), false});
+        return false;
+    }
+    rules.push_back(RuleEncoding{ruleDef, guard, next, finishes, assertions, true});
+    numAssertions += (int)assertions.size();
+    return true;
+}
+
+z3::expr_vector BoundedModelChecker::stepState(int step) {
+    z3::expr_vector state(ctx);
+    for (unsigned i = 0; i < current.size(); i++) {
+        string name = current[i].decl().name().str() + "@" + std::to_string(step);
+        state.push_back(ctx.constant(name.c_str(), current[i].get_sort()));
+    }
+    for (unsigned i = 0; i < havocs.size(); i++) {
+        string name = havocs[i].decl().name().str() + "@" + std::to_string(step);
+        state.push_back(ctx.constant(name.c_str(), havocs[i].get_sort()));
+    }
+    return state;
+}
+
+z3::expr BoundedModelChecker::atStep(const z3::expr &value, const z3::expr_vector &from, const z3::expr_vector &to) {
+    z3::expr result = value;
+    return result.substitute(from, to);
+}
+
+bool BoundedModelChecker::check(int maxSteps) {
+    auto start = chrono::steady_clock::now();
+    int numRegisters = (int)registerNames.size();
+    z3::expr_vector from(ctx);
+    for (unsigned i = 0; i < current.size(); i++)
+        from.push_back(current[i]);
+    for (unsigned i = 0; i < havocs.size(); i++)
+        from.push_back(havocs[i]);
+
+    bool unknown = false;
+    vector<z3::expr_vector> states;
+    states.push_back(stepState(0));
+    for (int r = 0; r < numRegisters; r++) {
+        const z3::expr &reg = states[0][r];
+        solver.add(reg.is_bool() ? !reg : reg == ctx.bv_val(0, reg.get_sort().bv_size()));
+    }
+    solver.add(!states[0][numRegisters]);
+
+    for (int step = 0; step < maxSteps; step++) {
+        states.push_back(stepState(step + 1));
+        const z3::expr_vector &state = states[step];
+        const z3::expr_vector &nextState = states[step + 1];
+        z3::expr fire = ctx.int_const(("$fire@" + std::to_string(step)).c_str());
+        solver.add(fire >= 0 && fire < (int)rules.size() && !state[numRegisters]);
+        z3::expr violated = ctx.bool_val(false);
+        for (size_t i = 0; i < rules.size(); i++) {
+            const RuleEncoding &rule = rules[i];
+            z3::expr fires = atStep(rule.guard, from, state);
+            for (int r = 0; r < numRegisters; r++)
+                fires = fires && nextState[r] == atStep(rule.next[r], from, state);
+            fires = fires && nextState[numRegisters] == atStep(rule.finishes, from, state);
+            solver.add(z3::implies(fire == (int)i, fires));
+            for (size_t j = 0; j < rule.assertions.size(); j++)
+                violated = violated || (fire == (int)i && atStep(rule.assertions[j].violated, from, state));
+        }
+
+        solver.push();
+        solver.add(violated);
+        z3::check_result result = solver.check();
+        if (result == z3::sat) {
+            printTrace(solver.get_model(), states, step);
+            solver.pop();
+            return false;
+        }
+        solver.pop();
+        if (result == z3::unknown) {
+            cerr << "BoundedModelChecker: step " << step << " is unknown: " << solver.reason_unknown() << endl;
+            unknown = true;
+        }
+        if (!unknown && solver.check() == z3::unsat) {
+            if (reportUnchecked())
+                return false;
+            out << "BMC " << moduleName << ": every run stops within " << step << " rule firings and no assertion fails"
+                << endl;
+            return true;
+        }
+    }
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+    if (unknown) {
+        out << "BMC " << moduleName << ": unknown, the solver gave up on some of the first " << maxSteps
+            << " rule firings" << endl;
+        return false;
+    }
+    if (reportUnchecked())
+        return false;
+    out << "BMC " << moduleName << ": no assertion fails within " << maxSteps << " rule firings" << endl;
+    cerr << "BoundedModelChecker: " << rules.size() << " rules, " << numAssertions << " assertions, "
+         << elapsed.count() << "ms" << endl;
+    return true;
+}
+
+bool BoundedModelChecker::reportUnchecked() {
+    if (uncheckedRules.empty())
+        return false;
+    out << "BMC " << moduleName << ": incomplete, no checked assertion fails but the assertions of rule";
+    if (uncheckedRules.size() > 1)
+        out << "s";
+    for (size_t i = 0; i < uncheckedRules.size(); i++)
+        out << " " << uncheckedRules[i];
+    out << " are not checked" << endl;
+    return true;
+}
+
+static string modelValue(const z3::model &model, const z3::expr &value) {
+    z3::expr v = model.eval(value, true);
+    if (v.is_bool())
+        return v.is_true() ? "True" : "False";
+    return v.get_decimal_string(0);
+}
+
+void BoundedModelChecker::printTrace(const z3::model &model, const vector<z3::expr_vector> &states, int failingStep) {
+    int numRegisters = (int)registerNames.size();
+    out << "BMC " << moduleName << ": assertion fails after " << (failingStep + 1) << " rule firings" << endl;
+    out << "    initial:";
+    for (int r = 0; r < numRegisters; r++)
+        out << " " << registerNames[r] << "=" << modelValue(model, states[0][r]);
+    out << endl;
+
+    z3::expr_vector from(ctx);
+    for (unsigned i = 0; i < current.size(); i++)
+        from.push_back(current[i]);
+    for (unsigned i = 0; i < havocs.size(); i++)
+        from.push_back(havocs[i]);
+    for (int step = 0; step <= failingStep; step++) {
+        z3::expr fire = model.eval(ctx.int_const(("$fire@" + std::to_string(step)).c_str()), true);
+        const RuleEncoding &rule = rules[fire.get_numeral_uint64()];
+        out << "    step " << step << ": rule " << rule.ruleDef->name;
+        if (!rule.encoded)
+            out << " (not encoded)";
+        if (step == failingStep) {
+            for (size_t j = 0; j < rule.assertions.size(); j++) {
+                const Assertion &assertion = rule.assertions[j];
+                if (model.eval(atStep(assertion.violated, from, states[step]), true).is_true())
+                    out << " fails \"" << assertion.message << "\" at " << assertion.sourcePos.toString();
+            }
+            out << endl;
+            break;
+        }
+        for (int r = 0; r < numRegisters; r++) {
+            string before = modelValue(model, states[step][r]);
+            string after = modelValue(model, states[step + 1][r]);
+            if (before != after)
+                out << " " << registerNames[r] << "=" << after;
+        }
+        out << endl;
+    }
+}
+
+bool BoundedModelChecker::execute(const shared_ptr<Stmt> &stmt) {
+    if (!stmt)
+        return true;
+    return dispatchStmt(stmt);
+}
+
+bool BoundedModelChecker::defaultStmt(const shared_ptr<Stmt> &stmt) {
+    cerr << "BoundedModelChecker: cannot encode statement at " << stmt->sourcePos.toString() << endl;
+    return false;
+}
+
+z3::expr BoundedModelChecker::active() {
+    return pathCondition && !returned;
+}
+
+void BoundedModelChecker::bind(const string &name, const z3::expr &value) {
+    auto it = env.find(name);
+    if (it != env.end())
+        it->second = value;
+    else
+        env.emplace(name, value);
+}
+
+bool BoundedModelChecker::visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt) {
+    bind(stmt->name, fit(eval(stmt->rhs), stmt->bsvtype, false));
+    return true;
+}
+
+bool BoundedModelChecker::visitBlockStmt(const shared_ptr<BlockStmt> &stmt) {
+    for (size_t i = 0; i < stmt->stmts.size(); i++) {
+        if (!execute(stmt->stmts[i]))
+            return false;
+    }
+    return true;
+}
+
+bool BoundedModelChecker::visitCallStmt(const shared_ptr<CallStmt> &stmt) {
+    eval(stmt->rhs);
+    return true;
+}
+
+bool BoundedModelChecker::visitExprStmt(const shared_ptr<ExprStmt> &stmt) {
+    eval(stmt->expr);
+    return true;
+}
+
+bool BoundedModelChecker::visitForStmt(const shared_ptr<ForStmt> &stmt) {
+    for (size_t i = 0; i < stmt->init.size(); i++) {
+        if (!execute(stmt->init[i]))
+            return false;
+    }
+    return executeLoop(stmt->test, stmt->incr, stmt->body);
+}
+
+bool BoundedModelChecker::visitWhileStmt(const shared_ptr<WhileStmt> &stmt) {
+    return executeLoop(stmt->test, vector<shared_ptr<Stmt>>(), stmt->body);
+}
+
+// only loops whose test is constant in every iteration are unrolled
+bool BoundedModelChecker::executeLoop(const shared_ptr<Expr> &test, const vector<shared_ptr<Stmt>> &incr,
+                                      const shared_ptr<Stmt> &body) {
+    for (int iteration = 0; iteration < maxLoopIterations; iteration++) {
+        z3::expr condition = toBool(eval(test)).simplify();
+        if (condition.is_false())
+            return true;
+        if (!condition.is_true()) {
+            cerr << "BoundedModelChecker: loop at " << test->sourcePos.toString() << " has a symbolic bound" << endl;
+            return false;
+        }
+        if (!execute(body))
+            return false;
+        for (size_t i = 0; i < incr.size(); i++) {
+            if (!execute(incr[i]))
+                return false;
+        }
+    }
+    cerr << "BoundedModelChecker: loop at " << test->sourcePos.toString() << " did not terminate" << endl;
+    return false;
+}
+
+// Both branches are encoded; the variables they assign are merged with
+// if-then-else and side effects are guarded by the path condition.
+bool BoundedModelChecker::visitIfStmt(const shared_ptr<IfStmt> &stmt) {
+    z3::expr condition = toBool(eval(stmt->condition));
+    z3::expr savedPathCondition = pathCondition;
+    map<string, z3::expr> savedEnv = env;
+    pathCondition = savedPathCondition && condition;
+    if (!execute(stmt->thenStmt))
+        return false;
+    map<string, z3::expr> thenEnv = env;
+    env = savedEnv;
+    pathCondition = savedPathCondition && !condition;
+    if (!execute(stmt->elseStmt))
+        return false;
+    pathCondition = savedPathCondition;
+    for (auto it = savedEnv.begin(); it != savedEnv.end(); ++it) {
+        z3::expr thenValue = thenEnv.find(it->first)->second;
+        z3::expr elseValue = env.find(it->first)->second;
+        if (!z3::eq(thenValue, elseValue))
+            it->second = z3::ite(condition, thenValue, elseValue);
+        else
+            it->second = thenValue;
+    }
+    env = savedEnv;
+    return true;
+}
+
+bool BoundedModelChecker::visitRegReadStmt(const shared_ptr<RegReadStmt> &stmt) {
+    auto it = registerIndex.find(stmt->regName);
+    if (it == registerIndex.cend())
+        return defaultStmt(stmt);
+    bind(stmt->var, current[it->second]);
+    return true;
+}
+
+bool BoundedModelChecker::visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt) {
+    auto it = registerIndex.find(stmt->regName);
+    if (it == registerIndex.cend())
+        return defaultStmt(stmt);
+    int regIndex = it->second;
+    z3::expr value = fit(eval(stmt->rhs), registerTypes[regIndex], isSigned(stmt->rhs->bsvtype));
+    z3::expr written = z3::ite(active(), value, next[regIndex]);
+    next.set(regIndex, written);
+    return true;
+}
+
+bool BoundedModelChecker::visitReturnStmt(const shared_ptr<ReturnStmt> &stmt) {
+    z3::expr value = fit(eval(stmt->value), returnType, isSigned(stmt->value->bsvtype));
+    if (hasReturnValue && Z3_is_eq_sort(ctx, value.get_sort(), returnValue.get_sort()))
+        returnValue = z3::ite(active(), value, returnValue);
+    else
+        returnValue = value;
+    hasReturnValue = true;
+    returned = returned || pathCondition;
+    return true;
+}
+
+bool BoundedModelChecker::visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt) {
+    shared_ptr<VarLValue> varLValue = stmt->lhs->varLValue();
+    if (!varLValue || stmt->op != "=")
+        return defaultStmt(stmt);
+    bind(varLValue->name, fit(eval(stmt->rhs), varLValue->bsvtype, isSigned(stmt->rhs->bsvtype)));
+    return true;
+}
+
+bool BoundedModelChecker::visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt) {
+    bind(stmt->name, fit(eval(stmt->rhs), stmt->bsvtype, isSigned(stmt->rhs->bsvtype)));
+    return true;
+}
+
+z3::expr BoundedModelChecker::eval(const shared_ptr<Expr> &expr) {
+    if (!expr)
+        return havoc(shared_ptr<BSVType>());
+    z3::expr value = dispatchExpr(expr);
+    // unsized literals and mixed-width operators come out wider than their type
+    if (value.is_bv() && bitWidth(expr->bsvtype) && value.get_sort().bv_size() != bitWidth(expr->bsvtype))
+        return resize(value, bitWidth(expr->bsvtype), isSigned(expr->bsvtype));
+    return value;
+}
+
+z3::expr BoundedModelChecker::havoc(const shared_ptr<BSVType> &bsvtype) {
+    string name = "$havoc" + std::to_string(havocs.size());
+    unsigned width = bitWidth(bsvtype);
+    z3::expr value = (bsvtype && bsvtype->name == "Bool") ? ctx.bool_const(name.c_str())
+                                                          : ctx.bv_const(name.c_str(), width ? width : 64);
+    havocs.push_back(value);
+    return value;
+}
+
+z3::expr BoundedModelChecker::toBool(const z3::expr &value) {
+    if (value.is_bool())
+        return value;
+    return value != ctx.bv_val(0, value.get_sort().bv_size());
+}
+
+z3::expr BoundedModelChecker::resize(const z3::expr &value, unsigned width, bool isSigned) {
+    z3::expr bits = value.is_bool() ? z3::ite(value, ctx.bv_val(1, 1), ctx.bv_val(0, 1)) : value;
+    unsigned size = bits.get_sort().bv_size();
+    if (size == width)
+        return bits;
+    if (size > width)
+        return bits.extract(width - 1, 0);
+    return isSigned ? z3::sext(bits, width - size) : z3::zext(bits, width - size);
+}
+
+// value as a value of bsvtype, when that is Bool or a bit vector
+z3::expr BoundedModelChecker::fit(const z3::expr &value, const shared_ptr<BSVType> &bsvtype, bool isSigned) {
+    if (bsvtype && bsvtype->name == "Bool")
+        return toBool(value);
+    if (unsigned width = bitWidth(bsvtype))
+        return resize(value, width, isSigned);
+    return value;
+}
+
+z3::expr BoundedModelChecker::defaultExpr(const shared_ptr<Expr> &expr) {
+    cerr << "BoundedModelChecker: expression at " << expr->sourcePos.toString() << " is unconstrained: ";
+    expr->prettyPrint(cerr, 0);
+    cerr << endl;
+    return havoc(expr->bsvtype);
+}
+
+z3::expr BoundedModelChecker::visitBitConcatExpr(const shared_ptr<BitConcatExpr> &expr) {
+    z3::expr bits = resize(eval(expr->values[0]), bitWidth(expr->values[0]->bsvtype) ? bitWidth(expr->values[0]->bsvtype) : 1, false);
+    for (size_t i = 1; i < expr->values.size(); i++) {
+        z3::expr value = eval(expr->values[i]);
+        bits = z3::concat(bits, value.is_bool() ? resize(value, 1, false) : value);
+    }
+    return bits;
+}
+
+z3::expr BoundedModelChecker::visitBitSelExpr(const shared_ptr<BitSelExpr> &expr) {
+    z3::expr value = eval(expr->value);
+    if (value.is_bool())
+        value = resize(value, 1, false);
+    unsigned size = value.get_sort().bv_size();
+    z3::expr msb = eval(expr->msb).simplify();
+    z3::expr lsb = (expr->lsb ? eval(expr->lsb) : msb).simplify();
+    uint64_t msbValue = 0, lsbValue = 0;
+    if (msb.is_numeral_u64(msbValue) && lsb.is_numeral_u64(lsbValue) && lsbValue <= msbValue && msbValue < size)
+        return value.extract((unsigned)msbValue, (unsigned)lsbValue);
+    if (!expr->lsb && msb.is_bv())
+        return z3::lshr(value, resize(msb, size, false)).extract(0, 0);
+    return defaultExpr(expr);
+}
+
+z3::expr BoundedModelChecker::visitCallExpr(const shared_ptr<CallExpr> &expr) {
+    shared_ptr<VarExpr> function = expr->function->varExpr();
+    if (!function)
+        return defaultExpr(expr);
+    const string &name = function->name;
+    if (name == "dynamicAssert" && expr->args.size()) {
+        z3::expr condition = toBool(eval(expr->args[0]));
+        string message;
+        if (expr->args.size() > 1 && expr->args[1]->stringConst())
+            message = expr->args[1]->stringConst()->repr;
+        assertions.push_back(Assertion{active() && !condition, message, expr->sourcePos});
+        return ctx.bool_val(true);
+    }
+    if (name == "$display" || name == "$write")
+        return ctx.bool_val(true);
+    if (name == "$finish") {
+        finishes = finishes || active();
+        return ctx.bool_val(true);
+    }
+    if ((name == "pack" || name == "unpack" || name == "zeroExtend" || name == "extend" || name == "truncate")
+        && expr->args.size() == 1) {
+        // resized to the type of the call by eval()
+        return eval(expr->args[0]);
+    }
+    if (name == "signExtend" && expr->args.size() == 1 && bitWidth(expr->bsvtype))
+        return resize(eval(expr->args[0]), bitWidth(expr->bsvtype), true);
+    auto it = functionDefs.find(name);
+    if (it != functionDefs.cend() && callDepth < maxCallDepth)
+        return callFunction(it->second, expr);
+    return defaultExpr(expr);
+}
+
+// the body is encoded inline, with its own variables and return value
+z3::expr BoundedModelChecker::callFunction(const shared_ptr<FunctionDefStmt> &functionDef,
+                                           const shared_ptr<CallExpr> &expr) {
+    map<string, z3::expr> functionEnv;
+    for (size_t i = 0; i < functionDef->params.size() && i < expr->args.size(); i++)
+        functionEnv.emplace(functionDef->params[i], fit(eval(expr->args[i]), functionDef->paramTypes[i], false));
+    map<string, z3::expr> savedEnv = env;
+    z3::expr savedReturned = returned;
+    z3::expr savedReturnValue = returnValue;
+    bool savedHasReturnValue = hasReturnValue;
+    shared_ptr<BSVType> savedReturnType = returnType;
+    env = functionEnv;
+    returnType = functionDef->returnType;
+    returned = ctx.bool_val(false);
+    hasReturnValue = false;
+    callDepth++;
+    bool encoded = true;
+    for (size_t i = 0; encoded && i < functionDef->stmts.size(); i++)
+        encoded = execute(functionDef->stmts[i]);
+    callDepth--;
+    z3::expr result = encoded && hasReturnValue ? returnValue : havoc(functionDef->returnType);
+    env = savedEnv;
+    returned = savedReturned;
+    returnValue = savedReturnValue;
+    hasReturnValue = savedHasReturnValue;
+    returnType = savedReturnType;
+    return result;
+}
+
+z3::expr BoundedModelChecker::visitCondExpr(const shared_ptr<CondExpr> &expr) {
+    z3::expr condition = toBool(eval(expr->cond));
+    z3::expr thenValue = eval(expr->thenExpr);
+    z3::expr elseValue = eval(expr->elseExpr);
+    if (thenValue.is_bv() && elseValue.is_bv()) {
+        unsigned width = max(thenValue.get_sort().bv_size(), elseValue.get_sort().bv_size());
+        thenValue = resize(thenValue, width, isSigned(expr->thenExpr->bsvtype));
+        elseValue = resize(elseValue, width, isSigned(expr->elseExpr->bsvtype));
+    } else if (thenValue.is_bool() != elseValue.is_bool()) {
+        thenValue = toBool(thenValue);
+        elseValue = toBool(elseValue);
+    }
+    return z3::ite(condition, thenValue, elseValue);
+}
+
+z3::expr BoundedModelChecker::visitIntConst(const shared_ptr<IntConst> &expr) {
+    unsigned width = bitWidth(expr->bsvtype);
+    BitVector bits = BitVector::fromString(expr->repr, width ? width : 64);
+    return ctx.bv_val(bits.toString(10).c_str(), bits.getWidth());
+}
+
+z3::expr BoundedModelChecker::visitOperatorExpr(const shared_ptr<OperatorExpr> &expr) {
+    const string &op = expr->op;
+    z3::expr lhs = eval(expr->lhs);
+    if (!expr->rhs) {
+        if (op == "!")
+            return !toBool(lhs);
+        if (lhs.is_bool())
+            lhs = resize(lhs, 1, false);
+        if (op == "~")
+            return ~lhs;
+        if (op == "-")
+            return -lhs;
+        return lhs;
+    }
+    z3::expr rhs = eval(expr->rhs);
+    if (op == "&&")
+        return toBool(lhs) && toBool(rhs);
+    if (op == "||")
+        return toBool(lhs) || toBool(rhs);
+    if (lhs.is_bool() && rhs.is_bool()) {
+        if (op == "==")
+            return lhs == rhs;
+        if (op == "!=" || op == "^")
+            return lhs != rhs;
+        if (op == "&")
+            return lhs && rhs;
+        if (op == "|")
+            return lhs || rhs;
+    }
+    bool signedOp = isSigned(expr->lhs->bsvtype);
+    unsigned width = max(lhs.is_bool() ? 1 : lhs.get_sort().bv_size(), rhs.is_bool() ? 1 : rhs.get_sort().bv_size());
+    lhs = resize(lhs, width, signedOp);
+    rhs = resize(rhs, width, isSigned(expr->rhs->bsvtype));
+    if (op == "+")
+        return lhs + rhs;
+    if (op == "-")
+        return lhs - rhs;
+    if (op == "*")
+        return lhs * rhs;
+    if (op == "/")
+        return signedOp ? lhs / rhs : z3::udiv(lhs, rhs);
+    if (op == "%")
+        return signedOp ? z3::srem(lhs, rhs) : z3::urem(lhs, rhs);
+    if (op == "&")
+        return lhs & rhs;
+    if (op == "|")
+        return lhs | rhs;
+    if (op == "^")
+        return lhs ^ rhs;
+    if (op == "<<")
+        return z3::shl(lhs, rhs);
+    if (op == ">>")
+        return signedOp ? z3::ashr(lhs, rhs) : z3::lshr(lhs, rhs);
+    if (op == "==")
+        return lhs == rhs;
+    if (op == "!=")
+        return lhs != rhs;
+    if (op == "<")
+        return signedOp ? lhs < rhs : z3::ult(lhs, rhs);
+    if (op == "<=")
+        return signedOp ? lhs <= rhs : z3::ule(lhs, rhs);
+    if (op == ">")
+        return signedOp ? lhs > rhs : z3::ugt(lhs, rhs);
+    if (op == ">=")
+        return signedOp ? lhs >= rhs : z3::uge(lhs, rhs);
+    return defaultExpr(expr);
+}
+
+z3::expr BoundedModelChecker::visitValueofExpr(const shared_ptr<ValueofExpr> &expr) {
+    shared_ptr<BSVType> argtype = expr->argtype->eval();
+    if (!argtype->isNumeric())
+        return defaultExpr(expr);
+    return ctx.bv_val((uint64_t)argtype->numericValue(), 64);
+}
+
+z3::expr BoundedModelChecker::visitVarExpr(const shared_ptr<VarExpr> &expr) {
+    const string &name = expr->name;
+    if (name == "True" || name == "False")
+        return ctx.bool_val(name == "True");
+    auto it = env.find(name);
+    if (it != env.cend())
+        return it->second;
+    it = moduleEnv.find(name);
+    if (it != moduleEnv.cend())
+        return it->second;
+    auto regIt = registerIndex.find(name);
+    if (regIt != registerIndex.cend())
+        return current[regIt->second];
+    return defaultExpr(expr);
+}
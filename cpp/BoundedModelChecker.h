@@ -0,0 +1,142 @@
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "z3++.h"
+
+#include "AstDispatch.h"
+#include "Stmt.h"
+
+using namespace std;
+
+// Bounded model checking of a flattened, simplified module, see Inliner.
+//
+// The registers are bit-vector constants, one set per step, and in each
+// step exactly one rule whose guard holds fires, as in Kami. Registers
+// start at zero, like in the Interpreter. The properties are the
+// dynamicAssert(cond, message) calls of the rule bodies (see
+// lib/Assert.bsv): check() looks for a sequence of at most maxSteps rule
+// firings that ends in a firing reaching an assertion with cond false,
+// and prints it as a trace of the rules fired and the registers they
+// changed.
+//
+// Each rule is encoded once, over step-free register constants, and
+// instantiated per step by substitution. The transition relations stay
+// in the solver and each step's properties are checked between push and
+// pop, so later steps reuse what the solver learned about earlier ones.
+//
+// Rules with statements that cannot be encoded may still fire, and the
+// registers they write are then unconstrained. Expressions that cannot be
+// encoded are unconstrained too. Neither hides a failing run, but a trace
+// that depends on them may be spurious. Both are reported. The assertions
+// of such rules are not checked, so a check that finds no failure is then
+// reported as incomplete instead of passing.
+class BoundedModelChecker : public StmtDispatcher<BoundedModelChecker, bool>,
+                            public ExprDispatcher<BoundedModelChecker, z3::expr> {
+    struct Assertion {
+        z3::expr violated;
+        string message;
+        SourcePos sourcePos;
+    };
+
+    struct RuleEncoding {
+        shared_ptr<RuleDefStmt> ruleDef;
+        z3::expr guard;
+        // per register, the value after the rule fires
+        z3::expr_vector next;
+        z3::expr finishes;
+        vector<Assertion> assertions;
+        // false if the rule only has its guard and unconstrained writes
+        bool encoded;
+    };
+
+    ostream &out;
+    z3::context ctx;
+    z3::solver solver;
+    map<string, shared_ptr<ModuleDefStmt>> moduleDefs;
+    map<string, shared_ptr<FunctionDefStmt>> functionDefs;
+    string moduleName;
+
+    vector<string> registerNames;
+    vector<shared_ptr<BSVType>> registerTypes;
+    map<string, int> registerIndex;
+    // the step-free state: the registers, then whether $finish was called
+    z3::expr_vector current;
+    // unconstrained values, renamed in each step
+    z3::expr_vector havocs;
+    vector<RuleEncoding> rules;
+    int numAssertions = 0;
+    // rules with assertions that were not encoded
+    vector<string> uncheckedRules;
+
+    // while encoding a rule or function
+    map<string, z3::expr> moduleEnv;
+    map<string, z3::expr> env;
+    z3::expr pathCondition;
+    z3::expr returned;
+    z3::expr returnValue;
+    bool hasReturnValue = false;
+    shared_ptr<BSVType> returnType;
+    z3::expr_vector next;
+    z3::expr finishes;
+    vector<Assertion> assertions;
+    int callDepth = 0;
+
+public:
+    BoundedModelChecker(const vector<shared_ptr<Stmt>> &packageStmts, ostream &out = cout);
+    ~BoundedModelChecker() {}
+
+    // encodes the registers and rules of the module, false if it has no assertions to check
+    bool load(const string &moduleName);
+    // false if an assertion fails within maxSteps rule firings, or if the
+    // solver cannot tell, or if some assertions are not encoded
+    bool check(int maxSteps);
+
+    z3::expr eval(const shared_ptr<Expr> &expr);
+    // false if the statement cannot be encoded
+    bool execute(const shared_ptr<Stmt> &stmt);
+
+    bool defaultStmt(const shared_ptr<Stmt> &stmt);
+    bool visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt);
+    bool visitBlockStmt(const shared_ptr<BlockStmt> &stmt);
+    bool visitCallStmt(const shared_ptr<CallStmt> &stmt);
+    bool visitExprStmt(const shared_ptr<ExprStmt> &stmt);
+    bool visitForStmt(const shared_ptr<ForStmt> &stmt);
+    bool visitIfStmt(const shared_ptr<IfStmt> &stmt);
+    bool visitRegReadStmt(const shared_ptr<RegReadStmt> &stmt);
+    bool visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt);
+    bool visitReturnStmt(const shared_ptr<ReturnStmt> &stmt);
+    bool visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt);
+    bool visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt);
+    bool visitWhileStmt(const shared_ptr<WhileStmt> &stmt);
+
+    z3::expr defaultExpr(const shared_ptr<Expr> &expr);
+    z3::expr visitBitConcatExpr(const shared_ptr<BitConcatExpr> &expr);
+    z3::expr visitBitSelExpr(const shared_ptr<BitSelExpr> &expr);
+    z3::expr visitCallExpr(const shared_ptr<CallExpr> &expr);
+    z3::expr visitCondExpr(const shared_ptr<CondExpr> &expr);
+    z3::expr visitIntConst(const shared_ptr<IntConst> &expr);
+    z3::expr visitOperatorExpr(const shared_ptr<OperatorExpr> &expr);
+    z3::expr visitValueofExpr(const shared_ptr<ValueofExpr> &expr);
+    z3::expr visitVarExpr(const shared_ptr<VarExpr> &expr);
+
+private:
+    bool encodeRule(const shared_ptr<RuleDefStmt> &ruleDef);
+    bool executeLoop(const shared_ptr<Expr> &test, const vector<shared_ptr<Stmt>> &incr, const shared_ptr<Stmt> &body);
+    z3::expr callFunction(const shared_ptr<FunctionDefStmt> &functionDef, const shared_ptr<CallExpr> &expr);
+    z3::expr havoc(const shared_ptr<BSVType> &bsvtype);
+    // prints that the check is incomplete if some assertions were not encoded
+    bool reportUnchecked();
+    z3::expr active();
+    void bind(const string &name, const z3::expr &value);
+    z3::expr toBool(const z3::expr &value);
+    z3::expr fit(const z3::expr &value, const shared_ptr<BSVType> &bsvtype, bool isSigned);
+    z3::expr resize(const z3::expr &value, unsigned width, bool isSigned);
+    z3::expr_vector stepState(int step);
+    z3::expr atStep(const z3::expr &value, const z3::expr_vector &from, const z3::expr_vector &to);
+    void printTrace(const z3::model &model, const vector<z3::expr_vector> &states, int failingStep);
+};
@@ -0,0 +1,259 @@
+#include <algorithm>
+
+#include "CommonSubexprs.h"
+#include "NameCollector.h"
+
+// Walks a statement and offers each expression to CommonSubexprs::occurrence.
+class OccurrenceCollector : public AstVisitor<OccurrenceCollector> {
+    CommonSubexprs &subexprs;
+
+public:
+    OccurrenceCollector(CommonSubexprs &subexprs) : subexprs(subexprs) {}
+
+    void visitArraySubExpr(const shared_ptr<ArraySubExpr> &expr) {
+        if (subexprs.occurrence(expr))
+            AstVisitor<OccurrenceCollector>::visitArraySubExpr(expr);
+    }
+
+    void visitBitConcatExpr(const shared_ptr<BitConcatExpr> &expr) {
+        if (subexprs.occurrence(expr))
+            AstVisitor<OccurrenceCollector>::visitBitConcatExpr(expr);
+    }
+
+    void visitBitSelExpr(const shared_ptr<BitSelExpr> &expr) {
+        if (subexprs.occurrence(expr))
+            AstVisitor<OccurrenceCollector>::visitBitSelExpr(expr);
+    }
+
+    // the function is generated as a method name, not as an expression
+    void visitCallExpr(const shared_ptr<CallExpr> &expr) {
+        visit(expr->args);
+    }
+
+    void visitCondExpr(const shared_ptr<CondExpr> &expr) {
+        if (subexprs.occurrence(expr))
+            AstVisitor<OccurrenceCollector>::visitCondExpr(expr);
+    }
+
+    void visitFieldExpr(const shared_ptr<FieldExpr> &expr) {
+        if (subexprs.occurrence(expr))
+            AstVisitor<OccurrenceCollector>::visitFieldExpr(expr);
+    }
+
+    void visitOperatorExpr(const shared_ptr<OperatorExpr> &expr) {
+        if (subexprs.occurrence(expr))
+            AstVisitor<OccurrenceCollector>::visitOperatorExpr(expr);
+    }
+};
+
+void CommonSubexprs::analyze(const shared_ptr<Expr> &guard, const vector<shared_ptr<Stmt>> &stmts) {
+    labels.clear();
+    nodes.clear();
+    ids.clear();
+    exprs.clear();
+    freeVars.clear();
+    heights.clear();
+    shareable.clear();
+    pure.clear();
+    shared.clear();
+    sharedById.clear();
+    open.clear();
+    counts.clear();
+
+    OccurrenceCollector collector(*this);
+    for (size_t i = 0; i <= stmts.size(); i++) {
+        currentStmt = i;
+        nestedDefs.clear();
+        set<string> defs;
+        if (i == 0) {
+            collector.visit(guard);
+        } else if (shared_ptr<Stmt> stmt = stmts[i - 1]) {
+            NameCollector names;
+            names.visit(stmt);
+            defs = names.bound;
+            defs.insert(names.assigned.cbegin(), names.assigned.cend());
+            // the right hand side of a binding or assignment still sees the previous value
+            nestedDefs = defs;
+            if (shared_ptr<VarBindingStmt> varBinding = stmt->varBindingStmt())
+                nestedDefs.erase(varBinding->name);
+            else if (shared_ptr<ActionBindingStmt> actionBinding = stmt->actionBindingStmt())
+                nestedDefs.erase(actionBinding->name);
+            else if (shared_ptr<RegReadStmt> regRead = stmt->regReadStmt())
+                nestedDefs.erase(regRead->var);
+            else if (shared_ptr<VarAssignStmt> varAssign = stmt->varAssignStmt())
+                if (shared_ptr<VarLValue> varLValue = varAssign->lhs->varLValue())
+                    nestedDefs.erase(varLValue->name);
+            collector.visit(stmt);
+        }
+
+        vector<int> killed;
+        for (auto it = open.cbegin(); it != open.cend(); ++it) {
+            const set<string> &vars = freeVars[it->first];
+            for (auto var = vars.cbegin(); var != vars.cend(); ++var) {
+                if (defs.count(*var)) {
+                    killed.push_back(it->first);
+                    break;
+                }
+            }
+        }
+        for (size_t j = 0; j < killed.size(); j++)
+            close(killed[j]);
+    }
+    while (open.size())
+        close(open.cbegin()->first);
+
+    stable_sort(shared.begin(), shared.end(), [](const Shared &a, const Shared &b) {
+        return a.first < b.first || (a.first == b.first && a.height < b.height);
+    });
+    for (size_t i = 0; i < shared.size(); i++) {
+        shared[i].name = prefix + to_string(i);
+        sharedById[ids[shared[i].expr.get()]].push_back(i);
+    }
+    currentStmt = 0;
+}
+
+vector<CommonSubexprs::Shared> CommonSubexprs::bindingsBefore(size_t i) const {
+    vector<Shared> bindings;
+    for (size_t j = 0; j < shared.size(); j++) {
+        if (shared[j].first == i)
+            bindings.push_back(shared[j]);
+    }
+    return bindings;
+}
+
+string CommonSubexprs::sharedName(const shared_ptr<Expr> &expr) const {
+    auto id = ids.find(expr.get());
+    if (id == ids.cend())
+        return string();
+    auto it = sharedById.find(id->second);
+    if (it == sharedById.cend())
+        return string();
+    for (size_t j = 0; j < it->second.size(); j++) {
+        const Shared &s = shared[it->second[j]];
+        if (s.first <= currentStmt && currentStmt <= s.last)
+            return s.name;
+    }
+    return string();
+}
+
+int CommonSubexprs::label(const string &name) {
+    auto it = labels.find(name);
+    if (it != labels.cend())
+        return it->second;
+    int id = labels.size();
+    labels[name] = id;
+    return id;
+}
+
+int CommonSubexprs::intern(const shared_ptr<Expr> &expr) {
+    auto cached = ids.find(expr.get());
+    if (cached != ids.cend())
+        return cached->second;
+
+    // literals and variables are typed by their context, so equal ones may still differ in width
+    vector<int> key{(int)expr->exprType, label(expr->bsvtype ? expr->bsvtype->to_string() : string())};
+    vector<shared_ptr<Expr>> children;
+    bool candidate = true;
+    bool simple = true;
+    switch (expr->exprType) {
+        case VarExprType:
+            key.push_back(label(expr->varExpr()->name));
+            candidate = false;
+            break;
+        case IntConstType:
+            key.push_back(label(expr->intConst()->repr));
+            candidate = false;
+            break;
+        case StringConstType:
+            key.push_back(label(expr->stringConst()->repr));
+            candidate = false;
+            break;
+        case OperatorExprType: {
+            shared_ptr<OperatorExpr> operatorExpr = expr->operatorExpr();
+            key.push_back(label(operatorExpr->op));
+            children = {operatorExpr->lhs, operatorExpr->rhs};
+            // negative literals
+            candidate = operatorExpr->rhs || !operatorExpr->lhs->intConst();
+        } break;
+        case FieldExprType:
+            key.push_back(label(expr->fieldExpr()->fieldName));
+            children = {expr->fieldExpr()->object};
+            break;
+        case BitSelExprType:
+            children = {expr->bitSelExpr()->value, expr->bitSelExpr()->msb, expr->bitSelExpr()->lsb};
+            break;
+        case BitConcatExprType:
+            children = expr->bitConcatExpr()->values;
+            break;
+        case CondExprType:
+            children = {expr->condExpr()->cond, expr->condExpr()->thenExpr, expr->condExpr()->elseExpr};
+            break;
+        case ArraySubExprType:
+            children = {expr->arraySubExpr()->array, expr->arraySubExpr()->index};
+            break;
+        default:
+            // calls and the rest are never equal to anything else
+            key.push_back(-1 - (int)exprs.size());
+            candidate = false;
+            simple = false;
+    }
+    for (size_t i = 0; i < children.size(); i++)
+        key.push_back(children[i] ? intern(children[i]) : -1);
+
+    int id;
+    auto it = nodes.find(key);
+    if (it != nodes.cend()) {
+        id = it->second;
+    } else {
+        id = exprs.size();
+        nodes[key] = id;
+        set<string> vars;
+        if (expr->exprType == VarExprType)
+            vars.insert(expr->varExpr()->name);
+        int height = 1;
+        bool isPure = simple;
+        for (size_t i = 0; i < children.size(); i++) {
+            if (!children[i])
+                continue;
+            int child = ids[children[i].get()];
+            vars.insert(freeVars[child].cbegin(), freeVars[child].cend());
+            height = max(height, heights[child] + 1);
+            isPure = isPure && pure[child];
+        }
+        exprs.push_back(expr);
+        freeVars.push_back(vars);
+        heights.push_back(height);
+        pure.push_back(isPure);
+        shareable.push_back(candidate && isPure);
+    }
+    ids[expr.get()] = id;
+    return id;
+}
+
+bool CommonSubexprs::occurrence(const shared_ptr<Expr> &expr) {
+    int id = intern(expr);
+    if (!shareable[id])
+        return true;
+    const set<string> &vars = freeVars[id];
+    for (auto var = vars.cbegin(); var != vars.cend(); ++var) {
+        if (nestedDefs.count(*var))
+            return true;
+    }
+    auto it = open.find(id);
+    if (it != open.end()) {
+        // the subexpressions of a repeated occurrence come with it
+        counts[id]++;
+        it->second.last = currentStmt;
+        return false;
+    }
+    open[id] = Shared{string(), expr, currentStmt, currentStmt, heights[id]};
+    counts[id] = 1;
+    return true;
+}
+
+void CommonSubexprs::close(int id) {
+    if (counts[id] >= 2)
+        shared.push_back(open[id]);
+    open.erase(id);
+    counts.erase(id);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Expr.h"
+#include "Stmt.h"
+
+using namespace std;
+
+// Finds the expressions a rule or method body computes more than once, for
+// GenerateKami to bind once with LET and refer to by name afterwards.
+//
+// Expressions are hash-consed, so structurally equal ones of the same type
+// share an id. An occurrence is shared with the earlier ones as long as
+// none of the variables it reads has been bound or assigned in between.
+// Each shared expression is bound before the top-level statement that
+// first uses it, so it stays in scope in the branches of the ifs that
+// follow. Expressions that call functions or methods are not shared.
+class CommonSubexprs {
+public:
+    struct Shared {
+        string name;
+        shared_ptr<Expr> expr;
+        // the first and last top-level statements using it, 0 being the guard
+        size_t first;
+        size_t last;
+        int height;
+    };
+
+private:
+    string prefix;
+    map<string, int> labels;
+    map<vector<int>, int> nodes;
+    map<const Expr *, int> ids;
+    // per id
+    vector<shared_ptr<Expr>> exprs;
+    vector<set<string>> freeVars;
+    vector<int> heights;
+    vector<bool> shareable;
+    vector<bool> pure;
+
+    vector<Shared> shared;
+    map<int, vector<size_t>> sharedById;
+    size_t currentStmt = 0;
+
+    // while analyzing, the variables bound or assigned inside the current statement
+    set<string> nestedDefs;
+    // candidates that may still be shared, with their number of occurrences
+    map<int, Shared> open;
+    map<int, int> counts;
+
+    friend class OccurrenceCollector;
+
+public:
+    CommonSubexprs(const string &prefix = "cse'") : prefix(prefix) {}
+    ~CommonSubexprs() {}
+
+    // guard may be null
+    void analyze(const shared_ptr<Expr> &guard, const vector<shared_ptr<Stmt>> &stmts);
+
+    // the expressions to bind before top-level statement i, which is the guard for 0 and stmts[i - 1] otherwise,
+    // inner ones first
+    vector<Shared> bindingsBefore(size_t i) const;
+
+    // sets the top-level statement being generated
+    void enterStmt(size_t i) { currentStmt = i; }
+
+    // the name bound to expr in the current top-level statement, empty if there is none
+    string sharedName(const shared_ptr<Expr> &expr) const;
+
+    size_t numShared() const { return shared.size(); }
+
+private:
+    int intern(const shared_ptr<Expr> &expr);
+    int label(const string &name);
+    // counts an occurrence of expr, false if its subexpressions need not be counted
+    bool occurrence(const shared_ptr<Expr> &expr);
+    void close(int id);
+};
@@ -0,0 +1,262 @@
+#include <chrono>
+
+#include "AstVisitor.h"
+#include "ConflictAnalysis.h"
+
+// Adds the registers and instances used by one rule or method to its footprint.
+class FootprintCollector : public AstVisitor<FootprintCollector> {
+    const map<string, size_t> &resourceIds;
+    const ModuleConflicts &conflicts;
+    // module definitions of the instances defined in this package
+    const map<string, shared_ptr<ModuleDefStmt>> &instanceModules;
+    Footprint &footprint;
+
+    static void set(vector<uint64_t> &bits, size_t id) {
+        bits[id / 64] |= (uint64_t)1 << (id % 64);
+    }
+
+    bool isActionMethod(const string &instanceName, const shared_ptr<FieldExpr> &expr) const {
+        auto it = instanceModules.find(instanceName);
+        if (it != instanceModules.cend()) {
+            const vector<shared_ptr<Stmt>> &stmts = it->second->stmts;
+            for (size_t i = 0; i < stmts.size(); i++) {
+                shared_ptr<MethodDefStmt> methodDef = stmts[i]->methodDefStmt();
+                if (methodDef && methodDef->name == expr->fieldName)
+                    return methodDef->returnType->name == "Action" || methodDef->returnType->name == "ActionValue";
+            }
+        }
+        // otherwise go by the method type, FunctionN with the return type last
+        shared_ptr<BSVType> bsvtype = expr->bsvtype;
+        if (bsvtype && bsvtype->name.find("Function") == 0 && bsvtype->params.size())
+            bsvtype = bsvtype->params.back();
+        return bsvtype && (bsvtype->name == "Action" || bsvtype->name == "ActionValue");
+    }
+
+public:
+    FootprintCollector(const map<string, size_t> &resourceIds, const ModuleConflicts &conflicts,
+                       const map<string, shared_ptr<ModuleDefStmt>> &instanceModules, Footprint &footprint)
+            : resourceIds(resourceIds), conflicts(conflicts), instanceModules(instanceModules),
+              footprint(footprint) {}
+
+    void visitRegReadStmt(const shared_ptr<RegReadStmt> &stmt) {
+        auto it = resourceIds.find(stmt->regName);
+        if (it != resourceIds.cend())
+            set(footprint.reads, it->second);
+    }
+
+    void visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt) {
+        auto it = resourceIds.find(stmt->regName);
+        if (it != resourceIds.cend())
+            set(footprint.writes, it->second);
+        AstVisitor<FootprintCollector>::visitRegWriteStmt(stmt);
+    }
+
+    // guards and some expressions still read registers by name
+    void visitVarExpr(const shared_ptr<VarExpr> &expr) {
+        auto it = resourceIds.find(expr->name);
+        if (it != resourceIds.cend())
+            set(footprint.reads, it->second);
+    }
+
+    void visitFieldExpr(const shared_ptr<FieldExpr> &expr) {
+        shared_ptr<VarExpr> varExpr = expr->object->varExpr();
+        auto it = varExpr ? resourceIds.find(varExpr->name) : resourceIds.cend();
+        if (it == resourceIds.cend() || it->second < conflicts.numRegisters) {
+            AstVisitor<FootprintCollector>::visitFieldExpr(expr);
+            return;
+        }
+        string methodName = varExpr->name + "." + expr->fieldName;
+        if (isActionMethod(varExpr->name, expr)) {
+            footprint.actionCalls.insert(methodName);
+            set(footprint.writes, it->second);
+        } else {
+            footprint.valueCalls.insert(methodName);
+            set(footprint.reads, it->second);
+        }
+    }
+};
+
+ConflictAnalysis::ConflictAnalysis(const vector<shared_ptr<Stmt>> &packageStmts) {
+    for (size_t i = 0; i < packageStmts.size(); i++) {
+        shared_ptr<Stmt> stmt = packageStmts[i];
+        if (!stmt)
+            continue;
+        if (shared_ptr<ModuleDefStmt> moduleDef = stmt->moduleDefStmt())
+            moduleDefs[moduleDef->name] = moduleDef;
+    }
+}
+
+void ConflictAnalysis::analyzePackage() {
+    for (auto it = moduleDefs.cbegin(); it != moduleDefs.cend(); ++it)
+        analyzeModule(it->second);
+}
+
+size_t ConflictAnalysis::analyzeModule(const shared_ptr<ModuleDefStmt> &moduleDef) {
+    auto start = chrono::steady_clock::now();
+    size_t index = modules.size();
+    modules.push_back(ModuleConflicts());
+    ModuleConflicts &conflicts = modules.back();
+    conflicts.moduleName = moduleDef->name;
+
+    vector<string> instances;
+    map<string, shared_ptr<ModuleDefStmt>> instanceModules;
+    for (size_t i = 0; i < moduleDef->stmts.size(); i++) {
+        shared_ptr<Stmt> stmt = moduleDef->stmts[i];
+        if (shared_ptr<RegisterStmt> registerStmt = stmt->registerStmt()) {
+            conflicts.resources.push_back(registerStmt->regName);
+        } else if (shared_ptr<ModuleInstStmt> moduleInst = stmt->moduleInstStmt()) {
+            if (moduleInst->interfaceType->name == "Reg") {
+                conflicts.resources.push_back(moduleInst->name);
+                continue;
+            }
+            instances.push_back(moduleInst->name);
+            shared_ptr<CallExpr> callExpr = moduleInst->rhs ? moduleInst->rhs->callExpr() : shared_ptr<CallExpr>();
+            shared_ptr<VarExpr> constructor = callExpr ? callExpr->function->varExpr() : shared_ptr<VarExpr>();
+            auto it = constructor ? moduleDefs.find(constructor->name) : moduleDefs.end();
+            if (it != moduleDefs.end())
+                instanceModules[moduleInst->name] = it->second;
+        }
+    }
+    conflicts.numRegisters = conflicts.resources.size();
+    conflicts.resources.insert(conflicts.resources.end(), instances.begin(), instances.end());
+    conflicts.numWords = (conflicts.resources.size() + 63) / 64;
+
+    map<string, size_t> resourceIds;
+    for (size_t i = 0; i < conflicts.resources.size(); i++)
+        resourceIds[conflicts.resources[i]] = i;
+
+    for (size_t i = 0; i < moduleDef->stmts.size(); i++) {
+        shared_ptr<Stmt> stmt = moduleDef->stmts[i];
+        shared_ptr<RuleDefStmt> ruleDef = stmt->ruleDefStmt();
+        shared_ptr<MethodDefStmt> methodDef = stmt->methodDefStmt();
+        if (!ruleDef && !methodDef)
+            continue;
+        conflicts.footprints.push_back(Footprint());
+        Footprint &footprint = conflicts.footprints.back();
+        footprint.name = ruleDef ? ruleDef->name : methodDef->name;
+        footprint.isRule = (bool)ruleDef;
+        footprint.reads.resize(conflicts.numWords);
+        footprint.writes.resize(conflicts.numWords);
+        FootprintCollector collector(resourceIds, conflicts, instanceModules, footprint);
+        collector.visit(ruleDef ? ruleDef->guard : methodDef->guard);
+        collector.visit(ruleDef ? ruleDef->stmts : methodDef->stmts);
+    }
+
+    computeMatrix(conflicts);
+    auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+    cerr << "Conflict analysis of " << conflicts.moduleName << ": " << conflicts.footprints.size()
+         << " rules and methods over " << conflicts.resources.size() << " resources in " << elapsed.count()
+         << "us" << endl;
+    return index;
+}
+
+// The footprints are copied into one flat array per set so that each pair
+// is a few straight-line loops over adjacent words, which the compiler
+// vectorizes, without any branches inside the loops.
+void ConflictAnalysis::computeMatrix(ModuleConflicts &conflicts) {
+    const size_t n = conflicts.footprints.size();
+    const size_t words = conflicts.numWords;
+    vector<uint64_t> reads(n * words), writes(n * words), instanceMask(words);
+    for (size_t a = 0; a < n; a++) {
+        copy(conflicts.footprints[a].reads.begin(), conflicts.footprints[a].reads.end(), reads.begin() + a * words);
+        copy(conflicts.footprints[a].writes.begin(), conflicts.footprints[a].writes.end(), writes.begin() + a * words);
+    }
+    for (size_t id = conflicts.numRegisters; id < conflicts.resources.size(); id++)
+        instanceMask[id / 64] |= (uint64_t)1 << (id % 64);
+
+    conflicts.matrix.assign(n * n, SameRule);
+    for (size_t a = 0; a < n; a++) {
+        const uint64_t *readsA = &reads[a * words];
+        const uint64_t *writesA = &writes[a * words];
+        for (size_t b = a + 1; b < n; b++) {
+            const uint64_t *readsB = &reads[b * words];
+            const uint64_t *writesB = &writes[b * words];
+            uint64_t readWrite = 0, writeRead = 0, writeWrite = 0, instanceWrites = 0;
+            for (size_t w = 0; w < words; w++) {
+                readWrite |= readsA[w] & writesB[w];
+                writeRead |= writesA[w] & readsB[w];
+                writeWrite |= writesA[w] & writesB[w];
+                instanceWrites |= writesA[w] & writesB[w] & instanceMask[w];
+            }
+            ConflictKind kind;
+            if (!readWrite && !writeRead && !writeWrite)
+                kind = ConflictFree;
+            else if (instanceWrites || (readWrite && writeRead))
+                kind = Conflicting;
+            else if (!writeRead)
+                kind = SequencedBefore;
+            else
+                kind = SequencedAfter;
+            conflicts.matrix[a * n + b] = kind;
+            conflicts.matrix[b * n + a] = kind == SequencedBefore ? SequencedAfter
+                                        : kind == SequencedAfter ? SequencedBefore : kind;
+        }
+    }
+}
+
+static void writeNames(ostream &out, const vector<uint64_t> &bits, const vector<string> &resources) {
+    out << "[";
+    bool first = true;
+    for (size_t id = 0; id < resources.size(); id++) {
+        if (!(bits[id / 64] & ((uint64_t)1 << (id % 64))))
+            continue;
+        out << (first ? "" : ", ") << "\"" << resources[id] << "\"";
+        first = false;
+    }
+    out << "]";
+}
+
+static void writeNames(ostream &out, const set<string> &names) {
+    out << "[";
+    for (auto it = names.cbegin(); it != names.cend(); ++it)
+        out << (it == names.cbegin() ? "" : ", ") << "\"" << *it << "\"";
+    out << "]";
+}
+
+// BSV identifiers need no escaping. Each row of "conflicts" is a string with
+// one ConflictKind character per column, in the order of "footprints".
+void ConflictAnalysis::writeJson(ostream &out, const string &packageName) const {
+    out << "{" << endl;
+    out << "  \"package\": \"" << packageName << "\"," << endl;
+    out << "  \"modules\": [" << endl;
+    for (size_t m = 0; m < modules.size(); m++) {
+        const ModuleConflicts &conflicts = modules[m];
+        out << "    {" << endl;
+        out << "      \"name\": \"" << conflicts.moduleName << "\"," << endl;
+        out << "      \"registers\": [";
+        for (size_t id = 0; id < conflicts.numRegisters; id++)
+            out << (id ? ", " : "") << "\"" << conflicts.resources[id] << "\"";
+        out << "]," << endl;
+        out << "      \"instances\": [";
+        for (size_t id = conflicts.numRegisters; id < conflicts.resources.size(); id++)
+            out << (id > conflicts.numRegisters ? ", " : "") << "\"" << conflicts.resources[id] << "\"";
+        out << "]," << endl;
+        out << "      \"footprints\": [" << endl;
+        for (size_t i = 0; i < conflicts.footprints.size(); i++) {
+            const Footprint &footprint = conflicts.footprints[i];
+            out << "        {\"name\": \"" << footprint.name << "\", \"kind\": \""
+                << (footprint.isRule ? "rule" : "method") << "\", \"reads\": ";
+            writeNames(out, footprint.reads, conflicts.resources);
+            out << ", \"writes\": ";
+            writeNames(out, footprint.writes, conflicts.resources);
+            out << ", \"valueCalls\": ";
+            writeNames(out, footprint.valueCalls);
+            out << ", \"actionCalls\": ";
+            writeNames(out, footprint.actionCalls);
+            out << "}" << (i + 1 < conflicts.footprints.size() ? "," : "") << endl;
+        }
+        out << "      ]," << endl;
+        out << "      \"conflicts\": [" << endl;
+        size_t n = conflicts.footprints.size();
+        for (size_t a = 0; a < n; a++) {
+            out << "        \"";
+            for (size_t b = 0; b < n; b++)
+                out << (char)conflicts.conflict(a, b);
+            out << "\"" << (a + 1 < n ? "," : "") << endl;
+        }
+        out << "      ]" << endl;
+        out << "    }" << (m + 1 < modules.size() ? "," : "") << endl;
+    }
+    out << "  ]" << endl;
+    out << "}" << endl;
+}
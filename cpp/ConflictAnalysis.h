@@ -0,0 +1,77 @@
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Stmt.h"
+
+using namespace std;
+
+// Registers and submodule instances read and written by a rule or method,
+// as bitsets over the resource ids of its module.
+struct Footprint {
+    string name;
+    bool isRule;
+    vector<uint64_t> reads;
+    vector<uint64_t> writes;
+    // submodule methods called, as instance.method
+    set<string> valueCalls;
+    set<string> actionCalls;
+};
+
+// How two rules or methods a and b of a module can be scheduled in the
+// same cycle. Sequenced means a can fire before b, with b seeing none of
+// a's writes.
+enum ConflictKind : char {
+    ConflictFree = 'F',
+    SequencedBefore = '<',
+    SequencedAfter = '>',
+    Conflicting = 'C',
+    SameRule = '-'
+};
+
+struct ModuleConflicts {
+    string moduleName;
+    // registers first, then submodule instances
+    vector<string> resources;
+    size_t numRegisters = 0;
+    // words per bitset
+    size_t numWords = 0;
+    vector<Footprint> footprints;
+    // footprints.size() squared, row a column b
+    vector<ConflictKind> matrix;
+
+    ConflictKind conflict(size_t a, size_t b) const { return matrix[a * footprints.size() + b]; }
+};
+
+// Computes the footprints of the rules and methods of each module of a
+// simplified package and the pairwise conflict matrix between them.
+//
+// Registers follow the usual read before write ordering: a write by a and
+// a read by b keep a from firing before b, and two writes of the same
+// register are sequenced, the later one winning. Submodules are treated
+// conservatively: value methods read the instance, action methods write
+// it, and two action methods of the same instance conflict.
+class ConflictAnalysis {
+    map<string, shared_ptr<ModuleDefStmt>> moduleDefs;
+    vector<ModuleConflicts> modules;
+
+public:
+    ConflictAnalysis(const vector<shared_ptr<Stmt>> &packageStmts);
+    ~ConflictAnalysis() {}
+
+    void analyzePackage();
+    // returns the index of the module's conflicts in results(), which later calls may move
+    size_t analyzeModule(const shared_ptr<ModuleDefStmt> &moduleDef);
+    const vector<ModuleConflicts> &results() const { return modules; }
+
+    void writeJson(ostream &out, const string &packageName) const;
+
+private:
+    void computeMatrix(ModuleConflicts &conflicts);
+};
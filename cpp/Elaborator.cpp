@@ -0,0 +1,866 @@
+#include <ctype.h>
+#include <set>
+
+#include "AstVisitor.h"
+#include "Elaborator.h"
+
+// loops still running after this many iterations are reported as errors
+// and left to the hardware
+static const int maxUnroll = 65536;
+static const int maxCallDepth = 1000;
+
+// Names of the variables assigned by a statement, including the ones
+// updated through an element, field or bit range.
+class AssignedVarsCollector : public AstVisitor<AssignedVarsCollector> {
+ public:
+    set<string> assignedVars;
+
+    void visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt) {
+        const VarSet &lvalueVars = stmt->attrs().assignedVars;
+        for (auto it = lvalueVars.begin(); it != lvalueVars.end(); ++it)
+            assignedVars.insert(it->name());
+        AstVisitor<AssignedVarsCollector>::visitVarAssignStmt(stmt);
+    }
+
+    void visitVarLValue(const shared_ptr<VarLValue> &lvalue) {
+        assignedVars.insert(lvalue->name);
+    }
+};
+
+// names bound by the statements themselves, not by nested ones
+static void boundNames(const vector<shared_ptr<Stmt>> &stmts, set<string> &names) {
+    for (size_t i = 0; i < stmts.size(); i++) {
+        if (!stmts[i])
+            continue;
+        if (shared_ptr<VarBindingStmt> varBinding = stmts[i]->varBindingStmt())
+            names.insert(varBinding->name);
+        else if (shared_ptr<ActionBindingStmt> actionBinding = stmts[i]->actionBindingStmt())
+            names.insert(actionBinding->name);
+        else if (shared_ptr<ModuleInstStmt> moduleInst = stmts[i]->moduleInstStmt())
+            names.insert(moduleInst->name);
+    }
+}
+
+// the rules and methods of an unrolled iteration, with the iteration appended
+// to their names so that each iteration declares its own
+static vector<shared_ptr<Stmt>> suffixRuleNames(const vector<shared_ptr<Stmt>> &stmts, const string &suffix) {
+    vector<shared_ptr<Stmt>> result;
+    for (size_t i = 0; i < stmts.size(); i++) {
+        shared_ptr<Stmt> stmt = stmts[i];
+        if (!stmt) {
+            result.push_back(stmt);
+        } else if (shared_ptr<RuleDefStmt> ruleDef = stmt->ruleDefStmt()) {
+            result.push_back(makeAst<RuleDefStmt>(ruleDef->name + suffix, ruleDef->guard, ruleDef->stmts,
+                                                  ruleDef->sourcePos));
+        } else if (shared_ptr<MethodDefStmt> methodDef = stmt->methodDefStmt()) {
+            result.push_back(makeAst<MethodDefStmt>(methodDef->name + suffix, methodDef->returnType,
+                                                    methodDef->params, methodDef->paramTypes, methodDef->guard,
+                                                    methodDef->stmts, methodDef->sourcePos));
+        } else if (shared_ptr<BlockStmt> blockStmt = stmt->blockStmt()) {
+            result.push_back(makeAst<BlockStmt>(suffixRuleNames(blockStmt->stmts, suffix), blockStmt->sourcePos));
+        } else {
+            result.push_back(stmt);
+        }
+    }
+    return result;
+}
+
+// an argument of a specialized module name: letters and digits are kept and
+// anything else becomes _ and two hex digits, so that __ only separates arguments
+static string encodeArg(const string &arg) {
+    static const char hexDigits[] = "0123456789abcdef";
+    string encoded;
+    for (size_t i = 0; i < arg.size(); i++) {
+        unsigned char c = arg[i];
+        if (isalnum(c)) {
+            encoded += (char)c;
+        } else {
+            encoded += '_';
+            encoded += hexDigits[c >> 4];
+            encoded += hexDigits[c & 0xf];
+        }
+    }
+    return encoded;
+}
+
+static bool isStaticSize(const shared_ptr<BSVType> &bsvtype) {
+    return bsvtype->isNumeric() && !bsvtype->name.empty()
+           && bsvtype->name.find_first_not_of("0123456789") == string::npos;
+}
+
+Elaborator::Elaborator(const vector<shared_ptr<Stmt>> &packageStmts)
+        : packageContext(make_shared<ValueContext>()), context(packageContext) {
+    for (size_t i = 0; i < packageStmts.size(); i++) {
+        shared_ptr<Stmt> stmt = packageStmts[i];
+        if (!stmt)
+            continue;
+        if (shared_ptr<ModuleDefStmt> moduleDef = stmt->moduleDefStmt())
+            moduleDefs[moduleDef->name] = moduleDef;
+        else if (shared_ptr<FunctionDefStmt> functionDef = stmt->functionDefStmt())
+            packageContext->bind(functionDef->name, make_shared<FunctionValue>(functionDef, packageContext));
+    }
+}
+
+shared_ptr<Value> Elaborator::eval(const shared_ptr<Expr> &expr) {
+    if (!expr)
+        return shared_ptr<Value>();
+    switch (expr->exprType) {
+        case IntConstType:
+            return literalValue(static_pointer_cast<IntConst>(expr)->repr);
+        case VarExprType: {
+            const string &name = static_pointer_cast<VarExpr>(expr)->name;
+            if (name == "True" || name == "False")
+                return make_shared<BoolValue>(name == "True");
+            return context->lookup(name);
+        }
+        case OperatorExprType: {
+            shared_ptr<OperatorExpr> operatorExpr = static_pointer_cast<OperatorExpr>(expr);
+            shared_ptr<Value> lhs = eval(operatorExpr->lhs);
+            if (!operatorExpr->rhs)
+                return lhs ? lhs->unop(operatorExpr->op) : shared_ptr<Value>();
+            // False && x and True || x do not depend on x
+            shared_ptr<BoolValue> lhsBool = lhs ? lhs->boolValue() : shared_ptr<BoolValue>();
+            if (lhsBool && ((operatorExpr->op == "&&" && !lhsBool->value)
+                            || (operatorExpr->op == "||" && lhsBool->value)))
+                return lhs;
+            shared_ptr<Value> rhs = eval(operatorExpr->rhs);
+            if (!lhs || !rhs)
+                return shared_ptr<Value>();
+            return lhs->binop(operatorExpr->op, rhs);
+        }
+        case CondExprType: {
+            shared_ptr<CondExpr> condExpr = static_pointer_cast<CondExpr>(expr);
+            shared_ptr<Value> cond = eval(condExpr->cond);
+            shared_ptr<BoolValue> boolValue = cond ? cond->boolValue() : shared_ptr<BoolValue>();
+            if (!boolValue)
+                return shared_ptr<Value>();
+            return eval(boolValue->value ? condExpr->thenExpr : condExpr->elseExpr);
+        }
+        case CallExprType:
+            return evalCall(static_pointer_cast<CallExpr>(expr));
+        case ArraySubExprType: {
+            shared_ptr<ArraySubExpr> arraySubExpr = static_pointer_cast<ArraySubExpr>(expr);
+            shared_ptr<Value> array = eval(arraySubExpr->array);
+            shared_ptr<Value> index = eval(arraySubExpr->index);
+            if (!array || !index || !index->intValue())
+                return shared_ptr<Value>();
+            return array->sub(index->intValue()->value);
+        }
+        case BitSelExprType: {
+            shared_ptr<BitSelExpr> bitSelExpr = static_pointer_cast<BitSelExpr>(expr);
+            shared_ptr<Value> value = eval(bitSelExpr->value);
+            shared_ptr<Value> msb = eval(bitSelExpr->msb);
+            shared_ptr<Value> lsb = bitSelExpr->lsb ? eval(bitSelExpr->lsb) : msb;
+            if (!value || !msb || !msb->intValue() || !lsb || !lsb->intValue())
+                return shared_ptr<Value>();
+            if (shared_ptr<BitValue> bitValue = value->bitValue())
+                return bitValue->sub(msb->intValue()->value, lsb->intValue()->value);
+            if (!value->intValue())
+                return shared_ptr<Value>();
+            return value->intValue()->sub(msb->intValue()->value, lsb->intValue()->value);
+        }
+        case BitConcatExprType: {
+            shared_ptr<BitConcatExpr> bitConcatExpr = static_pointer_cast<BitConcatExpr>(expr);
+            BitVector bits;
+            for (size_t i = 0; i < bitConcatExpr->values.size(); i++) {
+                BitVector valueBits = ::valueBits(eval(bitConcatExpr->values[i]));
+                if (!valueBits.getWidth())
+                    return shared_ptr<Value>();
+                bits = bits.concat(valueBits);
+            }
+            return bitsValue(bits);
+        }
+        case ValueofExprType: {
+            shared_ptr<BSVType> argtype = static_pointer_cast<ValueofExpr>(expr)->argtype->eval();
+            if (!isStaticSize(argtype))
+                return shared_ptr<Value>();
+            return make_shared<IntValue>(argtype->numericValue());
+        }
+        default:
+            break;
+    }
+    return shared_ptr<Value>();
+}
+
+shared_ptr<Value> Elaborator::eval(const shared_ptr<Stmt> &stmt) {
+    shared_ptr<Value> savedReturnValue = returnValue;
+    returnValue.reset();
+    shared_ptr<Value> result;
+    if (execute(stmt))
+        result = returnValue ? returnValue : make_shared<VoidValue>();
+    returnValue = savedReturnValue;
+    return result;
+}
+
+shared_ptr<Value> Elaborator::evalCall(const shared_ptr<CallExpr> &expr) {
+    shared_ptr<Value> function = eval(expr->function);
+    shared_ptr<FunctionValue> functionValue = function ? function->functionValue() : shared_ptr<FunctionValue>();
+    if (!functionValue)
+        return shared_ptr<Value>();
+    shared_ptr<FunctionDefStmt> functionDef = functionValue->functionDef;
+    if (functionDef->params.size() != expr->args.size())
+        return shared_ptr<Value>();
+
+    vector<shared_ptr<Value>> args;
+    string argsKey;
+    for (size_t i = 0; i < expr->args.size(); i++) {
+        shared_ptr<Value> arg = eval(expr->args[i]);
+        if (!arg)
+            return shared_ptr<Value>();
+        args.push_back(arg);
+        argsKey += (i ? "," : "") + arg->to_string();
+    }
+    // the package context only binds functions, while the context of a
+    // nested function may still be assigned to, so only package functions are cached
+    bool cacheable = functionValue->context == packageContext;
+    pair<shared_ptr<FunctionValue>,string> key(functionValue, argsKey);
+    auto it = cacheable ? callCache.find(key) : callCache.cend();
+    if (it != callCache.cend())
+        return it->second;
+    if (callDepth >= maxCallDepth) {
+        cerr << "Elaborator: call depth exceeded evaluating " << functionDef->name << "(" << argsKey << ")" << endl;
+        return shared_ptr<Value>();
+    }
+
+    shared_ptr<ValueContext> savedContext = context;
+    shared_ptr<Value> savedReturnValue = returnValue;
+    context = make_shared<ValueContext>(functionValue->context);
+    for (size_t i = 0; i < args.size(); i++)
+        context->bind(functionDef->params[i], args[i]);
+    returnValue.reset();
+    callDepth++;
+    bool executed = true;
+    for (size_t i = 0; executed && !returnValue && i < functionDef->stmts.size(); i++)
+        executed = execute(functionDef->stmts[i]);
+    callDepth--;
+    shared_ptr<Value> result = executed ? returnValue : shared_ptr<Value>();
+    context = savedContext;
+    returnValue = savedReturnValue;
+
+    // a failed call may succeed at a lower depth
+    if (cacheable && result)
+        callCache[key] = result;
+    return result;
+}
+
+// Runs a statement of a function body on static values. Returns false
+// if the statement needs a value that is not known at elaboration time.
+bool Elaborator::execute(const shared_ptr<Stmt> &stmt) {
+    if (!stmt)
+        return true;
+    switch (stmt->stmtType) {
+        case VarBindingStmtType: {
+            shared_ptr<VarBindingStmt> varBinding = static_pointer_cast<VarBindingStmt>(stmt);
+            shared_ptr<Value> value = eval(varBinding->rhs);
+            if (!value)
+                return false;
+            context->bind(varBinding->name, value);
+            return true;
+        }
+        case VarAssignStmtType: {
+            shared_ptr<VarAssignStmt> varAssign = static_pointer_cast<VarAssignStmt>(stmt);
+            shared_ptr<VarLValue> varLValue = varAssign->lhs->varLValue();
+            if (!varLValue || varAssign->op != "=")
+                return false;
+            shared_ptr<Value> value = eval(varAssign->rhs);
+            if (!value)
+                return false;
+            context->assign(varLValue->name, value);
+            return true;
+        }
+        case BlockStmtType: {
+            shared_ptr<BlockStmt> blockStmt = static_pointer_cast<BlockStmt>(stmt);
+            shared_ptr<ValueContext> savedContext = context;
+            context = make_shared<ValueContext>(savedContext);
+            bool executed = true;
+            for (size_t i = 0; executed && !returnValue && i < blockStmt->stmts.size(); i++)
+                executed = execute(blockStmt->stmts[i]);
+            context = savedContext;
+            return executed;
+        }
+        case IfStmtType: {
+            shared_ptr<IfStmt> ifStmt = static_pointer_cast<IfStmt>(stmt);
+            shared_ptr<Value> condition = eval(ifStmt->condition);
+            shared_ptr<BoolValue> boolValue = condition ? condition->boolValue() : shared_ptr<BoolValue>();
+            if (!boolValue)
+                return false;
+            return execute(boolValue->value ? ifStmt->thenStmt : ifStmt->elseStmt);
+        }
+        case ForStmtType: {
+            shared_ptr<ForStmt> forStmt = static_pointer_cast<ForStmt>(stmt);
+            return executeLoop(forStmt->init, forStmt->test, forStmt->incr, forStmt->body);
+        }
+        case WhileStmtType: {
+            shared_ptr<WhileStmt> whileStmt = static_pointer_cast<WhileStmt>(stmt);
+            return executeLoop(vector<shared_ptr<Stmt>>(), whileStmt->test, vector<shared_ptr<Stmt>>(), whileStmt->body);
+        }
+        case ReturnStmtType:
+            returnValue = eval(static_pointer_cast<ReturnStmt>(stmt)->value);
+            return returnValue != nullptr;
+        case FunctionDefStmtType: {
+            shared_ptr<FunctionDefStmt> functionDef = static_pointer_cast<FunctionDefStmt>(stmt);
+            context->bind(functionDef->name, make_shared<FunctionValue>(functionDef, context));
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+bool Elaborator::executeLoop(const vector<shared_ptr<Stmt>> &init, const shared_ptr<Expr> &test,
+                             const vector<shared_ptr<Stmt>> &incr, const shared_ptr<Stmt> &body) {
+    shared_ptr<ValueContext> savedContext = context;
+    context = make_shared<ValueContext>(savedContext);
+    bool executed = true;
+    for (size_t i = 0; executed && i < init.size(); i++)
+        executed = execute(init[i]);
+    for (int iteration = 0; executed && !returnValue; iteration++) {
+        shared_ptr<Value> condition = eval(test);
+        shared_ptr<BoolValue> boolValue = condition ? condition->boolValue() : shared_ptr<BoolValue>();
+        if (boolValue && boolValue->value && iteration == maxUnroll) {
+            cerr << "Elaborator: error: loop at " << body->sourcePos.toString() << " still running after "
+                 << maxUnroll << " iterations" << endl;
+            errors++;
+        }
+        if (!boolValue || iteration == maxUnroll) {
+            executed = false;
+            break;
+        }
+        if (!boolValue->value)
+            break;
+        executed = execute(body);
+        for (size_t i = 0; executed && !returnValue && i < incr.size(); i++)
+            executed = execute(incr[i]);
+    }
+    context = savedContext;
+    return executed;
+}
+
+shared_ptr<ModuleDefStmt> Elaborator::elaborate(const string &moduleName) {
+    return elaborate(moduleName, vector<shared_ptr<Value>>());
+}
+
+// Elaborates moduleName with its leading parameters bound to args. The
+// result is named after the constructor and the arguments, e.g. mkFifo__8.
+shared_ptr<ModuleDefStmt> Elaborator::elaborate(const string &moduleName, const vector<shared_ptr<Value>> &args) {
+    auto defIt = moduleDefs.find(moduleName);
+    if (defIt == moduleDefs.cend())
+        return shared_ptr<ModuleDefStmt>();
+    shared_ptr<ModuleDefStmt> moduleDef = defIt->second;
+
+    string name = moduleName;
+    for (size_t i = 0; i < args.size(); i++)
+        name += "__" + encodeArg(args[i]->to_string());
+    auto it = elaborated.find(name);
+    if (it != elaborated.cend()) {
+        if (!it->second)
+            cerr << "Elaborator: module " << name << " instantiates itself" << endl;
+        return it->second;
+    }
+    elaborated[name] = shared_ptr<ModuleDefStmt>();
+
+    shared_ptr<ValueContext> savedContext = context;
+    context = make_shared<ValueContext>(packageContext);
+    vector<string> params;
+    vector<shared_ptr<BSVType>> paramTypes;
+    for (size_t i = 0; i < moduleDef->params.size(); i++) {
+        if (i < args.size()) {
+            context->bind(moduleDef->params[i], args[i]);
+        } else {
+            context->bind(moduleDef->params[i], shared_ptr<Value>());
+            params.push_back(moduleDef->params[i]);
+            paramTypes.push_back(moduleDef->paramTypes[i]);
+        }
+    }
+    vector<shared_ptr<Stmt>> stmts;
+    for (size_t i = 0; i < moduleDef->stmts.size(); i++) {
+        if (moduleDef->stmts[i])
+            dispatchStmt(moduleDef->stmts[i], stmts);
+    }
+    context = savedContext;
+
+    shared_ptr<ModuleDefStmt> result = makeAst<ModuleDefStmt>(moduleDef->package, name, moduleDef->interfaceType,
+                                                              params, paramTypes, stmts, moduleDef->sourcePos);
+    elaborated[name] = result;
+    elaboratedOrder.push_back(result);
+    return result;
+}
+
+vector<shared_ptr<Stmt>> Elaborator::elaboratePackage(const vector<shared_ptr<Stmt>> &packageStmts) {
+    vector<shared_ptr<Stmt>> elaboratedStmts;
+    for (size_t i = 0; i < packageStmts.size(); i++) {
+        if (packageStmts[i])
+            dispatchStmt(packageStmts[i], elaboratedStmts);
+    }
+    return elaboratedStmts;
+}
+
+vector<shared_ptr<Stmt>> Elaborator::elaborateStmts(const vector<shared_ptr<Stmt>> &stmts, bool dynamic) {
+    shared_ptr<ValueContext> savedContext = context;
+    context = make_shared<ValueContext>(savedContext, dynamic);
+    vector<shared_ptr<Stmt>> elaboratedStmts;
+    for (size_t i = 0; i < stmts.size(); i++) {
+        if (stmts[i])
+            dispatchStmt(stmts[i], elaboratedStmts);
+    }
+    context = savedContext;
+    return elaboratedStmts;
+}
+
+shared_ptr<Stmt> Elaborator::elaborateSubstatement(const shared_ptr<Stmt> &stmt, bool dynamic) {
+    if (!stmt)
+        return stmt;
+    vector<shared_ptr<Stmt>> elaboratedStmts = elaborateStmts(vector<shared_ptr<Stmt>>{stmt}, dynamic);
+    if (elaboratedStmts.size() == 1)
+        return elaboratedStmts[0];
+    return makeAst<BlockStmt>(elaboratedStmts, stmt->sourcePos);
+}
+
+shared_ptr<Expr> Elaborator::elaborateExpr(const shared_ptr<Expr> &expr) {
+    if (!expr)
+        return expr;
+    if (expr->exprType != IntConstType && expr->exprType != StringConstType) {
+        shared_ptr<Value> value = eval(expr);
+        if (value) {
+            shared_ptr<VarExpr> varExpr = expr->varExpr();
+            shared_ptr<ModuleInstance> instance = value->moduleInstance();
+            if (varExpr && (value->to_string() == varExpr->name || (instance && instance->name == varExpr->name)))
+                return expr;
+            if (shared_ptr<Expr> constant = value->toExpr())
+                return constant;
+        }
+    }
+    return dispatchExpr(expr);
+}
+
+shared_ptr<Expr> Elaborator::defaultExpr(const shared_ptr<Expr> &expr) {
+    return expr;
+}
+
+shared_ptr<Expr> Elaborator::visitArraySubExpr(const shared_ptr<ArraySubExpr> &expr) {
+    shared_ptr<Expr> array = elaborateExpr(expr->array);
+    shared_ptr<Expr> index = elaborateExpr(expr->index);
+    if (array == expr->array && index == expr->index)
+        return expr;
+    return makeAst<ArraySubExpr>(array, index, expr->sourcePos);
+}
+
+shared_ptr<Expr> Elaborator::visitBitConcatExpr(const shared_ptr<BitConcatExpr> &expr) {
+    bool changed = false;
+    vector<shared_ptr<Expr>> values;
+    for (size_t i = 0; i < expr->values.size(); i++) {
+        values.push_back(elaborateExpr(expr->values[i]));
+        changed |= values.back() != expr->values[i];
+    }
+    if (!changed)
+        return expr;
+    return makeAst<BitConcatExpr>(values, expr->bsvtype, expr->sourcePos);
+}
+
+shared_ptr<Expr> Elaborator::visitBitSelExpr(const shared_ptr<BitSelExpr> &expr) {
+    shared_ptr<Expr> value = elaborateExpr(expr->value);
+    shared_ptr<Expr> msb = elaborateExpr(expr->msb);
+    shared_ptr<Expr> lsb = elaborateExpr(expr->lsb);
+    if (value == expr->value && msb == expr->msb && lsb == expr->lsb)
+        return expr;
+    return makeAst<BitSelExpr>(value, msb, lsb, expr->sourcePos);
+}
+
+shared_ptr<Expr> Elaborator::visitCallExpr(const shared_ptr<CallExpr> &expr) {
+    shared_ptr<Expr> function = elaborateExpr(expr->function);
+    bool changed = function != expr->function;
+    vector<shared_ptr<Expr>> args;
+    for (size_t i = 0; i < expr->args.size(); i++) {
+        args.push_back(elaborateExpr(expr->args[i]));
+        changed |= args.back() != expr->args[i];
+    }
+    if (!changed)
+        return expr;
+    return makeAst<CallExpr>(function, args, expr->sourcePos);
+}
+
+shared_ptr<Expr> Elaborator::visitCondExpr(const shared_ptr<CondExpr> &expr) {
+    shared_ptr<Expr> cond = elaborateExpr(expr->cond);
+    shared_ptr<Value> value = eval(cond);
+    if (shared_ptr<BoolValue> boolValue = value ? value->boolValue() : shared_ptr<BoolValue>())
+        return elaborateExpr(boolValue->value ? expr->thenExpr : expr->elseExpr);
+    shared_ptr<Expr> thenExpr = elaborateExpr(expr->thenExpr);
+    shared_ptr<Expr> elseExpr = elaborateExpr(expr->elseExpr);
+    if (cond == expr->cond && thenExpr == expr->thenExpr && elseExpr == expr->elseExpr)
+        return expr;
+    return makeAst<CondExpr>(cond, thenExpr, elseExpr, expr->sourcePos);
+}
+
+shared_ptr<Expr> Elaborator::visitFieldExpr(const shared_ptr<FieldExpr> &expr) {
+    shared_ptr<Expr> object = elaborateExpr(expr->object);
+    if (object == expr->object)
+        return expr;
+    return makeAst<FieldExpr>(object, expr->fieldName, expr->bsvtype, expr->sourcePos);
+}
+
+shared_ptr<Expr> Elaborator::visitMethodExpr(const shared_ptr<MethodExpr> &expr) {
+    shared_ptr<Expr> object = elaborateExpr(expr->object);
+    if (object == expr->object)
+        return expr;
+    return makeAst<MethodExpr>(object, expr->methodName, expr->bsvtype, expr->sourcePos);
+}
+
+shared_ptr<Expr> Elaborator::visitOperatorExpr(const shared_ptr<OperatorExpr> &expr) {
+    shared_ptr<Expr> lhs = elaborateExpr(expr->lhs);
+    shared_ptr<Expr> rhs = elaborateExpr(expr->rhs);
+    if (lhs == expr->lhs && rhs == expr->rhs)
+        return expr;
+    if (!rhs)
+        return makeAst<OperatorExpr>(expr->op, lhs, expr->sourcePos);
+    return makeAst<OperatorExpr>(expr->op, lhs, rhs, expr->sourcePos);
+}
+
+void Elaborator::defaultStmt(const shared_ptr<Stmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    elaboratedStmts.push_back(stmt);
+}
+
+void Elaborator::visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt,
+                                        vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    shared_ptr<Expr> rhs = elaborateExpr(stmt->rhs);
+    context->bind(stmt->name, shared_ptr<Value>());
+    if (rhs == stmt->rhs)
+        elaboratedStmts.push_back(stmt);
+    else
+        elaboratedStmts.push_back(makeAst<ActionBindingStmt>(stmt->bsvtype, stmt->name, rhs, stmt->sourcePos));
+}
+
+void Elaborator::visitBlockStmt(const shared_ptr<BlockStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    elaboratedStmts.push_back(makeAst<BlockStmt>(elaborateStmts(stmt->stmts), stmt->sourcePos));
+}
+
+void Elaborator::visitCallStmt(const shared_ptr<CallStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    shared_ptr<Expr> rhs = elaborateExpr(stmt->rhs);
+    context->bind(stmt->name, shared_ptr<Value>());
+    if (rhs == stmt->rhs)
+        elaboratedStmts.push_back(stmt);
+    else
+        elaboratedStmts.push_back(makeAst<CallStmt>(stmt->name, stmt->interfaceType, rhs, stmt->sourcePos));
+}
+
+void Elaborator::visitExprStmt(const shared_ptr<ExprStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    shared_ptr<Expr> expr = elaborateExpr(stmt->expr);
+    if (expr == stmt->expr)
+        elaboratedStmts.push_back(stmt);
+    else
+        elaboratedStmts.push_back(makeAst<ExprStmt>(expr, stmt->sourcePos));
+}
+
+void Elaborator::visitForStmt(const shared_ptr<ForStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    elaborateLoop(stmt, stmt->init, stmt->test, stmt->incr, stmt->body, elaboratedStmts);
+}
+
+void Elaborator::visitWhileStmt(const shared_ptr<WhileStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    elaborateLoop(stmt, vector<shared_ptr<Stmt>>(), stmt->test, vector<shared_ptr<Stmt>>(), stmt->body,
+                  elaboratedStmts);
+}
+
+// Unrolls the loop for as long as its test is static. Whatever remains
+// when the test or an increment stops being static is emitted as a loop
+// starting from the current values of the loop variables.
+void Elaborator::elaborateLoop(const shared_ptr<Stmt> &loop, const vector<shared_ptr<Stmt>> &init,
+                               const shared_ptr<Expr> &test, const vector<shared_ptr<Stmt>> &incr,
+                               const shared_ptr<Stmt> &body, vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    shared_ptr<ValueContext> outerContext = context;
+    context = make_shared<ValueContext>(outerContext);
+    vector<shared_ptr<VarBindingStmt>> loopVars;
+    vector<shared_ptr<Expr>> initValues;
+    for (size_t i = 0; i < init.size(); i++) {
+        shared_ptr<VarBindingStmt> varBinding = init[i]->varBindingStmt();
+        if (!varBinding)
+            continue;
+        shared_ptr<Expr> rhs = elaborateExpr(varBinding->rhs);
+        context->bind(varBinding->name, eval(rhs));
+        loopVars.push_back(varBinding);
+        initValues.push_back(rhs);
+    }
+
+    bool unrolled = false;
+    set<string> splicedNames;
+    size_t pendingIncr = incr.size();
+    for (int iteration = 0; pendingIncr == incr.size(); iteration++) {
+        shared_ptr<Value> condition = eval(test);
+        shared_ptr<BoolValue> boolValue = condition ? condition->boolValue() : shared_ptr<BoolValue>();
+        if (boolValue && !boolValue->value) {
+            context = outerContext;
+            return;
+        }
+        if (!boolValue)
+            break;
+        if (iteration == maxUnroll) {
+            cerr << "Elaborator: error: loop at " << loop->sourcePos.toString() << " not unrolled after "
+                 << maxUnroll << " iterations" << endl;
+            errors++;
+            break;
+        }
+        // spliced into the enclosing statements like the branch taken by
+        // visitIfStmt, unless an earlier iteration bound the same names
+        shared_ptr<BlockStmt> blockStmt = body->blockStmt();
+        vector<shared_ptr<Stmt>> iterationStmts = elaborateStmts(blockStmt ? blockStmt->stmts
+                                                                           : vector<shared_ptr<Stmt>>{body});
+        iterationStmts = suffixRuleNames(iterationStmts, "_" + to_string(iteration));
+        set<string> names;
+        boundNames(iterationStmts, names);
+        bool hides = false;
+        for (auto it = names.cbegin(); it != names.cend() && !hides; ++it)
+            hides = splicedNames.count(*it) != 0;
+        if (hides) {
+            elaboratedStmts.push_back(makeAst<BlockStmt>(iterationStmts, body->sourcePos));
+        } else {
+            splicedNames.insert(names.cbegin(), names.cend());
+            elaboratedStmts.insert(elaboratedStmts.end(), iterationStmts.begin(), iterationStmts.end());
+        }
+        unrolled = true;
+        for (size_t i = 0; i < incr.size(); i++) {
+            shared_ptr<VarAssignStmt> varAssign = incr[i]->varAssignStmt();
+            shared_ptr<VarLValue> varLValue = varAssign ? varAssign->lhs->varLValue() : shared_ptr<VarLValue>();
+            shared_ptr<Value> value = varLValue ? eval(varAssign->rhs) : shared_ptr<Value>();
+            if (!value) {
+                pendingIncr = i;
+                break;
+            }
+            context->assign(varLValue->name, value);
+        }
+    }
+
+    vector<shared_ptr<Stmt>> residualInit;
+    for (size_t i = 0; i < loopVars.size(); i++) {
+        shared_ptr<Value> value = context->lookup(loopVars[i]->name);
+        shared_ptr<Expr> rhs = (unrolled && value) ? value->toExpr() : shared_ptr<Expr>();
+        if (!rhs)
+            rhs = initValues[i];
+        residualInit.push_back(makeAst<VarBindingStmt>(loopVars[i]->bsvtype, loopVars[i]->name, rhs,
+                                                       loopVars[i]->sourcePos));
+    }
+    context = make_shared<ValueContext>(context, true);
+    forgetAssignedVars(body, incr);
+    shared_ptr<Expr> residualTest = elaborateExpr(test);
+    vector<shared_ptr<Stmt>> residualIncr = elaborateStmts(incr);
+    shared_ptr<Stmt> residualBody = elaborateSubstatement(body, true);
+    if (!loop->forStmt()) {
+        elaboratedStmts.push_back(makeAst<WhileStmt>(residualTest, residualBody, loop->sourcePos));
+    } else if (!unrolled) {
+        elaboratedStmts.push_back(makeAst<ForStmt>(residualInit, residualTest, residualIncr, residualBody,
+                                                   loop->sourcePos));
+    } else {
+        // the loop variables are declared ahead of the loop, followed by
+        // the increments that were not static in the last iteration
+        vector<shared_ptr<Stmt>> residualStmts = residualInit;
+        vector<shared_ptr<Stmt>> remainingIncr(incr.begin() + pendingIncr, incr.end());
+        vector<shared_ptr<Stmt>> elaboratedIncr = elaborateStmts(remainingIncr);
+        residualStmts.insert(residualStmts.end(), elaboratedIncr.begin(), elaboratedIncr.end());
+        residualStmts.push_back(makeAst<ForStmt>(vector<shared_ptr<Stmt>>(), residualTest, residualIncr,
+                                                 residualBody, loop->sourcePos));
+        elaboratedStmts.push_back(makeAst<BlockStmt>(residualStmts, loop->sourcePos));
+    }
+    context = outerContext;
+}
+
+// Variables assigned by a loop that is not unrolled have no static value
+// inside of it or after it.
+void Elaborator::forgetAssignedVars(const shared_ptr<Stmt> &body, const vector<shared_ptr<Stmt>> &incr) {
+    AssignedVarsCollector collector;
+    collector.visit(body);
+    collector.visit(incr);
+    for (auto it = collector.assignedVars.cbegin(); it != collector.assignedVars.cend(); ++it)
+        context->assign(*it, shared_ptr<Value>());
+}
+
+void Elaborator::visitFunctionDefStmt(const shared_ptr<FunctionDefStmt> &stmt,
+                                      vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    // kept for the calls whose arguments are not static
+    context->bind(stmt->name, make_shared<FunctionValue>(stmt, context));
+    elaboratedStmts.push_back(stmt);
+}
+
+void Elaborator::visitIfStmt(const shared_ptr<IfStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    shared_ptr<Expr> condition = elaborateExpr(stmt->condition);
+    shared_ptr<Value> value = eval(condition);
+    if (shared_ptr<BoolValue> boolValue = value ? value->boolValue() : shared_ptr<BoolValue>()) {
+        shared_ptr<Stmt> taken = boolValue->value ? stmt->thenStmt : stmt->elseStmt;
+        if (!taken)
+            return;
+        // spliced into the enclosing statements, so that instances created
+        // under a static condition stay at module level
+        if (shared_ptr<BlockStmt> blockStmt = taken->blockStmt()) {
+            vector<shared_ptr<Stmt>> takenStmts = elaborateStmts(blockStmt->stmts);
+            elaboratedStmts.insert(elaboratedStmts.end(), takenStmts.begin(), takenStmts.end());
+        } else {
+            dispatchStmt(taken, elaboratedStmts);
+        }
+        return;
+    }
+    shared_ptr<Stmt> thenStmt = elaborateSubstatement(stmt->thenStmt, true);
+    shared_ptr<Stmt> elseStmt = elaborateSubstatement(stmt->elseStmt, true);
+    elaboratedStmts.push_back(makeAst<IfStmt>(condition, thenStmt, elseStmt, stmt->sourcePos));
+}
+
+void Elaborator::visitInterfaceDefStmt(const shared_ptr<InterfaceDefStmt> &stmt,
+                                       vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    elaboratedStmts.push_back(makeAst<InterfaceDefStmt>(stmt->package, stmt->name, stmt->interfaceType,
+                                                        elaborateStmts(stmt->defs), stmt->sourcePos));
+}
+
+void Elaborator::visitMethodDefStmt(const shared_ptr<MethodDefStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    shared_ptr<ValueContext> savedContext = context;
+    context = make_shared<ValueContext>(savedContext);
+    for (size_t i = 0; i < stmt->params.size(); i++)
+        context->bind(stmt->params[i], shared_ptr<Value>());
+    shared_ptr<Expr> guard = elaborateExpr(stmt->guard);
+    vector<shared_ptr<Stmt>> stmts = elaborateStmts(stmt->stmts);
+    context = savedContext;
+    elaboratedStmts.push_back(makeAst<MethodDefStmt>(stmt->name, stmt->returnType, stmt->params, stmt->paramTypes,
+                                                     guard, stmts, stmt->sourcePos));
+}
+
+void Elaborator::visitModuleDefStmt(const shared_ptr<ModuleDefStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    elaborate(stmt->name);
+    // modules specialized along the way precede their first user
+    for (; emittedModules < elaboratedOrder.size(); emittedModules++)
+        elaboratedStmts.push_back(elaboratedOrder[emittedModules]);
+}
+
+void Elaborator::visitModuleInstStmt(const shared_ptr<ModuleInstStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    shared_ptr<BSVType> interfaceType = stmt->interfaceType;
+    shared_ptr<CallExpr> callExpr = stmt->rhs ? stmt->rhs->callExpr() : shared_ptr<CallExpr>();
+    shared_ptr<VarExpr> function = callExpr ? callExpr->function->varExpr() : shared_ptr<VarExpr>();
+    if (interfaceType && interfaceType->name == "Vector" && interfaceType->params.size() == 2
+        && function && function->name == "replicateM" && callExpr->args.size() == 1) {
+        shared_ptr<BSVType> size = interfaceType->params[0]->eval();
+        if (isStaticSize(size)) {
+            shared_ptr<BSVType> elementType = interfaceType->params[1];
+            vector<shared_ptr<Value>> elements;
+            for (long i = 0; i < size->numericValue(); i++) {
+                string elementName = stmt->name + "_" + to_string(i);
+                elaboratedStmts.push_back(makeAst<ModuleInstStmt>(elementName, elementType,
+                                                                  instantiate(callExpr->args[0]), stmt->sourcePos));
+                elements.push_back(make_shared<ModuleInstance>(elementName, elementType));
+            }
+            context->bind(stmt->name, make_shared<VectorValue>(elements));
+            return;
+        }
+    }
+
+    shared_ptr<Expr> rhs = instantiate(stmt->rhs);
+    context->bind(stmt->name, make_shared<ModuleInstance>(stmt->name, interfaceType));
+    if (rhs == stmt->rhs)
+        elaboratedStmts.push_back(stmt);
+    else
+        elaboratedStmts.push_back(makeAst<ModuleInstStmt>(stmt->name, interfaceType, rhs, stmt->sourcePos));
+}
+
+// Replaces the instantiation of a package module with static arguments by
+// an instantiation of its specialization.
+shared_ptr<Expr> Elaborator::instantiate(const shared_ptr<Expr> &rhs) {
+    shared_ptr<CallExpr> callExpr = rhs ? rhs->callExpr() : shared_ptr<CallExpr>();
+    shared_ptr<VarExpr> function = callExpr ? callExpr->function->varExpr() : shared_ptr<VarExpr>();
+    auto it = function ? moduleDefs.find(function->name) : moduleDefs.end();
+    if (it == moduleDefs.end() || it->second->params.empty())
+        return elaborateExpr(rhs);
+    vector<shared_ptr<Value>> args;
+    for (size_t i = 0; i < callExpr->args.size(); i++) {
+        shared_ptr<Value> arg = eval(callExpr->args[i]);
+        if (!arg || !(arg->intValue() || arg->boolValue()))
+            return elaborateExpr(rhs);
+        args.push_back(arg);
+    }
+    shared_ptr<ModuleDefStmt> specialized = elaborate(function->name, args);
+    if (!specialized)
+        return elaborateExpr(rhs);
+    return makeAst<CallExpr>(makeAst<VarExpr>(specialized->name, function->bsvtype, function->sourcePos),
+                             vector<shared_ptr<Expr>>(), callExpr->sourcePos);
+}
+
+void Elaborator::visitPatternMatchStmt(const shared_ptr<PatternMatchStmt> &stmt,
+                                       vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    shared_ptr<Expr> rhs = elaborateExpr(stmt->rhs);
+    if (rhs == stmt->rhs)
+        elaboratedStmts.push_back(stmt);
+    else
+        elaboratedStmts.push_back(makeAst<PatternMatchStmt>(stmt->pattern, stmt->op, rhs, stmt->sourcePos));
+}
+
+// The register of a write is kept as source text, so regs[i] is resolved
+// here when regs is an expanded Vector and i is static.
+string Elaborator::elaborateRegName(const string &regName) {
+    size_t open = regName.find('[');
+    if (open == string::npos || regName.back() != ']')
+        return regName;
+    string indexText = regName.substr(open + 1, regName.size() - open - 2);
+    shared_ptr<Value> index = (!indexText.empty() && isdigit(indexText[0]))
+                              ? IntValue::create(indexText) : context->lookup(indexText);
+    shared_ptr<Value> array = context->lookup(regName.substr(0, open));
+    if (!index || !index->intValue() || !array)
+        return regName;
+    shared_ptr<Value> element = array->sub(index->intValue()->value);
+    shared_ptr<ModuleInstance> instance = element ? element->moduleInstance() : shared_ptr<ModuleInstance>();
+    return instance ? instance->name : regName;
+}
+
+void Elaborator::visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    string regName = elaborateRegName(stmt->regName);
+    shared_ptr<Expr> rhs = elaborateExpr(stmt->rhs);
+    if (regName == stmt->regName && rhs == stmt->rhs)
+        elaboratedStmts.push_back(stmt);
+    else
+        elaboratedStmts.push_back(makeAst<RegWriteStmt>(regName, stmt->elementType, rhs, stmt->sourcePos));
+}
+
+void Elaborator::visitReturnStmt(const shared_ptr<ReturnStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    shared_ptr<Expr> value = elaborateExpr(stmt->value);
+    if (value == stmt->value)
+        elaboratedStmts.push_back(stmt);
+    else
+        elaboratedStmts.push_back(makeAst<ReturnStmt>(value, stmt->sourcePos));
+}
+
+void Elaborator::visitRuleDefStmt(const shared_ptr<RuleDefStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    shared_ptr<Expr> guard = elaborateExpr(stmt->guard);
+    vector<shared_ptr<Stmt>> stmts = elaborateStmts(stmt->stmts);
+    elaboratedStmts.push_back(makeAst<RuleDefStmt>(stmt->name, guard, stmts, stmt->sourcePos));
+}
+
+void Elaborator::visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    shared_ptr<Expr> rhs = elaborateExpr(stmt->rhs);
+    shared_ptr<LValue> lhs = stmt->lhs;
+    if (shared_ptr<VarLValue> varLValue = lhs->varLValue()) {
+        context->assign(varLValue->name,
+                        stmt->op == "=" ? boundValue(varLValue->bsvtype, eval(rhs)) : shared_ptr<Value>());
+    } else if (shared_ptr<ArraySubLValue> arraySubLValue = lhs->arraySubLValue()) {
+        shared_ptr<Expr> index = elaborateExpr(arraySubLValue->index);
+        if (index != arraySubLValue->index)
+            lhs = makeAst<ArraySubLValue>(arraySubLValue->array, index);
+    } else if (shared_ptr<RangeSelLValue> rangeSelLValue = lhs->rangeSelLValue()) {
+        shared_ptr<Expr> msb = elaborateExpr(rangeSelLValue->msb);
+        shared_ptr<Expr> lsb = elaborateExpr(rangeSelLValue->lsb);
+        if (msb != rangeSelLValue->msb || lsb != rangeSelLValue->lsb)
+            lhs = makeAst<RangeSelLValue>(rangeSelLValue->bitarray, msb, lsb);
+    }
+    if (lhs == stmt->lhs && rhs == stmt->rhs)
+        elaboratedStmts.push_back(stmt);
+    else
+        elaboratedStmts.push_back(makeAst<VarAssignStmt>(lhs, stmt->op, rhs, stmt->sourcePos));
+}
+
+// A variable of another type than the interface of the instance it is
+// bound to holds the value read from it, which is not static.
+shared_ptr<Value> Elaborator::boundValue(const shared_ptr<BSVType> &bsvtype, const shared_ptr<Value> &value) {
+    shared_ptr<ModuleInstance> instance = value ? value->moduleInstance() : shared_ptr<ModuleInstance>();
+    if (instance && bsvtype && bsvtype->to_string() != instance->interfaceType->to_string())
+        return shared_ptr<Value>();
+    return value;
+}
+
+void Elaborator::visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts) {
+    shared_ptr<Expr> rhs = elaborateExpr(stmt->rhs);
+    context->bind(stmt->name, boundValue(stmt->bsvtype, eval(rhs)));
+    if (rhs == stmt->rhs)
+        elaboratedStmts.push_back(stmt);
+    else
+        elaboratedStmts.push_back(makeAst<VarBindingStmt>(stmt->bsvtype, stmt->name, stmt->bindingType, rhs,
+                                                          stmt->sourcePos));
+}
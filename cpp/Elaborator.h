@@ -1,18 +1,100 @@
-
 #pragma once
 
-#include <Expr.h>
-#include <Stmt.h>
-#include <Value.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AstDispatch.h"
+#include "Expr.h"
+#include "Stmt.h"
+#include "Value.h"
+
+using namespace std;
 
-class Elaborator {
+// Static elaboration of a package.
+//
+// Expressions whose operands are known at elaboration time -- module
+// parameters, Integer bindings, loop variables, valueOf -- are evaluated and
+// replaced by constants. Loops with static bounds are unrolled, Vectors of
+// submodules built with replicateM become one instance per element, and
+// modules instantiated with static arguments are specialized, so that
+// elaborate() yields the module hierarchy with its parameters resolved.
+// Calls of package functions on static arguments are evaluated once per
+// argument list.
+class Elaborator : public StmtDispatcher<Elaborator, void, vector<shared_ptr<Stmt>> &>,
+                   public ExprDispatcher<Elaborator, shared_ptr<Expr>> {
+  map<string,shared_ptr<ModuleDefStmt>> moduleDefs;
+  // elaborated modules, by constructor name and static arguments
+  map<string,shared_ptr<ModuleDefStmt>> elaborated;
+  // in the order they were completed, submodules before their users
+  vector<shared_ptr<ModuleDefStmt>> elaboratedOrder;
+  size_t emittedModules = 0;
+  // results of calls of package functions, by function and arguments
+  map<pair<shared_ptr<FunctionValue>,string>,shared_ptr<Value>> callCache;
+  shared_ptr<ValueContext> packageContext;
+  shared_ptr<ValueContext> context;
+  // value of the return statement of the function being evaluated
+  shared_ptr<Value> returnValue;
+  int callDepth = 0;
+  int errors = 0;
  public:
-  Elaborator() {
-  }
+  Elaborator(const vector<shared_ptr<Stmt>> &packageStmts);
+  ~Elaborator() {}
 
+  // null if the value is not known at elaboration time
   shared_ptr<Value> eval(const shared_ptr<Expr> &expr);
-  shared_ptr<Value> eval(const shared_ptr<Stmt> &expr);
+  shared_ptr<Value> eval(const shared_ptr<Stmt> &stmt);
 
   shared_ptr<ModuleDefStmt> elaborate(const string &moduleName);
+  shared_ptr<ModuleDefStmt> elaborate(const string &moduleName, const vector<shared_ptr<Value>> &args);
+  vector<shared_ptr<Stmt>> elaboratePackage(const vector<shared_ptr<Stmt>> &packageStmts);
+  // loops that did not terminate within the unrolling limit
+  int numErrors() const { return errors; }
+  shared_ptr<Expr> elaborateExpr(const shared_ptr<Expr> &expr);
+
+  void defaultStmt(const shared_ptr<Stmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitBlockStmt(const shared_ptr<BlockStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitCallStmt(const shared_ptr<CallStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitExprStmt(const shared_ptr<ExprStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitForStmt(const shared_ptr<ForStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitFunctionDefStmt(const shared_ptr<FunctionDefStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitIfStmt(const shared_ptr<IfStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitInterfaceDefStmt(const shared_ptr<InterfaceDefStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitMethodDefStmt(const shared_ptr<MethodDefStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitModuleDefStmt(const shared_ptr<ModuleDefStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitModuleInstStmt(const shared_ptr<ModuleInstStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitPatternMatchStmt(const shared_ptr<PatternMatchStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitReturnStmt(const shared_ptr<ReturnStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitRuleDefStmt(const shared_ptr<RuleDefStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+  void visitWhileStmt(const shared_ptr<WhileStmt> &stmt, vector<shared_ptr<Stmt>> &elaboratedStmts);
+
+  shared_ptr<Expr> defaultExpr(const shared_ptr<Expr> &expr);
+  shared_ptr<Expr> visitArraySubExpr(const shared_ptr<ArraySubExpr> &expr);
+  shared_ptr<Expr> visitBitConcatExpr(const shared_ptr<BitConcatExpr> &expr);
+  shared_ptr<Expr> visitBitSelExpr(const shared_ptr<BitSelExpr> &expr);
+  shared_ptr<Expr> visitCallExpr(const shared_ptr<CallExpr> &expr);
+  shared_ptr<Expr> visitCondExpr(const shared_ptr<CondExpr> &expr);
+  shared_ptr<Expr> visitFieldExpr(const shared_ptr<FieldExpr> &expr);
+  shared_ptr<Expr> visitMethodExpr(const shared_ptr<MethodExpr> &expr);
+  shared_ptr<Expr> visitOperatorExpr(const shared_ptr<OperatorExpr> &expr);
 
+ private:
+  bool execute(const shared_ptr<Stmt> &stmt);
+  bool executeLoop(const vector<shared_ptr<Stmt>> &init, const shared_ptr<Expr> &test,
+                   const vector<shared_ptr<Stmt>> &incr, const shared_ptr<Stmt> &body);
+  shared_ptr<Value> evalCall(const shared_ptr<CallExpr> &expr);
+  void elaborateLoop(const shared_ptr<Stmt> &loop, const vector<shared_ptr<Stmt>> &init, const shared_ptr<Expr> &test,
+                     const vector<shared_ptr<Stmt>> &incr, const shared_ptr<Stmt> &body,
+                     vector<shared_ptr<Stmt>> &elaboratedStmts);
+  vector<shared_ptr<Stmt>> elaborateStmts(const vector<shared_ptr<Stmt>> &stmts, bool dynamic = false);
+  shared_ptr<Stmt> elaborateSubstatement(const shared_ptr<Stmt> &stmt, bool dynamic = false);
+  shared_ptr<Expr> instantiate(const shared_ptr<Expr> &rhs);
+  shared_ptr<Value> boundValue(const shared_ptr<BSVType> &bsvtype, const shared_ptr<Value> &value);
+  string elaborateRegName(const string &regName);
+  void forgetAssignedVars(const shared_ptr<Stmt> &body, const vector<shared_ptr<Stmt>> &incr);
 };
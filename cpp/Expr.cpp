@@ -29,7 +29,10 @@ shared_ptr<Expr> Expr::rename(string prefix, shared_ptr<LexicalScope> &scope) {
 
 VarExpr::VarExpr(const string &name, const shared_ptr<BSVType> &bsvtype, const SourcePos &sourcePos)
         : Expr(VarExprType, bsvtype, sourcePos), name(name), sourceName(name) {
-    attrs_.freeVars[name] = bsvtype;
+}
+
+void VarExpr::computeAttrs(ExprAttrs &attrs) {
+    attrs.freeVars.insert(name, bsvtype);
 }
 
 VarExpr::~VarExpr() {
@@ -45,12 +48,17 @@ shared_ptr<VarExpr> VarExpr::varExpr() { return static_pointer_cast<VarExpr, Exp
 
 shared_ptr<Expr> VarExpr::rename(string prefix, shared_ptr<LexicalScope> &scope) {
     shared_ptr<Declaration> decl = scope->lookup(name);
-    string newname = (decl) ? decl->name : name;
-    return shared_ptr<VarExpr>(new VarExpr(newname, bsvtype));
+    if (!decl || decl->name == name)
+        return shared_from_this();
+    return makeAst<VarExpr>(decl->name, bsvtype);
 }
 
 IntConst::IntConst(const string &repr, const SourcePos &sourcePos)
-        : Expr(IntConstType, sourcePos), repr(repr), base(0), width(0) {
+        : IntConst(repr, shared_ptr<BSVType>(), sourcePos) {
+}
+
+IntConst::IntConst(const string &repr, const shared_ptr<BSVType> &bsvtype, const SourcePos &sourcePos)
+        : Expr(IntConstType, bsvtype, sourcePos), repr(repr), base(0), width(0) {
     const char *repr_ptr = repr.c_str();
     const char *quote_ptr = strchr(repr_ptr, '\'');
     const char *base_ptr = (quote_ptr) ? quote_ptr + 1 : repr_ptr;
@@ -75,7 +83,7 @@ IntConst::IntConst(const string &repr, const SourcePos &sourcePos)
             break;
     }
     const char *value_ptr = (base) ? base_ptr + 1 : base_ptr;
-    value = strtoul(base_ptr, 0, base);
+    value = strtoul(value_ptr, 0, base);
     //fprintf(stderr, "%s width=%ld base=%ld value=%ld\n", repr.c_str(), width, base, value);
 }
 
@@ -89,7 +97,7 @@ void IntConst::prettyPrint(ostream &out, int depth) {
 shared_ptr<IntConst> IntConst::intConst() { return static_pointer_cast<IntConst, Expr>(shared_from_this()); }
 
 shared_ptr<Expr> IntConst::rename(string prefix, shared_ptr<LexicalScope> &scope) {
-    return shared_ptr<IntConst>(new IntConst(repr));
+    return shared_from_this();
 }
 
 OperatorExpr::OperatorExpr(const string &op, const shared_ptr<Expr> &lhs, const SourcePos &sourcePos)
@@ -120,11 +128,19 @@ shared_ptr<OperatorExpr> OperatorExpr::operatorExpr() {
     return static_pointer_cast<OperatorExpr, Expr>(shared_from_this());
 }
 
+void OperatorExpr::computeAttrs(ExprAttrs &attrs) {
+    attrs.freeVars.unite(lhs->attrs().freeVars);
+    if (rhs)
+        attrs.freeVars.unite(rhs->attrs().freeVars);
+}
+
 shared_ptr<Expr> OperatorExpr::rename(string prefix, shared_ptr<LexicalScope> &scope) {
+    if (!scope->renamesAny(attrs().freeVars))
+        return shared_from_this();
     if (rhs)
-        return shared_ptr<OperatorExpr>(new OperatorExpr(op, lhs->rename(prefix, scope), rhs->rename(prefix, scope)));
+        return makeAst<OperatorExpr>(op, lhs->rename(prefix, scope), rhs->rename(prefix, scope));
     else
-        return shared_ptr<OperatorExpr>(new OperatorExpr(op, lhs->rename(prefix, scope)));
+        return makeAst<OperatorExpr>(op, lhs->rename(prefix, scope));
 }
 
 MatchesExpr::MatchesExpr(const shared_ptr<Expr> &expr, const shared_ptr<Pattern> &pattern, const SourcePos &sourcePos)
@@ -158,21 +174,24 @@ shared_ptr<MatchesExpr> MatchesExpr::matchesExpr() {
 
 shared_ptr<Expr> MatchesExpr::rename(string prefix, shared_ptr<LexicalScope> &renames) {
     //FIXME: implement
-    return MatchesExpr::create(expr, pattern, patterncond);
+    return shared_from_this();
 }
 
 shared_ptr<MatchesExpr> MatchesExpr::create(const shared_ptr<Expr> &expr, const shared_ptr<Pattern> &pattern) {
-    return shared_ptr<MatchesExpr>(new MatchesExpr(expr, pattern));
+    return makeAst<MatchesExpr>(expr, pattern);
 }
 
 shared_ptr<MatchesExpr> MatchesExpr::create(const shared_ptr<Expr> &expr, const shared_ptr<Pattern> &pattern,
                                       const vector<shared_ptr<Expr>> &exprs) {
-    return shared_ptr<MatchesExpr>(new MatchesExpr(expr, pattern, exprs));
+    return makeAst<MatchesExpr>(expr, pattern, exprs);
 }
 
 FieldExpr::FieldExpr(const shared_ptr<Expr> &object, const std::string &fieldName, const shared_ptr<BSVType> &bsvtype, const SourcePos &sourcePos)
         : Expr(FieldExprType, bsvtype, sourcePos), object(object), fieldName(fieldName) {
-    uniteSet(attrs_.freeVars, object->attrs().freeVars);
+}
+
+void FieldExpr::computeAttrs(ExprAttrs &attrs) {
+    attrs.freeVars.unite(object->attrs().freeVars);
 }
 
 FieldExpr::~FieldExpr() {
@@ -187,7 +206,9 @@ void FieldExpr::prettyPrint(ostream &out, int depth) {
 shared_ptr<FieldExpr> FieldExpr::fieldExpr() { return static_pointer_cast<FieldExpr, Expr>(shared_from_this()); }
 
 shared_ptr<Expr> FieldExpr::rename(string prefix, shared_ptr<LexicalScope> &scope) {
-    return shared_ptr<FieldExpr>(new FieldExpr(object->rename(prefix, scope), fieldName, bsvtype));
+    if (!scope->renamesAny(attrs().freeVars))
+        return shared_from_this();
+    return makeAst<FieldExpr>(object->rename(prefix, scope), fieldName, bsvtype);
 }
 
 MethodExpr::MethodExpr(const shared_ptr<Expr> &object, const string &methodName, const shared_ptr<BSVType> &bsvtype,
@@ -205,8 +226,14 @@ shared_ptr<MethodExpr> MethodExpr::methodExpr() {
     return static_pointer_cast<MethodExpr, Expr>(shared_from_this());
 }
 
+void MethodExpr::computeAttrs(ExprAttrs &attrs) {
+    attrs.freeVars.unite(object->attrs().freeVars);
+}
+
 shared_ptr<Expr> MethodExpr::rename(string prefix, shared_ptr<LexicalScope> &renames)  {
-    return make_shared<MethodExpr>(object, methodName, bsvtype, sourcePos);
+    if (!renames->renamesAny(attrs().freeVars))
+        return shared_from_this();
+    return makeAst<MethodExpr>(object->rename(prefix, renames), methodName, bsvtype, sourcePos);
 }
 
 
@@ -228,8 +255,14 @@ shared_ptr<SubinterfaceExpr> SubinterfaceExpr::subinterfaceExpr() {
     return static_pointer_cast<SubinterfaceExpr, Expr>(shared_from_this());
 }
 
+void SubinterfaceExpr::computeAttrs(ExprAttrs &attrs) {
+    attrs.freeVars.unite(object->attrs().freeVars);
+}
+
 shared_ptr<Expr> SubinterfaceExpr::rename(string prefix, shared_ptr<LexicalScope> &renames) {
-    return make_shared<MethodExpr>(object, subinterfaceName, bsvtype, sourcePos);
+    if (!renames->renamesAny(attrs().freeVars))
+        return shared_from_this();
+    return makeAst<SubinterfaceExpr>(object->rename(prefix, renames), subinterfaceName, bsvtype, sourcePos);
 }
 
 CallExpr::CallExpr(const shared_ptr<Expr> &function, const vector<shared_ptr<Expr>> &args, const SourcePos &sourcePos)
@@ -257,11 +290,21 @@ void CallExpr::prettyPrint(ostream &out, int depth) {
 
 shared_ptr<CallExpr> CallExpr::callExpr() { return static_pointer_cast<CallExpr, Expr>(shared_from_this()); }
 
+void CallExpr::computeAttrs(ExprAttrs &attrs) {
+    attrs.freeVars.unite(function->attrs().freeVars);
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i])
+            attrs.freeVars.unite(args[i]->attrs().freeVars);
+    }
+}
+
 shared_ptr<Expr> CallExpr::rename(string prefix, shared_ptr<LexicalScope> &scope) {
+    if (!scope->renamesAny(attrs().freeVars))
+        return shared_from_this();
     vector<shared_ptr<Expr>> renamedArgs;
     for (size_t i = 0; i < args.size(); i++)
-        renamedArgs.push_back(args[i]->rename(prefix, scope));
-    return shared_ptr<CallExpr>(new CallExpr(function->rename(prefix, scope), renamedArgs));
+        renamedArgs.push_back(args[i] ? args[i]->rename(prefix, scope) : args[i]);
+    return makeAst<CallExpr>(function->rename(prefix, scope), renamedArgs);
 }
 
 
@@ -286,11 +329,18 @@ shared_ptr<EnumUnionStructExpr> EnumUnionStructExpr::enumUnionStructExpr() {
     return static_pointer_cast<EnumUnionStructExpr, Expr>(shared_from_this());
 }
 
+void EnumUnionStructExpr::computeAttrs(ExprAttrs &attrs) {
+    for (size_t i = 0; i < vals.size(); i++)
+        attrs.freeVars.unite(vals[i]->attrs().freeVars);
+}
+
 shared_ptr<Expr> EnumUnionStructExpr::rename(string prefix, shared_ptr<LexicalScope> &scope) {
+    if (!scope->renamesAny(attrs().freeVars))
+        return shared_from_this();
     vector<shared_ptr<Expr>> renamedVals;
     for (size_t i = 0; i < vals.size(); i++)
         renamedVals.push_back(vals[i]->rename(prefix, scope));
-    return make_shared<EnumUnionStructExpr>(tag, keys, renamedVals, bsvtype, sourcePos);
+    return makeAst<EnumUnionStructExpr>(tag, keys, renamedVals, bsvtype, sourcePos);
 }
 
 
@@ -312,9 +362,16 @@ shared_ptr<ArraySubExpr> ArraySubExpr::arraySubExpr() {
     return static_pointer_cast<ArraySubExpr, Expr>(shared_from_this());
 }
 
+void ArraySubExpr::computeAttrs(ExprAttrs &attrs) {
+    attrs.freeVars.unite(array->attrs().freeVars);
+    attrs.freeVars.unite(index->attrs().freeVars);
+}
+
 shared_ptr<Expr> ArraySubExpr::rename(string prefix, shared_ptr<LexicalScope> &scope) {
-    return shared_ptr<ArraySubExpr>(new ArraySubExpr(array->rename(prefix, scope),
-                                                     index->rename(prefix, scope)));
+    if (!scope->renamesAny(attrs().freeVars))
+        return shared_from_this();
+    return makeAst<ArraySubExpr>(array->rename(prefix, scope),
+                                                     index->rename(prefix, scope));
 }
 
 BitSelExpr::BitSelExpr(const shared_ptr<Expr> &value, const shared_ptr<Expr> &msb, const shared_ptr<Expr> &lsb, const SourcePos &sourcePos)
@@ -337,10 +394,18 @@ shared_ptr<BitSelExpr> BitSelExpr::bitSelExpr() {
     return static_pointer_cast<BitSelExpr, Expr>(shared_from_this());
 }
 
+void BitSelExpr::computeAttrs(ExprAttrs &attrs) {
+    attrs.freeVars.unite(value->attrs().freeVars);
+    attrs.freeVars.unite(msb->attrs().freeVars);
+    attrs.freeVars.unite(lsb->attrs().freeVars);
+}
+
 shared_ptr<Expr> BitSelExpr::rename(string prefix, shared_ptr<LexicalScope> &scope) {
-    return shared_ptr<BitSelExpr>(new BitSelExpr(value->rename(prefix, scope),
+    if (!scope->renamesAny(attrs().freeVars))
+        return shared_from_this();
+    return makeAst<BitSelExpr>(value->rename(prefix, scope),
                                                  msb->rename(prefix, scope),
-                                                 lsb->rename(prefix, scope)));
+                                                 lsb->rename(prefix, scope));
 }
 
 StringConst::StringConst(const string &repr, const SourcePos &sourcePos)
@@ -359,7 +424,7 @@ void StringConst::prettyPrint(ostream &out, int depth) {
 shared_ptr<StringConst> StringConst::stringConst() { return static_pointer_cast<StringConst, Expr>(shared_from_this()); }
 
 shared_ptr<Expr> StringConst::rename(string prefix, shared_ptr<LexicalScope> &scope) {
-    return shared_ptr<StringConst>(new StringConst(repr));
+    return shared_from_this();
 }
 
 void CaseExprItem::prettyPrint(ostream &out, int depth) {
@@ -433,10 +498,18 @@ shared_ptr<CondExpr> CondExpr::condExpr() {
     return static_pointer_cast<CondExpr, Expr>(shared_from_this());
 }
 
+void CondExpr::computeAttrs(ExprAttrs &attrs) {
+    attrs.freeVars.unite(cond->attrs().freeVars);
+    attrs.freeVars.unite(thenExpr->attrs().freeVars);
+    attrs.freeVars.unite(elseExpr->attrs().freeVars);
+}
+
 shared_ptr<Expr> CondExpr::rename(string prefix, shared_ptr<LexicalScope> &renames) {
-    return shared_ptr<CondExpr>(new CondExpr(cond->rename(prefix, renames),
+    if (!renames->renamesAny(attrs().freeVars))
+        return shared_from_this();
+    return makeAst<CondExpr>(cond->rename(prefix, renames),
                                              thenExpr->rename(prefix, renames),
-                                             elseExpr->rename(prefix, renames)));
+                                             elseExpr->rename(prefix, renames));
 }
 
 InterfaceExpr::InterfaceExpr(const shared_ptr<BSVType> bsvtype, const SourcePos &sourcePos) : Expr(InterfaceExprType, bsvtype, sourcePos) {
@@ -506,6 +579,16 @@ shared_ptr<BitConcatExpr> BitConcatExpr::bitConcatExpr() {
     return static_pointer_cast<BitConcatExpr, Expr>(shared_from_this());
 };
 
+void BitConcatExpr::computeAttrs(ExprAttrs &attrs) {
+    for (size_t i = 0; i < values.size(); i++)
+        attrs.freeVars.unite(values[i]->attrs().freeVars);
+}
+
 shared_ptr<Expr> BitConcatExpr::rename(string prefix, shared_ptr<LexicalScope> &renames) {
-    return static_pointer_cast<BitConcatExpr, Expr>(shared_from_this());
+    if (!renames->renamesAny(attrs().freeVars))
+        return shared_from_this();
+    vector<shared_ptr<Expr>> renamedValues;
+    for (size_t i = 0; i < values.size(); i++)
+        renamedValues.push_back(values[i]->rename(prefix, renames));
+    return makeAst<BitConcatExpr>(renamedValues, bsvtype, sourcePos);
 }
@@ -6,10 +6,12 @@
 #include <vector>
 #include <memory>
 
+#include "AstArena.h"
 #include "LexicalScope.h"
 #include "Pattern.h"
 #include "BSVType.h"
 #include "SourcePos.h"
+#include "VarSet.h"
 
 using namespace std;
 
@@ -36,9 +38,9 @@ enum ExprType {
 
 class ExprAttrs {
 public:
-    map<string, shared_ptr<BSVType>> boundVars;
-    map<string, shared_ptr<BSVType>> assignedVars;
-    map<string, shared_ptr<BSVType>> freeVars;
+    VarSet boundVars;
+    VarSet assignedVars;
+    VarSet freeVars;
 };
 
 class FieldExpr;
@@ -80,8 +82,14 @@ public:
     const ExprType exprType;
     const shared_ptr<BSVType> bsvtype;
     const SourcePos sourcePos;
-    ExprAttrs attrs_;
-    const ExprAttrs &attrs() { return attrs_; }
+    // computed on first use and cached; expressions are immutable once built
+    const ExprAttrs &attrs() {
+        if (!attrsValid) {
+            computeAttrs(attrs_);
+            attrsValid = true;
+        }
+        return attrs_;
+    }
 
     Expr(ExprType exprType, const SourcePos &sourcePos);
     Expr(ExprType exprType, const shared_ptr<BSVType> &bsvtype, const SourcePos &sourcePos);
@@ -126,6 +134,13 @@ public:
 
 
     virtual shared_ptr<Expr> rename(string prefix, shared_ptr<LexicalScope> &renames);
+
+protected:
+    virtual void computeAttrs(ExprAttrs &attrs) {}
+
+private:
+    ExprAttrs attrs_;
+    bool attrsValid = false;
 };
 
 class FieldExpr : public Expr {
@@ -143,6 +158,8 @@ public:
 
     shared_ptr<Expr> rename(string prefix, shared_ptr<LexicalScope> &renames) override;
 
+protected:
+    void computeAttrs(ExprAttrs &attrs) override;
 };
 
 class MethodExpr : public Expr {
@@ -160,6 +177,8 @@ public:
 
     shared_ptr<Expr> rename(string prefix, shared_ptr<LexicalScope> &renames) override;
 
+protected:
+    void computeAttrs(ExprAttrs &attrs) override;
 };
 
 class SubinterfaceExpr : public Expr {
@@ -177,6 +196,8 @@ public:
 
     shared_ptr<Expr> rename(string prefix, shared_ptr<LexicalScope> &renames) override;
 
+protected:
+    void computeAttrs(ExprAttrs &attrs) override;
 };
 class VarExpr : public Expr {
 public:
@@ -192,6 +213,9 @@ public:
     shared_ptr<VarExpr> varExpr() override;
 
     shared_ptr<Expr> rename(string prefix, shared_ptr<LexicalScope> &renames) override;
+
+protected:
+    void computeAttrs(ExprAttrs &attrs) override;
 };
 
 
@@ -209,6 +233,9 @@ public:
     virtual shared_ptr<CallExpr> callExpr() override;
 
     shared_ptr<Expr> rename(string prefix, shared_ptr<LexicalScope> &renames) override;
+
+protected:
+    void computeAttrs(ExprAttrs &attrs) override;
 };
 
 class CaseExprItem {
@@ -263,6 +290,9 @@ public:
     virtual shared_ptr<CondExpr> condExpr() override;
 
     shared_ptr<Expr> rename(string prefix, shared_ptr<LexicalScope> &renames) override;
+
+protected:
+    void computeAttrs(ExprAttrs &attrs) override;
 };
 
 class IntConst : public Expr {
@@ -274,6 +304,9 @@ public:
 public:
     IntConst(const string &repr, const SourcePos &sourcePos = SourcePos());
 
+    // a literal standing for a value of type bsvtype, as OptimizeAst propagates them
+    IntConst(const string &repr, const shared_ptr<BSVType> &bsvtype, const SourcePos &sourcePos = SourcePos());
+
     ~IntConst() override;
 
     void prettyPrint(ostream &out, int depth = 0) override;
@@ -335,6 +368,9 @@ public:
     shared_ptr<OperatorExpr> operatorExpr() override;
 
     shared_ptr<Expr> rename(string prefix, shared_ptr<LexicalScope> &renames) override;
+
+protected:
+    void computeAttrs(ExprAttrs &attrs) override;
 };
 
 class MatchesExpr : public Expr {
@@ -377,6 +413,9 @@ public:
     const shared_ptr<Expr> index;
 
     shared_ptr<Expr> rename(string prefix, shared_ptr<LexicalScope> &renames) override;
+
+protected:
+    void computeAttrs(ExprAttrs &attrs) override;
 };
 
 class BitConcatExpr : public Expr {
@@ -393,6 +432,9 @@ public:
     const vector<shared_ptr<Expr>> values;
 
     shared_ptr<Expr> rename(string prefix, shared_ptr<LexicalScope> &renames) override;
+
+protected:
+    void computeAttrs(ExprAttrs &attrs) override;
 };
 
 class BitSelExpr : public Expr {
@@ -412,6 +454,9 @@ public:
     const shared_ptr<Expr> lsb;
 
     shared_ptr<Expr> rename(string prefix, shared_ptr<LexicalScope> &renames) override;
+
+protected:
+    void computeAttrs(ExprAttrs &attrs) override;
 };
 
 class EnumUnionStructExpr : public Expr {
@@ -431,6 +476,9 @@ public:
     const string tag;
     const vector<string> keys;
     const vector<shared_ptr<Expr>> vals;
+
+protected:
+    void computeAttrs(ExprAttrs &attrs) override;
 };
 
 class ValueofExpr : public Expr {
@@ -13,7 +13,7 @@ public:
         vector<string> members;
         for (int i = 0; i < decl->members.size(); i++)
             members.push_back(decl->members[i]->name);
-        shared_ptr<Stmt> stmt = make_shared<TypedefEnumStmt>(decl->package, name, decl->bsvtype, members, decl->sourcePos);
+        shared_ptr<Stmt> stmt = makeAst<TypedefEnumStmt>(decl->package, name, decl->bsvtype, members, decl->sourcePos);
         stmts.push_back(stmt);
     }
 
@@ -47,12 +47,12 @@ public:
             memberNames.push_back(decl->members[i]->name);
             memberTypes.push_back(decl->members[i]->bsvtype);
         }
-        shared_ptr<TypedefStructStmt> stmt = make_shared<TypedefStructStmt>(decl->package, name, structType, memberNames, memberTypes, decl->sourcePos);
+        shared_ptr<TypedefStructStmt> stmt = makeAst<TypedefStructStmt>(decl->package, name, structType, memberNames, memberTypes, decl->sourcePos);
         stmts.push_back(stmt);
     }
 
     void visitTypeSynonymDeclaration(const shared_ptr<TypeSynonymDeclaration> &decl) override {
-        shared_ptr<Stmt> stmt = make_shared<TypedefSynonymStmt>(decl->package, decl->bsvtype, decl->lhstype, decl->sourcePos);
+        shared_ptr<Stmt> stmt = makeAst<TypedefSynonymStmt>(decl->package, decl->bsvtype, decl->lhstype, decl->sourcePos);
         //stmt->prettyPrint(cout, 0);
         stmts.push_back(stmt);
     }
@@ -66,15 +66,15 @@ std::shared_ptr<LValue> GenerateAst::lvalue(BSVParser::LvalueContext *lhs) {
     if (lhs->exprprimary() != nullptr) {
         shared_ptr<Expr> lhsLValue(expr(lhs->exprprimary()));
         if (lhs->index != nullptr) {
-            return make_shared<ArraySubLValue>(lhsLValue, expr(lhs->index));
+            return makeAst<ArraySubLValue>(lhsLValue, expr(lhs->index));
         } else if (lhs->msb != nullptr) {
-            return make_shared<RangeSelLValue>(lhsLValue, expr(lhs->msb), expr(lhs->lsb));
+            return makeAst<RangeSelLValue>(lhsLValue, expr(lhs->msb), expr(lhs->lsb));
         } else {
-            return make_shared<FieldLValue>(lhsLValue, lhs->lowerCaseIdentifier()->getText());
+            return makeAst<FieldLValue>(lhsLValue, lhs->lowerCaseIdentifier()->getText());
         }
     } else {
         shared_ptr<BSVType> bsvtype = typeChecker->lookup(lhs->lowerCaseIdentifier());
-        shared_ptr<LValue> lvalue = make_shared<VarLValue>(lhs->lowerCaseIdentifier()->getText(), bsvtype);
+        shared_ptr<LValue> lvalue = makeAst<VarLValue>(lhs->lowerCaseIdentifier()->getText(), bsvtype);
         return lvalue;
     }
 }
@@ -87,13 +87,13 @@ shared_ptr<Expr> GenerateAst::expr(BSVParser::ExpressionContext *ctx) {
     } else if (BSVParser::CondexprContext *condexpr = dynamic_cast<BSVParser::CondexprContext *>(ctx)) {
         return expr(condexpr);
     } else if (BSVParser::MatchesexprContext *matchesExpr = dynamic_cast<BSVParser::MatchesexprContext *>(ctx)) {
-        logstream << "Unhandled matches expr " << ctx->getText() << endl;
+        logstream << "Unhandled matches expr " << SourceText::excerpt(ctx) << endl;
         return expr(matchesExpr);
     } else if (BSVParser::CaseexprContext *caseExpr = dynamic_cast<BSVParser::CaseexprContext *>(ctx)) {
-        logstream << "Unhandled case expr " << ctx->getText() << endl;
+        logstream << "Unhandled case expr " << SourceText::excerpt(ctx) << endl;
         return expr(caseExpr);
     }
-    logstream << "How did we get here: expr " << ctx->getRuleIndex() << " " << ctx->getText() << endl;
+    logstream << "How did we get here: expr " << ctx->getRuleIndex() << " " << SourceText::excerpt(ctx) << endl;
     return result;
 }
 
@@ -110,7 +110,7 @@ std::shared_ptr<Expr> GenerateAst::expr(BSVParser::CaseexprContext *ctx) {
         exprItems.push_back(caseExprItem(ctx->caseexprdefaultitem()));
     }
     shared_ptr<BSVType> bsvtype(typeChecker->lookup(ctx));
-    return make_shared<CaseExpr>(matchValue, exprItems, bsvtype, sourcePos(ctx));
+    return makeAst<CaseExpr>(matchValue, exprItems, bsvtype, sourcePos(ctx));
 }
 
 std::shared_ptr<CaseExprItem> GenerateAst::caseExprItem(BSVParser::CaseexprpatitemContext *ctx) {
@@ -144,10 +144,10 @@ std::shared_ptr<Expr> GenerateAst::expr(BSVParser::CondexprContext *ctx) {
     shared_ptr<Expr> thenexpr(expr(ctx->expression(1)));
     shared_ptr<Expr> elseexpr(expr(ctx->expression(2)));
     if (!condexpr || !thenexpr || !elseexpr) {
-        logstream << "Funny cond expr: " << ctx->getText() << endl;
+        logstream << "Funny cond expr: " << SourceText::excerpt(ctx) << endl;
         logstream << (bool) condexpr << (bool) thenexpr << (bool) elseexpr << endl;
     }
-    shared_ptr<Expr> result(new CondExpr(condexpr, thenexpr, elseexpr));
+    shared_ptr<Expr> result(makeAst<CondExpr>(condexpr, thenexpr, elseexpr));
     return result;
 }
 
@@ -159,9 +159,9 @@ std::shared_ptr<Expr> GenerateAst::expr(BSVParser::MatchesexprContext *ctx) {
         vector<shared_ptr<Expr>> exprs;
         for (int i = 0; i < patterncond.size(); i++)
             exprs.push_back(expr(patterncond[i]->expression()));
-        return make_shared<MatchesExpr>(lhs, pattern, exprs, sourcePos(ctx));
+        return makeAst<MatchesExpr>(lhs, pattern, exprs, sourcePos(ctx));
     } else {
-        return make_shared<MatchesExpr>(lhs, pattern, sourcePos(ctx));
+        return makeAst<MatchesExpr>(lhs, pattern, sourcePos(ctx));
     }
 }
 
@@ -175,7 +175,7 @@ shared_ptr<Expr> GenerateAst::expr(BSVParser::BinopexprContext *ctx) {
     if (!lhs) {
         cerr << "GenerateAst no lhs " << sourceLocation(ctx) << endl;
     }
-    shared_ptr<Expr> result(new OperatorExpr(op, lhs, rhs));
+    shared_ptr<Expr> result(makeAst<OperatorExpr>(op, lhs, rhs));
     return result;
 }
 
@@ -184,8 +184,8 @@ shared_ptr<Expr> GenerateAst::expr(BSVParser::UnopexprContext *ctx) {
     shared_ptr<Expr> arg(expr(ctx->exprprimary()));
     if (ctx->op) {
         if (!arg)
-            logstream << "unhandled unop expr: " << ctx->exprprimary()->getText() << endl;
-        result.reset(new OperatorExpr(ctx->op->getText(), arg));
+            logstream << "unhandled unop expr: " << SourceText::excerpt(ctx->exprprimary()) << endl;
+        result = makeAst<OperatorExpr>(ctx->op->getText(), arg);
     } else {
         result = arg;
     }
@@ -199,30 +199,30 @@ shared_ptr<Expr> GenerateAst::expr(BSVParser::ExprprimaryContext *ctx) {
     if (BSVParser::FieldexprContext *fieldexpr = dynamic_cast<BSVParser::FieldexprContext *>(ctx)) {
         return expr(fieldexpr);
     } else if (BSVParser::VarexprContext *varexpr = dynamic_cast<BSVParser::VarexprContext *>(ctx)) {
-	    return make_shared<VarExpr>(varexpr->getText(), resultType, sourcePos(ctx));
+	    return makeAst<VarExpr>(varexpr->getText(), resultType, sourcePos(ctx));
     } else if (BSVParser::IntliteralContext *intliteral = dynamic_cast<BSVParser::IntliteralContext *>(ctx)) {
-        return make_shared<IntConst>(intliteral->getText(), sourcePos(ctx));
+        return makeAst<IntConst>(intliteral->getText(), sourcePos(ctx));
     } else if (BSVParser::StringliteralContext *stringliteral = dynamic_cast<BSVParser::StringliteralContext *>(ctx)) {
         string quotedString = stringliteral->getText();
         string unquotedString = quotedString.substr(1, quotedString.size() - 2);
-        return make_shared<StringConst>(unquotedString, sourcePos(ctx));
+        return makeAst<StringConst>(unquotedString, sourcePos(ctx));
     } else if (BSVParser::ValueofexprContext *valueofexpr = dynamic_cast<BSVParser::ValueofexprContext *>(ctx)) {
         shared_ptr<BSVType> bsvtype = typeChecker->lookup(valueofexpr->bsvtype());
-        return make_shared<ValueofExpr>(bsvtype, sourcePos(ctx));
+        return makeAst<ValueofExpr>(bsvtype, sourcePos(ctx));
     } else if (BSVParser::BitconcatContext *bitconcat = dynamic_cast<BSVParser::BitconcatContext *>(ctx)) {
         vector<shared_ptr<Expr>> values;
         for (int i = 0; bitconcat->expression(i); i++) {
             values.push_back(expr(bitconcat->expression(i)));
         }
-        return make_shared<BitConcatExpr>(values, typeChecker->lookup(ctx), sourcePos(ctx));
+        return makeAst<BitConcatExpr>(values, typeChecker->lookup(ctx), sourcePos(ctx));
     } else if (BSVParser::ArraysubContext *arraysub = dynamic_cast<BSVParser::ArraysubContext *>(ctx)) {
         shared_ptr<Expr> array(expr(arraysub->array));
         shared_ptr<Expr> msb(expr(arraysub->msb));
         if (arraysub->lsb) {
             shared_ptr<Expr> lsb(expr(arraysub->lsb));
-            return make_shared<BitSelExpr>(array, msb, lsb, sourcePos(ctx));
+            return makeAst<BitSelExpr>(array, msb, lsb, sourcePos(ctx));
         } else {
-            return make_shared<ArraySubExpr>(array, msb, sourcePos(ctx));
+            return makeAst<ArraySubExpr>(array, msb, sourcePos(ctx));
         }
     } else if (BSVParser::CallexprContext *callexpr = dynamic_cast<BSVParser::CallexprContext *>(ctx)) {
         shared_ptr<Expr> function(expr(callexpr->fcn));
@@ -231,16 +231,16 @@ shared_ptr<Expr> GenerateAst::expr(BSVParser::ExprprimaryContext *ctx) {
         for (size_t i = 0; i < args.size(); i++) {
             exprs.push_back(expr(args.at(i)));
         }
-        return make_shared<CallExpr>(function, exprs, sourcePos(ctx));
+        return makeAst<CallExpr>(function, exprs, sourcePos(ctx));
     } else if (BSVParser::SyscallexprContext *syscallexpr = dynamic_cast<BSVParser::SyscallexprContext *>(ctx)) {
         //FIXME: placeholder type for $display etc.
-        shared_ptr<VarExpr> function = make_shared<VarExpr>(syscallexpr->fcn->getText(), make_shared<BSVType>(), sourcePos(ctx));
+        shared_ptr<VarExpr> function = makeAst<VarExpr>(syscallexpr->fcn->getText(), make_shared<BSVType>(), sourcePos(ctx));
         vector<BSVParser::ExpressionContext *> args = syscallexpr->expression();
         vector<shared_ptr<Expr>> exprs;
         for (size_t i = 0; i < args.size(); i++) {
             exprs.push_back(expr(args.at(i)));
         }
-        return make_shared<CallExpr>(function, exprs, sourcePos(ctx));
+        return makeAst<CallExpr>(function, exprs, sourcePos(ctx));
     } else if (BSVParser::TaggedunionexprContext *unionexpr = dynamic_cast<BSVParser::TaggedunionexprContext *>(ctx)) {
         string tag = unionexpr->upperCaseIdentifier(0)->getText();
         vector<string> keys;
@@ -255,20 +255,20 @@ shared_ptr<Expr> GenerateAst::expr(BSVParser::ExprprimaryContext *ctx) {
             }
         } else {
             //FIXME
-            logstream << "unhandled tagged union: " << unionexpr->getText() << endl;
+            logstream << "unhandled tagged union: " << SourceText::excerpt(unionexpr) << endl;
         }
         shared_ptr<BSVType> bsvtype = typeChecker->lookup(ctx);
-        return make_shared<EnumUnionStructExpr>(tag, keys, vals, bsvtype, sourcePos(ctx));
+        return makeAst<EnumUnionStructExpr>(tag, keys, vals, bsvtype, sourcePos(ctx));
     } else if (BSVParser::ParenexprContext *parenexpr = dynamic_cast<BSVParser::ParenexprContext *>(ctx)) {
         return expr(parenexpr->expression());
     } else if (BSVParser::UndefinedexprContext *undef = dynamic_cast<BSVParser::UndefinedexprContext *>(ctx)) {
         //FIXME:: get type from type checker
-        return make_shared<VarExpr>("Undefined", make_shared<BSVType>(), sourcePos(ctx));
+        return makeAst<VarExpr>("Undefined", make_shared<BSVType>(), sourcePos(ctx));
     } else if (BSVParser::InterfaceexprContext *ifcexpr = dynamic_cast<BSVParser::InterfaceexprContext *>(ctx)) {
         shared_ptr<BSVType> bsvtype = typeChecker->lookup(ifcexpr);
-        return make_shared<InterfaceExpr>(bsvtype, sourcePos(ifcexpr));
+        return makeAst<InterfaceExpr>(bsvtype, sourcePos(ifcexpr));
     } else {
-        logstream << "Unhandled expr primary " << ctx->getText() << endl;
+        logstream << "Unhandled expr primary " << SourceText::excerpt(ctx) << endl;
     }
     return result;
 }
@@ -293,7 +293,7 @@ shared_ptr<Expr> GenerateAst::expr(BSVParser::FieldexprContext *fieldexpr) {
         //if (fieldName == "tpl_1")
             logstream << "field expr type " << object->bsvtype->to_string() << " result type "
                       << resultType->to_string() << endl;
-        return make_shared<FieldExpr>(object, fieldName, resultType, sourcePos(fieldexpr));
+        return makeAst<FieldExpr>(object, fieldName, resultType, sourcePos(fieldexpr));
     } else {
         assert(interfaceDecl);
         logstream << "interfacedecl " << interfaceDecl->name << endl;
@@ -301,10 +301,10 @@ shared_ptr<Expr> GenerateAst::expr(BSVParser::FieldexprContext *fieldexpr) {
         shared_ptr<InterfaceDeclaration> subinterfaceDecl = fieldDecl->interfaceDeclaration();
         if (subinterfaceDecl) {
             logstream << "    subinterface " << subinterfaceDecl->name << endl;
-            return make_shared<SubinterfaceExpr>(object, fieldName, resultType, sourcePos(fieldexpr));
+            return makeAst<SubinterfaceExpr>(object, fieldName, resultType, sourcePos(fieldexpr));
         } else {
             logstream << "    must be a method " << fieldName << endl;
-            shared_ptr<Expr> methodExpr = make_shared<MethodExpr>(object, fieldName, resultType, sourcePos(fieldexpr));
+            shared_ptr<Expr> methodExpr = makeAst<MethodExpr>(object, fieldName, resultType, sourcePos(fieldexpr));
             return methodExpr;
         }
     }
@@ -316,18 +316,37 @@ shared_ptr<PackageDefStmt> GenerateAst::generateAst(BSVParser::PackagedefContext
     vector<shared_ptr<Stmt>> package_stmts;
     logstream << "generateAst " << stmts.size() << " stmts" << endl;
     string packageName("<unnamed>");
+    typeChecker->declarePackage(ctx);
     for (size_t i = 0; i < stmts.size(); i++) {
         if (ctx->packagedecl()) {
             packageName = ctx->packagedecl()->packageide()->getText();
         }
-        antlrcpp::Any attributes = aiv.visit(stmts[i]);
-        if (aiv.contains(attributes, "nogen")) {
+        typeChecker->visit(stmts[i]);
+        if (hasAttribute(stmts[i], "nogen")) {
             cerr << "Skipping (* nogen *) statement at " << sourceLocation(stmts[i]) << endl;
             continue;
         }
         generateAst(stmts[i], package_stmts);
     }
-    return make_shared<PackageDefStmt>(packageName, package_stmts, sourcePos(ctx));
+    return makeAst<PackageDefStmt>(packageName, package_stmts, sourcePos(ctx));
+}
+
+// the attribute instances that start the declaration of a package statement
+bool GenerateAst::hasAttribute(BSVParser::PackagestmtContext *ctx, const string &attr) {
+    antlr4::ParserRuleContext *decl = ctx->getRuleContext<antlr4::ParserRuleContext>(0);
+    if (!decl)
+        return false;
+    for (size_t i = 0; i < decl->children.size(); i++) {
+        BSVParser::AttributeinstanceContext *attributeinstance =
+                dynamic_cast<BSVParser::AttributeinstanceContext *>(decl->children[i]);
+        if (!attributeinstance)
+            break;
+        for (int j = 0; attributeinstance->attrspec(j); j++) {
+            if (attributeinstance->attrspec(j)->getText() == attr)
+                return true;
+        }
+    }
+    return false;
 }
 
 void GenerateAst::generateAst(BSVParser::PackagestmtContext *ctx, vector<shared_ptr<Stmt>> &stmts) {
@@ -343,7 +362,7 @@ void GenerateAst::generateAst(BSVParser::PackagestmtContext *ctx, vector<shared_
         shared_ptr<LexicalScope> packageScope = typeChecker->lookupPackage(pkgname);
         GenerateAstPackageVisitor packageVisitor(logstream, stmts);
         packageScope->visit(packageVisitor);
-        shared_ptr<Stmt> stmt = make_shared<ImportStmt>(pkgname, sourcePos(ctx));
+        shared_ptr<Stmt> stmt = makeAst<ImportStmt>(pkgname, sourcePos(ctx));
         //stmt->prettyPrint(cout, 0);
         stmts.push_back(stmt);
     } else if (BSVParser::InterfacedeclContext *interfacedecl = ctx->interfacedecl()) {
@@ -357,12 +376,12 @@ void GenerateAst::generateAst(BSVParser::PackagestmtContext *ctx, vector<shared_
         for (int i = 0; enumctx->typedefenumelement(i); i++) {
             members.push_back(enumctx->typedefenumelement(i)->upperCaseIdentifier()->getText());
         }
-        shared_ptr<Stmt> stmt = make_shared<TypedefEnumStmt>(packageName, name, bsvtype, members, sourcePos(enumctx));
+        shared_ptr<Stmt> stmt = makeAst<TypedefEnumStmt>(packageName, name, bsvtype, members, sourcePos(enumctx));
         stmts.push_back(stmt);
     } else if (BSVParser::TypedefsynonymContext *synonym = ctx->typedefsynonym()) {
         shared_ptr<BSVType> type(typeChecker->bsvtype(synonym->bsvtype()));
         shared_ptr<BSVType> typedeftype(typeChecker->bsvtype(synonym->typedeftype()));
-        shared_ptr<Stmt> stmt = make_shared<TypedefSynonymStmt>(packageName, typedeftype, type, sourcePos(ctx));
+        shared_ptr<Stmt> stmt = makeAst<TypedefSynonymStmt>(packageName, typedeftype, type, sourcePos(ctx));
         //stmt->prettyPrint(cout, 0);
         stmts.push_back(stmt);
     } else if (BSVParser::TypedefstructContext *def = ctx->typedefstruct()) {
@@ -377,7 +396,7 @@ void GenerateAst::generateAst(BSVParser::PackagestmtContext *ctx, vector<shared_
             memberNames.push_back(member->lowerCaseIdentifier()->getText());
             memberTypes.push_back(typeChecker->bsvtype(member->bsvtype()));
         }
-        shared_ptr<Stmt> stmt = make_shared<TypedefStructStmt>(packageName, name, structType, memberNames, memberTypes, sourcePos(ctx));
+        shared_ptr<Stmt> stmt = makeAst<TypedefStructStmt>(packageName, name, structType, memberNames, memberTypes, sourcePos(ctx));
         //stmt->prettyPrint(cout, 0);
         stmts.push_back(stmt);
     } else if (BSVParser::FunctiondefContext *fcn = ctx->functiondef()) {
@@ -401,13 +420,13 @@ std::shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::InterfacedeclContext *
             shared_ptr<BSVType> returnType(typeChecker->bsvtype(methodproto->bsvtype()));
             vector<string> params;
             vector<shared_ptr<BSVType>> paramTypes;
-            shared_ptr<Stmt> methoddecl = make_shared<MethodDeclStmt>(methodName, returnType, params, paramTypes, sourcePos(ctx));
+            shared_ptr<Stmt> methoddecl = makeAst<MethodDeclStmt>(methodName, returnType, params, paramTypes, sourcePos(ctx));
             ast_members.push_back(methoddecl);
 
         }
     }
 
-    shared_ptr<Stmt> interfacedecl = make_shared<InterfaceDeclStmt>(packageName, interfaceName, interfaceType, ast_members, sourcePos(ctx));
+    shared_ptr<Stmt> interfacedecl = makeAst<InterfaceDeclStmt>(packageName, interfaceName, interfaceType, ast_members, sourcePos(ctx));
     return interfacedecl;
 }
 
@@ -427,14 +446,14 @@ std::shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::SubinterfacedefContext
                 returnType = typeChecker->bsvtype(methoddef->bsvtype());
             vector<string> params;
             vector<shared_ptr<BSVType>> paramTypes;
-            shared_ptr<Stmt> methoddecl(new MethodDeclStmt(methodName, returnType, params, paramTypes, sourcePos(ctx)));
+            shared_ptr<Stmt> methoddecl(makeAst<MethodDeclStmt>(methodName, returnType, params, paramTypes, sourcePos(ctx)));
             ast_members.push_back(methoddecl);
         } else {
             logstream << "unhandled subinterface " << member->getText() << endl;
         }
     }
 
-    shared_ptr<Stmt> interfacedef(new InterfaceDefStmt(string(), interfaceName, interfaceType, ast_members, sourcePos(ctx)));
+    shared_ptr<Stmt> interfacedef(makeAst<InterfaceDefStmt>(string(), interfaceName, interfaceType, ast_members, sourcePos(ctx)));
     return interfacedef;
 }
 
@@ -474,7 +493,7 @@ std::shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::ModuledefContext *ctx)
             logstream << "Unhandled module stmt: " << modstmt->getText() << endl;
         }
     }
-    shared_ptr<Stmt> moduledef = make_shared<ModuleDefStmt>(packageName, moduleName, interfaceType,
+    shared_ptr<Stmt> moduledef = makeAst<ModuleDefStmt>(packageName, moduleName, interfaceType,
                                                             params, paramTypes,
                                                             ast_stmts, sourcePos(ctx));
     //moduledef->prettyPrint(cout, 0);
@@ -523,7 +542,7 @@ std::shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::FunctiondefContext *ct
         ast_stmts.push_back(stmt);
     }
     //FIXME: global?
-    return make_shared<FunctionDefStmt>(packageName, functionName, returnType,
+    return makeAst<FunctionDefStmt>(packageName, functionName, returnType,
                                         params, paramTypes, guard, ast_stmts, sourcePos(ctx));
 }
 
@@ -562,7 +581,7 @@ std::shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::MethoddefContext *ctx)
             logstream << "unhandled method stmt: " << stmts.at(i)->getText() << endl;
         ast_stmts.push_back(stmt);
     }
-    return make_shared<MethodDefStmt>(methodName, returnType,
+    return makeAst<MethodDefStmt>(methodName, returnType,
                                       params, paramTypes, guard, ast_stmts, sourcePos(ctx));
 }
 
@@ -583,12 +602,12 @@ std::shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::RuledefContext *ctx) {
             logstream << "unhandled rule stmt: " << stmts.at(i)->getText();
         ast_stmts.push_back(stmt);
     }
-    shared_ptr<RuleDefStmt> ruledef(new RuleDefStmt(ruleName, guard, ast_stmts, sourcePos(ctx)));
+    shared_ptr<RuleDefStmt> ruledef(makeAst<RuleDefStmt>(ruleName, guard, ast_stmts, sourcePos(ctx)));
     return ruledef;
 }
 
 shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::StmtContext *ctx) {
-    logstream << "        stmt " << ctx->getText() << endl;
+    logstream << "        stmt " << SourceText::excerpt(ctx) << endl;
     if (BSVParser::RegwriteContext *regwrite = ctx->regwrite()) {
         string regName(regwrite->lhs->getText());
         shared_ptr<Expr> rhs(expr(regwrite->rhs));
@@ -598,10 +617,10 @@ shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::StmtContext *ctx) {
             elementType = regType->params[0];
         } else {
             logstream << "(* Unhandled RegWrite element type " << regType->to_string() << " for regwrite: "
-                      << ctx->getText() << "*)" << endl;
+                      << SourceText::excerpt(ctx) << "*)" << endl;
             elementType = make_shared<BSVType>("Bit", make_shared<BSVType>("32", BSVType_Numeric, false));
         }
-        return make_shared<RegWriteStmt>(regName, elementType, rhs, sourcePos(ctx));
+        return makeAst<RegWriteStmt>(regName, elementType, rhs, sourcePos(ctx));
     } else if (BSVParser::VarbindingContext *varbinding = ctx->varbinding()) {
         return generateAst(varbinding);
     } else if (BSVParser::ActionbindingContext *actionbinding = ctx->actionbinding()) {
@@ -616,7 +635,7 @@ shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::StmtContext *ctx) {
         shared_ptr<Stmt> elseStmt;
         if (ifstmt->stmt(1))
             elseStmt = generateAst(ifstmt->stmt(1));
-        shared_ptr<IfStmt> ifStmt = make_shared<IfStmt>(condition, thenStmt, elseStmt, sourcePos(ctx));
+        shared_ptr<IfStmt> ifStmt = makeAst<IfStmt>(condition, thenStmt, elseStmt, sourcePos(ctx));
         logstream << "if stmt at " << ifStmt->sourcePos.toString() << endl;
         logstream << "    assigned vars " << to_string(ifStmt->attrs().assignedVars) << endl;
         return ifStmt;
@@ -629,7 +648,7 @@ shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::StmtContext *ctx) {
                 logstream << "unhandled block stmt: " << stmts.at(i)->getText() << endl;
             ast_stmts.push_back(ast_stmt);
         }
-        return make_shared<BlockStmt>(ast_stmts, sourcePos(ctx));
+        return makeAst<BlockStmt>(ast_stmts, sourcePos(ctx));
     } else if (BSVParser::ActionblockContext *block = ctx->actionblock()) {
         vector<BSVParser::StmtContext *> stmts = block->stmt();
         vector<shared_ptr<Stmt>> ast_stmts;
@@ -639,7 +658,7 @@ shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::StmtContext *ctx) {
                 logstream << "unhandled block stmt: " << stmts.at(i)->getText() << endl;
             ast_stmts.push_back(ast_stmt);
         }
-        return make_shared<BlockStmt>(ast_stmts, sourcePos(ctx));
+        return makeAst<BlockStmt>(ast_stmts, sourcePos(ctx));
     } else if (BSVParser::ActionvalueblockContext *block = ctx->actionvalueblock()) {
         vector<BSVParser::StmtContext *> stmts = block->stmt();
         vector<shared_ptr<Stmt>> ast_stmts;
@@ -649,25 +668,31 @@ shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::StmtContext *ctx) {
                 logstream << "unhandled block stmt: " << stmts.at(i)->getText() << endl;
             ast_stmts.push_back(ast_stmt);
         }
-        return make_shared<BlockStmt>(ast_stmts, sourcePos(ctx));
+        return makeAst<BlockStmt>(ast_stmts, sourcePos(ctx));
     } else if (BSVParser::PatternbindingContext *patternBinding = ctx->patternbinding()) {
         shared_ptr<Expr> val(expr(patternBinding->expression()));
         shared_ptr<Pattern> pat = generateAst(patternBinding->pattern());
-        return make_shared<PatternMatchStmt>(pat, patternBinding->op->getText(), val);
+        return makeAst<PatternMatchStmt>(pat, patternBinding->op->getText(), val);
     } else if (BSVParser::ReturnstmtContext *ret_stmt = ctx->returnstmt()) {
         shared_ptr<Expr> val(expr(ret_stmt->expression()));
         if (!val) {
             logstream << "Unhandled return stmt at " << sourceLocation(ret_stmt->expression()) << endl;
         }
-        return make_shared<ReturnStmt>(val, sourcePos(ctx));
+        return makeAst<ReturnStmt>(val, sourcePos(ctx));
     } else if (BSVParser::ExpressionContext *exp_stmt = ctx->expression()) {
         shared_ptr<Expr> val(expr(exp_stmt));
-        return make_shared<ExprStmt>(val, sourcePos(ctx));
+        return makeAst<ExprStmt>(val, sourcePos(ctx));
     } else if (BSVParser::RuledefContext *ruledef = ctx->ruledef()) {
         return generateAst(ruledef);
     } else if (BSVParser::FunctiondefContext *fcn = ctx->functiondef()) {
         logstream << "function stmt " << ctx->getText() << endl;
         return generateAst(fcn);
+    } else if (BSVParser::ForstmtContext *forstmt = ctx->forstmt()) {
+        return generateAst(forstmt);
+    } else if (BSVParser::WhilestmtContext *whilestmt = ctx->whilestmt()) {
+        shared_ptr<Expr> test(expr(whilestmt->expression()));
+        shared_ptr<Stmt> body(generateAst(whilestmt->stmt()));
+        return makeAst<WhileStmt>(test, body, sourcePos(ctx));
     } else {
         logstream << "Unhandled stmt: " << ctx->getText() << endl;
         shared_ptr<Stmt> stmt;
@@ -691,13 +716,13 @@ shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::VarbindingContext *varbindi
         if (varinit->var) {
             string varName = varinit->var->getText();
             shared_ptr<BSVType> varType = typeChecker->lookup(varinit->var);
-            return make_shared<VarBindingStmt>(varType, varName, rhs, sourcePos(varbinding));
+            return makeAst<VarBindingStmt>(varType, varName, rhs, sourcePos(varbinding));
         } else {
             // tuple destructure
             //FIXME: destructure tuple binding
             string varName("fixmetuple");
             shared_ptr<BSVType> varType = make_shared<BSVType>("Tuple");
-            return make_shared<VarBindingStmt>(varType, varName, rhs, sourcePos(varbinding));
+            return makeAst<VarBindingStmt>(varType, varName, rhs, sourcePos(varbinding));
 
         }
     }
@@ -727,13 +752,13 @@ shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::ActionbindingContext *actio
         // if it is a module instantiation, translate to ModuleInstStmt
         if (rhsType->name == "Module") {
             cerr << "ModuleInst" << endl;
-            return make_shared<ModuleInstStmt>(varName, varType, rhs, sourcePos(actionbinding));
+            return makeAst<ModuleInstStmt>(varName, varType, rhs, sourcePos(actionbinding));
         }
     }
     //cout << "action binding rhs ";
     //expr(actionbinding->rhs)->prettyPrint(cout, 0); cout << endl;
 
-    shared_ptr<Stmt> actionBindingStmt = make_shared<ActionBindingStmt>(varType, varName, rhs, sourcePos(actionbinding));
+    shared_ptr<Stmt> actionBindingStmt = makeAst<ActionBindingStmt>(varType, varName, rhs, sourcePos(actionbinding));
     return actionBindingStmt;
 }
 
@@ -743,7 +768,7 @@ shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::VarassignContext *varassign
     shared_ptr<Expr> rhs(expr(varassign->expression()));
     if (!rhs)
         logstream << "var binding unhandled rhs: " << varassign->expression()->getText() << endl;
-    shared_ptr<Stmt> stmt = make_shared<VarAssignStmt>(lhs, op, rhs, sourcePos(varassign));
+    shared_ptr<Stmt> stmt = makeAst<VarAssignStmt>(lhs, op, rhs, sourcePos(varassign));
     logstream << "var assign at " << stmt->sourcePos.toString() << endl;
     logstream << "    assigned vars " << to_string(stmt->attrs().assignedVars) << endl;
     return stmt;
@@ -757,49 +782,71 @@ shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::ModuleinstContext *modulein
     else
         varType.reset(new BSVType());
     shared_ptr<Expr> rhs(expr(moduleinst->rhs));
-    shared_ptr<Stmt> moduleInstStmt = make_shared<ModuleInstStmt>(varName, varType, rhs, sourcePos(moduleinst));
+    shared_ptr<Stmt> moduleInstStmt = makeAst<ModuleInstStmt>(varName, varType, rhs, sourcePos(moduleinst));
     return moduleInstStmt;
 }
 
+shared_ptr<Stmt> GenerateAst::generateAst(BSVParser::ForstmtContext *forstmt) {
+    BSVParser::ForinitContext *forinit = forstmt->forinit();
+    vector<shared_ptr<Stmt>> init;
+    shared_ptr<BSVType> varType = typeChecker->bsvtype(forinit->bsvtype());
+    init.push_back(makeAst<VarBindingStmt>(varType, forinit->var->getText(), expr(forinit->expression()),
+                                           sourcePos(forinit)));
+    std::vector<BSVParser::SimplevardeclassignContext *> decls = forinit->simplevardeclassign();
+    for (size_t i = 0; i < decls.size(); i++) {
+        shared_ptr<BSVType> declType = decls[i]->bsvtype()
+                                       ? typeChecker->bsvtype(decls[i]->bsvtype())
+                                       : typeChecker->lookup(decls[i]->expression());
+        init.push_back(makeAst<VarBindingStmt>(declType, decls[i]->var->getText(), expr(decls[i]->expression()),
+                                               sourcePos(decls[i])));
+    }
+    shared_ptr<Expr> test(expr(forstmt->fortest()->expression()));
+    vector<shared_ptr<Stmt>> incr;
+    std::vector<BSVParser::VarincrContext *> varincrs = forstmt->forincr()->varincr();
+    for (size_t i = 0; i < varincrs.size(); i++) {
+        shared_ptr<BSVType> incrType = typeChecker->lookup(varincrs[i]->expression());
+        shared_ptr<LValue> lhs = makeAst<VarLValue>(varincrs[i]->lowerCaseIdentifier()->getText(), incrType);
+        incr.push_back(makeAst<VarAssignStmt>(lhs, "=", expr(varincrs[i]->expression()), sourcePos(varincrs[i])));
+    }
+    shared_ptr<Stmt> body(generateAst(forstmt->stmt()));
+    return makeAst<ForStmt>(init, test, incr, body, sourcePos(forstmt));
+}
+
 std::shared_ptr<Pattern> GenerateAst::generateAst(BSVParser::PatternContext *ctx) {
     if (BSVParser::ConstantpatternContext *constPattern = ctx->constantpattern()) {
         if (constPattern->IntLiteral()) {
-            return make_shared<IntPattern>(strtoul(ctx->getText().c_str(), 0, 0));
+            return makeAst<IntPattern>(strtoul(ctx->getText().c_str(), 0, 0));
         } else if (constPattern->IntPattern()) {
-            return make_shared<IntPattern>(ctx->getText());
+            return makeAst<IntPattern>(ctx->getText());
         } else {
             logstream << "Unhandled constant pattern: " << ctx->getText() << endl;
-            return make_shared<WildcardPattern>();
+            return makeAst<WildcardPattern>();
         }
     } else if (BSVParser::TaggedunionpatternContext *taggedPattern = ctx->taggedunionpattern()) {
         logstream << "checkme tagged union pattern: " << ctx->getText() << endl;
-        return make_shared<TaggedPattern>(ctx->getText());
+        return makeAst<TaggedPattern>(ctx->getText());
     } else if (BSVParser::TuplepatternContext *tuplePattern = ctx->tuplepattern()) {
         logstream << "Unhandled tagged union pattern: " << ctx->getText() << endl;
         vector<BSVParser::PatternContext *> patterns = ctx->tuplepattern()->pattern();
         vector<shared_ptr<Pattern>> ast_patterns;
         for (int i = 0; i < patterns.size(); i++)
             ast_patterns.push_back(generateAst(patterns[i]));
-        return make_shared<TuplePattern>(ast_patterns);
+        return makeAst<TuplePattern>(ast_patterns);
     } else if (ctx->var) {
-        return make_shared<VarPattern>(ctx->getText());
+        return makeAst<VarPattern>(ctx->getText());
     } else if (ctx->pattern()) {
         return generateAst(ctx->pattern());
     } else {
-        return make_shared<WildcardPattern>();
+        return makeAst<WildcardPattern>();
     }
     assert(0);
 }
 
 
 string GenerateAst::sourceLocation(antlr4::ParserRuleContext *ctx) {
-    antlr4::Token *start = ctx->getStart();
-    string filename = start->getTokenSource()->getSourceName();
-    size_t line = start->getLine();
-    return filename + ":" + to_string(line);
+    return sourceText.location(ctx);
 }
 
 SourcePos GenerateAst::sourcePos(antlr4::ParserRuleContext *ctx) {
-    antlr4::Token *start = ctx->getStart();
-    return SourcePos(start->getTokenSource()->getSourceName(), start->getLine(), start->getCharPositionInLine());
+    return sourceText.sourcePos(ctx);
 }
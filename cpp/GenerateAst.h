@@ -8,10 +8,10 @@
 #include <BSVParser.h>
 #pragma GCC diagnostic pop
 
-#include "AttributeInstanceVisitor.h"
 #include "BSVType.h"
 #include "Expr.h"
 #include "Pattern.h"
+#include "SourceText.h"
 #include "Stmt.h"
 #include "TypeChecker.h"
 
@@ -19,11 +19,12 @@ class GenerateAst {
     shared_ptr<TypeChecker> typeChecker;
     string packageName;
     ofstream logstream;
-    AttributeInstanceVisitor aiv;
+    SourceText sourceText;
 public:
     GenerateAst(const string &packageName, shared_ptr<TypeChecker> &typeChecker)
         : typeChecker(typeChecker), packageName(packageName), logstream(string("kami/") + packageName + string(".ast.log"), ostream::out) {}
 
+    // type checks each statement of the package and generates its AST while the model solved for it is current
     std::shared_ptr<PackageDefStmt> generateAst(BSVParser::PackagedefContext *ctx);
 
     void generateAst(BSVParser::PackagestmtContext *ctx, vector<std::shared_ptr<Stmt>> &stmts);
@@ -78,7 +79,11 @@ public:
 
     std::shared_ptr<Stmt> generateAst(BSVParser::ModuleinstContext *moduleinst);
 
+    std::shared_ptr<Stmt> generateAst(BSVParser::ForstmtContext *forstmt);
+
 private:
+    static bool hasAttribute(BSVParser::PackagestmtContext *ctx, const string &attr);
+
     string sourceLocation(antlr4::ParserRuleContext *pContext);
     SourcePos sourcePos(antlr4::ParserRuleContext *pContext);
 };
@@ -0,0 +1,923 @@
+#include <algorithm>
+
+#include "BitVector.h"
+#include "GenerateCpp.h"
+
+// written at the top of each generated file
+static const char *runtime = R"RUNTIME(#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#ifndef BSVSIM_RUNTIME
+#define BSVSIM_RUNTIME
+namespace bsvsim {
+
+typedef unsigned __int128 uint128_t;
+typedef __int128 int128_t;
+
+template <int width, typename T>
+inline T truncate(T value) {
+    return width >= (int)(8 * sizeof(T)) ? value : (T)(value & (((T)1 << (width % (8 * sizeof(T)))) - 1));
+}
+
+// the low width bits of value, sign extended, for Int#(n) held in a wider signed type
+template <int width, typename T>
+inline T signExtend(T value) {
+    const int shift = 8 * (int)sizeof(T) - width;
+    return shift <= 0 ? value : (T)((T)((uint128_t)value << shift) >> shift);
+}
+
+inline uint128_t bits(uint128_t value, int msb, int lsb) {
+    int width = msb - lsb + 1;
+    value >>= lsb;
+    return width >= 128 ? value : value & (((uint128_t)1 << width) - 1);
+}
+
+inline uint128_t concat(uint128_t high, uint128_t low, int lowWidth) {
+    return (high << lowWidth) | bits(low, lowWidth - 1, 0);
+}
+
+inline std::string toString(uint128_t value, int base) {
+    static const char digits[] = "0123456789abcdef";
+    std::string str;
+    do {
+        str.insert(str.begin(), digits[(int)(value % base)]);
+        value /= base;
+    } while (value);
+    return str;
+}
+
+// an argument of $display: a string, or the bits of a value, which %d prints
+// with a sign if signedWidth is not 0
+struct DisplayArg {
+    uint128_t value = 0;
+    int signedWidth = 0;
+    const char *str = nullptr;
+
+    DisplayArg(uint128_t value) : value(value) {}
+    DisplayArg(uint128_t value, int signedWidth)
+        : value(bits(value, signedWidth - 1, 0)), signedWidth(signedWidth) {}
+    DisplayArg(const char *str) : str(str) {}
+
+    std::string toString(int base) const {
+        if (str)
+            return str;
+        if (base == 10 && signedWidth && bits(value, signedWidth - 1, signedWidth - 1))
+            return "-" + bsvsim::toString(bits(-value, signedWidth - 1, 0), 10);
+        return bsvsim::toString(value, base);
+    }
+};
+
+// $display and $write: %d, %h, %x, %b, %o, %s and %%, field widths are ignored
+inline void display(bool newline, const char *format, std::initializer_list<DisplayArg> args) {
+    std::string str;
+    auto arg = args.begin();
+    for (const char *p = format; p && *p; p++) {
+        if (*p != '%' || !p[1]) {
+            str += *p;
+            continue;
+        }
+        p++;
+        while (p[1] && *p >= '0' && *p <= '9')
+            p++;
+        if (*p == '%') {
+            str += '%';
+            continue;
+        }
+        if (arg == args.end())
+            break;
+        int base = (*p == 'h' || *p == 'x') ? 16 : (*p == 'b') ? 2 : (*p == 'o') ? 8 : 10;
+        str += (arg++)->toString(base);
+    }
+    for (; arg != args.end(); arg++)
+        str += arg->toString(10);
+    if (newline)
+        str += '\n';
+    fputs(str.c_str(), stdout);
+}
+
+inline void dynamicAssert(bool condition, const char *message, const char *sourcePos) {
+    if (!condition)
+        fprintf(stderr, "assertion failed at %s: %s\n", sourcePos, message);
+}
+
+// Value change dump of the registers, written through a buffer
+class VcdWriter {
+    FILE *file = nullptr;
+    std::string buffer;
+    std::vector<uint128_t> values;
+    std::vector<int> widths;
+    std::vector<bool> dumped;
+
+    static std::string code(int id) {
+        std::string str;
+        do {
+            str += (char)('!' + id % 94);
+            id /= 94;
+        } while (id);
+        return str;
+    }
+
+public:
+    ~VcdWriter() { close(); }
+
+    bool open(const char *filename) {
+        file = fopen(filename, "w");
+        if (!file)
+            return false;
+        buffer += "$timescale 1ns $end\n$scope module top $end\n";
+        return true;
+    }
+
+    int var(const char *name, int width) {
+        int id = (int)values.size();
+        values.push_back(0);
+        widths.push_back(width);
+        dumped.push_back(false);
+        buffer += "$var wire " + std::to_string(width) + " " + code(id) + " " + name + " $end\n";
+        return id;
+    }
+
+    void endDefinitions() { buffer += "$upscope $end\n$enddefinitions $end\n"; }
+
+    void time(long t) { buffer += "#" + std::to_string(t) + "\n"; }
+
+    void value(int id, uint128_t v) {
+        if (dumped[id] && values[id] == v)
+            return;
+        values[id] = v;
+        dumped[id] = true;
+        buffer += 'b';
+        for (int i = widths[id] - 1; i >= 0; i--)
+            buffer += (char)('0' + (int)((v >> i) & 1));
+        buffer += ' ' + code(id) + '\n';
+        if (buffer.size() >= (1 << 16))
+            flush();
+    }
+
+    void flush() {
+        if (file && buffer.size())
+            fwrite(buffer.data(), 1, buffer.size(), file);
+        buffer.clear();
+    }
+
+    void close() {
+        flush();
+        if (file)
+            fclose(file);
+        file = nullptr;
+    }
+};
+
+}
+#endif
+)RUNTIME";
+
+// BSV names with the $ the Inliner uses for instance prefixes
+static string cppName(const string &name) {
+    string str;
+    for (size_t i = 0; i < name.size(); i++) {
+        if (name[i] == '$')
+            str += "__";
+        else
+            str += name[i];
+    }
+    return str;
+}
+
+static bool isSigned(const shared_ptr<BSVType> &bsvtype) {
+    return bsvtype && (bsvtype->name == "Int" || bsvtype->name == "Integer");
+}
+
+static bool isComparison(const string &op) {
+    return op == "==" || op == "!=" || op == "<" || op == "<=" || op == ">" || op == ">=";
+}
+
+// the type of the value of expr; the parser leaves operators untyped, so
+// theirs comes from their operands
+static shared_ptr<BSVType> valueType(const shared_ptr<Expr> &expr) {
+    if (!expr)
+        return shared_ptr<BSVType>();
+    if (expr->bsvtype)
+        return expr->bsvtype;
+    shared_ptr<OperatorExpr> operatorExpr = expr->operatorExpr();
+    if (!operatorExpr)
+        return shared_ptr<BSVType>();
+    const string &op = operatorExpr->op;
+    if (isComparison(op) || op == "!" || op == "&&" || op == "||")
+        return BSVType::create("Bool");
+    shared_ptr<BSVType> lhsType = valueType(operatorExpr->lhs);
+    if (lhsType || !operatorExpr->rhs || op == "<<" || op == ">>")
+        return lhsType;
+    return valueType(operatorExpr->rhs);
+}
+
+static bool isExactWidth(int width) {
+    return width == 8 || width == 16 || width == 32 || width == 64 || width == 128;
+}
+
+static int traceWidth(const shared_ptr<BSVType> &bsvtype) {
+    if (bsvtype->name == "Bool")
+        return 1;
+    if (bsvtype->name == "Integer")
+        return 64;
+    return min(bsvtype->bitWidth(), 128);
+}
+
+void GenerateCpp::open(const string &filename) {
+    this->filename = filename;
+    cerr << "Opening C++ file " << filename << endl;
+    out.open(filename);
+    out << "// Generated by bsv-parser" << endl;
+    out << runtime << endl;
+}
+
+void GenerateCpp::close() {
+    out << "#ifdef BSVSIM_TOP" << endl;
+    out << "int main(int argc, char **argv) {" << endl;
+    out << "    long cycles = argc > 1 ? atol(argv[1]) : 1000;" << endl;
+    out << "    bsvsim::VcdWriter vcd;" << endl;
+    out << "    bool tracing = argc > 2 && vcd.open(argv[2]);" << endl;
+    out << "    static BSVSIM_TOP top;" << endl;
+    out << "    long cycle = top.run(cycles, tracing ? &vcd : nullptr);" << endl;
+    out << "    fprintf(stderr, \"%ld cycles\\n\", cycle);" << endl;
+    out << "    return 0;" << endl;
+    out << "}" << endl;
+    out << "#endif" << endl;
+    cerr << "Closing C++ file " << filename << endl;
+    out.close();
+}
+
+void GenerateCpp::generateStmts(const vector<shared_ptr<Stmt>> &stmts) {
+    for (size_t i = 0; i < stmts.size(); i++)
+        generateCpp(stmts[i], 0);
+}
+
+void GenerateCpp::generateCpp(const shared_ptr<Stmt> &stmt, int depth) {
+    if (stmt)
+        dispatchStmt(stmt, depth);
+}
+
+void GenerateCpp::generateCpp(const shared_ptr<Expr> &expr) {
+    dispatchExpr(expr);
+}
+
+string GenerateCpp::cppType(const shared_ptr<BSVType> &bsvtype) {
+    if (!bsvtype)
+        return "void";
+    const string &name = bsvtype->name;
+    if (name == "Bool")
+        return "bool";
+    if (name == "Integer")
+        return "int64_t";
+    if (name == "Action" || name == "Void" || name == "Empty")
+        return "void";
+    int width = bsvtype->bitWidth();
+    if (!width)
+        return "uint64_t /* " + bsvtype->to_string() + " */";
+    if (name == "Int") {
+        // sign extended to the width of the type
+        if (width <= 64)
+            return "int" + std::to_string(width <= 8 ? 8 : width <= 16 ? 16 : width <= 32 ? 32 : 64) + "_t";
+        if (width > 128)
+            cerr << "GenerateCpp: " << bsvtype->to_string() << " is truncated to 128 bits" << endl;
+        return "bsvsim::int128_t";
+    }
+    if (width <= 8)
+        return "uint8_t";
+    if (width <= 16)
+        return "uint16_t";
+    if (width <= 32)
+        return "uint32_t";
+    if (width <= 64)
+        return "uint64_t";
+    if (width > 128)
+        cerr << "GenerateCpp: " << bsvtype->to_string() << " is truncated to 128 bits" << endl;
+    return "bsvsim::uint128_t";
+}
+
+// expr truncated to the width of bsvtype, for stores into narrower fields
+void GenerateCpp::generateTruncated(const shared_ptr<Expr> &expr, const shared_ptr<BSVType> &bsvtype) {
+    int width = bsvtype ? bsvtype->bitWidth() : 0;
+    if (!width) {
+        generateCpp(expr);
+        return;
+    }
+    if (isExactWidth(width) || width > 128) {
+        out << "(" << cppType(bsvtype) << ")(";
+        generateCpp(expr);
+        out << ")";
+        return;
+    }
+    out << (bsvtype->name == "Int" ? "bsvsim::signExtend<" : "bsvsim::truncate<") << width << ">(("
+        << cppType(bsvtype) << ")(";
+    generateCpp(expr);
+    out << "))";
+}
+
+void GenerateCpp::collectRegisterWrites(const shared_ptr<Stmt> &stmt) {
+    if (!stmt)
+        return;
+    switch (stmt->stmtType) {
+        case RegWriteStmtType: {
+            const string &regName = static_pointer_cast<RegWriteStmt>(stmt)->regName;
+            if (find(writtenRegisters.begin(), writtenRegisters.end(), regName) == writtenRegisters.end())
+                writtenRegisters.push_back(regName);
+        }
+            break;
+        case BlockStmtType: {
+            shared_ptr<BlockStmt> blockStmt = static_pointer_cast<BlockStmt>(stmt);
+            for (size_t i = 0; i < blockStmt->stmts.size(); i++)
+                collectRegisterWrites(blockStmt->stmts[i]);
+        }
+            break;
+        case IfStmtType:
+            collectRegisterWrites(static_pointer_cast<IfStmt>(stmt)->thenStmt);
+            collectRegisterWrites(static_pointer_cast<IfStmt>(stmt)->elseStmt);
+            break;
+        case ForStmtType:
+            collectRegisterWrites(static_pointer_cast<ForStmt>(stmt)->body);
+            break;
+        case WhileStmtType:
+            collectRegisterWrites(static_pointer_cast<WhileStmt>(stmt)->body);
+            break;
+        default:
+            break;
+    }
+}
+
+// Registers are written through a copy that is committed at the end, so
+// that the rule or method reads the values from before it started.
+void GenerateCpp::generateBody(const vector<shared_ptr<Stmt>> &stmts, int depth) {
+    writtenRegisters.clear();
+    for (size_t i = 0; i < stmts.size(); i++)
+        collectRegisterWrites(stmts[i]);
+    for (size_t i = 0; i < writtenRegisters.size(); i++) {
+        indent(out, depth);
+        out << cppType(registers[writtenRegisters[i]]) << " " << cppName(writtenRegisters[i]) << "__next = "
+            << cppName(writtenRegisters[i]) << ";" << endl;
+    }
+    for (size_t i = 0; i < stmts.size(); i++)
+        generateCpp(stmts[i], depth);
+    generateCommit(depth);
+}
+
+void GenerateCpp::generateCommit(int depth) {
+    for (size_t i = 0; i < writtenRegisters.size(); i++) {
+        indent(out, depth);
+        out << cppName(writtenRegisters[i]) << " = " << cppName(writtenRegisters[i]) << "__next;" << endl;
+    }
+}
+
+void GenerateCpp::defaultStmt(const shared_ptr<Stmt> &stmt, int depth) {
+    cerr << "GenerateCpp: unhandled statement at " << stmt->sourcePos.toString() << endl;
+    indent(out, depth);
+    out << "#error \"unhandled statement at " << stmt->sourcePos.toString() << "\"" << endl;
+}
+
+void GenerateCpp::visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt, int depth) {
+    indent(out, depth);
+    out << cppType(stmt->bsvtype) << " " << cppName(stmt->name) << " = ";
+    generateTruncated(stmt->rhs, stmt->bsvtype);
+    out << ";" << endl;
+}
+
+void GenerateCpp::visitBlockStmt(const shared_ptr<BlockStmt> &stmt, int depth) {
+    indent(out, depth);
+    out << "{" << endl;
+    for (size_t i = 0; i < stmt->stmts.size(); i++)
+        generateCpp(stmt->stmts[i], depth + 1);
+    indent(out, depth);
+    out << "}" << endl;
+}
+
+void GenerateCpp::visitCallStmt(const shared_ptr<CallStmt> &stmt, int depth) {
+    indent(out, depth);
+    generateCpp(stmt->rhs);
+    out << ";" << endl;
+}
+
+void GenerateCpp::visitExprStmt(const shared_ptr<ExprStmt> &stmt, int depth) {
+    indent(out, depth);
+    generateCpp(stmt->expr);
+    out << ";" << endl;
+}
+
+void GenerateCpp::visitForStmt(const shared_ptr<ForStmt> &stmt, int depth) {
+    indent(out, depth);
+    out << "{" << endl;
+    for (size_t i = 0; i < stmt->init.size(); i++)
+        generateCpp(stmt->init[i], depth + 1);
+    indent(out, depth + 1);
+    out << "for (; ";
+    generateCpp(stmt->test);
+    out << "; ) {" << endl;
+    generateCpp(stmt->body, depth + 2);
+    for (size_t i = 0; i < stmt->incr.size(); i++)
+        generateCpp(stmt->incr[i], depth + 2);
+    indent(out, depth + 1);
+    out << "}" << endl;
+    indent(out, depth);
+    out << "}" << endl;
+}
+
+void GenerateCpp::visitFunctionDefStmt(const shared_ptr<FunctionDefStmt> &stmt, int depth) {
+    indent(out, depth);
+    out << (depth ? "" : "static inline ") << cppType(stmt->returnType) << " " << cppName(stmt->name) << "(";
+    for (size_t i = 0; i < stmt->params.size(); i++)
+        out << (i ? ", " : "") << cppType(stmt->paramTypes[i]) << " " << cppName(stmt->params[i]);
+    out << ") {" << endl;
+    vector<string> savedWrittenRegisters = writtenRegisters;
+    writtenRegisters.clear();
+    for (size_t i = 0; i < stmt->stmts.size(); i++)
+        generateCpp(stmt->stmts[i], depth + 1);
+    writtenRegisters = savedWrittenRegisters;
+    indent(out, depth);
+    out << "}" << endl << endl;
+}
+
+void GenerateCpp::visitIfStmt(const shared_ptr<IfStmt> &stmt, int depth) {
+    indent(out, depth);
+    out << "if (";
+    generateCpp(stmt->condition);
+    out << ") {" << endl;
+    generateCpp(stmt->thenStmt, depth + 1);
+    if (stmt->elseStmt) {
+        indent(out, depth);
+        out << "} else {" << endl;
+        generateCpp(stmt->elseStmt, depth + 1);
+    }
+    indent(out, depth);
+    out << "}" << endl;
+}
+
+void GenerateCpp::visitImportStmt(const shared_ptr<ImportStmt> &stmt, int depth) {
+    out << "// import " << stmt->name << endl;
+}
+
+void GenerateCpp::visitInterfaceDeclStmt(const shared_ptr<InterfaceDeclStmt> &stmt, int depth) {
+    // the methods are members of the module classes
+}
+
+void GenerateCpp::visitMethodDefStmt(const shared_ptr<MethodDefStmt> &stmt, int depth) {
+    string name = cppName(stmt->name);
+    if (stmt->guard) {
+        indent(out, depth);
+        out << "bool " << name << "__ready() const { return ";
+        generateCpp(stmt->guard);
+        out << "; }" << endl;
+    }
+    indent(out, depth);
+    out << cppType(stmt->returnType) << " " << name << "(";
+    for (size_t i = 0; i < stmt->params.size(); i++)
+        out << (i ? ", " : "") << cppType(stmt->paramTypes[i]) << " " << cppName(stmt->params[i]);
+    out << ") {" << endl;
+    generateBody(stmt->stmts, depth + 1);
+    writtenRegisters.clear();
+    indent(out, depth);
+    out << "}" << endl;
+}
+
+void GenerateCpp::visitModuleDefStmt(const shared_ptr<ModuleDefStmt> &stmt, int depth) {
+    registers.clear();
+    string name = cppName(stmt->name);
+    out << "// module " << stmt->name << " at " << stmt->sourcePos.toString() << endl;
+    out << "class " << name << " {" << endl;
+    out << "public:" << endl;
+    indent(out, 1);
+    out << "long cycle = 0;" << endl;
+    indent(out, 1);
+    out << "bool finished = false;" << endl;
+
+    // registers and module level bindings first, they are the fields
+    vector<shared_ptr<RegisterStmt>> registerStmts;
+    vector<shared_ptr<RuleDefStmt>> rules;
+    for (size_t i = 0; i < stmt->stmts.size(); i++) {
+        shared_ptr<Stmt> moduleStmt = stmt->stmts[i];
+        if (moduleStmt->stmtType == RegisterStmtType)
+            registerStmts.push_back(static_pointer_cast<RegisterStmt>(moduleStmt));
+        if (moduleStmt->stmtType == RuleDefStmtType)
+            rules.push_back(static_pointer_cast<RuleDefStmt>(moduleStmt));
+        if (moduleStmt->stmtType == RegisterStmtType || moduleStmt->stmtType == VarBindingStmtType
+            || moduleStmt->stmtType == ModuleInstStmtType)
+            generateCpp(moduleStmt, 1);
+    }
+    out << endl;
+    for (size_t i = 0; i < stmt->stmts.size(); i++) {
+        shared_ptr<Stmt> moduleStmt = stmt->stmts[i];
+        if (moduleStmt->stmtType != RegisterStmtType && moduleStmt->stmtType != VarBindingStmtType
+            && moduleStmt->stmtType != ModuleInstStmtType)
+            generateCpp(moduleStmt, 1);
+    }
+
+    // the static schedule: the rules in declaration order, one at a time
+    indent(out, 1);
+    out << "// returns the number of rules fired" << endl;
+    indent(out, 1);
+    out << "int step() {" << endl;
+    indent(out, 2);
+    out << "int fired = 0;" << endl;
+    for (size_t i = 0; i < rules.size(); i++) {
+        string ruleName = cppName(rules[i]->name);
+        indent(out, 2);
+        out << "if (!finished && guard_" << ruleName << "()) {" << endl;
+        indent(out, 3);
+        out << "rule_" << ruleName << "();" << endl;
+        indent(out, 3);
+        out << "fired++;" << endl;
+        indent(out, 2);
+        out << "}" << endl;
+    }
+    indent(out, 2);
+    out << "if (fired)" << endl;
+    indent(out, 3);
+    out << "cycle++;" << endl;
+    indent(out, 2);
+    out << "return fired;" << endl;
+    indent(out, 1);
+    out << "}" << endl << endl;
+
+    indent(out, 1);
+    out << "void traceVars(bsvsim::VcdWriter &vcd) {" << endl;
+    for (size_t i = 0; i < registerStmts.size(); i++) {
+        indent(out, 2);
+        out << "vcdIds[" << i << "] = vcd.var(\"" << registerStmts[i]->regName << "\", "
+            << traceWidth(registerStmts[i]->elementType) << ");" << endl;
+    }
+    indent(out, 1);
+    out << "}" << endl << endl;
+    indent(out, 1);
+    out << "void trace(bsvsim::VcdWriter &vcd) {" << endl;
+    for (size_t i = 0; i < registerStmts.size(); i++) {
+        if (!traceWidth(registerStmts[i]->elementType))
+            continue;
+        indent(out, 2);
+        out << "vcd.value(vcdIds[" << i << "], (bsvsim::uint128_t)" << cppName(registerStmts[i]->regName) << ");"
+            << endl;
+    }
+    indent(out, 1);
+    out << "}" << endl << endl;
+
+    indent(out, 1);
+    out << "// runs until maxCycles, $finish or a cycle in which no rule can fire" << endl;
+    indent(out, 1);
+    out << "long run(long maxCycles, bsvsim::VcdWriter *vcd = nullptr) {" << endl;
+    indent(out, 2);
+    out << "if (vcd) {" << endl;
+    indent(out, 3);
+    out << "traceVars(*vcd);" << endl;
+    indent(out, 3);
+    out << "vcd->endDefinitions();" << endl;
+    indent(out, 2);
+    out << "}" << endl;
+    indent(out, 2);
+    out << "while (cycle < maxCycles && !finished) {" << endl;
+    indent(out, 3);
+    out << "if (vcd) {" << endl;
+    indent(out, 4);
+    out << "vcd->time(cycle);" << endl;
+    indent(out, 4);
+    out << "trace(*vcd);" << endl;
+    indent(out, 3);
+    out << "}" << endl;
+    indent(out, 3);
+    out << "if (!step())" << endl;
+    indent(out, 4);
+    out << "break;" << endl;
+    indent(out, 2);
+    out << "}" << endl;
+    indent(out, 2);
+    out << "if (vcd) {" << endl;
+    indent(out, 3);
+    out << "vcd->time(cycle);" << endl;
+    indent(out, 3);
+    out << "trace(*vcd);" << endl;
+    indent(out, 3);
+    out << "vcd->flush();" << endl;
+    indent(out, 2);
+    out << "}" << endl;
+    indent(out, 2);
+    out << "return cycle;" << endl;
+    indent(out, 1);
+    out << "}" << endl << endl;
+
+    out << "private:" << endl;
+    indent(out, 1);
+    out << "int vcdIds[" << max((size_t)1, registerStmts.size()) << "];" << endl;
+    out << "};" << endl << endl;
+    registers.clear();
+}
+
+void GenerateCpp::visitModuleInstStmt(const shared_ptr<ModuleInstStmt> &stmt, int depth) {
+    cerr << "GenerateCpp: instance " << stmt->name << " at " << stmt->sourcePos.toString()
+         << " is not simulated" << endl;
+    indent(out, depth);
+    out << "// instance " << stmt->name << " of " << stmt->interfaceType->to_string() << " is not simulated" << endl;
+}
+
+void GenerateCpp::visitRegisterStmt(const shared_ptr<RegisterStmt> &stmt, int depth) {
+    registers[stmt->regName] = stmt->elementType;
+    indent(out, depth);
+    // the simplified AST does not keep the reset values
+    out << cppType(stmt->elementType) << " " << cppName(stmt->regName) << " = 0;" << endl;
+}
+
+void GenerateCpp::visitRegReadStmt(const shared_ptr<RegReadStmt> &stmt, int depth) {
+    indent(out, depth);
+    out << cppType(stmt->varType) << " " << cppName(stmt->var) << " = " << cppName(stmt->regName) << ";" << endl;
+}
+
+void GenerateCpp::visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt, int depth) {
+    indent(out, depth);
+    out << cppName(stmt->regName) << "__next = ";
+    auto it = registers.find(stmt->regName);
+    generateTruncated(stmt->rhs, it != registers.cend() ? it->second : stmt->elementType);
+    out << ";" << endl;
+}
+
+void GenerateCpp::visitReturnStmt(const shared_ptr<ReturnStmt> &stmt, int depth) {
+    indent(out, depth);
+    if (writtenRegisters.empty()) {
+        out << "return ";
+        generateCpp(stmt->value);
+        out << ";" << endl;
+        return;
+    }
+    // ActionValue methods commit their writes before returning
+    out << "{" << endl;
+    indent(out, depth + 1);
+    out << "auto result = ";
+    generateCpp(stmt->value);
+    out << ";" << endl;
+    generateCommit(depth + 1);
+    indent(out, depth + 1);
+    out << "return result;" << endl;
+    indent(out, depth);
+    out << "}" << endl;
+}
+
+void GenerateCpp::visitRuleDefStmt(const shared_ptr<RuleDefStmt> &stmt, int depth) {
+    string name = cppName(stmt->name);
+    indent(out, depth);
+    out << "bool guard_" << name << "() const { return ";
+    if (stmt->guard)
+        generateCpp(stmt->guard);
+    else
+        out << "true";
+    out << "; }" << endl;
+    indent(out, depth);
+    out << "void rule_" << name << "() {" << endl;
+    generateBody(stmt->stmts, depth + 1);
+    writtenRegisters.clear();
+    indent(out, depth);
+    out << "}" << endl << endl;
+}
+
+void GenerateCpp::visitTypedefSynonymStmt(const shared_ptr<TypedefSynonymStmt> &stmt, int depth) {
+    // uses of the synonym are already resolved by the type checker
+}
+
+void GenerateCpp::visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt, int depth) {
+    shared_ptr<VarLValue> varLValue = stmt->lhs->varLValue();
+    if (!varLValue) {
+        defaultStmt(stmt, depth);
+        return;
+    }
+    indent(out, depth);
+    out << cppName(varLValue->name) << " " << stmt->op << " ";
+    generateTruncated(stmt->rhs, varLValue->bsvtype);
+    out << ";" << endl;
+}
+
+void GenerateCpp::visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt, int depth) {
+    indent(out, depth);
+    out << cppType(stmt->bsvtype) << " " << cppName(stmt->name) << " = ";
+    generateTruncated(stmt->rhs, stmt->bsvtype);
+    out << ";" << endl;
+}
+
+void GenerateCpp::visitWhileStmt(const shared_ptr<WhileStmt> &stmt, int depth) {
+    indent(out, depth);
+    out << "while (";
+    generateCpp(stmt->test);
+    out << ") {" << endl;
+    generateCpp(stmt->body, depth + 1);
+    indent(out, depth);
+    out << "}" << endl;
+}
+
+void GenerateCpp::defaultExpr(const shared_ptr<Expr> &expr) {
+    cerr << "GenerateCpp: unhandled expression at " << expr->sourcePos.toString() << endl;
+    out << "/* unhandled: ";
+    expr->prettyPrint(out, 0);
+    out << " */ 0";
+}
+
+void GenerateCpp::visitBitConcatExpr(const shared_ptr<BitConcatExpr> &expr) {
+    // concat(concat(a, b, width(b)), c, width(c))
+    for (size_t i = 1; i < expr->values.size(); i++)
+        out << "bsvsim::concat(";
+    for (size_t i = 0; i < expr->values.size(); i++) {
+        const shared_ptr<Expr> &value = expr->values[i];
+        if (i == 0) {
+            out << "(bsvsim::uint128_t)";
+            generateCpp(value);
+            continue;
+        }
+        int width = value->bsvtype ? value->bsvtype->bitWidth() : 0;
+        if (!width)
+            cerr << "GenerateCpp: unknown width in concatenation at " << expr->sourcePos.toString() << endl;
+        out << ", ";
+        generateCpp(value);
+        out << ", " << width << ")";
+    }
+}
+
+void GenerateCpp::visitBitSelExpr(const shared_ptr<BitSelExpr> &expr) {
+    out << "bsvsim::bits(";
+    generateCpp(expr->value);
+    out << ", ";
+    generateCpp(expr->msb);
+    out << ", ";
+    generateCpp(expr->lsb ? expr->lsb : expr->msb);
+    out << ")";
+}
+
+void GenerateCpp::visitCallExpr(const shared_ptr<CallExpr> &expr) {
+    shared_ptr<VarExpr> function = expr->function->varExpr();
+    if (!function) {
+        defaultExpr(expr);
+        return;
+    }
+    const string &name = function->name;
+    if (name == "$display" || name == "$write") {
+        size_t firstArg = 0;
+        out << "bsvsim::display(" << (name == "$display" ? "true" : "false") << ", ";
+        if (expr->args.size() && expr->args[0]->exprType == StringConstType) {
+            generateCpp(expr->args[0]);
+            firstArg = 1;
+        } else {
+            out << "nullptr";
+        }
+        out << ", {";
+        for (size_t i = firstArg; i < expr->args.size(); i++) {
+            const shared_ptr<Expr> &arg = expr->args[i];
+            shared_ptr<BSVType> argType = valueType(arg);
+            out << (i > firstArg ? ", " : "");
+            if (arg->exprType == StringConstType || (argType && argType->name == "String")) {
+                generateCpp(arg);
+            } else if (isSigned(argType)) {
+                int width = argType->name == "Integer" ? 64 : min(argType->bitWidth(), 128);
+                out << "bsvsim::DisplayArg((bsvsim::uint128_t)(";
+                generateCpp(arg);
+                out << "), " << (width ? width : 64) << ")";
+            } else {
+                out << "(bsvsim::uint128_t)(";
+                generateCpp(arg);
+                out << ")";
+            }
+        }
+        out << "})";
+        return;
+    }
+    if (name == "$finish") {
+        out << "(finished = true)";
+        return;
+    }
+    if (name == "dynamicAssert" && expr->args.size() == 2) {
+        out << "bsvsim::dynamicAssert(";
+        generateCpp(expr->args[0]);
+        out << ", ";
+        generateCpp(expr->args[1]);
+        out << ", \"" << expr->sourcePos.toString() << "\")";
+        return;
+    }
+    if ((name == "pack" || name == "zeroExtend") && expr->args.size() == 1) {
+        // the bits of an Int#(n), without the sign extension it is held with
+        shared_ptr<BSVType> argType = valueType(expr->args[0]);
+        int width = argType && argType->name == "Int" ? argType->bitWidth() : 0;
+        if (width && width < 128) {
+            out << "bsvsim::bits((bsvsim::uint128_t)(";
+            generateCpp(expr->args[0]);
+            out << "), " << width - 1 << ", 0)";
+            return;
+        }
+    }
+    if ((name == "pack" || name == "unpack" || name == "zeroExtend" || name == "extend" || name == "truncate")
+        && expr->args.size() == 1) {
+        // the value is converted where it is stored
+        out << "(";
+        generateCpp(expr->args[0]);
+        out << ")";
+        return;
+    }
+    if (name == "signExtend" && expr->args.size() == 1) {
+        int width = expr->args[0]->bsvtype ? expr->args[0]->bsvtype->bitWidth() : 0;
+        if (width && width < 64) {
+            out << "(int64_t)((uint64_t)(";
+            generateCpp(expr->args[0]);
+            out << ") << " << (64 - width) << ") >> " << (64 - width);
+            return;
+        }
+    }
+    out << cppName(name) << "(";
+    for (size_t i = 0; i < expr->args.size(); i++) {
+        if (i)
+            out << ", ";
+        generateCpp(expr->args[i]);
+    }
+    out << ")";
+}
+
+void GenerateCpp::visitCondExpr(const shared_ptr<CondExpr> &expr) {
+    out << "(";
+    generateCpp(expr->cond);
+    out << " ? ";
+    generateCpp(expr->thenExpr);
+    out << " : ";
+    generateCpp(expr->elseExpr);
+    out << ")";
+}
+
+void GenerateCpp::visitIntConst(const shared_ptr<IntConst> &expr) {
+    BitVector bits = BitVector::fromString(expr->repr, 64);
+    if (bits.getWidth() <= 64) {
+        out << "0x" << bits.toString(16) << "ull";
+        return;
+    }
+    BitVector high = (bits >> 64).truncate(64);
+    out << "(((bsvsim::uint128_t)0x" << high.toString(16) << "ull << 64) | 0x"
+        << bits.truncate(64).toString(16) << "ull)";
+}
+
+// C++ computes in int or wider, so the operands of sized values are widened
+// to 64 or 128 bits, signed for Int#(n), and the results of arithmetic are
+// truncated back to the width of the operands.
+void GenerateCpp::visitOperatorExpr(const shared_ptr<OperatorExpr> &expr) {
+    const string &op = expr->op;
+    bool shift = op == "<<" || op == ">>";
+    shared_ptr<BSVType> resultType = valueType(expr);
+    shared_ptr<BSVType> operandType = isComparison(op) ? valueType(expr->lhs) : resultType;
+    if (isComparison(op) && !operandType)
+        operandType = valueType(expr->rhs);
+    int width = operandType ? operandType->bitWidth() : 0;
+    bool isSignedOp = isSigned(operandType);
+    string operandCast;
+    if (width || (isSignedOp && (isComparison(op) || op == "/" || op == "%" || op == ">>")))
+        operandCast = width > 64 ? (isSignedOp ? "(bsvsim::int128_t)" : "(bsvsim::uint128_t)")
+                                 : (isSignedOp ? "(int64_t)" : "(uint64_t)");
+    bool truncated = width && !isComparison(op) && op != "&&" && op != "||" && op != "!";
+    if (truncated) {
+        if (isExactWidth(width) || width > 128)
+            out << "(" << cppType(resultType) << ")";
+        else
+            out << (isSignedOp ? "bsvsim::signExtend<" : "bsvsim::truncate<") << width << ">((" << cppType(resultType)
+                << ")";
+    }
+    out << "(";
+    if (!expr->rhs) {
+        out << op << operandCast << "(";
+        generateCpp(expr->lhs);
+        out << ")";
+    } else {
+        out << operandCast << "(";
+        generateCpp(expr->lhs);
+        out << ") " << op << " " << (shift ? "" : operandCast) << "(";
+        generateCpp(expr->rhs);
+        out << ")";
+    }
+    out << ")";
+    if (truncated && !isExactWidth(width) && width <= 128)
+        out << ")";
+}
+
+void GenerateCpp::visitStringConst(const shared_ptr<StringConst> &expr) {
+    out << "\"";
+    for (size_t i = 0; i < expr->repr.size(); i++) {
+        char c = expr->repr[i];
+        if (c == '"' || c == '\\')
+            out << '\\';
+        out << c;
+    }
+    out << "\"";
+}
+
+void GenerateCpp::visitValueofExpr(const shared_ptr<ValueofExpr> &expr) {
+    shared_ptr<BSVType> argtype = expr->argtype->eval();
+    if (!argtype->isNumeric()) {
+        defaultExpr(expr);
+        return;
+    }
+    out << argtype->numericValue();
+}
+
+void GenerateCpp::visitVarExpr(const shared_ptr<VarExpr> &expr) {
+    if (expr->name == "True" || expr->name == "False") {
+        out << (expr->name == "True" ? "true" : "false");
+        return;
+    }
+    out << cppName(expr->name);
+}
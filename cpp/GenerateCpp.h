@@ -0,0 +1,92 @@
+#pragma once
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AstDispatch.h"
+#include "BSVType.h"
+#include "Expr.h"
+#include "Stmt.h"
+
+using namespace std;
+
+// Generates a standalone C++ simulator from a flattened, simplified
+// package, see Inliner.
+//
+// Each module becomes a class with a field per register, a guard and a
+// body function per rule and a member function per method. step() fires
+// the rules in declaration order, one at a time, like the Interpreter, and
+// run() optionally traces the registers to a VCD file. The runtime support
+// is written into the generated file, so it only needs the system compiler:
+//
+//   g++ -O2 -DBSVSIM_TOP=mkTop -o sim sim/Package.cpp
+//   ./sim [cycles] [trace.vcd]
+//
+// Values of up to 64 bits are held in the standard integer types and values
+// of up to 128 bits in unsigned __int128. Int#(n) is held sign extended in
+// the signed types, and arithmetic is truncated to the width of its operands.
+class GenerateCpp : public StmtDispatcher<GenerateCpp, void, int>,
+                    public ExprDispatcher<GenerateCpp, void> {
+    string filename;
+    ofstream out;
+    // registers of the module being generated, by name
+    map<string, shared_ptr<BSVType>> registers;
+    // registers written by the rule or method being generated
+    vector<string> writtenRegisters;
+
+public:
+    GenerateCpp() {}
+    ~GenerateCpp() {}
+
+    void open(const string &filename);
+    void close();
+
+    void generateStmts(const vector<shared_ptr<Stmt>> &stmts);
+    void generateCpp(const shared_ptr<Stmt> &stmt, int depth = 0);
+    void generateCpp(const shared_ptr<Expr> &expr);
+
+    void defaultStmt(const shared_ptr<Stmt> &stmt, int depth);
+    void visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt, int depth);
+    void visitBlockStmt(const shared_ptr<BlockStmt> &stmt, int depth);
+    void visitCallStmt(const shared_ptr<CallStmt> &stmt, int depth);
+    void visitExprStmt(const shared_ptr<ExprStmt> &stmt, int depth);
+    void visitForStmt(const shared_ptr<ForStmt> &stmt, int depth);
+    void visitFunctionDefStmt(const shared_ptr<FunctionDefStmt> &stmt, int depth);
+    void visitIfStmt(const shared_ptr<IfStmt> &stmt, int depth);
+    void visitImportStmt(const shared_ptr<ImportStmt> &stmt, int depth);
+    void visitInterfaceDeclStmt(const shared_ptr<InterfaceDeclStmt> &stmt, int depth);
+    void visitMethodDefStmt(const shared_ptr<MethodDefStmt> &stmt, int depth);
+    void visitModuleDefStmt(const shared_ptr<ModuleDefStmt> &stmt, int depth);
+    void visitModuleInstStmt(const shared_ptr<ModuleInstStmt> &stmt, int depth);
+    void visitRegisterStmt(const shared_ptr<RegisterStmt> &stmt, int depth);
+    void visitRegReadStmt(const shared_ptr<RegReadStmt> &stmt, int depth);
+    void visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt, int depth);
+    void visitReturnStmt(const shared_ptr<ReturnStmt> &stmt, int depth);
+    void visitRuleDefStmt(const shared_ptr<RuleDefStmt> &stmt, int depth);
+    void visitTypedefSynonymStmt(const shared_ptr<TypedefSynonymStmt> &stmt, int depth);
+    void visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt, int depth);
+    void visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt, int depth);
+    void visitWhileStmt(const shared_ptr<WhileStmt> &stmt, int depth);
+
+    void defaultExpr(const shared_ptr<Expr> &expr);
+    void visitBitConcatExpr(const shared_ptr<BitConcatExpr> &expr);
+    void visitBitSelExpr(const shared_ptr<BitSelExpr> &expr);
+    void visitCallExpr(const shared_ptr<CallExpr> &expr);
+    void visitCondExpr(const shared_ptr<CondExpr> &expr);
+    void visitIntConst(const shared_ptr<IntConst> &expr);
+    void visitOperatorExpr(const shared_ptr<OperatorExpr> &expr);
+    void visitStringConst(const shared_ptr<StringConst> &expr);
+    void visitValueofExpr(const shared_ptr<ValueofExpr> &expr);
+    void visitVarExpr(const shared_ptr<VarExpr> &expr);
+
+private:
+    string cppType(const shared_ptr<BSVType> &bsvtype);
+    void generateTruncated(const shared_ptr<Expr> &expr, const shared_ptr<BSVType> &bsvtype);
+    void generateBody(const vector<shared_ptr<Stmt>> &stmts, int depth);
+    void generateCommit(int depth);
+    void collectRegisterWrites(const shared_ptr<Stmt> &stmt);
+};
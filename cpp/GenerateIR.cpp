@@ -43,55 +43,12 @@ void GenerateIR::generateIR(const vector<shared_ptr<Stmt>> &stmts, int depth) {
 }
 
 void GenerateIR::generateIR(const shared_ptr<Stmt> &stmt, int depth) {
-    if (shared_ptr<ActionBindingStmt> actionBindingStmt = stmt->actionBindingStmt()) {
-        generateIR(actionBindingStmt, depth);
-    } else if (shared_ptr<VarBindingStmt> varBindingStmt = stmt->varBindingStmt()) {
-        generateIR(varBindingStmt, depth);
-    } else if (shared_ptr<BlockStmt> blockStmt = stmt->blockStmt()) {
-        generateIR(blockStmt, depth);
-    } else if (shared_ptr<ExprStmt> exprStmt = stmt->exprStmt()) {
-        generateIR(exprStmt, depth);
-    } else if (shared_ptr<IfStmt> ifStmt = stmt->ifStmt()) {
-        generateIR(ifStmt, depth);
-    } else if (shared_ptr<ImportStmt> importStmt = stmt->importStmt()) {
-        generateIR(importStmt, depth);
-    } else if (shared_ptr<InterfaceDeclStmt> interfaceDeclStmt = stmt->interfaceDeclStmt()) {
-        generateIR(interfaceDeclStmt, depth);
-    } else if (shared_ptr<MethodDeclStmt> methodDeclStmt = stmt->methodDeclStmt()) {
-        generateIR(methodDeclStmt, depth);
-    } else if (shared_ptr<MethodDefStmt> methodDefStmt = stmt->methodDefStmt()) {
-        generateIR(methodDefStmt, depth);
-    } else if (shared_ptr<ModuleDefStmt> moduleDefStmt = stmt->moduleDefStmt()) {
-        generateIR(moduleDefStmt, depth);
-    } else if (shared_ptr<RegWriteStmt> regWriteStmt = stmt->regWriteStmt()) {
-        generateIR(regWriteStmt, depth);
-    } else if (shared_ptr<ReturnStmt> returnStmt = stmt->returnStmt()) {
-        generateIR(returnStmt, depth);
-    } else if (shared_ptr<RuleDefStmt> ruleDefStmt = stmt->ruleDefStmt()) {
-        generateIR(ruleDefStmt, depth);
-    } else if (shared_ptr<TypedefStructStmt> typedefStructStmt = stmt->typedefStructStmt()) {
-        generateIR(typedefStructStmt, depth);
-    } else if (shared_ptr<TypedefSynonymStmt> typedefSynonymStmt = stmt->typedefSynonymStmt()) {
-        generateIR(typedefSynonymStmt, depth);
-    }
+    dispatchStmt(stmt, depth);
 }
 
 void GenerateIR::generateIR(const shared_ptr<Expr> &expr, int depth, int precedence) {
-    if (shared_ptr<FieldExpr> fieldExpr = expr->fieldExpr()) {
-        generateIR(fieldExpr, depth);
-    } else if (shared_ptr<VarExpr> varExpr = expr->varExpr()) {
-        generateIR(varExpr, depth);
-    } else if (shared_ptr<CallExpr> callExpr = expr->callExpr()) {
-        generateIR(callExpr, depth);
-    } else if (shared_ptr<IntConst> intConst = expr->intConst()) {
-        generateIR(intConst, depth);
-    } else if (shared_ptr<OperatorExpr> operatorExpr = expr->operatorExpr()) {
-        generateIR(operatorExpr, depth);
-    } else if (shared_ptr<ArraySubExpr> arraySubExpr = expr->arraySubExpr()) {
-        generateIR(arraySubExpr, depth);
-    } else if (shared_ptr<EnumUnionStructExpr> enumUnionStructExpr = expr->enumUnionStructExpr()) {
-        generateIR(enumUnionStructExpr, depth);
-    }
+    //FIXME: precedence, the operator handlers do not pass it down yet
+    dispatchExpr(expr, depth, 0);
 }
 
 void GenerateIR::generateIR(const shared_ptr<BSVType> &bsvtype, int depth) {
@@ -108,7 +65,7 @@ void GenerateIR::generateIR(const shared_ptr<BSVType> &bsvtype, int depth) {
 }
 
 
-void GenerateIR::generateIR(const shared_ptr<ActionBindingStmt> &stmt, int depth) {
+void GenerateIR::visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt, int depth) {
     indent(out, 4 * depth);
     generateIR(stmt->bsvtype, depth);
     out << " " << stmt->name << " <- ";
@@ -116,20 +73,20 @@ void GenerateIR::generateIR(const shared_ptr<ActionBindingStmt> &stmt, int depth
     out << endl;
 }
 
-void GenerateIR::generateIR(const shared_ptr<BlockStmt> &stmt, int depth) {
+void GenerateIR::visitBlockStmt(const shared_ptr<BlockStmt> &stmt, int depth) {
     out << "{" << endl;
     generateIR(stmt->stmts, depth + 1);
     indent(out, 4 * depth);
     out << "}" << endl;
 }
 
-void GenerateIR::generateIR(const shared_ptr<ExprStmt> &stmt, int depth) {
+void GenerateIR::visitExprStmt(const shared_ptr<ExprStmt> &stmt, int depth) {
     indent(out, 4 * depth);
     generateIR(stmt->expr, depth + 1);
     out << ":" << endl;
 }
 
-void GenerateIR::generateIR(const shared_ptr<IfStmt> &stmt, int depth) {
+void GenerateIR::visitIfStmt(const shared_ptr<IfStmt> &stmt, int depth) {
     indent(out, 4 * depth);
     out << "if (";
     generateIR(stmt->condition, depth);
@@ -141,11 +98,11 @@ void GenerateIR::generateIR(const shared_ptr<IfStmt> &stmt, int depth) {
     out << endl;
 }
 
-void GenerateIR::generateIR(const shared_ptr<ImportStmt> &stmt, int depth) {
+void GenerateIR::visitImportStmt(const shared_ptr<ImportStmt> &stmt, int depth) {
 
 }
 
-void GenerateIR::generateIR(const shared_ptr<InterfaceDeclStmt> &stmt, int depth) {
+void GenerateIR::visitInterfaceDeclStmt(const shared_ptr<InterfaceDeclStmt> &stmt, int depth) {
     indent(out, 4 * depth);
     out << "INTERFACE " << stmt->name << " {" << endl;
     for (size_t i = 0; i < stmt->decls.size(); i++) {
@@ -155,7 +112,7 @@ void GenerateIR::generateIR(const shared_ptr<InterfaceDeclStmt> &stmt, int depth
     out << "}" << endl;
 }
 
-void GenerateIR::generateIR(const shared_ptr<MethodDeclStmt> &stmt, int depth) {
+void GenerateIR::visitMethodDeclStmt(const shared_ptr<MethodDeclStmt> &stmt, int depth) {
     indent(out, 4 * depth);
     out << "METHOD";
     if (stmt->returnType->name == "Action")
@@ -178,7 +135,7 @@ void GenerateIR::generateIR(const shared_ptr<MethodDeclStmt> &stmt, int depth) {
     out << endl;
 }
 
-void GenerateIR::generateIR(const shared_ptr<MethodDefStmt> &stmt, int depth) {
+void GenerateIR::visitMethodDefStmt(const shared_ptr<MethodDefStmt> &stmt, int depth) {
     indent(out, 4 * depth);
     out << "METHOD";
     if (stmt->returnType->name == "Action")
@@ -215,7 +172,7 @@ void GenerateIR::generateIR(const shared_ptr<MethodDefStmt> &stmt, int depth) {
     out << "}" << endl;
 }
 
-void GenerateIR::generateIR(const shared_ptr<ModuleDefStmt> &stmt, int depth) {
+void GenerateIR::visitModuleDefStmt(const shared_ptr<ModuleDefStmt> &stmt, int depth) {
     indent(out, 4 * depth);
     out << "MODULE " << stmt->name << " {" << endl;
     for (size_t i = 0; i < stmt->params.size(); i++) {
@@ -244,18 +201,18 @@ void GenerateIR::generateIR(const shared_ptr<ModuleDefStmt> &stmt, int depth) {
     out << "}" << endl;
 }
 
-void GenerateIR::generateIR(const shared_ptr<RegWriteStmt> &stmt, int depth) {
+void GenerateIR::visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt, int depth) {
     indent(out, 4 * depth);
     out << "STORE :" << stmt->regName << " = ";
     generateIR(stmt->rhs);
     out << endl;
 }
 
-void GenerateIR::generateIR(const shared_ptr<ReturnStmt> &stmt, int depth) {
+void GenerateIR::visitReturnStmt(const shared_ptr<ReturnStmt> &stmt, int depth) {
 
 }
 
-void GenerateIR::generateIR(const shared_ptr<RuleDefStmt> &stmt, int depth) {
+void GenerateIR::visitRuleDefStmt(const shared_ptr<RuleDefStmt> &stmt, int depth) {
     indent(out, 4 * depth);
     out << "METHOD/Rule/Action RULE$" << stmt->name;
     if (stmt->guard) {
@@ -277,7 +234,7 @@ void GenerateIR::generateIR(const shared_ptr<RuleDefStmt> &stmt, int depth) {
     out << "}" << endl;
 }
 
-void GenerateIR::generateIR(const shared_ptr<TypedefStructStmt> &stmt, int depth) {
+void GenerateIR::visitTypedefStructStmt(const shared_ptr<TypedefStructStmt> &stmt, int depth) {
     indent(out, 4 * depth);
     out << "STRUCT " << stmt->name << " {" << endl;
     indent(out, 4 * depth);
@@ -290,11 +247,11 @@ void GenerateIR::generateIR(const shared_ptr<TypedefStructStmt> &stmt, int depth
     out << "}" << endl;
 }
 
-void GenerateIR::generateIR(const shared_ptr<TypedefSynonymStmt> &stmt, int depth) {
+void GenerateIR::visitTypedefSynonymStmt(const shared_ptr<TypedefSynonymStmt> &stmt, int depth) {
 
 }
 
-void GenerateIR::generateIR(const shared_ptr<VarBindingStmt> &stmt, int depth) {
+void GenerateIR::visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt, int depth) {
     indent(out, 4 * depth);
     //generateIR(stmt->bsvtype, depth);
     out << stmt->name << " = ";
@@ -302,16 +259,16 @@ void GenerateIR::generateIR(const shared_ptr<VarBindingStmt> &stmt, int depth) {
     out << endl;
 }
 
-void GenerateIR::generateIR(const shared_ptr<FieldExpr> &expr, int depth, int level) {
+void GenerateIR::visitFieldExpr(const shared_ptr<FieldExpr> &expr, int depth, int level) {
     generateIR(expr->object, depth, 0);
     out << "." << expr->fieldName;
 }
 
-void GenerateIR::generateIR(const shared_ptr<VarExpr> &expr, int depth, int level) {
+void GenerateIR::visitVarExpr(const shared_ptr<VarExpr> &expr, int depth, int level) {
     out << expr->name;
 }
 
-void GenerateIR::generateIR(const shared_ptr<CallExpr> &expr, int depth, int level) {
+void GenerateIR::visitCallExpr(const shared_ptr<CallExpr> &expr, int depth, int level) {
     generateIR(expr->function, depth, 0);
     out << "(";
     for (size_t i = 0; i < expr->args.size(); i++) {
@@ -322,7 +279,7 @@ void GenerateIR::generateIR(const shared_ptr<CallExpr> &expr, int depth, int lev
     out << ")";
 }
 
-void GenerateIR::generateIR(const shared_ptr<IntConst> &expr, int depth, int level) {
+void GenerateIR::visitIntConst(const shared_ptr<IntConst> &expr, int depth, int level) {
     //FIXME: base
     if (expr->base && expr->base != 10)
         out << std::hex;
@@ -331,7 +288,7 @@ void GenerateIR::generateIR(const shared_ptr<IntConst> &expr, int depth, int lev
         out << std::dec;
 }
 
-void GenerateIR::generateIR(const shared_ptr<OperatorExpr> &expr, int depth, int level) {
+void GenerateIR::visitOperatorExpr(const shared_ptr<OperatorExpr> &expr, int depth, int level) {
     //FIXME: precedence
     int op_precedence = op_precedences.find(expr->op)->second;
     if (op_precedence > level)
@@ -347,14 +304,14 @@ void GenerateIR::generateIR(const shared_ptr<OperatorExpr> &expr, int depth, int
         out << ")";
 }
 
-void GenerateIR::generateIR(const shared_ptr<ArraySubExpr> &expr, int depth, int level) {
+void GenerateIR::visitArraySubExpr(const shared_ptr<ArraySubExpr> &expr, int depth, int level) {
     generateIR(expr->array, depth, 0);
     out << "[";
     generateIR(expr->index, depth, 0);
     out << "]";
 }
 
-void GenerateIR::generateIR(const shared_ptr<EnumUnionStructExpr> &expr, int depth, int level) {
+void GenerateIR::visitEnumUnionStructExpr(const shared_ptr<EnumUnionStructExpr> &expr, int depth, int level) {
     out << expr->tag;
     //FIXME: keys and values, struct vs union
     if (expr->keys.size()) {
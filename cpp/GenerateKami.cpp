@@ -2,6 +2,7 @@
 // Created by Jamey Hicks on 10/28/19.
 //
 
+#include <algorithm>
 #include <assert.h>
 #include <sstream>
 #include "GenerateKami.h"
@@ -23,60 +24,142 @@ GenerateKami::GenerateKami() {
 
 }
 
+static const string prelude[] = {
+        "Require Import Bool String List.",
+        "Require Import Lib.CommonTactics Lib.ilist Lib.Word.",
+        "Require Import Lib.Struct Lib.FMap Lib.StringEq Lib.Indexer.",
+        "Require Import Kami.Syntax Kami.Semantics Kami.RefinementFacts Kami.Renaming Kami.Wf.",
+        "Require Import Kami.Renaming Kami.Inline Kami.InlineFacts.",
+        "Require Import Kami.Decomposition Kami.Notations Kami.Tactics.",
+        "Require Import Kami.PrimFifo.",
+        "Require Import Init.Nat.",
+        "Require Import Bsvtokami."
+        "",
+        "Require Import Ex.MemTypes.",
+        "",
+        "Set Implicit Arguments.",
+        "Definition Int := Bit.",
+        "Open Scope string.",
+        ""
+};
+
 void GenerateKami::open(const string &filename) {
     this->filename = filename;
-    logstream << "Opening Kami file " << filename << endl;
-    out.open(filename);
+    size_t slash = filename.rfind('/');
+    dirname = slash == string::npos ? string(".") : filename.substr(0, slash);
+    packageName = slash == string::npos ? filename : filename.substr(slash + 1);
+    if (packageName.size() > 2 && packageName.substr(packageName.size() - 2) == ".v")
+        packageName = packageName.substr(0, packageName.size() - 2);
     logstream.open(filename + string(".kami.log"), ostream::out);
-
-    string prelude[] = {
-            "Require Import Bool String List.",
-            "Require Import Lib.CommonTactics Lib.ilist Lib.Word.",
-            "Require Import Lib.Struct Lib.FMap Lib.StringEq Lib.Indexer.",
-            "Require Import Kami.Syntax Kami.Semantics Kami.RefinementFacts Kami.Renaming Kami.Wf.",
-            "Require Import Kami.Renaming Kami.Inline Kami.InlineFacts.",
-            "Require Import Kami.Decomposition Kami.Notations Kami.Tactics.",
-            "Require Import Kami.PrimFifo.",
-            "Require Import Init.Nat.",
-            "Require Import Bsvtokami."
-            "",
-            "Require Import Ex.MemTypes.",
-            "",
-            "Set Implicit Arguments.",
-            "Definition Int := Bit.",
-            "Open Scope string.",
-            ""
-    };
-    for (size_t i = 0; i < sizeof(prelude) / sizeof(string); i++) {
-        out << prelude[i] << endl;
-    }
+    logstream << "Opening Kami file " << filename << endl;
 }
 
 void GenerateKami::close() {
     logstream << "Closing Kami file " << filename << endl;
-    out.close();
     logstream.close();
 }
 
 void GenerateKami::generateStmts(std::vector<shared_ptr<struct Stmt>> stmts, int depth) {
-    std::vector<shared_ptr<struct Stmt>> sortedStmts = stmts; //sortStmts(stmts);
-    for (int i = 0; i < sortedStmts.size(); i++) {
-        shared_ptr<Stmt> stmt = sortedStmts[i];
-        generateKami(stmt, depth);
-        out << endl;
+    // each module goes in a file of its own, the rest of the package in <package>_Defs.v,
+    // and <package>.v re-exports them; a package without modules stays in <package>.v
+    vector<KamiFile> kamiFiles(1);
+    kamiFiles[0].name = packageName;
+    for (size_t i = 0; i < stmts.size(); i++) {
+        if (stmts[i]->stmtType == ModuleDefStmtType) {
+            KamiFile kamiFile;
+            kamiFile.name = packageName + "_" + stmts[i]->moduleDefStmt()->name;
+            kamiFile.stmts.push_back(stmts[i]);
+            kamiFiles.push_back(kamiFile);
+        } else {
+            kamiFiles[0].stmts.push_back(stmts[i]);
+        }
+    }
+    if (kamiFiles.size() > 1)
+        kamiFiles[0].name = packageName + "_Defs";
+
+    map<string, size_t> definingFile;
+    for (size_t i = 0; i < kamiFiles.size(); i++) {
+        KamiFile &kamiFile = kamiFiles[i];
+        structDeclNames.clear();
+        for (size_t j = 0; j < kamiFile.stmts.size(); j++) {
+            shared_ptr<Stmt> stmt = kamiFile.stmts[j];
+            out.str("");
+            structDecls.clear();
+            generateKami(stmt, depth);
+            out << endl;
+            kamiFile.decls.insert(kamiFile.decls.end(), structDecls.cbegin(), structDecls.cend());
+            KamiDecl decl{out.str(), definedNames(stmt), set<string>()};
+            for (auto it = decl.defines.cbegin(); it != decl.defines.cend(); ++it)
+                definingFile[*it] = i;
+            kamiFile.decls.push_back(decl);
+        }
+        for (size_t j = 0; j < kamiFile.decls.size(); j++)
+            kamiFile.decls[j].uses = referencedNames(kamiFile.decls[j].text);
     }
+
+    Graph g(kamiFiles.size());
+    for (size_t i = 0; i < kamiFiles.size(); i++) {
+        KamiFile &kamiFile = kamiFiles[i];
+        for (size_t j = 0; j < kamiFile.decls.size(); j++) {
+            const set<string> &uses = kamiFile.decls[j].uses;
+            for (auto it = uses.cbegin(); it != uses.cend(); ++it) {
+                auto defining = definingFile.find(*it);
+                if (defining == definingFile.cend() || defining->second == i)
+                    continue;
+                if (kamiFile.requires.insert(kamiFiles[defining->second].name).second)
+                    g.addEdge(defining->second, i);
+            }
+        }
+    }
+    vector<int> order;
+    if (!g.topologicalSort(order)) {
+        vector<vector<int>> cycles = g.cycles();
+        for (size_t i = 0; i < cycles.size(); i++) {
+            cerr << "Kami files of package " << packageName << " require each other:";
+            for (size_t j = 0; j < cycles[i].size(); j++)
+                cerr << " " << kamiFiles[cycles[i][j]].name;
+            cerr << endl;
+        }
+    }
+
+    vector<KamiFile> sortedFiles;
+    set<string> written;
+    for (size_t i = 0; i < order.size(); i++) {
+        KamiFile &kamiFile = kamiFiles[order[i]];
+        for (auto it = kamiFile.requires.begin(); it != kamiFile.requires.end(); ) {
+            if (written.count(*it)) {
+                ++it;
+                continue;
+            }
+            cerr << "Kami file " << kamiFile.name << " cannot require " << *it << " which requires it" << endl;
+            it = kamiFile.requires.erase(it);
+        }
+        kamiFile.decls = sortDecls(kamiFile.decls);
+        writeKamiFile(kamiFile);
+        written.insert(kamiFile.name);
+        sortedFiles.push_back(kamiFile);
+    }
+    if (kamiFiles.size() > 1) {
+        KamiFile packageFile;
+        packageFile.name = packageName;
+        for (size_t i = 0; i < sortedFiles.size(); i++)
+            packageFile.exports.push_back(sortedFiles[i].name);
+        writeKamiFile(packageFile);
+        sortedFiles.push_back(packageFile);
+    }
+    writeCoqProject(sortedFiles);
 }
 
 void GenerateKami::generateModuleStmt(const shared_ptr<struct Stmt> &stmt, int depth, vector<shared_ptr<Stmt>> &actionStmts) {
     switch (stmt->stmtType) {
         case MethodDefStmtType:
-            generateModuleStmt(stmt->methodDefStmt(), depth, actionStmts);
+            generateModuleStmt(static_pointer_cast<MethodDefStmt>(stmt), depth, actionStmts);
             break;
         case RegisterStmtType:
-            generateModuleStmt(stmt->registerStmt(), depth, actionStmts);
+            generateModuleStmt(static_pointer_cast<RegisterStmt>(stmt), depth, actionStmts);
             break;
         case RuleDefStmtType:
-            generateModuleStmt(stmt->ruleDefStmt(), depth, actionStmts);
+            generateModuleStmt(static_pointer_cast<RuleDefStmt>(stmt), depth, actionStmts);
             break;
         default:
             out << "(* unhandled module stmt type " << stmt->stmtType << " at " << stmt->sourcePos.toString() << endl;
@@ -116,9 +199,12 @@ void GenerateKami::generateModuleStmt(const shared_ptr<MethodDefStmt> &methoddef
         generateKami(actionStmts[i], depth + 1);
         out << endl;
     }
+    commonSubexprs.analyze(shared_ptr<Expr>(), methoddef->stmts);
+    sharingExprs = true;
     int num_stmts = methoddef->stmts.size();
     for (int i = 0; i < num_stmts; i++) {
         shared_ptr<Stmt> stmt = methoddef->stmts[i];
+        generateSharedExprs(i + 1, depth + 1);
         generateKami(stmt, depth + 1);
         if (i < num_stmts - 1) {
             //out << ";";
@@ -126,6 +212,8 @@ void GenerateKami::generateModuleStmt(const shared_ptr<MethodDefStmt> &methoddef
         out << endl;
     }
 
+    sharingExprs = false;
+
     if (returnPending.size()) {
         indent(out, depth + 1);
         out << returnPending << endl;
@@ -154,7 +242,10 @@ void GenerateKami::generateModuleStmt(const shared_ptr<class RuleDefStmt> & rule
         generateKami(actionStmts[i], depth + 1);
         out << endl;
     }
+    commonSubexprs.analyze(ruledef->guard, ruledef->stmts);
+    sharingExprs = true;
     if (ruledef->guard) {
+        generateSharedExprs(0, depth + 1);
         indent(out, depth + 1);
         out << "Assert(";
         generateKami(ruledef->guard);
@@ -164,12 +255,14 @@ void GenerateKami::generateModuleStmt(const shared_ptr<class RuleDefStmt> & rule
     int num_stmts = ruledef->stmts.size();
     for (int i = 0; i < num_stmts; i++) {
         shared_ptr<Stmt> stmt = ruledef->stmts[i];
+        generateSharedExprs(i + 1, depth + 1);
         generateKami(stmt, depth + 1);
         if (i < num_stmts - 1) {
             //out << ";";
         }
         out << endl;
     }
+    sharingExprs = false;
     if (returnPending.size()) {
         indent(out, depth);
         out << returnPending << endl;
@@ -196,186 +289,151 @@ void GenerateKami::generateModuleStmt(const shared_ptr<VarBindingStmt> &stmt, in
 }
 
 void GenerateKami::generateKami(const shared_ptr<Stmt> &stmt, int depth) {
-    switch (stmt->stmtType) {
-        case ActionBindingStmtType:
-            generateKami(stmt->actionBindingStmt(), depth);
-            break;
-        case VarBindingStmtType:
-            generateKami(stmt->varBindingStmt(), depth);
-            break;
-        case BlockStmtType:
-            generateKami(stmt->blockStmt(), depth);
-            break;
-        case CallStmtType:
-            generateKami(stmt->callStmt(), depth);
-            break;
-        case ExprStmtType:
-            generateKami(stmt->exprStmt(), depth);
-            break;
-        case FunctionDefStmtType:
-            generateKami(stmt->functionDefStmt(), depth);
-            break;
-        case IfStmtType:
-            generateKami(stmt->ifStmt(), depth);
-            break;
-        case ImportStmtType:
-            generateKami(stmt->importStmt(), depth);
-            break;
-        case InterfaceDeclStmtType:
-            generateKami(stmt->interfaceDeclStmt(), depth);
-            break;
-        case InterfaceDefStmtType:
-            out << "(* interfaceDefStmt: " << endl;
-            stmt->interfaceDefStmt()->prettyPrint(out, 1);
-            out << "*)" << endl;
-            break;
-        case MethodDeclStmtType:
-            generateKami(stmt->methodDeclStmt(), depth);
-            break;
-        case MethodDefStmtType:
-            generateKami(stmt->methodDefStmt(), depth);
-            break;
-        case ModuleDefStmtType:
-            generateKami(stmt->moduleDefStmt(), depth);
-            break;
-        case PatternMatchStmtType:
-            out << "(* PatternMatchStmt" << endl;
-            stmt->patternMatchStmt()->prettyPrint(out, 1);
-            out << "*)" << endl;
-            break;
-        case RegReadStmtType:
-            generateKami(stmt->regReadStmt(), depth);
-            break;
-        case RegWriteStmtType:
-            generateKami(stmt->regWriteStmt(), depth);
-            break;
-        case ReturnStmtType:
-            generateKami(stmt->returnStmt(), depth);
-            break;
-        case TypedefEnumStmtType:
-            generateKami(stmt->typedefEnumStmt(), depth);
-            break;
-        case TypedefStructStmtType:
-            generateKami(stmt->typedefStructStmt(), depth);
-            break;
-        case TypedefSynonymStmtType:
-            generateKami(stmt->typedefSynonymStmt(), depth);
-            break;
-        case VarAssignStmtType:
-            generateKami(stmt->varAssignStmt(), depth);
-            break;
-        case PackageDefStmtType:
-            out << "(* Package: " << stmt->packageDefStmt()->name << " *)";
-            break;
-        case ModuleInstStmtType:
-            generateKami(stmt->moduleInstStmt(), depth);
-            break;
-        case RegisterStmtType:
-        case RuleDefStmtType:
-        case InvalidStmtType:
-            assert(0);
+    dispatchStmt(stmt, depth);
+}
+
+// binds the expressions first shared by top-level statement stmtIndex of a rule or method, see CommonSubexprs
+void GenerateKami::generateSharedExprs(size_t stmtIndex, int depth) {
+    commonSubexprs.enterStmt(stmtIndex);
+    vector<CommonSubexprs::Shared> bindings = commonSubexprs.bindingsBefore(stmtIndex);
+    for (size_t i = 0; i < bindings.size(); i++) {
+        indent(out, depth);
+        out << "LET " << bindings[i].name << " <- ";
+        dispatchExpr(bindings[i].expr, depth + 1, 100);
+        out << " ;" << endl;
     }
 }
 
+void GenerateKami::defaultStmt(const shared_ptr<Stmt> &stmt, int depth) {
+    // RegisterStmt and RuleDefStmt are handled by generateModuleStmt
+    assert(0);
+}
+
+void GenerateKami::visitInterfaceDefStmt(const shared_ptr<InterfaceDefStmt> &stmt, int depth) {
+    out << "(* interfaceDefStmt: " << endl;
+    stmt->prettyPrint(out, 1);
+    out << "*)" << endl;
+}
+
+// loops with static bounds are unrolled by the Elaborator
+void GenerateKami::visitForStmt(const shared_ptr<ForStmt> &stmt, int depth) {
+    out << "(* unelaborated ForStmt" << endl;
+    stmt->prettyPrint(out, 1);
+    out << "*)" << endl;
+}
+
+void GenerateKami::visitWhileStmt(const shared_ptr<WhileStmt> &stmt, int depth) {
+    out << "(* unelaborated WhileStmt" << endl;
+    stmt->prettyPrint(out, 1);
+    out << "*)" << endl;
+}
+
+void GenerateKami::visitPatternMatchStmt(const shared_ptr<PatternMatchStmt> &stmt, int depth) {
+    out << "(* PatternMatchStmt" << endl;
+    stmt->prettyPrint(out, 1);
+    out << "*)" << endl;
+}
+
+void GenerateKami::visitPackageDefStmt(const shared_ptr<PackageDefStmt> &stmt, int depth) {
+    out << "(* Package: " << stmt->name << " *)";
+}
+
 void GenerateKami::generateKami(const shared_ptr<Expr> &expr, int depth, int precedence) {
-    switch (expr->exprType) {
-        case InvalidExprType:
-            return;
-        case ArraySubExprType: {
-            shared_ptr<ArraySubExpr> arraySubExpr = expr->arraySubExpr();
-            generateKami(arraySubExpr->array, depth+1, 0);
-            out << " @[ ";
-            generateKami(arraySubExpr->index, depth + 1, 0);
-            out << " ]";
-        } return;
-        case BitSelExprType: {
-            shared_ptr<BitSelExpr> bitSelExpr = expr->bitSelExpr();
-            assert(bitSelExpr->lsb);
-            generateKami(bitSelExpr->value, depth+1, 0);
-            out << " @[ ";
-            generateKami(bitSelExpr->msb, depth + 1, 0);
-            out << " : ";
-            generateKami(bitSelExpr->lsb, depth + 1, 0);
-            out << " ]";
-            out << " $width"; // fixme
-        } return;
-        case BitConcatExprType: {
-            shared_ptr<BitConcatExpr> bitConcatExpr = expr->bitConcatExpr();
-            out << "{ ";
-            for (int i = 0; i < bitConcatExpr->values.size(); i++) {
-                if (i > 0)
-                    out << ", ";
-                generateKami(bitConcatExpr->values[i], depth + 1);
-            }
-            out << " }";
-        } return;
-        case CallExprType:
-            generateKami(expr->callExpr(), depth, precedence);
+    if (sharingExprs && expr) {
+        string sharedName = commonSubexprs.sharedName(expr);
+        if (sharedName.size()) {
+            out << "#" << sharedName;
             return;
-        case CondExprType: {
-            shared_ptr<CondExpr> condExpr = expr->condExpr();
-            out << endl;
-            indent(out, depth);
-            out << "(IF ";
-            generateKami(condExpr->cond, depth + 1);
-            out << " then ";
-            generateKami(condExpr->thenExpr, depth + 1);
-            out << " else ";
-            generateKami(condExpr->elseExpr, depth + 1);
-            out << ")";
-        } return;
-        case EnumUnionStructExprType: {
-            shared_ptr<EnumUnionStructExpr> tagExpr = expr->enumUnionStructExpr();
-            out << "(* tagged ";
-            if (tagExpr->bsvtype)
-                out << tagExpr->bsvtype->to_string();
-            out << " *)" << tagExpr->tag;
-        } return;
-        case FieldExprType:
-            generateKami(expr->fieldExpr(), depth, precedence);
-            return;
-        case MethodExprType:
-            generateKami(expr->methodExpr(), depth, precedence);
-            return;
-        case SubinterfaceExprType:
-            generateKami(expr->subinterfaceExpr(), depth, precedence);
-            return;
-        case IntConstType:
-            out << "$" << expr->intConst()->value;
-            return;
-        case OperatorExprType:
-            generateKami(expr->operatorExpr(), depth, precedence);
-            return;
-        case VarExprType:
-            generateKami(expr->varExpr(), depth, precedence);
-            return;
-        case CaseExprType:
-        case MatchesExprType:
-            out << "Unflattened " << expr->exprType << " { ";
-            expr->prettyPrint(out, depth);
-            out << " }";
-            break;
-        case StringConstType:
-            out << "\"" << expr->stringConst()->repr << "\"";
-            break;
-        case InterfaceExprType:
-            out << "Unimplemented " << expr->exprType << " { ";
-            expr->prettyPrint(out, depth);
-            out << " }";
-            break;
-        case ValueofExprType: {
-            shared_ptr<ValueofExpr> valueof = expr->valueofExpr();
-            shared_ptr<BSVType> argtype = valueof->argtype;
-            if (argtype->name == "Numeric") {
-                out << argtype->params[0]->to_string();
-            } else {
-                out << "Unimplemented " << expr->exprType << " { ";
-                expr->prettyPrint(out, depth);
-                out << " }";
-            }
-            break;
         }
     }
+    dispatchExpr(expr, depth, precedence);
+}
+
+void GenerateKami::defaultExpr(const shared_ptr<Expr> &expr, int depth, int precedence) {
+}
+
+void GenerateKami::visitArraySubExpr(const shared_ptr<ArraySubExpr> &arraySubExpr, int depth, int precedence) {
+    generateKami(arraySubExpr->array, depth+1, 0);
+    out << " @[ ";
+    generateKami(arraySubExpr->index, depth + 1, 0);
+    out << " ]";
+}
+
+void GenerateKami::visitBitSelExpr(const shared_ptr<BitSelExpr> &bitSelExpr, int depth, int precedence) {
+    assert(bitSelExpr->lsb);
+    generateKami(bitSelExpr->value, depth+1, 0);
+    out << " @[ ";
+    generateKami(bitSelExpr->msb, depth + 1, 0);
+    out << " : ";
+    generateKami(bitSelExpr->lsb, depth + 1, 0);
+    out << " ]";
+    out << " $width"; // fixme
+}
+
+void GenerateKami::visitBitConcatExpr(const shared_ptr<BitConcatExpr> &bitConcatExpr, int depth, int precedence) {
+    out << "{ ";
+    for (int i = 0; i < bitConcatExpr->values.size(); i++) {
+        if (i > 0)
+            out << ", ";
+        generateKami(bitConcatExpr->values[i], depth + 1);
+    }
+    out << " }";
+}
+
+void GenerateKami::visitCondExpr(const shared_ptr<CondExpr> &condExpr, int depth, int precedence) {
+    out << endl;
+    indent(out, depth);
+    out << "(IF ";
+    generateKami(condExpr->cond, depth + 1);
+    out << " then ";
+    generateKami(condExpr->thenExpr, depth + 1);
+    out << " else ";
+    generateKami(condExpr->elseExpr, depth + 1);
+    out << ")";
+}
+
+void GenerateKami::visitEnumUnionStructExpr(const shared_ptr<EnumUnionStructExpr> &tagExpr, int depth, int precedence) {
+    out << "(* tagged ";
+    if (tagExpr->bsvtype)
+        out << tagExpr->bsvtype->to_string();
+    out << " *)" << tagExpr->tag;
+}
+
+void GenerateKami::visitIntConst(const shared_ptr<IntConst> &expr, int depth, int precedence) {
+    out << "$" << expr->value;
+}
+
+void GenerateKami::visitCaseExpr(const shared_ptr<CaseExpr> &expr, int depth, int precedence) {
+    out << "Unflattened " << expr->exprType << " { ";
+    expr->prettyPrint(out, depth);
+    out << " }";
+}
+
+void GenerateKami::visitMatchesExpr(const shared_ptr<MatchesExpr> &expr, int depth, int precedence) {
+    out << "Unflattened " << expr->exprType << " { ";
+    expr->prettyPrint(out, depth);
+    out << " }";
+}
+
+void GenerateKami::visitStringConst(const shared_ptr<StringConst> &expr, int depth, int precedence) {
+    out << "\"" << expr->repr << "\"";
+}
+
+void GenerateKami::visitInterfaceExpr(const shared_ptr<InterfaceExpr> &expr, int depth, int precedence) {
+    out << "Unimplemented " << expr->exprType << " { ";
+    expr->prettyPrint(out, depth);
+    out << " }";
+}
+
+void GenerateKami::visitValueofExpr(const shared_ptr<ValueofExpr> &valueof, int depth, int precedence) {
+    shared_ptr<BSVType> argtype = valueof->argtype;
+    if (argtype->name == "Numeric") {
+        out << argtype->params[0]->to_string();
+    } else {
+        out << "Unimplemented " << valueof->exprType << " { ";
+        valueof->prettyPrint(out, depth);
+        out << " }";
+    }
 }
 
 void GenerateKami::generateCoqType(const shared_ptr<BSVType> &bsvtype, int depth) {
@@ -421,14 +479,14 @@ void GenerateKami::generateKami(const shared_ptr<BSVType> &bsvtype, int depth) {
         out << ")";
 }
 
-void GenerateKami::generateKami(const shared_ptr<ModuleInstStmt> &stmt, int depth) {
+void GenerateKami::visitModuleInstStmt(const shared_ptr<ModuleInstStmt> &stmt, int depth) {
     indent(out, depth);
     out << "(* ";
     stmt->prettyPrint(out, depth + 1);
     out << " *);" << endl;
 }
 
-void GenerateKami::generateKami(const shared_ptr<ActionBindingStmt> &actionbinding, int depth) {
+void GenerateKami::visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &actionbinding, int depth) {
     shared_ptr<BSVType> bsvtype = actionbinding->bsvtype;
     if (bsvtype && bsvtype->name == "Reg") {
         indent(out, depth);
@@ -445,7 +503,7 @@ void GenerateKami::generateKami(const shared_ptr<ActionBindingStmt> &actionbindi
     }
 }
 
-void GenerateKami::generateKami(const shared_ptr<BlockStmt> &blockstmt, int depth) {
+void GenerateKami::visitBlockStmt(const shared_ptr<BlockStmt> &blockstmt, int depth) {
     int num_stmts = blockstmt->stmts.size();
     indent(out, depth);
     out << "(* block " << blockstmt->sourcePos.toString() << " *)" << endl;
@@ -461,7 +519,7 @@ void GenerateKami::generateKami(const shared_ptr<BlockStmt> &blockstmt, int dept
 
 }
 
-void GenerateKami::generateKami(const shared_ptr<CallStmt> &callStmt, int depth) {
+void GenerateKami::visitCallStmt(const shared_ptr<CallStmt> &callStmt, int depth) {
     indent(out, depth);
     out << "Call " << callStmt->name << " : ";
     generateKami(callStmt->interfaceType, depth + 1);
@@ -470,14 +528,14 @@ void GenerateKami::generateKami(const shared_ptr<CallStmt> &callStmt, int depth)
     out << " ;" << endl;
 }
 
-void GenerateKami::generateKami(const shared_ptr<ExprStmt> &stmt, int depth) {
+void GenerateKami::visitExprStmt(const shared_ptr<ExprStmt> &stmt, int depth) {
     indent(out, depth);
     out << "(* expr " << stmt->expr->exprType << " *) ";
     generateKami(stmt->expr, depth + 1);
 }
 
 
-void GenerateKami::generateKami(const shared_ptr<FunctionDefStmt> &functiondef, int depth) {
+void GenerateKami::visitFunctionDefStmt(const shared_ptr<FunctionDefStmt> &functiondef, int depth) {
     indent(out, depth);
     out << "(* function def " << functiondef->name << " at " << functiondef->sourcePos.toString() << " *)" << endl;
     returnPending = "Retv";
@@ -505,8 +563,8 @@ void GenerateKami::generateKami(const shared_ptr<FunctionDefStmt> &functiondef,
     indent(out, depth); out << ")%kami_action." << endl;
 }
 
-void GenerateKami::generateKami(const shared_ptr<IfStmt> &stmt, int depth) {
-    map<string,shared_ptr<BSVType>> assignedVars = stmt->attrs().assignedVars;
+void GenerateKami::visitIfStmt(const shared_ptr<IfStmt> &stmt, int depth) {
+    map<string,shared_ptr<BSVType>> assignedVars = stmt->attrs().assignedVars.byName();
     returnPending = "Retv";
 
     indent(out, depth);
@@ -564,7 +622,7 @@ void GenerateKami::generateKami(const shared_ptr<IfStmt> &stmt, int depth) {
     out << endl;
     indent(out, depth);
     out << ") as retval ;" << endl;
-    string structfields = formatStructDecl(assignedVars);
+    string structfields = assignedVars.size() ? structDeclName(assignedVars) : string();
     int i = 0;
     for (auto it = assignedVars.cbegin(); it != assignedVars.cend(); ++it, i++) {
         indent(out, depth);
@@ -575,19 +633,19 @@ void GenerateKami::generateKami(const shared_ptr<IfStmt> &stmt, int depth) {
     returnPending = "Ret #retval";
 }
 
-void GenerateKami::generateKami(const shared_ptr<ImportStmt> &stmt, int depth) {
+void GenerateKami::visitImportStmt(const shared_ptr<ImportStmt> &stmt, int depth) {
     out << "(* Require Import " << stmt->name << ". *)" << endl;
 }
 
-void GenerateKami::generateKami(const shared_ptr<InterfaceDeclStmt> &stmt, int depth) {
+void GenerateKami::visitInterfaceDeclStmt(const shared_ptr<InterfaceDeclStmt> &stmt, int depth) {
     out << "(* interface decl " << stmt->name << " *)" << endl;
 }
 
-void GenerateKami::generateKami(const shared_ptr<MethodDeclStmt> &stmt, int depth) {
+void GenerateKami::visitMethodDeclStmt(const shared_ptr<MethodDeclStmt> &stmt, int depth) {
     out << "(* method decl " << stmt->name << " *)" << endl;
 }
 
-void GenerateKami::generateKami(const shared_ptr<MethodDefStmt> &method, int depth) {
+void GenerateKami::visitMethodDefStmt(const shared_ptr<MethodDefStmt> &method, int depth) {
     returnPending = "Retv";
     out << "(* method def " << method->name << " *)" << endl;
     indent(out, depth);
@@ -599,7 +657,10 @@ void GenerateKami::generateKami(const shared_ptr<MethodDefStmt> &method, int dep
         out << ") ";
     }
     out << " := " << endl;
+    commonSubexprs.analyze(method->guard, method->stmts);
+    sharingExprs = true;
     if (method->guard) {
+        generateSharedExprs(0, depth + 1);
         indent(out, depth + 1);
         out << "Assert(";
         generateKami(method->guard);
@@ -607,15 +668,17 @@ void GenerateKami::generateKami(const shared_ptr<MethodDefStmt> &method, int dep
         out << endl;
     }
     for (int i = 0; i < method->stmts.size(); i++) {
+        generateSharedExprs(i + 1, depth + 1);
         generateKami(method->stmts[i], depth + 1);
     }
+    sharingExprs = false;
     if (returnPending.size()) {
         indent(out, depth + 1);
         out << returnPending << endl;
     }
 }
 
-void GenerateKami::generateKami(const shared_ptr<ModuleDefStmt> &moduledef, int depth) {
+void GenerateKami::visitModuleDefStmt(const shared_ptr<ModuleDefStmt> &moduledef, int depth) {
     bool enclosingActionContext = actionContext;
     actionContext = true;
     instanceNames.clear();
@@ -680,7 +743,7 @@ void GenerateKami::generateKami(const shared_ptr<ModuleDefStmt> &moduledef, int
     actionContext = enclosingActionContext;
 }
 
-void GenerateKami::generateKami(const shared_ptr<RegReadStmt> &regread, int depth) {
+void GenerateKami::visitRegReadStmt(const shared_ptr<RegReadStmt> &regread, int depth) {
     indent(out, depth);
     out << "Read "<< regread->var << " : ";
     generateKami(regread->varType, depth + 1);
@@ -688,7 +751,7 @@ void GenerateKami::generateKami(const shared_ptr<RegReadStmt> &regread, int dept
     out << " ;";
 }
 
-void GenerateKami::generateKami(const shared_ptr<RegWriteStmt> &regwrite, int depth) {
+void GenerateKami::visitRegWriteStmt(const shared_ptr<RegWriteStmt> &regwrite, int depth) {
     indent(out, depth);
     out << "Write \"" << regwrite->regName << "\" : ";
     //FIXME: placeholder for type
@@ -698,7 +761,7 @@ void GenerateKami::generateKami(const shared_ptr<RegWriteStmt> &regwrite, int de
     out << " ;";
 }
 
-void GenerateKami::generateKami(const shared_ptr<ReturnStmt> &stmt, int depth) {
+void GenerateKami::visitReturnStmt(const shared_ptr<ReturnStmt> &stmt, int depth) {
     returnPending = string();
 
     indent(out, depth);
@@ -709,7 +772,7 @@ void GenerateKami::generateKami(const shared_ptr<ReturnStmt> &stmt, int depth) {
 }
 
 
-void GenerateKami::generateKami(const shared_ptr<TypedefEnumStmt> &stmt, int depth) {
+void GenerateKami::visitTypedefEnumStmt(const shared_ptr<TypedefEnumStmt> &stmt, int depth) {
     logstream << "typedef enum " << stmt->enumType->to_string() << endl;
     indent(out, depth);
     out << "(* Enum " << stmt->name << " at " << stmt->sourcePos.toString() << " *)" << endl;
@@ -721,7 +784,7 @@ void GenerateKami::generateKami(const shared_ptr<TypedefEnumStmt> &stmt, int dep
     }
 }
 
-void GenerateKami::generateKami(const shared_ptr<TypedefStructStmt> &stmt, int depth) {
+void GenerateKami::visitTypedefStructStmt(const shared_ptr<TypedefStructStmt> &stmt, int depth) {
     logstream << "typedef struct " << stmt->structType->to_string() << endl;
 
     indent(out, depth);
@@ -740,7 +803,7 @@ void GenerateKami::generateKami(const shared_ptr<TypedefStructStmt> &stmt, int d
     out << endl;
 }
 
-void GenerateKami::generateKami(const shared_ptr<TypedefSynonymStmt> &stmt, int depth) {
+void GenerateKami::visitTypedefSynonymStmt(const shared_ptr<TypedefSynonymStmt> &stmt, int depth) {
     indent(out, depth);
     out << "(* typedef synonym " << stmt->type->to_string() << " at " << stmt->sourcePos.toString() << " *)" << endl;
     indent(out, depth);
@@ -753,7 +816,7 @@ void GenerateKami::generateKami(const shared_ptr<TypedefSynonymStmt> &stmt, int
 
 }
 
-void GenerateKami::generateKami(const shared_ptr<VarAssignStmt> &stmt, int depth) {
+void GenerateKami::visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt, int depth) {
     shared_ptr<LValue> lvalue = stmt->lhs;
     switch (lvalue->lvalueType) {
         case ArraySubLValueType: {
@@ -801,7 +864,7 @@ void GenerateKami::generateKami(const shared_ptr<VarAssignStmt> &stmt, int depth
         }
     }
 }
-void GenerateKami::generateKami(const shared_ptr<VarBindingStmt> &stmt, int depth) {
+void GenerateKami::visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt, int depth) {
     indent(out, depth);
     if (actionContext) {
         out << "(* varbinding *) ";
@@ -831,7 +894,7 @@ void GenerateKami::generateKami(const shared_ptr<VarBindingStmt> &stmt, int dept
     }
 }
 
-void GenerateKami::generateKami(const shared_ptr<FieldExpr> &expr, int depth, int precedence) {
+void GenerateKami::visitFieldExpr(const shared_ptr<FieldExpr> &expr, int depth, int precedence) {
     if (!expr->bsvtype) {
         expr->prettyPrint(logstream);
         logstream << endl;
@@ -843,7 +906,7 @@ void GenerateKami::generateKami(const shared_ptr<FieldExpr> &expr, int depth, in
     out << ") @. \"" << expr->fieldName << "\"";
 }
 
-void GenerateKami::generateKami(const shared_ptr<MethodExpr> &expr, int depth, int precedence) {
+void GenerateKami::visitMethodExpr(const shared_ptr<MethodExpr> &expr, int depth, int precedence) {
     logstream << "method expr ";
     expr->object->bsvtype->to_string();
     logstream << " " << expr->methodName << " at " << expr->sourcePos.toString() << endl;
@@ -852,7 +915,7 @@ void GenerateKami::generateKami(const shared_ptr<MethodExpr> &expr, int depth, i
     out << " -- (* method *) \"" << expr->methodName << "\"";
 }
 
-void GenerateKami::generateKami(const shared_ptr<SubinterfaceExpr> &expr, int depth, int precedence) {
+void GenerateKami::visitSubinterfaceExpr(const shared_ptr<SubinterfaceExpr> &expr, int depth, int precedence) {
     logstream << "subinterface expr ";
     expr->object->bsvtype->to_string();
     logstream << " " << expr->subinterfaceName << " at " << expr->sourcePos.toString() << endl;
@@ -861,15 +924,17 @@ void GenerateKami::generateKami(const shared_ptr<SubinterfaceExpr> &expr, int de
     out << " -- (* subinfc *) \"" << expr->subinterfaceName << "\"";
 }
 
-void GenerateKami::generateKami(const shared_ptr<VarExpr> &expr, int depth, int precedence) {
+void GenerateKami::visitVarExpr(const shared_ptr<VarExpr> &expr, int depth, int precedence) {
     if (expr->name == "Undefined") {
         out << "$$Default";
+    } else if (expr->name == "True" || expr->name == "False") {
+        out << "$$" << (expr->name == "True" ? "true" : "false");
     } else {
         out << "#" << expr->name;
     }
 }
 
-void GenerateKami::generateKami(const shared_ptr<CallExpr> &expr, int depth, int precedence) {
+void GenerateKami::visitCallExpr(const shared_ptr<CallExpr> &expr, int depth, int precedence) {
     shared_ptr<Expr> functionExpr = expr->function;
     out << "(MethodSig (";
     generateMethodName(functionExpr);
@@ -933,11 +998,7 @@ void GenerateKami::generateMethodName(const shared_ptr<Expr> &expr) {
     }
 }
 
-void GenerateKami::generateKami(const shared_ptr<IntConst> &expr, int depth, int precedence) {
-    out << expr->value;
-}
-
-void GenerateKami::generateKami(const shared_ptr<OperatorExpr> &expr, int depth, int precedence) {
+void GenerateKami::visitOperatorExpr(const shared_ptr<OperatorExpr> &expr, int depth, int precedence) {
     if (!expr->rhs)
         out << expr->op << " ";
     generateKami(expr->lhs, depth, precedence);
@@ -947,35 +1008,6 @@ void GenerateKami::generateKami(const shared_ptr<OperatorExpr> &expr, int depth,
     }
 }
 
-void GenerateKami::generateKami(const shared_ptr<ArraySubExpr> &expr, int depth, int precedence) {
-    out << "( ";
-    generateKami(expr->array, depth + 1, precedence);
-    out << " ! (* array sub *) ";
-    generateKami(expr->index, depth + 1, precedence);
-    out << " )";
-}
-
-void GenerateKami::generateKami(const shared_ptr<BitSelExpr> &expr, int depth, int precedence) {
-    out << "( ";
-    generateKami(expr->value, depth + 1, precedence);
-    out << " ! (* array sub *) ";
-    generateKami(expr->msb, depth + 1, precedence);
-    out << " , ";
-    generateKami(expr->lsb, depth + 1, precedence);
-    out << " )";
-}
-
-void GenerateKami::generateKami(const shared_ptr<EnumUnionStructExpr> &expr, int depth, int precedence) {
-    out << "STRUCT { ";
-    for (int i = 0; i < expr->keys.size(); i++) {
-        if (i > 0)
-            out << "; ";
-        out << " \"" << expr->keys[i] << " : ";
-        generateKami(expr->vals[i], depth + 1, precedence);
-    }
-    out << " }";
-}
-
 string GenerateKami::callStmtFunctionName(const shared_ptr<CallStmt> &callStmt)
 {
     shared_ptr<Expr> rhs = callStmt->rhs;
@@ -985,10 +1017,181 @@ string GenerateKami::callStmtFunctionName(const shared_ptr<CallStmt> &callStmt)
     return varExpr->name;
 }
 
-std::vector<shared_ptr<struct Stmt>> GenerateKami::sortStmts(vector<shared_ptr<struct Stmt>> stmts) {
-    Graph g(stmts.size());
+// orders the definitions of a file so that each comes after the ones it uses, keeping them in order otherwise
+vector<KamiDecl> GenerateKami::sortDecls(const vector<KamiDecl> &decls) {
+    map<string, size_t> definedBy;
+    for (size_t i = 0; i < decls.size(); i++) {
+        for (auto it = decls[i].defines.cbegin(); it != decls[i].defines.cend(); ++it)
+            definedBy.insert(make_pair(*it, i));
+    }
+
+    Graph g(decls.size());
+    for (size_t i = 0; i < decls.size(); i++) {
+        set<size_t> predecessors;
+        for (auto it = decls[i].uses.cbegin(); it != decls[i].uses.cend(); ++it) {
+            auto defining = definedBy.find(*it);
+            if (defining != definedBy.cend() && defining->second != i)
+                predecessors.insert(defining->second);
+        }
+        for (auto it = predecessors.cbegin(); it != predecessors.cend(); ++it)
+            g.addEdge(*it, i);
+    }
+    vector<int> order;
+    if (!g.topologicalSort(order)) {
+        vector<vector<int>> cycles = g.cycles();
+        for (size_t i = 0; i < cycles.size(); i++) {
+            logstream << "Cyclic definitions in package " << packageName << ":";
+            for (size_t j = 0; j < cycles[i].size(); j++) {
+                const set<string> &defines = decls[cycles[i][j]].defines;
+                if (defines.size())
+                    logstream << " " << *defines.cbegin();
+            }
+            logstream << endl;
+        }
+    }
+
+    vector<KamiDecl> sortedDecls;
+    for (size_t i = 0; i < order.size(); i++)
+        sortedDecls.push_back(decls[order[i]]);
+    return sortedDecls;
+}
+
+// the names a top-level statement defines in the generated Coq
+set<string> GenerateKami::definedNames(const shared_ptr<Stmt> &stmt) {
+    set<string> names;
+    switch (stmt->stmtType) {
+        case FunctionDefStmtType:
+            names.insert(stmt->functionDefStmt()->name);
+            break;
+        case ModuleDefStmtType:
+            names.insert(stmt->moduleDefStmt()->name);
+            names.insert("module'" + stmt->moduleDefStmt()->name);
+            break;
+        case TypedefEnumStmtType: {
+            shared_ptr<TypedefEnumStmt> typedefEnum = stmt->typedefEnumStmt();
+            names.insert(typedefEnum->name);
+            names.insert(typedefEnum->name + "'Fields");
+            names.insert(typedefEnum->members.cbegin(), typedefEnum->members.cend());
+        } break;
+        case TypedefStructStmtType: {
+            shared_ptr<TypedefStructStmt> typedefStruct = stmt->typedefStructStmt();
+            names.insert(typedefStruct->structType->name);
+            names.insert(typedefStruct->structType->name + "'Fields");
+        } break;
+        case TypedefSynonymStmtType:
+            names.insert(stmt->typedefSynonymStmt()->typedeftype->name);
+            break;
+        case VarBindingStmtType:
+            names.insert(stmt->varBindingStmt()->name);
+            break;
+        default:
+            break;
+    }
+    return names;
+}
+
+// the Coq identifiers in text, leaving out strings and comments
+set<string> GenerateKami::referencedNames(const string &text) {
+    set<string> names;
+    int commentDepth = 0;
+    size_t i = 0;
+    while (i < text.size()) {
+        char c = text[i];
+        if (text.compare(i, 2, "(*") == 0) {
+            commentDepth++;
+            i += 2;
+        } else if (commentDepth && text.compare(i, 2, "*)") == 0) {
+            commentDepth--;
+            i += 2;
+        } else if (commentDepth) {
+            i++;
+        } else if (c == '"') {
+            size_t end = text.find('"', i + 1);
+            i = end == string::npos ? text.size() : end + 1;
+        } else if (isalpha(c) || c == '_') {
+            size_t start = i;
+            while (i < text.size() && (isalnum(text[i]) || text[i] == '_' || text[i] == '\''))
+                i++;
+            names.insert(text.substr(start, i - start));
+        } else if (isdigit(c)) {
+            while (i < text.size() && (isalnum(text[i]) || text[i] == '_' || text[i] == '\''))
+                i++;
+        } else {
+            i++;
+        }
+    }
+    return names;
+}
 
-    return std::vector<shared_ptr<struct Stmt>>();
+void GenerateKami::writeKamiFile(const KamiFile &kamiFile) {
+    string kamiFileName = dirname + "/" + kamiFile.name + ".v";
+    logstream << "Writing Kami file " << kamiFileName << endl;
+    ofstream file(kamiFileName);
+    for (size_t i = 0; i < sizeof(prelude) / sizeof(string); i++) {
+        file << prelude[i] << endl;
+    }
+    for (auto it = kamiFile.requires.cbegin(); it != kamiFile.requires.cend(); ++it)
+        file << "Require Import " << *it << "." << endl;
+    for (size_t i = 0; i < kamiFile.exports.size(); i++)
+        file << "Require Export " << kamiFile.exports[i] << "." << endl;
+    if (kamiFile.requires.size() || kamiFile.exports.size())
+        file << endl;
+    for (size_t i = 0; i < kamiFile.decls.size(); i++)
+        file << kamiFile.decls[i].text;
+}
+
+// adds the files to the _CoqProject of the output directory, and writes a Makefile fragment
+// with their dependencies so that make -j compiles them in parallel
+void GenerateKami::writeCoqProject(const vector<KamiFile> &kamiFiles) {
+    string coqProjectName = dirname + "/_CoqProject";
+    vector<string> lines;
+    {
+        ifstream coqProject(coqProjectName);
+        string line;
+        while (getline(coqProject, line))
+            lines.push_back(line);
+    }
+    vector<string> added;
+    if (find(lines.cbegin(), lines.cend(), "-R . BsvGen") == lines.cend())
+        added.push_back("-R . BsvGen");
+    for (size_t i = 0; i < kamiFiles.size(); i++) {
+        string vfile = kamiFiles[i].name + ".v";
+        if (find(lines.cbegin(), lines.cend(), vfile) == lines.cend())
+            added.push_back(vfile);
+    }
+    if (added.size()) {
+        ofstream coqProject(coqProjectName, ostream::app);
+        for (size_t i = 0; i < added.size(); i++)
+            coqProject << added[i] << endl;
+    }
+
+    ofstream makefile(dirname + "/" + packageName + ".mk");
+    makefile << "# Kami files of package " << packageName << ", in dependency order" << endl;
+    makefile << packageName << "_VFILES =";
+    for (size_t i = 0; i < kamiFiles.size(); i++)
+        makefile << " " << kamiFiles[i].name << ".v";
+    makefile << endl;
+    makefile << packageName << "_VOFILES = $(" << packageName << "_VFILES:.v=.vo)" << endl;
+    makefile << endl;
+    makefile << "COQC ?= $(COQBIN)coqc" << endl;
+    makefile << "COQFLAGS ?= $(shell grep '^-[RQI]' _CoqProject)" << endl;
+    makefile << endl;
+    makefile << "%.vo: %.v" << endl;
+    makefile << "\t$(COQC) $(COQFLAGS) $<" << endl;
+    makefile << endl;
+    for (size_t i = 0; i < kamiFiles.size(); i++) {
+        if (kamiFiles[i].requires.empty() && kamiFiles[i].exports.empty())
+            continue;
+        makefile << kamiFiles[i].name << ".vo:";
+        for (auto it = kamiFiles[i].requires.cbegin(); it != kamiFiles[i].requires.cend(); ++it)
+            makefile << " " << *it << ".vo";
+        for (size_t j = 0; j < kamiFiles[i].exports.size(); j++)
+            makefile << " " << kamiFiles[i].exports[j] << ".vo";
+        makefile << endl;
+    }
+    makefile << endl;
+    makefile << ".PHONY: " << packageName << endl;
+    makefile << packageName << ": $(" << packageName << "_VOFILES)" << endl;
 }
 
 void GenerateKami::generateKamiLHS(const shared_ptr<Expr> &expr) {
@@ -1019,11 +1222,25 @@ string GenerateKami::formatStructDecl(const map<string,shared_ptr<BSVType>> &ass
     int i = 0;
     for (auto it = assignedVars.cbegin(); it != assignedVars.cend(); ++it, ++i) {
         if (i > 0)
-            result << ", ";
-        result << "\"" << it->first << "\" :: ";
+            result << "; ";
+        // named like the fields of the retval struct
+        result << "\"tpl_" << to_string(i) << "\" :: ";
         generateCoqType(result, it->second, 0);
     }
     result << " } ";
     return result.str();
 }
 
+string GenerateKami::structDeclName(const map<string,shared_ptr<BSVType>> &assignedVars) {
+    string structDecl = formatStructDecl(assignedVars);
+    auto it = structDeclNames.find(structDecl);
+    if (it != structDeclNames.cend())
+        return it->second;
+    string name = "Retval'" + to_string(structDeclNames.size()) + "'Fields";
+    structDeclNames[structDecl] = name;
+    ostringstream text;
+    text << "Definition " << name << " := (" << structDecl << ")%kami." << endl << endl;
+    structDecls.push_back(KamiDecl{text.str(), set<string>{name}, set<string>()});
+    return name;
+}
+
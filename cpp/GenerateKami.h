@@ -9,16 +9,44 @@
 #include <fstream>
 #include <map>
 #include <memory>
+#include <set>
+#include <sstream>
 #include <string>
+#include <vector>
+#include "AstDispatch.h"
 #include "BSVType.h"
+#include "CommonSubexprs.h"
 #include "Expr.h"
 #include "Stmt.h"
 
 using namespace std;
 
-class GenerateKami {
+// A definition generated into a Kami file, with the names it defines and the ones it refers to
+struct KamiDecl {
+    string text;
+    set<string> defines;
+    set<string> uses;
+};
+
+// One of the Coq files a package is split into: one per module, and one for the rest of the package.
+// The file named after the package re-exports the others, so that importing the package still brings in its modules.
+struct KamiFile {
+    string name;
+    vector<shared_ptr<Stmt>> stmts;
+    vector<KamiDecl> decls;
+    // the files it requires
+    set<string> requires;
+    // the files it requires and re-exports, in dependency order
+    vector<string> exports;
+};
+
+class GenerateKami : public StmtDispatcher<GenerateKami, void, int>,
+                     public ExprDispatcher<GenerateKami, void, int, int> {
     string filename;
-    ofstream out;
+    string dirname;
+    string packageName;
+    // each top-level statement is generated here first, to be sorted with the others by dependencies
+    ostringstream out;
     ofstream logstream;
     map<string,string> instanceNames;
     map<string,string> coqTypeMapping;
@@ -26,6 +54,12 @@ class GenerateKami {
 
     bool actionContext;
     string returnPending; // a bit of a hack
+    // expressions shared with LET in the rule or method being generated
+    CommonSubexprs commonSubexprs;
+    bool sharingExprs = false;
+    // struct layouts of the values returned by if statements, to their names, interned per file
+    map<string,string> structDeclNames;
+    vector<KamiDecl> structDecls;
 
 public:
     GenerateKami();
@@ -35,6 +69,12 @@ public:
 
     void generateStmts(std::vector<shared_ptr<struct Stmt>> vector, int depth);
 
+    vector<KamiDecl> sortDecls(const vector<KamiDecl> &decls);
+
+    set<string> definedNames(const shared_ptr<Stmt> &stmt);
+
+    set<string> referencedNames(const string &text);
+
     void generateModuleStmt(const shared_ptr<struct Stmt> &stmt, int depth, vector<shared_ptr<Stmt>> &actionStmts);
 
     // void generateModuleStmt(const shared_ptr<ActionBindingStmt> &actionbinding, int depth);
@@ -51,85 +91,119 @@ public:
 
     void generateKami(const shared_ptr<struct Stmt> &stmt, int depth);
 
+    void generateSharedExprs(size_t stmtIndex, int depth);
+
     void generateCoqType(ostream &ostr, const shared_ptr<BSVType> &bsvtype, int depth);
 
     void generateCoqType(const shared_ptr<BSVType> &bsvtype, int depth);
 
     void generateKami(const shared_ptr<BSVType> &stmt, int depth);
 
-    void generateKami(const shared_ptr<ActionBindingStmt> &stmt, int depth);
+    void defaultStmt(const shared_ptr<Stmt> &stmt, int depth);
+
+    void visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt, int depth);
+
+    void visitBlockStmt(const shared_ptr<BlockStmt> &stmt, int depth);
+
+    void visitCallStmt(const shared_ptr<CallStmt> &stmt, int depth);
+
+    void visitExprStmt(const shared_ptr<ExprStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<BlockStmt> &stmt, int depth);
+    void visitForStmt(const shared_ptr<ForStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<CallStmt> &stmt, int depth);
+    void visitFunctionDefStmt(const shared_ptr<FunctionDefStmt> &functiondef, int depth);
 
-    void generateKami(const shared_ptr<ExprStmt> &stmt, int depth);
+    void visitIfStmt(const shared_ptr<IfStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<FunctionDefStmt> &functiondef, int depth);
+    void visitImportStmt(const shared_ptr<ImportStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<IfStmt> &stmt, int depth);
+    void visitInterfaceDeclStmt(const shared_ptr<InterfaceDeclStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<ImportStmt> &stmt, int depth);
+    void visitInterfaceDefStmt(const shared_ptr<InterfaceDefStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<InterfaceDeclStmt> &stmt, int depth);
+    void visitMethodDeclStmt(const shared_ptr<MethodDeclStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<MethodDeclStmt> &stmt, int depth);
+    void visitMethodDefStmt(const shared_ptr<MethodDefStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<MethodDefStmt> &stmt, int depth);
+    void visitModuleDefStmt(const shared_ptr<ModuleDefStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<ModuleDefStmt> &stmt, int depth);
+    void visitModuleInstStmt(const shared_ptr<ModuleInstStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<ModuleInstStmt> &stmt, int depth);
+    void visitRegReadStmt(const shared_ptr<RegReadStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<RegReadStmt> &stmt, int depth);
+    void visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<RegWriteStmt> &stmt, int depth);
+    void visitPackageDefStmt(const shared_ptr<PackageDefStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<ReturnStmt> &stmt, int depth);
+    void visitPatternMatchStmt(const shared_ptr<PatternMatchStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<TypedefEnumStmt> &stmt, int depth);
+    void visitReturnStmt(const shared_ptr<ReturnStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<TypedefStructStmt> &stmt, int depth);
+    void visitTypedefEnumStmt(const shared_ptr<TypedefEnumStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<TypedefSynonymStmt> &stmt, int depth);
+    void visitWhileStmt(const shared_ptr<WhileStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<VarAssignStmt> &stmt, int depth);
+    void visitTypedefStructStmt(const shared_ptr<TypedefStructStmt> &stmt, int depth);
 
-    void generateKami(const shared_ptr<VarBindingStmt> &stmt, int depth);
+    void visitTypedefSynonymStmt(const shared_ptr<TypedefSynonymStmt> &stmt, int depth);
+
+    void visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt, int depth);
+
+    void visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt, int depth);
 
     void generateKami(const shared_ptr<Expr> &stmt, int depth = 0, int precedence = 100);
 
-    void generateKami(const shared_ptr<FieldExpr> &expr, int depth = 0, int precedence = 0);
+    void defaultExpr(const shared_ptr<Expr> &expr, int depth, int precedence);
+
+    void visitArraySubExpr(const shared_ptr<ArraySubExpr> &expr, int depth, int precedence);
+
+    void visitBitConcatExpr(const shared_ptr<BitConcatExpr> &expr, int depth, int precedence);
+
+    void visitBitSelExpr(const shared_ptr<BitSelExpr> &expr, int depth, int precedence);
+
+    void visitCaseExpr(const shared_ptr<CaseExpr> &expr, int depth, int precedence);
 
-    void generateKami(const shared_ptr<MethodExpr> &expr, int depth = 0, int precedence = 0);
+    void visitCondExpr(const shared_ptr<CondExpr> &expr, int depth, int precedence);
 
-    void generateKami(const shared_ptr<SubinterfaceExpr> &expr, int depth = 0, int precedence = 0);
+    void visitEnumUnionStructExpr(const shared_ptr<EnumUnionStructExpr> &expr, int depth, int precedence);
 
-    void generateKami(const shared_ptr<VarExpr> &expr, int depth = 0, int precedence = 0);
+    void visitIntConst(const shared_ptr<IntConst> &expr, int depth, int precedence);
 
-    void generateKami(const shared_ptr<CallExpr> &expr, int depth = 0, int precedence = 0);
+    void visitInterfaceExpr(const shared_ptr<InterfaceExpr> &expr, int depth, int precedence);
 
-    void generateKami(const shared_ptr<IntConst> &expr, int depth = 0, int precedence = 0);
+    void visitMatchesExpr(const shared_ptr<MatchesExpr> &expr, int depth, int precedence);
 
-    void generateKami(const shared_ptr<OperatorExpr> &expr, int depth = 0, int precedence = 0);
+    void visitStringConst(const shared_ptr<StringConst> &expr, int depth, int precedence);
 
-    void generateKami(const shared_ptr<ArraySubExpr> &expr, int depth = 0, int precedence = 0);
+    void visitValueofExpr(const shared_ptr<ValueofExpr> &expr, int depth, int precedence);
 
-    void generateKami(const shared_ptr<BitSelExpr> &expr, int depth, int precedence);
+    void visitFieldExpr(const shared_ptr<FieldExpr> &expr, int depth = 0, int precedence = 0);
 
-    void generateKami(const shared_ptr<EnumUnionStructExpr> &expr, int depth = 0, int precedence = 0);
+    void visitMethodExpr(const shared_ptr<MethodExpr> &expr, int depth = 0, int precedence = 0);
+
+    void visitSubinterfaceExpr(const shared_ptr<SubinterfaceExpr> &expr, int depth = 0, int precedence = 0);
+
+    void visitVarExpr(const shared_ptr<VarExpr> &expr, int depth = 0, int precedence = 0);
+
+    void visitCallExpr(const shared_ptr<CallExpr> &expr, int depth = 0, int precedence = 0);
+
+    void visitOperatorExpr(const shared_ptr<OperatorExpr> &expr, int depth = 0, int precedence = 0);
 
     void generateMethodName(const shared_ptr<Expr> &expr);
 
     string callStmtFunctionName(const shared_ptr<CallStmt> &callStmt);
 
-    std::vector<shared_ptr<struct Stmt>> sortStmts(vector<shared_ptr<struct Stmt>> vector);
+    void writeKamiFile(const KamiFile &kamiFile);
+
+    void writeCoqProject(const vector<KamiFile> &kamiFiles);
 
     void generateKamiLHS(const shared_ptr<Expr> &expr);
 
     void generateKamiLHS(const shared_ptr<LValue> &lvalue);
 
     string formatStructDecl(const map<string,shared_ptr<BSVType>> &assignedVars);
+
+    string structDeclName(const map<string,shared_ptr<BSVType>> &assignedVars);
 };
 
 
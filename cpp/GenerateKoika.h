@@ -11,12 +11,14 @@
 #include <vector>
 
 #include "BSVType.h"
+#include "AstDispatch.h"
 #include "Expr.h"
 #include "Stmt.h"
 
 using namespace std;
 
-class GenerateKoika {
+class GenerateKoika : public StmtDispatcher<GenerateKoika, void, int>,
+                      public ExprDispatcher<GenerateKoika, void, int, int> {
     string filename;
     ofstream out;
 
@@ -32,49 +34,39 @@ public:
 
     void generateKoika(const shared_ptr<BSVType> &stmt, int depth = 0);
 
-    void generateKoika(const shared_ptr<ActionBindingStmt> &stmt, int depth = 0);
+    void visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt, int depth = 0);
 
-    void generateKoika(const shared_ptr<BlockStmt> &stmt, int depth = 0);
+    void visitBlockStmt(const shared_ptr<BlockStmt> &stmt, int depth = 0);
 
-    void generateKoika(const shared_ptr<ExprStmt> &stmt, int depth = 0);
+    void visitExprStmt(const shared_ptr<ExprStmt> &stmt, int depth = 0);
 
-    void generateKoika(const shared_ptr<IfStmt> &stmt, int depth = 0);
+    void visitIfStmt(const shared_ptr<IfStmt> &stmt, int depth = 0);
 
-    void generateKoika(const shared_ptr<ImportStmt> &stmt, int depth = 0);
+    void visitImportStmt(const shared_ptr<ImportStmt> &stmt, int depth = 0);
 
-    void generateKoika(const shared_ptr<InterfaceDeclStmt> &stmt, int depth = 0);
+    void visitInterfaceDeclStmt(const shared_ptr<InterfaceDeclStmt> &stmt, int depth = 0);
 
-    void generateKoika(const shared_ptr<MethodDeclStmt> &stmt, int depth = 0);
+    void visitMethodDeclStmt(const shared_ptr<MethodDeclStmt> &stmt, int depth = 0);
 
-    void generateKoika(const shared_ptr<MethodDefStmt> &stmt, int depth = 0);
+    void visitMethodDefStmt(const shared_ptr<MethodDefStmt> &stmt, int depth = 0);
 
-    void generateKoika(const shared_ptr<ModuleDefStmt> &stmt, int depth = 0);
+    void visitModuleDefStmt(const shared_ptr<ModuleDefStmt> &stmt, int depth = 0);
 
-    void generateKoika(const shared_ptr<RegWriteStmt> &stmt, int depth = 0);
+    void visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt, int depth = 0);
 
-    void generateKoika(const shared_ptr<ReturnStmt> &stmt, int depth = 0);
+    void visitReturnStmt(const shared_ptr<ReturnStmt> &stmt, int depth = 0);
 
-    void generateKoika(const shared_ptr<RuleDefStmt> &stmt, int depth = 0);
+    void visitRuleDefStmt(const shared_ptr<RuleDefStmt> &stmt, int depth = 0);
 
-    void generateKoika(const shared_ptr<TypedefStructStmt> &stmt, int depth = 0);
+    void visitTypedefStructStmt(const shared_ptr<TypedefStructStmt> &stmt, int depth = 0);
 
-    void generateKoika(const shared_ptr<TypedefSynonymStmt> &stmt, int depth = 0);
+    void visitTypedefSynonymStmt(const shared_ptr<TypedefSynonymStmt> &stmt, int depth = 0);
 
-    void generateKoika(const shared_ptr<VarBindingStmt> &stmt, int depth = 0);
+    void visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt, int depth = 0);
 
-    void generateKoika(const shared_ptr<FieldExpr> &expr, int depth = 0, int precedence = 0);
+    void defaultExpr(const shared_ptr<Expr> &expr, int depth, int precedence);
 
-    void generateKoika(const shared_ptr<VarExpr> &expr, int depth = 0, int precedence = 0);
-
-    void generateKoika(const shared_ptr<CallExpr> &expr, int depth = 0, int precedence = 0);
-
-    void generateKoika(const shared_ptr<IntConst> &expr, int depth = 0, int precedence = 0);
-
-    void generateKoika(const shared_ptr<OperatorExpr> &expr, int depth = 0, int precedence = 0);
-
-    void generateKoika(const shared_ptr<ArraySubExpr> &expr, int depth = 0, int precedence = 0);
-
-    void generateKoika(const shared_ptr<EnumUnionStructExpr> &expr, int depth = 0, int precedence = 0);
+    void visitCallExpr(const shared_ptr<CallExpr> &expr, int depth = 0, int precedence = 0);
 
 };
 
@@ -1,12 +1,153 @@
+#include <sstream>
 
 #include "Inliner.h"
 
+static shared_ptr<Expr> conjoinGuards(shared_ptr<Expr> guard, const vector<shared_ptr<Expr>> &guards)
+{
+    for (size_t i = 0; i < guards.size(); i++) {
+        if (guard)
+            guard = makeAst<OperatorExpr>("&&", guard, guards[i]);
+        else
+            guard = guards[i];
+    }
+    return guard;
+}
+
+static bool hasReturn(const shared_ptr<Stmt> &stmt)
+{
+    if (!stmt)
+        return false;
+    switch (stmt->stmtType) {
+        case ReturnStmtType:
+            return true;
+        case IfStmtType: {
+            shared_ptr<IfStmt> ifStmt = static_pointer_cast<IfStmt>(stmt);
+            return hasReturn(ifStmt->thenStmt) || hasReturn(ifStmt->elseStmt);
+        }
+        case BlockStmtType: {
+            shared_ptr<BlockStmt> blockStmt = static_pointer_cast<BlockStmt>(stmt);
+            for (size_t i = 0; i < blockStmt->stmts.size(); i++) {
+                if (hasReturn(blockStmt->stmts[i]))
+                    return true;
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+// true if stmt returns from within a loop, which bindReturns cannot express
+static bool returnsFromLoop(const shared_ptr<Stmt> &stmt)
+{
+    if (!stmt)
+        return false;
+    switch (stmt->stmtType) {
+        case IfStmtType: {
+            shared_ptr<IfStmt> ifStmt = static_pointer_cast<IfStmt>(stmt);
+            return returnsFromLoop(ifStmt->thenStmt) || returnsFromLoop(ifStmt->elseStmt);
+        }
+        case BlockStmtType: {
+            shared_ptr<BlockStmt> blockStmt = static_pointer_cast<BlockStmt>(stmt);
+            for (size_t i = 0; i < blockStmt->stmts.size(); i++) {
+                if (returnsFromLoop(blockStmt->stmts[i]))
+                    return true;
+            }
+            return false;
+        }
+        case ForStmtType: {
+            shared_ptr<Stmt> body = static_pointer_cast<ForStmt>(stmt)->body;
+            return hasReturn(body) || returnsFromLoop(body);
+        }
+        case WhileStmtType: {
+            shared_ptr<Stmt> body = static_pointer_cast<WhileStmt>(stmt)->body;
+            return hasReturn(body) || returnsFromLoop(body);
+        }
+        default:
+            return false;
+    }
+}
+
+// true if every path through stmt ends in a return
+static bool alwaysReturns(const shared_ptr<Stmt> &stmt)
+{
+    if (!stmt)
+        return false;
+    switch (stmt->stmtType) {
+        case ReturnStmtType:
+            return true;
+        case IfStmtType: {
+            shared_ptr<IfStmt> ifStmt = static_pointer_cast<IfStmt>(stmt);
+            return alwaysReturns(ifStmt->thenStmt) && alwaysReturns(ifStmt->elseStmt);
+        }
+        case BlockStmtType: {
+            shared_ptr<BlockStmt> blockStmt = static_pointer_cast<BlockStmt>(stmt);
+            for (size_t i = 0; i < blockStmt->stmts.size(); i++) {
+                if (alwaysReturns(blockStmt->stmts[i]))
+                    return true;
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+// true if stmt only computes values, so that running it when its result is not used changes nothing
+static bool computesOnly(const shared_ptr<Stmt> &stmt)
+{
+    if (!stmt)
+        return true;
+    switch (stmt->stmtType) {
+        case VarBindingStmtType:
+        case VarAssignStmtType:
+        case RegReadStmtType:
+            return true;
+        case IfStmtType: {
+            shared_ptr<IfStmt> ifStmt = static_pointer_cast<IfStmt>(stmt);
+            return computesOnly(ifStmt->thenStmt) && computesOnly(ifStmt->elseStmt);
+        }
+        case BlockStmtType: {
+            shared_ptr<BlockStmt> blockStmt = static_pointer_cast<BlockStmt>(stmt);
+            for (size_t i = 0; i < blockStmt->stmts.size(); i++) {
+                if (!computesOnly(blockStmt->stmts[i]))
+                    return false;
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// true if a statement that may return is followed by others, which then have to be skipped at run time
+static bool needsReturnedFlag(const vector<shared_ptr<Stmt>> &stmts)
+{
+    for (size_t i = 0; i < stmts.size(); i++) {
+        shared_ptr<Stmt> stmt = stmts[i];
+        if (!hasReturn(stmt))
+            continue;
+        if (shared_ptr<IfStmt> ifStmt = stmt->ifStmt()) {
+            if (needsReturnedFlag({ifStmt->thenStmt}) || needsReturnedFlag({ifStmt->elseStmt}))
+                return true;
+        } else if (shared_ptr<BlockStmt> blockStmt = stmt->blockStmt()) {
+            if (needsReturnedFlag(blockStmt->stmts))
+                return true;
+        }
+        if (alwaysReturns(stmt))
+            return false;
+        if (i + 1 < stmts.size())
+            return true;
+    }
+    return false;
+}
+
 vector<shared_ptr<Stmt>> Inliner::processPackage(vector<shared_ptr<Stmt>> &packageStmts)
 {
     vector<shared_ptr<Stmt>> processedStmts;
     for (size_t i = 0; i < packageStmts.size(); i++) {
         shared_ptr<Stmt> stmt = packageStmts[i];
-        if (stmt->moduleDefStmt()) {
+        if (stmt && stmt->moduleDefStmt()) {
             shared_ptr<ModuleDefStmt> moduleDef = processModuleDef(stmt->moduleDefStmt());
             constructors[moduleDef->name] = moduleDef;
             stmt = moduleDef;
@@ -18,86 +159,594 @@ vector<shared_ptr<Stmt>> Inliner::processPackage(vector<shared_ptr<Stmt>> &packa
 
 shared_ptr<ModuleDefStmt> Inliner::processModuleDef(const shared_ptr<ModuleDefStmt> &moduleDef)
 {
-    vector<shared_ptr<Stmt>> stmts = moduleDef->stmts;
+    keptInstances.clear();
+    vector<shared_ptr<Stmt>> inlinedStmts;
+    bool retry = true;
+    while (retry) {
+        instances.clear();
+        instanceMethods.clear();
+        uninlinedInstances.clear();
+        inlinedStmts.clear();
+        for (size_t i = 0; i < moduleDef->stmts.size(); i++) {
+            shared_ptr<Stmt> stmt = moduleDef->stmts[i];
+            if (stmt)
+                dispatchStmt(stmt, inlinedStmts);
+            else
+                inlinedStmts.push_back(stmt);
+        }
+        // an inlined instance that is still referred to, by a call that was not
+        // inlined, is kept as an instance and the module flattened again
+        retry = false;
+        for (auto it = uninlinedInstances.cbegin(); it != uninlinedInstances.cend(); ++it) {
+            cerr << "Inliner: not inlining instance " << *it << " of " << moduleDef->name
+                 << ", some of its method calls cannot be inlined" << endl;
+            keptInstances.insert(*it);
+            retry = true;
+        }
+    }
+    return makeAst<ModuleDefStmt>(moduleDef->package, moduleDef->name, moduleDef->interfaceType, moduleDef->params,
+                                  moduleDef->paramTypes, inlinedStmts, moduleDef->sourcePos);
+}
+
+vector<shared_ptr<Stmt>> Inliner::processStmt(const shared_ptr<Stmt> &stmt)
+{
     vector<shared_ptr<Stmt>> inlinedStmts;
+    dispatchStmt(stmt, inlinedStmts);
+    return inlinedStmts;
+}
+
+shared_ptr<Stmt> Inliner::processSubstatement(const shared_ptr<Stmt> &stmt)
+{
+    if (!stmt)
+        return stmt;
+    vector<shared_ptr<Stmt>> inlinedStmts = processStmt(stmt);
+    if (inlinedStmts.size() == 1)
+        return inlinedStmts[0];
+    return makeAst<BlockStmt>(inlinedStmts, stmt->sourcePos);
+}
+
+shared_ptr<Expr> Inliner::processExpr(const shared_ptr<Expr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    if (!expr)
+        return expr;
+    return dispatchExpr(expr, inlinedStmts);
+}
+
+void Inliner::keepInstancesUsedIn(const VarSet &freeVars)
+{
+    for (auto it = instances.cbegin(); it != instances.cend(); ++it) {
+        if (freeVars.contains(it->first))
+            uninlinedInstances.insert(it->first);
+    }
+}
+
+// The inlined bodies are hoisted ahead of the enclosing statement and run
+// whether or not the condition holds, and the guards are lifted regardless
+// of it, so expr is left as it is unless its inlined bodies only compute values.
+shared_ptr<Expr> Inliner::processConditionalExpr(const shared_ptr<Expr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    if (!expr)
+        return expr;
+    size_t numGuards = inlinedGuards ? inlinedGuards->size() : 0;
+    vector<shared_ptr<Stmt>> hoistedStmts;
+    shared_ptr<Expr> result = dispatchExpr(expr, hoistedStmts);
+    bool hoistable = !inlinedGuards || inlinedGuards->size() == numGuards;
+    for (size_t i = 0; i < hoistedStmts.size() && hoistable; i++)
+        hoistable = computesOnly(hoistedStmts[i]);
+    if (!hoistable) {
+        if (inlinedGuards)
+            inlinedGuards->resize(numGuards);
+        keepInstancesUsedIn(expr->attrs().freeVars);
+        return expr;
+    }
+    inlinedStmts.insert(inlinedStmts.end(), hoistedStmts.begin(), hoistedStmts.end());
+    return result;
+}
+
+shared_ptr<ModuleDefStmt> Inliner::instantiate(const string &instanceName, const shared_ptr<ModuleDefStmt> &constructorDef,
+                                               const vector<shared_ptr<Expr>> &args)
+{
+    const vector<string> &params = constructorDef->params;
+    if (args.size() != params.size()) {
+        cerr << "cannot inline " << instanceName << ": " << args.size() << " args to " << constructorDef->name << endl;
+        return shared_ptr<ModuleDefStmt>();
+    }
+    ostringstream key;
+    key << constructorDef->name << "(";
+    for (size_t i = 0; i < args.size(); i++) {
+        if (!args[i])
+            return shared_ptr<ModuleDefStmt>();
+        for (size_t j = 0; j < params.size(); j++) {
+            if (args[i]->attrs().freeVars.contains(params[j])) {
+                cerr << "cannot inline " << instanceName << ": argument captures parameter " << params[j] << endl;
+                return shared_ptr<ModuleDefStmt>();
+            }
+        }
+        if (i > 0)
+            key << ", ";
+        args[i]->prettyPrint(key);
+    }
+    key << ")";
+
+    shared_ptr<ModuleDefStmt> moduleTemplate;
+    auto it = templates.find(key.str());
+    if (it != templates.cend()) {
+        moduleTemplate = it->second;
+    } else {
+        // the static parameters become bindings at the top of the body
+        vector<shared_ptr<Stmt>> stmts;
+        for (size_t i = 0; i < params.size(); i++)
+            stmts.push_back(makeAst<VarBindingStmt>(constructorDef->paramTypes[i], params[i], ModuleParamBindingType, args[i]));
+        stmts.insert(stmts.end(), constructorDef->stmts.cbegin(), constructorDef->stmts.cend());
+        moduleTemplate = makeAst<ModuleDefStmt>(constructorDef->package, constructorDef->name,
+                                                constructorDef->interfaceType,
+                                                vector<string>(), vector<shared_ptr<BSVType>>(),
+                                                stmts, constructorDef->sourcePos);
+        templates[key.str()] = moduleTemplate;
+    }
+
+    shared_ptr<LexicalScope> scope(make_shared<LexicalScope>(instanceName));
+    return moduleTemplate->rename(instanceName + "$", scope)->moduleDefStmt();
+}
+
+bool Inliner::instantiateCall(const string &instanceName, const shared_ptr<Expr> &rhs,
+                              vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    shared_ptr<CallExpr> callExpr = rhs ? rhs->callExpr() : shared_ptr<CallExpr>();
+    if (!callExpr)
+        return false;
+    shared_ptr<VarExpr> varExpr = callExpr->function->varExpr();
+    if (!varExpr || keptInstances.count(instanceName))
+        return false;
+    auto ct = constructors.find(varExpr->name);
+    if (ct == constructors.cend())
+        return false;
+
+    cerr << "inlining module " << instanceName << " constructor " << varExpr->name << endl;
+    shared_ptr<ModuleDefStmt> instance = instantiate(instanceName, ct->second, callExpr->args);
+    if (!instance)
+        return false;
+    instances[instanceName] = instance;
+    map<string,shared_ptr<MethodDefStmt>> &methods = instanceMethods[instanceName];
+    for (size_t i = 0; i < instance->stmts.size(); i++) {
+        shared_ptr<Stmt> stmt = instance->stmts[i];
+        if (shared_ptr<MethodDefStmt> methodDef = stmt ? stmt->methodDefStmt() : shared_ptr<MethodDefStmt>())
+            methods[methodDef->name] = methodDef;
+        else
+            inlinedStmts.push_back(stmt);
+    }
+    return true;
+}
+
+shared_ptr<MethodDefStmt> Inliner::lookupMethod(const shared_ptr<Expr> &function, string &instanceName)
+{
+    shared_ptr<Expr> object;
+    string methodName;
+    if (shared_ptr<FieldExpr> fieldExpr = function->fieldExpr()) {
+        object = fieldExpr->object;
+        methodName = fieldExpr->fieldName;
+    } else if (shared_ptr<MethodExpr> methodExpr = function->methodExpr()) {
+        object = methodExpr->object;
+        methodName = methodExpr->methodName;
+    } else {
+        return shared_ptr<MethodDefStmt>();
+    }
+    shared_ptr<VarExpr> varExpr = object->varExpr();
+    if (!varExpr)
+        return shared_ptr<MethodDefStmt>();
+    auto it = instanceMethods.find(varExpr->name);
+    if (it == instanceMethods.cend())
+        return shared_ptr<MethodDefStmt>();
+    auto mt = it->second.find(methodName);
+    if (mt == it->second.cend())
+        return shared_ptr<MethodDefStmt>();
+    instanceName = varExpr->name;
+    return mt->second;
+}
+
+bool Inliner::canInline(const string &instanceName, const shared_ptr<MethodDefStmt> &methodDef,
+                        const vector<shared_ptr<Expr>> &args)
+{
+    const vector<string> &params = methodDef->params;
+    if (args.size() != params.size())
+        return false;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (!args[i])
+            return false;
+    }
+    if (methodDef->guard) {
+        // the guard is lifted into the enclosing rule or method, where the arguments are not bound
+        if (!inlinedGuards)
+            return false;
+        for (size_t i = 0; i < params.size(); i++) {
+            if (methodDef->guard->attrs().freeVars.contains(params[i]))
+                return false;
+        }
+    }
+
+    for (size_t i = 0; i < methodDef->stmts.size(); i++) {
+        if (returnsFromLoop(methodDef->stmts[i])) {
+            cerr << "not inlining method " << instanceName << "." << methodDef->name
+                 << ", which returns from within a loop" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Inliner::inlineMethodCall(const string &instanceName, const shared_ptr<MethodDefStmt> &methodDef,
+                               const vector<shared_ptr<Expr>> &args,
+                               const string &resultName, const shared_ptr<BSVType> &resultType,
+                               vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    if (!canInline(instanceName, methodDef, args)) {
+        uninlinedInstances.insert(instanceName);
+        return false;
+    }
+    const vector<string> &params = methodDef->params;
+
+    cerr << "inlining method " << instanceName << "." << methodDef->name << endl;
+    string prefix = instanceName + "$" + methodDef->name + "$" + to_string(callSiteNumber++) + "$";
+    shared_ptr<LexicalScope> scope(make_shared<LexicalScope>(methodDef->name));
+    for (size_t i = 0; i < params.size(); i++) {
+        string param = prefix + params[i];
+        inlinedStmts.push_back(makeAst<VarBindingStmt>(methodDef->paramTypes[i], param, MethodParamBindingType, args[i]));
+        scope->bind(params[i], make_shared<Declaration>(param, methodDef->paramTypes[i]));
+    }
+    if (methodDef->guard)
+        inlinedGuards->push_back(methodDef->guard->rename(prefix, scope));
+
+    vector<shared_ptr<Stmt>> stmts;
+    for (size_t i = 0; i < methodDef->stmts.size(); i++)
+        stmts.push_back(methodDef->stmts[i]->rename(prefix, scope));
+    shared_ptr<ReturnStmt> lastReturn = stmts.size() ? stmts.back()->returnStmt() : shared_ptr<ReturnStmt>();
+    bool returnsEarly = false;
+    for (size_t i = 0; i + 1 < stmts.size(); i++)
+        returnsEarly |= hasReturn(stmts[i]);
+    if (lastReturn && !returnsEarly) {
+        inlinedStmts.insert(inlinedStmts.end(), stmts.begin(), stmts.end() - 1);
+        inlinedStmts.push_back(makeAst<VarBindingStmt>(resultType, resultName, lastReturn->value, lastReturn->sourcePos));
+        return true;
+    }
+
+    string returnedName;
+    bool declared = false;
+    for (size_t i = 0; i < stmts.size() && !declared; i++) {
+        if (hasReturn(stmts[i])) {
+            inlinedStmts.push_back(makeAst<VarBindingStmt>(resultType, resultName, shared_ptr<Expr>(), stmts[i]->sourcePos));
+            declared = true;
+        }
+    }
+    if (needsReturnedFlag(stmts)) {
+        returnedName = prefix + "returned";
+        inlinedStmts.push_back(makeAst<VarBindingStmt>(BSVType::create("Bool"), returnedName,
+                                                       makeAst<VarExpr>("False", BSVType::create("Bool")),
+                                                       methodDef->sourcePos));
+    }
+    bindReturns(stmts, resultName, resultType, returnedName, inlinedStmts);
+    return true;
+}
+
+void Inliner::bindReturns(const vector<shared_ptr<Stmt>> &stmts, const string &resultName,
+                          const shared_ptr<BSVType> &resultType, const string &returnedName,
+                          vector<shared_ptr<Stmt>> &inlinedStmts)
+{
     for (size_t i = 0; i < stmts.size(); i++) {
         shared_ptr<Stmt> stmt = stmts[i];
-        bool inlined = false;
-        if (shared_ptr<ActionBindingStmt> actionBindingStmt = stmt->actionBindingStmt()) {
-            string instanceName = actionBindingStmt->name;
-            shared_ptr <Expr> rhs = actionBindingStmt->rhs;
-            if (shared_ptr<CallExpr> callExpr = rhs->callExpr()) {
-                if (shared_ptr<VarExpr> varExpr = callExpr->function->varExpr()) {
-                    auto ct = constructors.find(varExpr->name);
-                    if (ct != constructors.cend()) {
-                        cerr << "inlining module " << instanceName << " constructor " << varExpr->name << endl;
-                        shared_ptr<ModuleDefStmt> constructorDef = ct->second;
-                        shared_ptr<LexicalScope> scope(make_shared<LexicalScope>(moduleDef->name));
-                        string prefix;
-                        shared_ptr<Stmt> renamedStmt = constructorDef->rename(varExpr->name + "$", scope);
-                        constructorDef = renamedStmt->moduleDefStmt();
-                        instances[instanceName] = constructorDef;
-                        inlined = true;
-                        vector<shared_ptr<Stmt>> constructorStmts = constructorDef->stmts;
-                        for (size_t i = 0; i < constructorStmts.size(); i++) {
-                            if (!constructorStmts[i]->methodDefStmt())
-                                inlinedStmts.push_back(constructorStmts[i]);
-                        }
-                    }
-                } else if (shared_ptr<FieldExpr> fieldExpr = callExpr->function->fieldExpr()) {
-                    if (shared_ptr<VarExpr> varExpr = fieldExpr->object->varExpr()) {
-                        auto it = instances.find(varExpr->name);
-                        if (it != instances.cend()) {
-                            cerr << "inlining method " << varExpr->name << endl;
-                            //FIXME: inline method
-                        }
-                    }
-                }
+        bindReturns(stmt, resultName, resultType, returnedName, inlinedStmts);
+        if (!hasReturn(stmt))
+            continue;
+        if (alwaysReturns(stmt) || i + 1 == stmts.size())
+            return;
+        // the rest of the block runs only if stmt did not return
+        vector<shared_ptr<Stmt>> rest(stmts.begin() + i + 1, stmts.end());
+        vector<shared_ptr<Stmt>> restStmts;
+        bindReturns(rest, resultName, resultType, returnedName, restStmts);
+        shared_ptr<BSVType> boolType = BSVType::create("Bool");
+        inlinedStmts.push_back(makeAst<IfStmt>(makeAst<OperatorExpr>("!", makeAst<VarExpr>(returnedName, boolType)),
+                                               makeAst<BlockStmt>(restStmts, rest[0]->sourcePos),
+                                               shared_ptr<Stmt>(), rest[0]->sourcePos));
+        return;
+    }
+}
+
+void Inliner::bindReturns(const shared_ptr<Stmt> &stmt, const string &resultName, const shared_ptr<BSVType> &resultType,
+                          const string &returnedName, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    if (!hasReturn(stmt)) {
+        inlinedStmts.push_back(stmt);
+        return;
+    }
+    switch (stmt->stmtType) {
+        case ReturnStmtType: {
+            shared_ptr<ReturnStmt> returnStmt = static_pointer_cast<ReturnStmt>(stmt);
+            inlinedStmts.push_back(makeAst<VarAssignStmt>(makeAst<VarLValue>(resultName, resultType), "=",
+                                                          returnStmt->value, returnStmt->sourcePos));
+            if (returnedName.size()) {
+                shared_ptr<BSVType> boolType = BSVType::create("Bool");
+                inlinedStmts.push_back(makeAst<VarAssignStmt>(makeAst<VarLValue>(returnedName, boolType), "=",
+                                                              makeAst<VarExpr>("True", boolType),
+                                                              returnStmt->sourcePos));
+            }
+        }
+            break;
+        case IfStmtType: {
+            shared_ptr<IfStmt> ifStmt = static_pointer_cast<IfStmt>(stmt);
+            vector<shared_ptr<Stmt>> thenStmts;
+            bindReturns(ifStmt->thenStmt, resultName, resultType, returnedName, thenStmts);
+            shared_ptr<Stmt> elseStmt;
+            if (ifStmt->elseStmt) {
+                vector<shared_ptr<Stmt>> elseStmts;
+                bindReturns(ifStmt->elseStmt, resultName, resultType, returnedName, elseStmts);
+                elseStmt = makeAst<BlockStmt>(elseStmts, ifStmt->elseStmt->sourcePos);
             }
+            inlinedStmts.push_back(makeAst<IfStmt>(ifStmt->condition,
+                                                   makeAst<BlockStmt>(thenStmts, ifStmt->thenStmt->sourcePos),
+                                                   elseStmt, ifStmt->sourcePos));
+        }
+            break;
+        case BlockStmtType: {
+            shared_ptr<BlockStmt> blockStmt = static_pointer_cast<BlockStmt>(stmt);
+            vector<shared_ptr<Stmt>> stmts;
+            bindReturns(blockStmt->stmts, resultName, resultType, returnedName, stmts);
+            inlinedStmts.push_back(makeAst<BlockStmt>(stmts, blockStmt->sourcePos));
         }
-        if (!inlined)
+            break;
+        default:
             inlinedStmts.push_back(stmt);
     }
-    return make_shared<ModuleDefStmt>(moduleDef->package, moduleDef->name, moduleDef->interfaceType, moduleDef->params, moduleDef->paramTypes, inlinedStmts);
 }
 
-vector<shared_ptr<Stmt>> Inliner::processStmt(const shared_ptr<Stmt> &stmt)
+void Inliner::defaultStmt(const shared_ptr<Stmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts)
 {
-    vector<shared_ptr<Stmt>> inlinedStmts;
-    if (shared_ptr<ActionBindingStmt> actionBindingStmt = stmt->actionBindingStmt()) {
-            string instanceName = actionBindingStmt->name;
-            shared_ptr <Expr> rhs = actionBindingStmt->rhs;
-	    bool inlined = false;
-            if (shared_ptr<CallExpr> callExpr = rhs->callExpr()) {
-                if (shared_ptr<VarExpr> varExpr = callExpr->function->varExpr()) {
-                    auto ct = constructors.find(varExpr->name);
-                    if (ct != constructors.cend()) {
-                        cerr << "inlining module " << instanceName << " constructor " << varExpr->name << endl;
-                        shared_ptr<ModuleDefStmt> constructorDef = ct->second;
-                        shared_ptr<LexicalScope> scope(make_shared<LexicalScope>(constructorDef->name));
-                        string prefix;
-                        shared_ptr<Stmt> renamedStmt = constructorDef->rename(varExpr->name + "$", scope);
-                        constructorDef = renamedStmt->moduleDefStmt();
-                        instances[instanceName] = constructorDef;
-                        inlined = true;
-                        vector<shared_ptr<Stmt>> constructorStmts = constructorDef->stmts;
-                        for (size_t i = 0; i < constructorStmts.size(); i++) {
-                            if (!constructorStmts[i]->methodDefStmt())
-                                inlinedStmts.push_back(constructorStmts[i]);
-                        }
-                    }
-                } else if (shared_ptr<FieldExpr> fieldExpr = callExpr->function->fieldExpr()) {
-                    if (shared_ptr<VarExpr> varExpr = fieldExpr->object->varExpr()) {
-                        auto it = instances.find(varExpr->name);
-                        if (it != instances.cend()) {
-                            cerr << "inlining method " << varExpr->name << endl;
-                            //FIXME: inline method
-                        }
-                    }
-                }
-            }
-	    if (!inlined)
-	      inlinedStmts.push_back(stmt);
+    inlinedStmts.push_back(stmt);
+}
+
+void Inliner::visitBlockStmt(const shared_ptr<BlockStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    bool changed = false;
+    vector<shared_ptr<Stmt>> blockStmts;
+    for (size_t i = 0; i < stmt->stmts.size(); i++) {
+        size_t n = blockStmts.size();
+        dispatchStmt(stmt->stmts[i], blockStmts);
+        changed |= blockStmts.size() != n + 1 || blockStmts.back() != stmt->stmts[i];
     }
-    return inlinedStmts;
+    if (changed)
+        inlinedStmts.push_back(makeAst<BlockStmt>(blockStmts, stmt->sourcePos));
+    else
+        inlinedStmts.push_back(stmt);
+}
+
+void Inliner::visitCallStmt(const shared_ptr<CallStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    if (!inlinedGuards && instantiateCall(stmt->name, stmt->rhs, inlinedStmts))
+        return;
+    shared_ptr<CallExpr> callExpr = stmt->rhs->callExpr();
+    if (!callExpr) {
+        inlinedStmts.push_back(stmt);
+        return;
+    }
+    bool changed = false;
+    vector<shared_ptr<Expr>> args;
+    for (size_t i = 0; i < callExpr->args.size(); i++) {
+        args.push_back(processExpr(callExpr->args[i], inlinedStmts));
+        changed |= args.back() != callExpr->args[i];
+    }
+    string instanceName;
+    shared_ptr<MethodDefStmt> methodDef = lookupMethod(callExpr->function, instanceName);
+    if (methodDef && inlineMethodCall(instanceName, methodDef, args, stmt->name, stmt->interfaceType, inlinedStmts))
+        return;
+    if (changed)
+        inlinedStmts.push_back(makeAst<CallStmt>(stmt->name, stmt->interfaceType,
+                                                 makeAst<CallExpr>(callExpr->function, args, callExpr->sourcePos),
+                                                 stmt->sourcePos));
+    else
+        inlinedStmts.push_back(stmt);
+}
+
+void Inliner::visitExprStmt(const shared_ptr<ExprStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    shared_ptr<Expr> expr = processExpr(stmt->expr, inlinedStmts);
+    if (expr != stmt->expr)
+        inlinedStmts.push_back(makeAst<ExprStmt>(expr, stmt->sourcePos));
+    else
+        inlinedStmts.push_back(stmt);
+}
+
+// the body is inlined in place; calls in the test and increments stay, as they run in every iteration
+void Inliner::visitForStmt(const shared_ptr<ForStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    vector<shared_ptr<Stmt>> init;
+    for (size_t i = 0; i < stmt->init.size(); i++)
+        dispatchStmt(stmt->init[i], init);
+    keepInstancesUsedIn(stmt->test->attrs().freeVars);
+    for (size_t i = 0; i < stmt->incr.size(); i++)
+        keepInstancesUsedIn(stmt->incr[i]->attrs().freeVars);
+    shared_ptr<Stmt> body = processSubstatement(stmt->body);
+    if (init != stmt->init || body != stmt->body)
+        inlinedStmts.push_back(makeAst<ForStmt>(init, stmt->test, stmt->incr, body, stmt->sourcePos));
+    else
+        inlinedStmts.push_back(stmt);
+}
+
+void Inliner::visitIfStmt(const shared_ptr<IfStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    shared_ptr<Expr> condition = processExpr(stmt->condition, inlinedStmts);
+    shared_ptr<Stmt> thenStmt = processSubstatement(stmt->thenStmt);
+    shared_ptr<Stmt> elseStmt = processSubstatement(stmt->elseStmt);
+    if (condition != stmt->condition || thenStmt != stmt->thenStmt || elseStmt != stmt->elseStmt)
+        inlinedStmts.push_back(makeAst<IfStmt>(condition, thenStmt, elseStmt, stmt->sourcePos));
+    else
+        inlinedStmts.push_back(stmt);
+}
+
+void Inliner::visitMethodDefStmt(const shared_ptr<MethodDefStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    vector<shared_ptr<Expr>> guards;
+    vector<shared_ptr<Expr>> *enclosingGuards = inlinedGuards;
+    inlinedGuards = &guards;
+    vector<shared_ptr<Stmt>> methodStmts;
+    for (size_t i = 0; i < stmt->stmts.size(); i++)
+        dispatchStmt(stmt->stmts[i], methodStmts);
+    inlinedGuards = enclosingGuards;
+
+    inlinedStmts.push_back(makeAst<MethodDefStmt>(stmt->name, stmt->returnType, stmt->params, stmt->paramTypes,
+                                                  conjoinGuards(stmt->guard, guards), methodStmts,
+                                                  stmt->sourcePos));
+}
+
+void Inliner::visitModuleInstStmt(const shared_ptr<ModuleInstStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    if (!instantiateCall(stmt->name, stmt->rhs, inlinedStmts))
+        inlinedStmts.push_back(stmt);
+}
+
+void Inliner::visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    shared_ptr<Expr> rhs = processExpr(stmt->rhs, inlinedStmts);
+    if (rhs != stmt->rhs)
+        inlinedStmts.push_back(makeAst<RegWriteStmt>(stmt->regName, stmt->elementType, rhs, stmt->sourcePos));
+    else
+        inlinedStmts.push_back(stmt);
+}
+
+void Inliner::visitReturnStmt(const shared_ptr<ReturnStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    shared_ptr<Expr> value = processExpr(stmt->value, inlinedStmts);
+    if (value != stmt->value)
+        inlinedStmts.push_back(makeAst<ReturnStmt>(value, stmt->sourcePos));
+    else
+        inlinedStmts.push_back(stmt);
+}
+
+void Inliner::visitRuleDefStmt(const shared_ptr<RuleDefStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    vector<shared_ptr<Expr>> guards;
+    vector<shared_ptr<Expr>> *enclosingGuards = inlinedGuards;
+    inlinedGuards = &guards;
+    vector<shared_ptr<Stmt>> ruleStmts;
+    for (size_t i = 0; i < stmt->stmts.size(); i++)
+        dispatchStmt(stmt->stmts[i], ruleStmts);
+    inlinedGuards = enclosingGuards;
+
+    inlinedStmts.push_back(makeAst<RuleDefStmt>(stmt->name, conjoinGuards(stmt->guard, guards), ruleStmts,
+                                                stmt->sourcePos));
+}
+
+void Inliner::visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    shared_ptr<Expr> rhs = processExpr(stmt->rhs, inlinedStmts);
+    if (rhs != stmt->rhs)
+        inlinedStmts.push_back(makeAst<VarAssignStmt>(stmt->lhs, stmt->op, rhs, stmt->sourcePos));
+    else
+        inlinedStmts.push_back(stmt);
+}
+
+void Inliner::visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    shared_ptr<Expr> rhs = processExpr(stmt->rhs, inlinedStmts);
+    if (rhs != stmt->rhs)
+        inlinedStmts.push_back(makeAst<VarBindingStmt>(stmt->bsvtype, stmt->name, stmt->bindingType, rhs, stmt->sourcePos));
+    else
+        inlinedStmts.push_back(stmt);
+}
+
+void Inliner::visitWhileStmt(const shared_ptr<WhileStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    keepInstancesUsedIn(stmt->test->attrs().freeVars);
+    shared_ptr<Stmt> body = processSubstatement(stmt->body);
+    if (body != stmt->body)
+        inlinedStmts.push_back(makeAst<WhileStmt>(stmt->test, body, stmt->sourcePos));
+    else
+        inlinedStmts.push_back(stmt);
+}
+
+shared_ptr<Expr> Inliner::defaultExpr(const shared_ptr<Expr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    keepInstancesUsedIn(expr->attrs().freeVars);
+    return expr;
+}
+
+shared_ptr<Expr> Inliner::visitArraySubExpr(const shared_ptr<ArraySubExpr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    shared_ptr<Expr> array = processExpr(expr->array, inlinedStmts);
+    shared_ptr<Expr> index = processExpr(expr->index, inlinedStmts);
+    if (array == expr->array && index == expr->index)
+        return expr;
+    return makeAst<ArraySubExpr>(array, index, expr->sourcePos);
+}
+
+shared_ptr<Expr> Inliner::visitBitSelExpr(const shared_ptr<BitSelExpr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    shared_ptr<Expr> value = processExpr(expr->value, inlinedStmts);
+    shared_ptr<Expr> msb = processExpr(expr->msb, inlinedStmts);
+    shared_ptr<Expr> lsb = processExpr(expr->lsb, inlinedStmts);
+    if (value == expr->value && msb == expr->msb && lsb == expr->lsb)
+        return expr;
+    return makeAst<BitSelExpr>(value, msb, lsb, expr->sourcePos);
+}
+
+shared_ptr<Expr> Inliner::visitCallExpr(const shared_ptr<CallExpr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    bool changed = false;
+    vector<shared_ptr<Expr>> args;
+    for (size_t i = 0; i < expr->args.size(); i++) {
+        args.push_back(processExpr(expr->args[i], inlinedStmts));
+        changed |= args.back() != expr->args[i];
+    }
+    string instanceName;
+    if (shared_ptr<MethodDefStmt> methodDef = lookupMethod(expr->function, instanceName)) {
+        string resultName = instanceName + "$" + methodDef->name + "$" + to_string(callSiteNumber) + "$result";
+        if (inlineMethodCall(instanceName, methodDef, args, resultName, methodDef->returnType, inlinedStmts))
+            return makeAst<VarExpr>(resultName, methodDef->returnType, expr->sourcePos);
+    }
+    if (!changed)
+        return expr;
+    return makeAst<CallExpr>(expr->function, args, expr->sourcePos);
+}
+
+shared_ptr<Expr> Inliner::visitCondExpr(const shared_ptr<CondExpr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    shared_ptr<Expr> cond = processExpr(expr->cond, inlinedStmts);
+    shared_ptr<Expr> thenExpr = processConditionalExpr(expr->thenExpr, inlinedStmts);
+    shared_ptr<Expr> elseExpr = processConditionalExpr(expr->elseExpr, inlinedStmts);
+    if (cond == expr->cond && thenExpr == expr->thenExpr && elseExpr == expr->elseExpr)
+        return expr;
+    return makeAst<CondExpr>(cond, thenExpr, elseExpr, expr->sourcePos);
+}
+
+shared_ptr<Expr> Inliner::visitFieldExpr(const shared_ptr<FieldExpr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    string instanceName;
+    if (shared_ptr<MethodDefStmt> methodDef = lookupMethod(expr, instanceName)) {
+        string resultName = instanceName + "$" + methodDef->name + "$" + to_string(callSiteNumber) + "$result";
+        if (inlineMethodCall(instanceName, methodDef, vector<shared_ptr<Expr>>(), resultName, methodDef->returnType, inlinedStmts))
+            return makeAst<VarExpr>(resultName, methodDef->returnType, expr->sourcePos);
+    }
+    shared_ptr<Expr> object = processExpr(expr->object, inlinedStmts);
+    if (object == expr->object)
+        return expr;
+    return makeAst<FieldExpr>(object, expr->fieldName, expr->bsvtype, expr->sourcePos);
+}
+
+shared_ptr<Expr> Inliner::visitMethodExpr(const shared_ptr<MethodExpr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    string instanceName;
+    if (shared_ptr<MethodDefStmt> methodDef = lookupMethod(expr, instanceName)) {
+        string resultName = instanceName + "$" + methodDef->name + "$" + to_string(callSiteNumber) + "$result";
+        if (inlineMethodCall(instanceName, methodDef, vector<shared_ptr<Expr>>(), resultName, methodDef->returnType, inlinedStmts))
+            return makeAst<VarExpr>(resultName, methodDef->returnType, expr->sourcePos);
+    }
+    return expr;
+}
+
+shared_ptr<Expr> Inliner::visitOperatorExpr(const shared_ptr<OperatorExpr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts)
+{
+    shared_ptr<Expr> lhs = processExpr(expr->lhs, inlinedStmts);
+    bool shortCircuit = expr->op == "&&" || expr->op == "||";
+    shared_ptr<Expr> rhs = shortCircuit ? processConditionalExpr(expr->rhs, inlinedStmts)
+                                        : processExpr(expr->rhs, inlinedStmts);
+    if (lhs == expr->lhs && rhs == expr->rhs)
+        return expr;
+    return makeAst<OperatorExpr>(expr->op, lhs, rhs, expr->sourcePos);
 }
@@ -1,17 +1,42 @@
-
 #pragma once
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 
+#include "AstDispatch.h"
 #include "Stmt.h"
 
 using namespace std;
 
-class Inliner {
+// Flattens the module hierarchy of a simplified package.
+//
+// Each module is flattened once, in package order, and recorded as a
+// constructor. An instantiation of a known constructor is expanded from a
+// template keyed by the constructor and its static parameters; the template
+// is prepared on first use and later instances only rename it with the
+// instance prefix. Method calls on inlined instances are replaced by the
+// method bodies, and method guards are lifted into the guard of the
+// enclosing rule or method. Calls under ?:, && and || are inlined only if
+// that adds no guard and no action. An instance stays an instance if any
+// call of its methods cannot be inlined.
+class Inliner : public StmtDispatcher<Inliner, void, vector<shared_ptr<Stmt>> &>,
+                public ExprDispatcher<Inliner, shared_ptr<Expr>, vector<shared_ptr<Stmt>> &> {
+  // flattened module definitions, by constructor name
   map<string,shared_ptr<ModuleDefStmt>> constructors;
+  // instantiation templates, by constructor and static parameters
+  map<string,shared_ptr<ModuleDefStmt>> templates;
+  // submodule instances of the module being flattened
   map<string,shared_ptr<ModuleDefStmt>> instances;
+  map<string,map<string,shared_ptr<MethodDefStmt>>> instanceMethods;
+  // instances of the module being flattened that are used where they cannot be inlined
+  set<string> keptInstances;
+  // instances whose method calls were left in place by this pass over the module
+  set<string> uninlinedInstances;
+  // guards of methods inlined into the current rule or method, null outside of them
+  vector<shared_ptr<Expr>> *inlinedGuards = nullptr;
+  int callSiteNumber = 0;
  public:
   Inliner() {}
   ~Inliner() {}
@@ -20,4 +45,50 @@ class Inliner {
   shared_ptr<ModuleDefStmt> processModuleDef(const shared_ptr<ModuleDefStmt> &moduleDef);
   vector<shared_ptr<Stmt>> processStmt(const shared_ptr<Stmt> &stmt);
 
+  void defaultStmt(const shared_ptr<Stmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts);
+  void visitBlockStmt(const shared_ptr<BlockStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts);
+  void visitCallStmt(const shared_ptr<CallStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts);
+  void visitExprStmt(const shared_ptr<ExprStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts);
+  void visitForStmt(const shared_ptr<ForStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts);
+  void visitIfStmt(const shared_ptr<IfStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts);
+  void visitMethodDefStmt(const shared_ptr<MethodDefStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts);
+  void visitModuleInstStmt(const shared_ptr<ModuleInstStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts);
+  void visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts);
+  void visitReturnStmt(const shared_ptr<ReturnStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts);
+  void visitRuleDefStmt(const shared_ptr<RuleDefStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts);
+  void visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts);
+  void visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts);
+  void visitWhileStmt(const shared_ptr<WhileStmt> &stmt, vector<shared_ptr<Stmt>> &inlinedStmts);
+
+  shared_ptr<Expr> defaultExpr(const shared_ptr<Expr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts);
+  shared_ptr<Expr> visitArraySubExpr(const shared_ptr<ArraySubExpr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts);
+  shared_ptr<Expr> visitBitSelExpr(const shared_ptr<BitSelExpr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts);
+  shared_ptr<Expr> visitCallExpr(const shared_ptr<CallExpr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts);
+  shared_ptr<Expr> visitCondExpr(const shared_ptr<CondExpr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts);
+  shared_ptr<Expr> visitFieldExpr(const shared_ptr<FieldExpr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts);
+  shared_ptr<Expr> visitMethodExpr(const shared_ptr<MethodExpr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts);
+  shared_ptr<Expr> visitOperatorExpr(const shared_ptr<OperatorExpr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts);
+
+ private:
+  shared_ptr<ModuleDefStmt> instantiate(const string &instanceName, const shared_ptr<ModuleDefStmt> &constructorDef,
+                                        const vector<shared_ptr<Expr>> &args);
+  bool instantiateCall(const string &instanceName, const shared_ptr<Expr> &rhs, vector<shared_ptr<Stmt>> &inlinedStmts);
+  shared_ptr<MethodDefStmt> lookupMethod(const shared_ptr<Expr> &function, string &instanceName);
+  bool canInline(const string &instanceName, const shared_ptr<MethodDefStmt> &methodDef,
+                 const vector<shared_ptr<Expr>> &args);
+  bool inlineMethodCall(const string &instanceName, const shared_ptr<MethodDefStmt> &methodDef,
+                        const vector<shared_ptr<Expr>> &args,
+                        const string &resultName, const shared_ptr<BSVType> &resultType,
+                        vector<shared_ptr<Stmt>> &inlinedStmts);
+  // assigns returned values to resultName; statements after a return are skipped by testing returnedName
+  void bindReturns(const vector<shared_ptr<Stmt>> &stmts, const string &resultName,
+                   const shared_ptr<BSVType> &resultType, const string &returnedName,
+                   vector<shared_ptr<Stmt>> &inlinedStmts);
+  void bindReturns(const shared_ptr<Stmt> &stmt, const string &resultName, const shared_ptr<BSVType> &resultType,
+                   const string &returnedName, vector<shared_ptr<Stmt>> &inlinedStmts);
+  shared_ptr<Stmt> processSubstatement(const shared_ptr<Stmt> &stmt);
+  shared_ptr<Expr> processExpr(const shared_ptr<Expr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts);
+  void keepInstancesUsedIn(const VarSet &freeVars);
+  // for operands that are evaluated only under a condition
+  shared_ptr<Expr> processConditionalExpr(const shared_ptr<Expr> &expr, vector<shared_ptr<Stmt>> &inlinedStmts);
 };
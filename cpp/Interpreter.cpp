@@ -0,0 +1,532 @@
+#include <ctype.h>
+
+#include "Interpreter.h"
+
+// loops still running after this many iterations make the rule fail
+static const long maxLoopIterations = 1 << 20;
+
+static shared_ptr<Value> zeroValue(const shared_ptr<BSVType> &bsvtype) {
+    if (bsvtype && bsvtype->name == "Bool")
+        return make_shared<BoolValue>(false);
+    if (int width = bsvtype ? bsvtype->bitWidth() : 0)
+        return bitsValue(BitVector(width));
+    return make_shared<IntValue>(0);
+}
+
+Interpreter::Interpreter(const vector<shared_ptr<Stmt>> &packageStmts, ostream &out)
+        : out(out), packageContext(make_shared<ValueContext>()), context(packageContext) {
+    for (size_t i = 0; i < packageStmts.size(); i++) {
+        shared_ptr<Stmt> stmt = packageStmts[i];
+        if (!stmt)
+            continue;
+        if (shared_ptr<ModuleDefStmt> moduleDef = stmt->moduleDefStmt())
+            moduleDefs[moduleDef->name] = moduleDef;
+        else if (shared_ptr<FunctionDefStmt> functionDef = stmt->functionDefStmt())
+            packageContext->bind(functionDef->name, make_shared<FunctionValue>(functionDef, packageContext));
+        else if (shared_ptr<VarBindingStmt> varBinding = stmt->varBindingStmt())
+            packageContext->bind(varBinding->name, eval(varBinding->rhs));
+    }
+}
+
+bool Interpreter::load(const string &moduleName) {
+    auto it = moduleDefs.find(moduleName);
+    if (it == moduleDefs.cend()) {
+        cerr << "Interpreter: no module " << moduleName << endl;
+        return false;
+    }
+    shared_ptr<ModuleDefStmt> moduleDef = it->second;
+    if (moduleDef->params.size())
+        cerr << "Interpreter: parameters of " << moduleName << " are not bound" << endl;
+    moduleContext = make_shared<ValueContext>(packageContext);
+    context = moduleContext;
+    vector<shared_ptr<RuleDefStmt>> ruleDefs;
+    int numMethods = 0;
+    for (size_t i = 0; i < moduleDef->stmts.size(); i++) {
+        shared_ptr<Stmt> stmt = moduleDef->stmts[i];
+        switch (stmt->stmtType) {
+            case RegisterStmtType: {
+                shared_ptr<RegisterStmt> registerStmt = static_pointer_cast<RegisterStmt>(stmt);
+                // the simplified AST does not keep the reset values
+                registerIndex[registerStmt->regName] = (int)registers.size();
+                registers.push_back(make_shared<RegValue>(registerStmt->regName, zeroValue(registerStmt->elementType)));
+                registerTypes.push_back(registerStmt->elementType);
+                lastWrite.push_back(0);
+            }
+                break;
+            case RuleDefStmtType:
+                ruleDefs.push_back(static_pointer_cast<RuleDefStmt>(stmt));
+                break;
+            case ModuleInstStmtType:
+                cerr << "Interpreter: instance " << static_pointer_cast<ModuleInstStmt>(stmt)->name
+                     << " at " << stmt->sourcePos.toString() << " is not simulated" << endl;
+                break;
+            case MethodDefStmtType:
+                // nothing calls the methods of the top module
+                numMethods++;
+                break;
+            default:
+                execute(stmt);
+        }
+    }
+    for (size_t i = 0; i < ruleDefs.size(); i++)
+        addRule(ruleDefs[i]);
+    if (rules.empty()) {
+        cerr << "Interpreter: module " << moduleName << " has no rules to run";
+        if (numMethods)
+            cerr << "; its methods only run when called from another module";
+        cerr << endl;
+    }
+    return !rules.empty();
+}
+
+void Interpreter::addRule(const shared_ptr<RuleDefStmt> &ruleDef) {
+    SimRule rule;
+    rule.ruleDef = ruleDef;
+    if (ruleDef->guard) {
+        const VarSet &guardVars = ruleDef->guard->attrs().freeVars;
+        for (auto it = guardVars.begin(); it != guardVars.end(); ++it) {
+            string name = it->name();
+            auto regIt = registerIndex.find(name);
+            if (regIt != registerIndex.cend())
+                rule.guardReads.push_back(regIt->second);
+            else if (!moduleContext->lookup(name) && name != "True" && name != "False")
+                rule.guardReadsKnown = false;
+        }
+    }
+    rules.push_back(rule);
+}
+
+long Interpreter::run(long maxCycles) {
+    long cycle = 0;
+    for (; cycle < maxCycles && !finished; cycle++) {
+        bool fired = false;
+        for (size_t i = 0; i < rules.size() && !finished; i++) {
+            if (evalGuard(rules[i]) && fire(rules[i]))
+                fired = true;
+        }
+        if (!fired) {
+            cerr << "Interpreter: no rule can fire in cycle " << cycle << endl;
+            break;
+        }
+    }
+    cerr << "Interpreter: " << cycle << " cycles, " << guardEvaluations << " guard evaluations, "
+         << guardsSkipped << " skipped" << endl;
+    for (size_t i = 0; i < rules.size(); i++)
+        cerr << "    rule " << rules[i].ruleDef->name << " fired " << rules[i].firings << " times" << endl;
+    return cycle;
+}
+
+bool Interpreter::evalGuard(SimRule &rule) {
+    if (!rule.ruleDef->guard)
+        return true;
+    if (rule.guardStamp && rule.guardReadsKnown) {
+        bool stale = false;
+        for (size_t i = 0; i < rule.guardReads.size() && !stale; i++)
+            stale = lastWrite[rule.guardReads[i]] > rule.guardStamp;
+        if (!stale) {
+            guardsSkipped++;
+            return rule.guardValue;
+        }
+    }
+    guardEvaluations++;
+    context = make_shared<ValueContext>(moduleContext);
+    shared_ptr<Value> value = eval(rule.ruleDef->guard);
+    context = moduleContext;
+    shared_ptr<BoolValue> boolValue = value ? value->boolValue() : shared_ptr<BoolValue>();
+    if (!boolValue)
+        cerr << "Interpreter: guard of rule " << rule.ruleDef->name << " could not be evaluated" << endl;
+    rule.guardValue = boolValue && boolValue->value;
+    rule.guardStamp = writeStamp;
+    return rule.guardValue;
+}
+
+bool Interpreter::fire(SimRule &rule) {
+    context = make_shared<ValueContext>(moduleContext);
+    written.clear();
+    bool executed = true;
+    for (size_t i = 0; executed && i < rule.ruleDef->stmts.size(); i++)
+        executed = execute(rule.ruleDef->stmts[i]);
+    context = moduleContext;
+    if (!executed) {
+        for (size_t i = 0; i < written.size(); i++)
+            registers[written[i]]->newValue.reset();
+        return false;
+    }
+    // the writes of the rule take effect together
+    writeStamp++;
+    for (size_t i = 0; i < written.size(); i++) {
+        registers[written[i]]->commit();
+        lastWrite[written[i]] = writeStamp;
+    }
+    rule.firings++;
+    return true;
+}
+
+bool Interpreter::execute(const shared_ptr<Stmt> &stmt) {
+    if (!stmt)
+        return true;
+    return dispatchStmt(stmt);
+}
+
+bool Interpreter::defaultStmt(const shared_ptr<Stmt> &stmt) {
+    cerr << "Interpreter: cannot execute statement at " << stmt->sourcePos.toString() << endl;
+    stmt->prettyPrint(cerr, 1);
+    return false;
+}
+
+bool Interpreter::visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt) {
+    shared_ptr<Value> value = eval(stmt->rhs);
+    if (!value)
+        return false;
+    context->bind(stmt->name, value);
+    return true;
+}
+
+bool Interpreter::visitBlockStmt(const shared_ptr<BlockStmt> &stmt) {
+    shared_ptr<ValueContext> savedContext = context;
+    context = make_shared<ValueContext>(savedContext);
+    bool executed = true;
+    for (size_t i = 0; executed && !returnValue && i < stmt->stmts.size(); i++)
+        executed = execute(stmt->stmts[i]);
+    context = savedContext;
+    return executed;
+}
+
+bool Interpreter::visitCallStmt(const shared_ptr<CallStmt> &stmt) {
+    shared_ptr<Value> value = eval(stmt->rhs);
+    if (!value)
+        return false;
+    if (stmt->name != "unused")
+        context->bind(stmt->name, value);
+    return true;
+}
+
+bool Interpreter::visitExprStmt(const shared_ptr<ExprStmt> &stmt) {
+    return eval(stmt->expr) != nullptr;
+}
+
+bool Interpreter::visitForStmt(const shared_ptr<ForStmt> &stmt) {
+    shared_ptr<ValueContext> savedContext = context;
+    context = make_shared<ValueContext>(savedContext);
+    bool executed = true;
+    for (size_t i = 0; executed && i < stmt->init.size(); i++)
+        executed = execute(stmt->init[i]);
+    executed = executed && executeLoop(stmt->test, stmt->incr, stmt->body);
+    context = savedContext;
+    return executed;
+}
+
+bool Interpreter::visitWhileStmt(const shared_ptr<WhileStmt> &stmt) {
+    return executeLoop(stmt->test, vector<shared_ptr<Stmt>>(), stmt->body);
+}
+
+bool Interpreter::executeLoop(const shared_ptr<Expr> &test, const vector<shared_ptr<Stmt>> &incr,
+                              const shared_ptr<Stmt> &body) {
+    for (long iteration = 0; iteration < maxLoopIterations; iteration++) {
+        shared_ptr<Value> condition = eval(test);
+        shared_ptr<BoolValue> boolValue = condition ? condition->boolValue() : shared_ptr<BoolValue>();
+        if (!boolValue)
+            return false;
+        if (!boolValue->value)
+            return true;
+        if (!execute(body))
+            return false;
+        if (returnValue)
+            return true;
+        for (size_t i = 0; i < incr.size(); i++) {
+            if (!execute(incr[i]))
+                return false;
+        }
+    }
+    cerr << "Interpreter: loop at " << test->sourcePos.toString() << " did not terminate" << endl;
+    return false;
+}
+
+bool Interpreter::visitIfStmt(const shared_ptr<IfStmt> &stmt) {
+    shared_ptr<Value> condition = eval(stmt->condition);
+    shared_ptr<BoolValue> boolValue = condition ? condition->boolValue() : shared_ptr<BoolValue>();
+    if (!boolValue)
+        return false;
+    return execute(boolValue->value ? stmt->thenStmt : stmt->elseStmt);
+}
+
+bool Interpreter::visitRegReadStmt(const shared_ptr<RegReadStmt> &stmt) {
+    auto it = registerIndex.find(stmt->regName);
+    if (it == registerIndex.cend())
+        return defaultStmt(stmt);
+    context->bind(stmt->var, registers[it->second]->read());
+    return true;
+}
+
+bool Interpreter::visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt) {
+    auto it = registerIndex.find(stmt->regName);
+    if (it == registerIndex.cend())
+        return defaultStmt(stmt);
+    shared_ptr<Value> value = eval(stmt->rhs);
+    if (!value)
+        return false;
+    int regIndex = it->second;
+    registers[regIndex]->update(resize(value, registerTypes[regIndex], false));
+    written.push_back(regIndex);
+    return true;
+}
+
+bool Interpreter::visitReturnStmt(const shared_ptr<ReturnStmt> &stmt) {
+    returnValue = eval(stmt->value);
+    return returnValue != nullptr;
+}
+
+bool Interpreter::visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt) {
+    shared_ptr<VarLValue> varLValue = stmt->lhs->varLValue();
+    if (!varLValue || stmt->op != "=")
+        return defaultStmt(stmt);
+    shared_ptr<Value> value = eval(stmt->rhs);
+    if (!value)
+        return false;
+    context->assign(varLValue->name, resize(value, varLValue->bsvtype, false));
+    return true;
+}
+
+bool Interpreter::visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt) {
+    // a declaration without a value, such as the result of an inlined method, starts out as zero
+    shared_ptr<Value> value = stmt->rhs ? eval(stmt->rhs) : zeroValue(stmt->bsvtype);
+    if (!value)
+        return false;
+    context->bind(stmt->name, resize(value, stmt->bsvtype, false));
+    return true;
+}
+
+shared_ptr<Value> Interpreter::eval(const shared_ptr<Expr> &expr) {
+    if (!expr)
+        return shared_ptr<Value>();
+    return dispatchExpr(expr);
+}
+
+shared_ptr<Value> Interpreter::defaultExpr(const shared_ptr<Expr> &expr) {
+    cerr << "Interpreter: cannot evaluate expression at " << expr->sourcePos.toString() << ": ";
+    expr->prettyPrint(cerr, 0);
+    cerr << endl;
+    return shared_ptr<Value>();
+}
+
+shared_ptr<Value> Interpreter::visitBitConcatExpr(const shared_ptr<BitConcatExpr> &expr) {
+    BitVector bits;
+    for (size_t i = 0; i < expr->values.size(); i++) {
+        BitVector valueBits = ::valueBits(eval(expr->values[i]));
+        if (!valueBits.getWidth())
+            return shared_ptr<Value>();
+        bits = bits.concat(valueBits);
+    }
+    return bitsValue(bits);
+}
+
+shared_ptr<Value> Interpreter::visitBitSelExpr(const shared_ptr<BitSelExpr> &expr) {
+    shared_ptr<Value> value = eval(expr->value);
+    shared_ptr<Value> msb = eval(expr->msb);
+    shared_ptr<Value> lsb = expr->lsb ? eval(expr->lsb) : msb;
+    if (!value || !msb || !msb->intValue() || !lsb || !lsb->intValue())
+        return shared_ptr<Value>();
+    if (shared_ptr<BitValue> bitValue = value->bitValue())
+        return bitValue->sub(msb->intValue()->value, lsb->intValue()->value);
+    if (shared_ptr<IntValue> intValue = value->intValue())
+        return intValue->sub(msb->intValue()->value, lsb->intValue()->value);
+    return shared_ptr<Value>();
+}
+
+shared_ptr<Value> Interpreter::visitCallExpr(const shared_ptr<CallExpr> &expr) {
+    vector<shared_ptr<Value>> args;
+    for (size_t i = 0; i < expr->args.size(); i++) {
+        shared_ptr<Value> arg = eval(expr->args[i]);
+        if (!arg)
+            return shared_ptr<Value>();
+        args.push_back(arg);
+    }
+    if (shared_ptr<VarExpr> function = expr->function->varExpr()) {
+        const string &name = function->name;
+        if (name == "$display" || name == "$write") {
+            vector<bool> signedArgs;
+            for (size_t i = 0; i < expr->args.size(); i++)
+                signedArgs.push_back(isSignedExpr(expr->args[i]));
+            return display(name, args, signedArgs) ? make_shared<VoidValue>() : shared_ptr<Value>();
+        }
+        if (name == "$finish") {
+            finished = true;
+            return make_shared<VoidValue>();
+        }
+        if (name == "dynamicAssert" && args.size() == 2) {
+            shared_ptr<BoolValue> condition = args[0]->boolValue();
+            if (condition && !condition->value)
+                cerr << "Interpreter: assertion failed at " << expr->sourcePos.toString() << ": "
+                     << args[1]->to_string() << endl;
+            return make_shared<VoidValue>();
+        }
+        if ((name == "pack" || name == "unpack") && args.size() == 1)
+            return args[0];
+        if ((name == "zeroExtend" || name == "signExtend" || name == "extend" || name == "truncate")
+            && args.size() == 1) {
+            shared_ptr<BSVType> argType = expr->args[0]->bsvtype;
+            bool signExtend = name == "signExtend" || (name == "extend" && argType && argType->name == "Int");
+            return resize(args[0], expr->bsvtype, signExtend);
+        }
+    }
+    shared_ptr<Value> function = eval(expr->function);
+    shared_ptr<FunctionValue> functionValue = function ? function->functionValue() : shared_ptr<FunctionValue>();
+    if (!functionValue)
+        return defaultExpr(expr);
+    return callFunction(functionValue, args);
+}
+
+shared_ptr<Value> Interpreter::callFunction(const shared_ptr<FunctionValue> &function,
+                                            const vector<shared_ptr<Value>> &args) {
+    shared_ptr<FunctionDefStmt> functionDef = function->functionDef;
+    if (functionDef->params.size() != args.size())
+        return shared_ptr<Value>();
+    shared_ptr<ValueContext> savedContext = context;
+    shared_ptr<Value> savedReturnValue = returnValue;
+    context = make_shared<ValueContext>(function->context);
+    for (size_t i = 0; i < args.size(); i++)
+        context->bind(functionDef->params[i], args[i]);
+    returnValue.reset();
+    bool executed = true;
+    for (size_t i = 0; executed && !returnValue && i < functionDef->stmts.size(); i++)
+        executed = execute(functionDef->stmts[i]);
+    shared_ptr<Value> result = executed ? returnValue : shared_ptr<Value>();
+    context = savedContext;
+    returnValue = savedReturnValue;
+    return result;
+}
+
+static string decimal(const BitVector &bits, bool isSigned) {
+    if (isSigned && bits.isNegative())
+        return "-" + (-bits).toString(10);
+    return bits.toString(10);
+}
+
+// Formats the arguments of $display and $write: %d, %h, %x, %b, %s and %%,
+// with any field width ignored. Arguments without a format are printed in
+// decimal, with a sign if they are Int#(n).
+bool Interpreter::display(const string &task, const vector<shared_ptr<Value>> &args, const vector<bool> &signedArgs) {
+    size_t argIndex = 0;
+    while (argIndex < args.size()) {
+        bool isSigned = signedArgs[argIndex];
+        shared_ptr<Value> arg = args[argIndex++];
+        shared_ptr<StringValue> format = arg->stringValue();
+        if (!format) {
+            BitVector bits = valueBits(arg);
+            out << (bits.getWidth() ? decimal(bits, isSigned) : arg->to_string());
+            continue;
+        }
+        const string &str = format->value;
+        for (size_t i = 0; i < str.size(); i++) {
+            if (str[i] != '%' || i + 1 == str.size()) {
+                out << str[i];
+                continue;
+            }
+            i++;
+            while (i < str.size() && isdigit(str[i]))
+                i++;
+            char conversion = (char)tolower(str[i]);
+            if (conversion == '%') {
+                out << '%';
+                continue;
+            }
+            if (argIndex == args.size()) {
+                cerr << "Interpreter: missing argument for " << task << " format \"" << str << "\"" << endl;
+                return false;
+            }
+            isSigned = signedArgs[argIndex];
+            shared_ptr<Value> value = args[argIndex++];
+            BitVector bits = valueBits(value);
+            shared_ptr<IntValue> intValue = value->intValue();
+            shared_ptr<BoolValue> boolValue = value->boolValue();
+            if (conversion == 's' || (!bits.getWidth() && !intValue && !boolValue)) {
+                out << value->to_string();
+            } else if (boolValue) {
+                out << (boolValue->value ? 1 : 0);
+            } else if (!bits.getWidth()) {
+                // Integer
+                if (conversion == 'h' || conversion == 'x')
+                    out << hex << intValue->value << dec;
+                else
+                    out << intValue->value;
+            } else {
+                int base = (conversion == 'h' || conversion == 'x') ? 16 : (conversion == 'b') ? 2
+                           : (conversion == 'o') ? 8 : 10;
+                out << (base == 10 ? decimal(bits, isSigned) : bits.toString(base));
+            }
+        }
+    }
+    if (task == "$display")
+        out << endl;
+    return true;
+}
+
+// Truncates or extends sized values and Integers to the width of bsvtype
+shared_ptr<Value> Interpreter::resize(const shared_ptr<Value> &value, const shared_ptr<BSVType> &bsvtype,
+                                      bool signExtend) {
+    int width = bsvtype ? bsvtype->bitWidth() : 0;
+    if (!width || !value)
+        return value;
+    shared_ptr<IntValue> intValue = value->intValue();
+    if (intValue && !intValue->width)
+        return bitsValue(BitVector(64, intValue->value).signExtend(width));
+    BitVector bits = valueBits(value);
+    if (!bits.getWidth() || bits.getWidth() == width)
+        return value;
+    return bitsValue(signExtend ? bits.signExtend(width) : bits.zeroExtend(width));
+}
+
+shared_ptr<Value> Interpreter::visitCondExpr(const shared_ptr<CondExpr> &expr) {
+    shared_ptr<Value> cond = eval(expr->cond);
+    shared_ptr<BoolValue> boolValue = cond ? cond->boolValue() : shared_ptr<BoolValue>();
+    if (!boolValue)
+        return shared_ptr<Value>();
+    return eval(boolValue->value ? expr->thenExpr : expr->elseExpr);
+}
+
+shared_ptr<Value> Interpreter::visitIntConst(const shared_ptr<IntConst> &expr) {
+    return literalValue(expr->repr);
+}
+
+shared_ptr<Value> Interpreter::visitOperatorExpr(const shared_ptr<OperatorExpr> &expr) {
+    shared_ptr<Value> lhs = eval(expr->lhs);
+    if (!lhs)
+        return shared_ptr<Value>();
+    if (!expr->rhs)
+        return lhs->unop(expr->op);
+    shared_ptr<BoolValue> lhsBool = lhs->boolValue();
+    if (lhsBool && ((expr->op == "&&" && !lhsBool->value) || (expr->op == "||" && lhsBool->value)))
+        return lhs;
+    shared_ptr<Value> rhs = eval(expr->rhs);
+    if (!rhs)
+        return shared_ptr<Value>();
+    bool isSigned = isSignedExpr(expr->lhs) || (expr->op != "<<" && expr->op != ">>" && isSignedExpr(expr->rhs));
+    shared_ptr<Value> result = isSigned ? signedBinop(expr->op, lhs, rhs) : lhs->binop(expr->op, rhs);
+    if (!result)
+        return defaultExpr(expr);
+    return result;
+}
+
+shared_ptr<Value> Interpreter::visitStringConst(const shared_ptr<StringConst> &expr) {
+    return make_shared<StringValue>(expr->repr);
+}
+
+shared_ptr<Value> Interpreter::visitValueofExpr(const shared_ptr<ValueofExpr> &expr) {
+    shared_ptr<BSVType> argtype = expr->argtype->eval();
+    if (!argtype->isNumeric())
+        return defaultExpr(expr);
+    return make_shared<IntValue>(argtype->numericValue());
+}
+
+shared_ptr<Value> Interpreter::visitVarExpr(const shared_ptr<VarExpr> &expr) {
+    const string &name = expr->name;
+    if (name == "True" || name == "False")
+        return make_shared<BoolValue>(name == "True");
+    if (shared_ptr<Value> value = context->lookup(name))
+        return value;
+    // guards read registers directly
+    auto it = registerIndex.find(name);
+    if (it != registerIndex.cend())
+        return registers[it->second]->read();
+    return defaultExpr(expr);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AstDispatch.h"
+#include "Stmt.h"
+#include "Value.h"
+
+using namespace std;
+
+// Executes a flattened, simplified module, see Inliner.
+//
+// Rules fire one at a time: in each cycle the rules are tried in the order
+// they were declared and each rule whose guard holds runs to completion
+// and commits its register writes before the next rule is tried. A rule
+// that reaches a statement it cannot execute does not fire.
+//
+// Guards are only re-evaluated when a register they read has been written
+// since they were last evaluated. Guards that read anything other than
+// registers and module-level bindings are evaluated every time.
+class Interpreter : public StmtDispatcher<Interpreter, bool>,
+                    public ExprDispatcher<Interpreter, shared_ptr<Value>> {
+  struct SimRule {
+    shared_ptr<RuleDefStmt> ruleDef;
+    // indices of the registers read by the guard
+    vector<int> guardReads;
+    // false if the guard depends on more than guardReads
+    bool guardReadsKnown = true;
+    bool guardValue = false;
+    // value of writeStamp when the guard was evaluated, 0 if never
+    long guardStamp = 0;
+    long firings = 0;
+  };
+
+  ostream &out;
+  map<string,shared_ptr<ModuleDefStmt>> moduleDefs;
+  shared_ptr<ValueContext> packageContext;
+  shared_ptr<ValueContext> moduleContext;
+  shared_ptr<ValueContext> context;
+  map<string,int> registerIndex;
+  vector<shared_ptr<RegValue>> registers;
+  vector<shared_ptr<BSVType>> registerTypes;
+  // value of writeStamp at the last write of each register
+  vector<long> lastWrite;
+  long writeStamp = 1;
+  vector<SimRule> rules;
+  // registers written by the rule being fired
+  vector<int> written;
+  shared_ptr<Value> returnValue;
+  bool finished = false;
+  long guardEvaluations = 0;
+  long guardsSkipped = 0;
+ public:
+  Interpreter(const vector<shared_ptr<Stmt>> &packageStmts, ostream &out = cout);
+  ~Interpreter() {}
+
+  // prepares the registers and rules of the module, false if it has no rules to run
+  bool load(const string &moduleName);
+  // returns the number of cycles run, which is less than maxCycles
+  // after $finish or when no rule can fire
+  long run(long maxCycles);
+
+  // null if the expression cannot be evaluated
+  shared_ptr<Value> eval(const shared_ptr<Expr> &expr);
+  // false if the statement cannot be executed
+  bool execute(const shared_ptr<Stmt> &stmt);
+
+  bool defaultStmt(const shared_ptr<Stmt> &stmt);
+  bool visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt);
+  bool visitBlockStmt(const shared_ptr<BlockStmt> &stmt);
+  bool visitCallStmt(const shared_ptr<CallStmt> &stmt);
+  bool visitExprStmt(const shared_ptr<ExprStmt> &stmt);
+  bool visitForStmt(const shared_ptr<ForStmt> &stmt);
+  bool visitIfStmt(const shared_ptr<IfStmt> &stmt);
+  bool visitRegReadStmt(const shared_ptr<RegReadStmt> &stmt);
+  bool visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt);
+  bool visitReturnStmt(const shared_ptr<ReturnStmt> &stmt);
+  bool visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt);
+  bool visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt);
+  bool visitWhileStmt(const shared_ptr<WhileStmt> &stmt);
+
+  shared_ptr<Value> defaultExpr(const shared_ptr<Expr> &expr);
+  shared_ptr<Value> visitBitConcatExpr(const shared_ptr<BitConcatExpr> &expr);
+  shared_ptr<Value> visitBitSelExpr(const shared_ptr<BitSelExpr> &expr);
+  shared_ptr<Value> visitCallExpr(const shared_ptr<CallExpr> &expr);
+  shared_ptr<Value> visitCondExpr(const shared_ptr<CondExpr> &expr);
+  shared_ptr<Value> visitIntConst(const shared_ptr<IntConst> &expr);
+  shared_ptr<Value> visitOperatorExpr(const shared_ptr<OperatorExpr> &expr);
+  shared_ptr<Value> visitStringConst(const shared_ptr<StringConst> &expr);
+  shared_ptr<Value> visitValueofExpr(const shared_ptr<ValueofExpr> &expr);
+  shared_ptr<Value> visitVarExpr(const shared_ptr<VarExpr> &expr);
+
+ private:
+  void addRule(const shared_ptr<RuleDefStmt> &ruleDef);
+  bool evalGuard(SimRule &rule);
+  bool fire(SimRule &rule);
+  bool executeLoop(const shared_ptr<Expr> &test, const vector<shared_ptr<Stmt>> &incr, const shared_ptr<Stmt> &body);
+  shared_ptr<Value> callFunction(const shared_ptr<FunctionValue> &function, const vector<shared_ptr<Value>> &args);
+  bool display(const string &task, const vector<shared_ptr<Value>> &args, const vector<bool> &signedArgs);
+  shared_ptr<Value> resize(const shared_ptr<Value> &value, const shared_ptr<BSVType> &bsvtype, bool signExtend);
+};
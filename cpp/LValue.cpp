@@ -9,8 +9,11 @@
 
 VarLValue::VarLValue(const string &name, const shared_ptr<BSVType> &bsvtype)
 : LValue(VarLValueType), name(name), bsvtype(bsvtype) {
-    attrs_.boundVars[name] = bsvtype;
-    attrs_.freeVars[name] = bsvtype;
+}
+
+void VarLValue::computeAttrs(LValueAttrs &attrs) {
+    attrs.boundVars.insert(name, bsvtype);
+    attrs.freeVars.insert(name, bsvtype);
 }
 
 VarLValue::~VarLValue(){}
@@ -25,20 +28,20 @@ shared_ptr<VarLValue> VarLValue::varLValue() {
 
 shared_ptr<LValue> VarLValue::rename(string prefix, shared_ptr<LexicalScope> &scope)
 {
-    //FIXME:
     shared_ptr<Declaration> binding = scope->lookup(name);
-    if (binding) {
-        return make_shared<VarLValue>(binding->name, binding->bsvtype);
-    } else {
-        return make_shared<VarLValue>(name, binding->bsvtype);
-    }
+    if (!binding || binding->name == name)
+        return shared_from_this();
+    return makeAst<VarLValue>(binding->name, binding->bsvtype);
 }
 
 FieldLValue::FieldLValue(const shared_ptr<Expr> &obj, const string &field)
 : LValue(FieldLValueType), obj(obj), field(field) {
-    uniteSet(attrs_.assignedVars, obj->attrs().freeVars);
+}
+
+void FieldLValue::computeAttrs(LValueAttrs &attrs) {
+    attrs.assignedVars.unite(obj->attrs().freeVars);
 
-    uniteSet(attrs_.freeVars, obj->attrs().freeVars);
+    attrs.freeVars.unite(obj->attrs().freeVars);
 }
 
 FieldLValue::~FieldLValue() {}
@@ -53,19 +56,24 @@ shared_ptr<FieldLValue> FieldLValue::fieldLValue() {
 
 shared_ptr<struct LValue> FieldLValue::rename(string prefix, shared_ptr<LexicalScope> &scope)
 {
-    return shared_ptr<LValue>(new FieldLValue(obj->rename(prefix, scope), field));
+    if (!scope->renamesAny(attrs().freeVars))
+        return shared_from_this();
+    return makeAst<FieldLValue>(obj->rename(prefix, scope), field);
 }
 
 shared_ptr<LValue> FieldLValue::create(shared_ptr<Expr> obj, string fieldname) {
-    return shared_ptr<LValue>(new FieldLValue(obj, fieldname));
+    return makeAst<FieldLValue>(obj, fieldname);
 }
 
 ArraySubLValue::ArraySubLValue(const shared_ptr<Expr> &array, const shared_ptr<Expr> &index)
 : LValue(ArraySubLValueType), array(array), index(index) {
-    uniteSet(attrs_.assignedVars, array->attrs().freeVars);
+}
+
+void ArraySubLValue::computeAttrs(LValueAttrs &attrs) {
+    attrs.assignedVars.unite(array->attrs().freeVars);
 
-    uniteSet(attrs_.freeVars, array->attrs().freeVars);
-    uniteSet(attrs_.freeVars, index->attrs().freeVars);
+    attrs.freeVars.unite(array->attrs().freeVars);
+    attrs.freeVars.unite(index->attrs().freeVars);
 }
 
 ArraySubLValue::~ArraySubLValue() {
@@ -84,21 +92,25 @@ shared_ptr<ArraySubLValue> ArraySubLValue::arraySubLValue() {
 }
 
 shared_ptr<struct LValue> ArraySubLValue::rename(string prefix, shared_ptr<LexicalScope> &scope) {
+    if (!scope->renamesAny(attrs().freeVars))
+        return shared_from_this();
     return create(array->rename(prefix, scope), index->rename(prefix, scope));
 }
 
 shared_ptr<LValue> ArraySubLValue::create(shared_ptr<Expr> array, const shared_ptr<Expr> &index) {
-    return shared_ptr<LValue>(new ArraySubLValue(array, index));
+    return makeAst<ArraySubLValue>(array, index);
 }
 
 RangeSelLValue::RangeSelLValue(const shared_ptr<Expr> &bitarray, const shared_ptr<Expr> &msb, const shared_ptr<Expr> &lsb)
 : LValue(RangeSelLValueType), bitarray(bitarray), msb(msb), lsb(lsb) {
-    uniteSet(attrs_.assignedVars, bitarray->attrs().freeVars);
+}
 
-    uniteSet(attrs_.freeVars, bitarray->attrs().freeVars);
-    uniteSet(attrs_.freeVars, msb->attrs().freeVars);
-    uniteSet(attrs_.freeVars, lsb->attrs().freeVars);
+void RangeSelLValue::computeAttrs(LValueAttrs &attrs) {
+    attrs.assignedVars.unite(bitarray->attrs().freeVars);
 
+    attrs.freeVars.unite(bitarray->attrs().freeVars);
+    attrs.freeVars.unite(msb->attrs().freeVars);
+    attrs.freeVars.unite(lsb->attrs().freeVars);
 }
 
 RangeSelLValue::~RangeSelLValue(){}
@@ -113,7 +125,9 @@ void RangeSelLValue::prettyPrint(ostream &out, int depth) {
 }
 
 shared_ptr<struct LValue> RangeSelLValue::rename(string prefix, shared_ptr<LexicalScope> &scope) {
-    return make_shared<RangeSelLValue>(bitarray->rename(prefix, scope), msb->rename(prefix, scope), lsb->rename(prefix, scope));
+    if (!scope->renamesAny(attrs().freeVars))
+        return shared_from_this();
+    return makeAst<RangeSelLValue>(bitarray->rename(prefix, scope), msb->rename(prefix, scope), lsb->rename(prefix, scope));
 }
 
 shared_ptr<RangeSelLValue> RangeSelLValue::rangeSelLValue() {
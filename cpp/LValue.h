@@ -7,6 +7,7 @@
 
 #include <memory>
 
+#include "AstArena.h"
 #include "Expr.h"
 #include "LexicalScope.h"
 
@@ -27,16 +28,22 @@ class RangeSelLValue;
 
 class LValueAttrs {
 public:
-    map<string,shared_ptr<BSVType>> boundVars;
-    map<string,shared_ptr<BSVType>> assignedVars;
-    map<string,shared_ptr<BSVType>> freeVars;
+    VarSet boundVars;
+    VarSet assignedVars;
+    VarSet freeVars;
 };
 
 class LValue : public enable_shared_from_this<LValue> {
 public:
     const LValueType lvalueType;
-    LValueAttrs attrs_;
-    const LValueAttrs &attrs() { return attrs_; }
+    // computed on first use and cached
+    const LValueAttrs &attrs() {
+        if (!attrsValid) {
+            computeAttrs(attrs_);
+            attrsValid = true;
+        }
+        return attrs_;
+    }
 public:
     LValue(LValueType lvalueType = InvalidLValueType) : lvalueType(lvalueType) {};
     virtual ~LValue() {}
@@ -50,6 +57,12 @@ public:
 
     virtual shared_ptr<struct LValue> rename(string prefix, shared_ptr<LexicalScope> &scope) = 0;
 
+protected:
+    virtual void computeAttrs(LValueAttrs &attrs) = 0;
+
+private:
+    LValueAttrs attrs_;
+    bool attrsValid = false;
 };
 
 class VarLValue : public LValue {
@@ -62,6 +75,9 @@ public:
     shared_ptr<VarLValue> varLValue() override;
 
     shared_ptr<struct LValue> rename(string prefix, shared_ptr<LexicalScope> &scope) override;
+
+protected:
+    void computeAttrs(LValueAttrs &attrs) override;
 };
 
 class ArraySubLValue : public LValue {
@@ -77,6 +93,9 @@ public:
     shared_ptr<struct LValue> rename(string prefix, shared_ptr<LexicalScope> &scope) override;
 
     static shared_ptr<LValue> create(shared_ptr<Expr> array, const shared_ptr<Expr> &index);
+
+protected:
+    void computeAttrs(LValueAttrs &attrs) override;
 };
 
 
@@ -92,6 +111,9 @@ public:
     void prettyPrint(ostream &out, int depth) override;
     shared_ptr<struct LValue> rename(string prefix, shared_ptr<LexicalScope> &scope) override;
     shared_ptr<RangeSelLValue> rangeSelLValue() override;
+
+protected:
+    void computeAttrs(LValueAttrs &attrs) override;
 };
 
 class FieldLValue : public LValue {
@@ -106,6 +128,9 @@ public:
     shared_ptr<struct LValue> rename(string prefix, shared_ptr<LexicalScope> &scope) override;
 
     static shared_ptr<LValue> create(shared_ptr<Expr> obj, string basicString);
+
+protected:
+    void computeAttrs(LValueAttrs &attrs) override;
 };
 
 
@@ -1,4 +1,6 @@
 
+#include <algorithm>
+
 #include "LexicalScope.h"
 
 shared_ptr<Declaration> LexicalScope::lookup(const string &name) const {
@@ -13,9 +15,47 @@ shared_ptr<Declaration> LexicalScope::lookup(const string &name) const {
     }
 }
 
+bool LexicalScope::renamesAny(const VarSet &vars) const {
+    if (vars.empty())
+        return false;
+    // walk whichever side is smaller, so that renaming a deep expression does not
+    // rescan the free variables of every subexpression against the whole scope
+    size_t numRenamed = 0;
+    for (const LexicalScope *scope = this; scope; scope = scope->parent.get())
+        numRenamed += scope->renamedIds.size();
+    if (numRenamed < vars.size()) {
+        for (const LexicalScope *scope = this; scope; scope = scope->parent.get()) {
+            for (VarId id : scope->renamedIds) {
+                if (!vars.contains(id))
+                    continue;
+                // a closer scope may bind it back to itself
+                shared_ptr<Declaration> decl = lookup(VarSet::name(id));
+                if (decl && decl->name != VarSet::name(id))
+                    return true;
+            }
+        }
+        return false;
+    }
+    for (auto it = vars.begin(); it != vars.end(); ++it) {
+        shared_ptr<Declaration> decl = lookup(it->name());
+        if (decl && decl->name != it->name())
+            return true;
+    }
+    return false;
+}
+
 void LexicalScope::bind(const string &name, const shared_ptr<Declaration> &value) {
     bindings[name] = value;
     bindingList.push_back(value);
+    VarId id = VarSet::intern(name);
+    auto pos = lower_bound(renamedIds.begin(), renamedIds.end(), id);
+    bool renamed = value && value->name != name;
+    if (pos != renamedIds.end() && *pos == id) {
+        if (!renamed)
+            renamedIds.erase(pos);
+    } else if (renamed) {
+        renamedIds.insert(pos, id);
+    }
 }
 
 void LexicalScope::import(const shared_ptr<LexicalScope> &scope)
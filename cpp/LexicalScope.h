@@ -5,6 +5,7 @@
 #include <string>
 
 #include "Declaration.h"
+#include "VarSet.h"
 
 using namespace std;
 
@@ -12,6 +13,8 @@ class LexicalScope {
     const string name;
     map<string, shared_ptr<Declaration>> bindings;
     vector<shared_ptr<Declaration>> bindingList;
+    // sorted ids of the names bound here to a declaration with a different name
+    vector<VarId> renamedIds;
 public:
     LexicalScope(const string &name) : name(name), parent() {}
     LexicalScope(const string &name, shared_ptr<LexicalScope> &parent) : name(name), parent(parent) {}
@@ -21,6 +24,8 @@ public:
     bool isGlobal() { return parent == NULL; }
 
     shared_ptr<Declaration> lookup(const string &name) const;
+    // true if any of vars is bound here to a declaration with a different name
+    bool renamesAny(const VarSet &vars) const;
 
     void bind(const string &name, const shared_ptr<Declaration> &value);
     void import(const shared_ptr<LexicalScope> &scope);
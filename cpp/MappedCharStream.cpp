@@ -0,0 +1,113 @@
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdefaulted-function-deleted"
+#include "antlr4-runtime.h"
+#pragma GCC diagnostic pop
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MappedCharStream.h"
+
+MappedCharStream::MappedCharStream(const string &fileName) : name(fileName) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            mapped = (const char *) addr;
+            mappedSize = st.st_size;
+        }
+    }
+    close(fd);
+    if (!mapped)
+        return;
+
+    size_t i = 0;
+    while (i < mappedSize && !(mapped[i] & 0x80))
+        i++;
+    if (i == mappedSize) {
+        numCodePoints = mappedSize;
+        return;
+    }
+
+    // not ASCII: decode it like ANTLRInputStream, dropping a UTF-8 byte order mark
+    const char *first = mapped;
+    if (mappedSize >= 3 && memcmp(first, "\xef\xbb\xbf", 3) == 0)
+        first += 3;
+    decoded = antlrcpp::utf8_to_utf32(first, mapped + mappedSize);
+    numCodePoints = decoded.size();
+    munmap((void *) mapped, mappedSize);
+    mapped = nullptr;
+    mappedSize = 0;
+}
+
+MappedCharStream::~MappedCharStream() {
+    if (mapped)
+        munmap((void *) mapped, mappedSize);
+}
+
+void MappedCharStream::consume() {
+    if (p >= numCodePoints)
+        throw IllegalStateException("cannot consume EOF");
+    p++;
+}
+
+size_t MappedCharStream::LA(ssize_t i) {
+    if (i == 0)
+        return 0; // undefined
+    ssize_t position = (ssize_t) p;
+    if (i < 0) {
+        i++; // LA(-1) is the code point before p
+        if (position + i - 1 < 0)
+            return IntStream::EOF;
+    }
+    if (position + i - 1 >= (ssize_t) numCodePoints)
+        return IntStream::EOF;
+    return codePoint(position + i - 1);
+}
+
+ssize_t MappedCharStream::mark() {
+    return -1;
+}
+
+void MappedCharStream::release(ssize_t marker) {
+}
+
+size_t MappedCharStream::index() {
+    return p;
+}
+
+void MappedCharStream::seek(size_t index) {
+    p = min(index, numCodePoints);
+}
+
+size_t MappedCharStream::size() {
+    return numCodePoints;
+}
+
+string MappedCharStream::getSourceName() const {
+    return name.empty() ? IntStream::UNKNOWN_SOURCE_NAME : name;
+}
+
+string MappedCharStream::getText(const misc::Interval &interval) {
+    if (interval.a < 0 || interval.b < 0 || (size_t) interval.a >= numCodePoints)
+        return string();
+    size_t start = interval.a;
+    size_t stop = min((size_t) interval.b, numCodePoints - 1);
+    if (stop < start)
+        return string();
+    if (mapped)
+        return string(mapped + start, stop - start + 1);
+    return antlrcpp::utf32_to_utf8(decoded.substr(start, stop - start + 1));
+}
+
+string MappedCharStream::toString() const {
+    if (mapped)
+        return string(mapped, mappedSize);
+    return antlrcpp::utf32_to_utf8(decoded);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <CharStream.h>
+#include <string>
+
+using namespace antlr4;
+using namespace std;
+
+// A CharStream over a memory-mapped source file. ANTLRFileStream reads the file into a
+// string and decodes it into a UTF-32 buffer; a file that is pure ASCII, as BSV sources
+// nearly always are, is served straight from the mapped bytes instead, and only other
+// files are decoded.
+class MappedCharStream : public CharStream {
+    string name;
+    const char *mapped = nullptr;
+    size_t mappedSize = 0;
+    // the code points of a file that is not ASCII, when mapped is null
+    UTF32String decoded;
+    size_t numCodePoints = 0;
+    size_t p = 0;
+
+    size_t codePoint(size_t i) const {
+        return mapped ? (unsigned char) mapped[i] : decoded[i];
+    }
+
+public:
+    // an empty stream if the file cannot be read, like ANTLRFileStream
+    MappedCharStream(const string &fileName);
+    ~MappedCharStream();
+
+    void consume() override;
+    size_t LA(ssize_t i) override;
+    ssize_t mark() override;
+    void release(ssize_t marker) override;
+    size_t index() override;
+    void seek(size_t index) override;
+    size_t size() override;
+    string getSourceName() const override;
+    string getText(const misc::Interval &interval) override;
+    string toString() const override;
+
+private:
+    MappedCharStream(const MappedCharStream &) = delete;
+    MappedCharStream &operator=(const MappedCharStream &) = delete;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <set>
+#include <string>
+
+#include "AstVisitor.h"
+
+using namespace std;
+
+// Collects the variables used by statements and expressions and the ones they bind or assign,
+// including those of nested scopes.
+class NameCollector : public AstVisitor<NameCollector> {
+    bool inLValue = false;
+
+public:
+    set<string> used;
+    set<string> bound;
+    set<string> assigned;
+    // calls system tasks or submodule methods
+    bool impure = false;
+
+    void visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt) {
+        bound.insert(stmt->name);
+        AstVisitor<NameCollector>::visitActionBindingStmt(stmt);
+    }
+
+    void visitRegReadStmt(const shared_ptr<RegReadStmt> &stmt) {
+        bound.insert(stmt->var);
+    }
+
+    void visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt) {
+        bound.insert(stmt->name);
+        AstVisitor<NameCollector>::visitVarBindingStmt(stmt);
+    }
+
+    void visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt) {
+        inLValue = true;
+        visit(stmt->lhs);
+        inLValue = false;
+        visit(stmt->rhs);
+    }
+
+    void visitVarLValue(const shared_ptr<VarLValue> &lvalue) {
+        used.insert(lvalue->name);
+        assigned.insert(lvalue->name);
+    }
+
+    void visitVarExpr(const shared_ptr<VarExpr> &expr) {
+        used.insert(expr->name);
+        if (inLValue)
+            assigned.insert(expr->name);
+    }
+
+    void visitCallExpr(const shared_ptr<CallExpr> &expr) {
+        shared_ptr<VarExpr> function = expr->function->varExpr();
+        if (!function || function->name[0] == '$')
+            impure = true;
+        AstVisitor<NameCollector>::visitCallExpr(expr);
+    }
+};
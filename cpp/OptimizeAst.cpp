@@ -0,0 +1,542 @@
+#include <algorithm>
+
+#include "NameCollector.h"
+#include "OptimizeAst.h"
+
+// names bound by the statements themselves, not by nested ones
+static void boundNames(const vector<shared_ptr<Stmt>> &stmts, vector<string> &names) {
+    for (size_t i = 0; i < stmts.size(); i++) {
+        if (!stmts[i])
+            continue;
+        if (shared_ptr<VarBindingStmt> varBinding = stmts[i]->varBindingStmt())
+            names.push_back(varBinding->name);
+        else if (shared_ptr<ActionBindingStmt> actionBinding = stmts[i]->actionBindingStmt())
+            names.push_back(actionBinding->name);
+        else if (shared_ptr<RegReadStmt> regRead = stmts[i]->regReadStmt())
+            names.push_back(regRead->var);
+    }
+}
+
+static vector<shared_ptr<Stmt>> substatements(const shared_ptr<Stmt> &stmt) {
+    if (shared_ptr<BlockStmt> block = stmt->blockStmt())
+        return block->stmts;
+    return vector<shared_ptr<Stmt>>{stmt};
+}
+
+static bool isEmpty(const shared_ptr<Stmt> &stmt) {
+    return !stmt || (stmt->blockStmt() && stmt->blockStmt()->stmts.empty());
+}
+
+// the value a binding of type bsvtype holds, as in the Interpreter
+static shared_ptr<Value> resize(const shared_ptr<Value> &value, const shared_ptr<BSVType> &bsvtype) {
+    int width = bsvtype ? bsvtype->bitWidth() : 0;
+    if (!width)
+        return value;
+    shared_ptr<IntValue> intValue = value->intValue();
+    if (intValue && !intValue->width)
+        return bitsValue(BitVector(64, intValue->value).signExtend(width));
+    BitVector bits = valueBits(value);
+    if (!bits.getWidth() || bits.getWidth() == width)
+        return value;
+    return bitsValue(bits.zeroExtend(width));
+}
+
+// the literal for value; sized values get a sized literal of the type of the
+// expression it replaces, so that concatenations and the backends keep their width
+static shared_ptr<Expr> literal(const shared_ptr<Value> &value, const shared_ptr<BSVType> &bsvtype) {
+    shared_ptr<IntValue> intValue = value->intValue();
+    if (!intValue || !intValue->width)
+        return value->toExpr();
+    shared_ptr<BSVType> literalType = bsvtype;
+    if (!literalType || literalType->bitWidth() != intValue->width)
+        literalType = BSVType::create("Bit", vector<shared_ptr<BSVType>>{
+                BSVType::create(to_string(intValue->width), BSVType_Numeric)});
+    return makeAst<IntConst>(to_string(intValue->width) + "'d" + to_string((unsigned long)intValue->value),
+                             literalType);
+}
+
+static bool sameType(const shared_ptr<BSVType> &a, const shared_ptr<BSVType> &b) {
+    return a && b && a->to_string() == b->to_string();
+}
+
+vector<shared_ptr<Stmt>> OptimizeAst::optimize(const vector<shared_ptr<Stmt>> &packageStmts) {
+    vector<shared_ptr<Stmt>> optimizedStmts;
+    for (size_t i = 0; i < packageStmts.size(); i++) {
+        shared_ptr<Stmt> stmt = packageStmts[i];
+        if (!stmt) {
+            optimizedStmts.push_back(stmt);
+        } else if (shared_ptr<ModuleDefStmt> moduleDef = stmt->moduleDefStmt()) {
+            optimizedStmts.push_back(optimizeModule(moduleDef));
+        } else if (shared_ptr<FunctionDefStmt> functionDef = stmt->functionDefStmt()) {
+            optimizedStmts.push_back(makeAst<FunctionDefStmt>(functionDef->package, functionDef->name,
+                                                              functionDef->returnType, functionDef->params,
+                                                              functionDef->paramTypes,
+                                                              optimize(functionDef->guard).expr,
+                                                              optimizeBody(functionDef->stmts, functionDef->params),
+                                                              functionDef->sourcePos));
+        } else {
+            optimizedStmts.push_back(stmt);
+        }
+    }
+    cerr << "OptimizeAst: folded " << numFolded << " expressions, propagated " << numPropagated
+         << " values, pruned " << numPruned << " branches, removed " << numRemoved << " statements" << endl;
+    return optimizedStmts;
+}
+
+shared_ptr<Stmt> OptimizeAst::optimizeModule(const shared_ptr<ModuleDefStmt> &moduleDef) {
+    vector<shared_ptr<Stmt>> stmts;
+    for (size_t i = 0; i < moduleDef->stmts.size(); i++) {
+        shared_ptr<Stmt> stmt = moduleDef->stmts[i];
+        if (!stmt) {
+            stmts.push_back(stmt);
+        } else if (shared_ptr<RuleDefStmt> ruleDef = stmt->ruleDefStmt()) {
+            stmts.push_back(makeAst<RuleDefStmt>(ruleDef->name, optimize(ruleDef->guard).expr,
+                                                 optimizeBody(ruleDef->stmts, vector<string>()),
+                                                 ruleDef->sourcePos));
+        } else if (shared_ptr<MethodDefStmt> methodDef = stmt->methodDefStmt()) {
+            stmts.push_back(makeAst<MethodDefStmt>(methodDef->name, methodDef->returnType, methodDef->params,
+                                                   methodDef->paramTypes, optimize(methodDef->guard).expr,
+                                                   optimizeBody(methodDef->stmts, methodDef->params),
+                                                   methodDef->sourcePos));
+        } else if (shared_ptr<FunctionDefStmt> functionDef = stmt->functionDefStmt()) {
+            stmts.push_back(makeAst<FunctionDefStmt>(functionDef->package, functionDef->name,
+                                                     functionDef->returnType, functionDef->params,
+                                                     functionDef->paramTypes, optimize(functionDef->guard).expr,
+                                                     optimizeBody(functionDef->stmts, functionDef->params),
+                                                     functionDef->sourcePos));
+        } else {
+            stmts.push_back(stmt);
+        }
+    }
+    return makeAst<ModuleDefStmt>(moduleDef->package, moduleDef->name, moduleDef->interfaceType,
+                                  moduleDef->params, moduleDef->paramTypes, stmts, moduleDef->sourcePos);
+}
+
+vector<shared_ptr<Stmt>> OptimizeAst::optimizeBody(const vector<shared_ptr<Stmt>> &stmts,
+                                                   const vector<string> &params) {
+    scopeNames = params;
+    vector<shared_ptr<Stmt>> result;
+    optimizeStmts(stmts, result);
+    constants.clear();
+    copies.clear();
+    regReads.clear();
+    scopeNames.clear();
+
+    set<string> live;
+    eliminateDead(result, live);
+    return result;
+}
+
+void OptimizeAst::optimizeStmts(const vector<shared_ptr<Stmt>> &stmts, vector<shared_ptr<Stmt>> &result) {
+    size_t scopeSize = scopeNames.size();
+    boundNames(stmts, scopeNames);
+    for (size_t i = 0; i < stmts.size(); i++) {
+        if (stmts[i])
+            dispatchStmt(stmts[i], result);
+    }
+    scopeNames.resize(scopeSize);
+}
+
+// optimizes a nested scope, which sees but does not change what is known about the enclosing one
+shared_ptr<Stmt> OptimizeAst::optimizeSubstatement(const shared_ptr<Stmt> &stmt) {
+    if (!stmt)
+        return stmt;
+    map<string, shared_ptr<Value>> enclosingConstants = constants;
+    map<string, string> enclosingCopies = copies;
+    map<string, string> enclosingRegReads = regReads;
+
+    vector<shared_ptr<Stmt>> stmts;
+    optimizeStmts(substatements(stmt), stmts);
+
+    constants = enclosingConstants;
+    copies = enclosingCopies;
+    regReads = enclosingRegReads;
+    invalidate(stmt);
+
+    if (!stmt->blockStmt() && stmts.size() == 1)
+        return stmts[0];
+    return makeAst<BlockStmt>(stmts, stmt->sourcePos);
+}
+
+void OptimizeAst::invalidate(const string &name) {
+    constants.erase(name);
+    copies.erase(name);
+    for (auto it = copies.begin(); it != copies.end();) {
+        if (it->second == name)
+            it = copies.erase(it);
+        else
+            ++it;
+    }
+    for (auto it = regReads.begin(); it != regReads.end();) {
+        if (it->second == name)
+            it = regReads.erase(it);
+        else
+            ++it;
+    }
+}
+
+void OptimizeAst::invalidate(const shared_ptr<Stmt> &stmt) {
+    NameCollector names;
+    names.visit(stmt);
+    for (auto it = names.bound.cbegin(); it != names.bound.cend(); ++it)
+        invalidate(*it);
+    for (auto it = names.assigned.cbegin(); it != names.assigned.cend(); ++it)
+        invalidate(*it);
+}
+
+void OptimizeAst::defaultStmt(const shared_ptr<Stmt> &stmt, vector<shared_ptr<Stmt>> &result) {
+    invalidate(stmt);
+    result.push_back(stmt);
+}
+
+void OptimizeAst::visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt,
+                                         vector<shared_ptr<Stmt>> &result) {
+    shared_ptr<Expr> rhs = optimize(stmt->rhs).expr;
+    invalidate(stmt->name);
+    result.push_back(makeAst<ActionBindingStmt>(stmt->bsvtype, stmt->name, rhs, stmt->sourcePos));
+}
+
+void OptimizeAst::visitBlockStmt(const shared_ptr<BlockStmt> &stmt, vector<shared_ptr<Stmt>> &result) {
+    result.push_back(optimizeSubstatement(stmt));
+}
+
+void OptimizeAst::visitCallStmt(const shared_ptr<CallStmt> &stmt, vector<shared_ptr<Stmt>> &result) {
+    result.push_back(makeAst<CallStmt>(stmt->name, stmt->interfaceType, optimize(stmt->rhs).expr,
+                                       stmt->sourcePos));
+}
+
+void OptimizeAst::visitExprStmt(const shared_ptr<ExprStmt> &stmt, vector<shared_ptr<Stmt>> &result) {
+    result.push_back(makeAst<ExprStmt>(optimize(stmt->expr).expr, stmt->sourcePos));
+}
+
+void OptimizeAst::visitIfStmt(const shared_ptr<IfStmt> &stmt, vector<shared_ptr<Stmt>> &result) {
+    FoldedExpr condition = optimize(stmt->condition);
+    shared_ptr<BoolValue> cond = condition.value ? condition.value->boolValue() : shared_ptr<BoolValue>();
+    if (cond) {
+        shared_ptr<Stmt> taken = cond->value ? stmt->thenStmt : stmt->elseStmt;
+        if (!taken) {
+            numPruned++;
+            return;
+        }
+        // splice the branch taken into the enclosing statements unless its bindings would hide others
+        vector<shared_ptr<Stmt>> takenStmts = substatements(taken);
+        vector<string> names;
+        boundNames(takenStmts, names);
+        bool hides = false;
+        for (size_t i = 0; i < names.size(); i++) {
+            if (find(scopeNames.cbegin(), scopeNames.cend(), names[i]) != scopeNames.cend())
+                hides = true;
+        }
+        if (!hides) {
+            numPruned++;
+            scopeNames.insert(scopeNames.end(), names.cbegin(), names.cend());
+            for (size_t i = 0; i < takenStmts.size(); i++) {
+                if (takenStmts[i])
+                    dispatchStmt(takenStmts[i], result);
+            }
+            return;
+        }
+    }
+    shared_ptr<Stmt> thenStmt = optimizeSubstatement(stmt->thenStmt);
+    shared_ptr<Stmt> elseStmt = optimizeSubstatement(stmt->elseStmt);
+    result.push_back(makeAst<IfStmt>(condition.expr, thenStmt, elseStmt, stmt->sourcePos));
+}
+
+void OptimizeAst::visitRegReadStmt(const shared_ptr<RegReadStmt> &stmt, vector<shared_ptr<Stmt>> &result) {
+    // registers keep their value until the end of the rule or method
+    auto it = regReads.find(stmt->regName);
+    if (it != regReads.cend()) {
+        numPropagated++;
+        if (it->second == stmt->var)
+            return;
+        string previous = it->second;
+        invalidate(stmt->var);
+        result.push_back(makeAst<VarBindingStmt>(stmt->varType, stmt->var,
+                                                 makeAst<VarExpr>(previous, stmt->varType, stmt->sourcePos),
+                                                 stmt->sourcePos));
+        copies[stmt->var] = previous;
+        return;
+    }
+    invalidate(stmt->var);
+    regReads[stmt->regName] = stmt->var;
+    result.push_back(stmt);
+}
+
+void OptimizeAst::visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt, vector<shared_ptr<Stmt>> &result) {
+    result.push_back(makeAst<RegWriteStmt>(stmt->regName, stmt->elementType, optimize(stmt->rhs).expr,
+                                           stmt->sourcePos));
+}
+
+void OptimizeAst::visitReturnStmt(const shared_ptr<ReturnStmt> &stmt, vector<shared_ptr<Stmt>> &result) {
+    result.push_back(makeAst<ReturnStmt>(optimize(stmt->value).expr, stmt->sourcePos));
+}
+
+void OptimizeAst::visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt, vector<shared_ptr<Stmt>> &result) {
+    shared_ptr<Expr> rhs = optimize(stmt->rhs).expr;
+    invalidate(stmt);
+    result.push_back(makeAst<VarAssignStmt>(stmt->lhs, stmt->op, rhs, stmt->sourcePos));
+}
+
+void OptimizeAst::visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt, vector<shared_ptr<Stmt>> &result) {
+    FoldedExpr rhs = optimize(stmt->rhs);
+    invalidate(stmt->name);
+    result.push_back(makeAst<VarBindingStmt>(stmt->bsvtype, stmt->name, stmt->bindingType, rhs.expr,
+                                             stmt->sourcePos));
+    shared_ptr<Value> value = rhs.value;
+    if (value && (value->intValue() || value->bitValue() || value->boolValue())) {
+        constants[stmt->name] = resize(value, stmt->bsvtype);
+    } else if (shared_ptr<VarExpr> var = rhs.expr ? rhs.expr->varExpr() : shared_ptr<VarExpr>()) {
+        // a copy of a variable of another type would be resized
+        if (var->name != stmt->name && sameType(stmt->bsvtype, var->bsvtype))
+            copies[stmt->name] = var->name;
+    }
+}
+
+FoldedExpr OptimizeAst::optimize(const shared_ptr<Expr> &expr) {
+    if (!expr)
+        return FoldedExpr();
+    return dispatchExpr(expr);
+}
+
+// replaces expr by the literal for value, if there is one; literals are
+// untyped, so an Int#(n) expression keeps its value but not its literal
+FoldedExpr OptimizeAst::constant(const shared_ptr<Expr> &expr, const shared_ptr<Value> &value) {
+    shared_ptr<Expr> valueExpr = literal(value, expr->bsvtype);
+    if (!valueExpr || (!value->boolValue() && isSignedExpr(expr)))
+        return FoldedExpr{expr, value};
+    numFolded++;
+    return FoldedExpr{valueExpr, value};
+}
+
+FoldedExpr OptimizeAst::defaultExpr(const shared_ptr<Expr> &expr) {
+    return FoldedExpr{expr, shared_ptr<Value>()};
+}
+
+FoldedExpr OptimizeAst::visitArraySubExpr(const shared_ptr<ArraySubExpr> &expr) {
+    shared_ptr<Expr> array = optimize(expr->array).expr;
+    shared_ptr<Expr> index = optimize(expr->index).expr;
+    if (array == expr->array && index == expr->index)
+        return FoldedExpr{expr, shared_ptr<Value>()};
+    return FoldedExpr{makeAst<ArraySubExpr>(array, index, expr->sourcePos), shared_ptr<Value>()};
+}
+
+FoldedExpr OptimizeAst::visitBitConcatExpr(const shared_ptr<BitConcatExpr> &expr) {
+    vector<shared_ptr<Expr>> values;
+    BitVector bits;
+    bool isConstant = true;
+    bool changed = false;
+    for (size_t i = 0; i < expr->values.size(); i++) {
+        FoldedExpr value = optimize(expr->values[i]);
+        BitVector valueBits = ::valueBits(value.value);
+        if (valueBits.getWidth())
+            bits = bits.concat(valueBits);
+        else
+            isConstant = false;
+        changed |= value.expr != expr->values[i];
+        values.push_back(value.expr);
+    }
+    if (isConstant && bits.getWidth())
+        return constant(expr, bitsValue(bits));
+    if (!changed)
+        return FoldedExpr{expr, shared_ptr<Value>()};
+    return FoldedExpr{makeAst<BitConcatExpr>(values, expr->bsvtype, expr->sourcePos), shared_ptr<Value>()};
+}
+
+FoldedExpr OptimizeAst::visitBitSelExpr(const shared_ptr<BitSelExpr> &expr) {
+    FoldedExpr value = optimize(expr->value);
+    FoldedExpr msb = optimize(expr->msb);
+    FoldedExpr lsb = expr->lsb ? optimize(expr->lsb) : msb;
+    shared_ptr<IntValue> msbValue = msb.value ? msb.value->intValue() : shared_ptr<IntValue>();
+    shared_ptr<IntValue> lsbValue = lsb.value ? lsb.value->intValue() : shared_ptr<IntValue>();
+    if (value.value && msbValue && lsbValue) {
+        shared_ptr<Value> bits;
+        if (shared_ptr<BitValue> bitValue = value.value->bitValue())
+            bits = bitValue->sub(msbValue->value, lsbValue->value);
+        else if (shared_ptr<IntValue> intValue = value.value->intValue())
+            bits = intValue->sub(msbValue->value, lsbValue->value);
+        if (bits)
+            return constant(expr, bits);
+    }
+    if (value.expr == expr->value && msb.expr == expr->msb && (!expr->lsb || lsb.expr == expr->lsb))
+        return FoldedExpr{expr, shared_ptr<Value>()};
+    return FoldedExpr{makeAst<BitSelExpr>(value.expr, msb.expr, expr->lsb ? lsb.expr : expr->lsb, expr->sourcePos),
+                      shared_ptr<Value>()};
+}
+
+FoldedExpr OptimizeAst::visitCallExpr(const shared_ptr<CallExpr> &expr) {
+    vector<shared_ptr<Expr>> args;
+    bool changed = false;
+    for (size_t i = 0; i < expr->args.size(); i++) {
+        args.push_back(optimize(expr->args[i]).expr);
+        changed |= args.back() != expr->args[i];
+    }
+    if (!changed)
+        return FoldedExpr{expr, shared_ptr<Value>()};
+    return FoldedExpr{makeAst<CallExpr>(expr->function, args, expr->sourcePos), shared_ptr<Value>()};
+}
+
+FoldedExpr OptimizeAst::visitCondExpr(const shared_ptr<CondExpr> &expr) {
+    FoldedExpr cond = optimize(expr->cond);
+    if (shared_ptr<BoolValue> condValue = cond.value ? cond.value->boolValue() : shared_ptr<BoolValue>()) {
+        numFolded++;
+        return optimize(condValue->value ? expr->thenExpr : expr->elseExpr);
+    }
+    shared_ptr<Expr> thenExpr = optimize(expr->thenExpr).expr;
+    shared_ptr<Expr> elseExpr = optimize(expr->elseExpr).expr;
+    if (cond.expr == expr->cond && thenExpr == expr->thenExpr && elseExpr == expr->elseExpr)
+        return FoldedExpr{expr, shared_ptr<Value>()};
+    return FoldedExpr{makeAst<CondExpr>(cond.expr, thenExpr, elseExpr, expr->sourcePos), shared_ptr<Value>()};
+}
+
+FoldedExpr OptimizeAst::visitFieldExpr(const shared_ptr<FieldExpr> &expr) {
+    shared_ptr<Expr> object = optimize(expr->object).expr;
+    if (object == expr->object)
+        return FoldedExpr{expr, shared_ptr<Value>()};
+    return FoldedExpr{makeAst<FieldExpr>(object, expr->fieldName, expr->bsvtype, expr->sourcePos),
+                      shared_ptr<Value>()};
+}
+
+FoldedExpr OptimizeAst::visitIntConst(const shared_ptr<IntConst> &expr) {
+    return FoldedExpr{expr, literalValue(expr->repr)};
+}
+
+FoldedExpr OptimizeAst::visitOperatorExpr(const shared_ptr<OperatorExpr> &expr) {
+    FoldedExpr lhs = optimize(expr->lhs);
+    if (!expr->rhs) {
+        // negative literals stay as they are
+        if (lhs.value && expr->op == "-" && expr->lhs->intConst())
+            return FoldedExpr{expr, lhs.value->unop(expr->op)};
+        shared_ptr<Value> value = lhs.value ? lhs.value->unop(expr->op) : shared_ptr<Value>();
+        if (value) {
+            FoldedExpr folded = constant(expr, value);
+            if (folded.expr != expr)
+                return folded;
+        }
+        if (lhs.expr == expr->lhs)
+            return FoldedExpr{expr, value};
+        return FoldedExpr{makeAst<OperatorExpr>(expr->op, lhs.expr, expr->rhs, expr->sourcePos), value};
+    }
+    FoldedExpr rhs = optimize(expr->rhs);
+    if (expr->op == "&&" || expr->op == "||") {
+        // True || x is True, False || x is x, and likewise for &&
+        bool dominant = expr->op == "||";
+        shared_ptr<BoolValue> lhsBool = lhs.value ? lhs.value->boolValue() : shared_ptr<BoolValue>();
+        shared_ptr<BoolValue> rhsBool = rhs.value ? rhs.value->boolValue() : shared_ptr<BoolValue>();
+        if (lhsBool || rhsBool)
+            numFolded++;
+        if (lhsBool)
+            return lhsBool->value == dominant ? lhs : rhs;
+        if (rhsBool)
+            return rhsBool->value == dominant ? rhs : lhs;
+    }
+    shared_ptr<Value> value;
+    if (lhs.value && rhs.value) {
+        // as in the Interpreter
+        bool isSigned = isSignedExpr(expr->lhs) || (expr->op != "<<" && expr->op != ">>" && isSignedExpr(expr->rhs));
+        value = isSigned ? signedBinop(expr->op, lhs.value, rhs.value) : lhs.value->binop(expr->op, rhs.value);
+        if (value) {
+            FoldedExpr folded = constant(expr, value);
+            if (folded.expr != expr)
+                return folded;
+        }
+    }
+    if (lhs.expr == expr->lhs && rhs.expr == expr->rhs)
+        return FoldedExpr{expr, value};
+    return FoldedExpr{makeAst<OperatorExpr>(expr->op, lhs.expr, rhs.expr, expr->sourcePos), value};
+}
+
+FoldedExpr OptimizeAst::visitVarExpr(const shared_ptr<VarExpr> &expr) {
+    const string &name = expr->name;
+    if (name == "True" || name == "False")
+        return FoldedExpr{expr, make_shared<BoolValue>(name == "True")};
+    auto copy = copies.find(name);
+    if (copy != copies.cend()) {
+        numPropagated++;
+        return FoldedExpr{makeAst<VarExpr>(copy->second, expr->bsvtype, expr->sourcePos), shared_ptr<Value>()};
+    }
+    auto it = constants.find(name);
+    if (it != constants.cend()) {
+        shared_ptr<Expr> valueExpr = literal(it->second, expr->bsvtype);
+        if (!valueExpr || isSignedType(expr->bsvtype))
+            return FoldedExpr{expr, it->second};
+        numPropagated++;
+        return FoldedExpr{valueExpr, it->second};
+    }
+    return FoldedExpr{expr, shared_ptr<Value>()};
+}
+
+// Removes the bindings and register reads of stmts that are not live, given
+// the variables live after them, and updates live to the ones live before.
+void OptimizeAst::eliminateDead(vector<shared_ptr<Stmt>> &stmts, set<string> &live) {
+    vector<shared_ptr<Stmt>> kept;
+    for (size_t i = stmts.size(); i-- > 0;) {
+        shared_ptr<Stmt> stmt = stmts[i];
+        if (!stmt)
+            continue;
+        if (shared_ptr<VarBindingStmt> varBinding = stmt->varBindingStmt()) {
+            NameCollector names;
+            names.visit(varBinding->rhs);
+            if (!live.count(varBinding->name) && !names.impure) {
+                numRemoved++;
+                continue;
+            }
+            live.erase(varBinding->name);
+            live.insert(names.used.cbegin(), names.used.cend());
+        } else if (shared_ptr<RegReadStmt> regRead = stmt->regReadStmt()) {
+            if (!live.count(regRead->var)) {
+                numRemoved++;
+                continue;
+            }
+            live.erase(regRead->var);
+        } else if (shared_ptr<IfStmt> ifStmt = stmt->ifStmt()) {
+            // GenerateKami returns the variables assigned in either branch from both of them
+            set<string> thenLive = live;
+            map<string, shared_ptr<BSVType>> assignedVars = ifStmt->attrs().assignedVars.byName();
+            for (auto it = assignedVars.cbegin(); it != assignedVars.cend(); ++it)
+                thenLive.insert(it->first);
+            set<string> elseLive = thenLive;
+            shared_ptr<Stmt> thenStmt = eliminateDeadSubstatement(ifStmt->thenStmt, thenLive);
+            shared_ptr<Stmt> elseStmt = eliminateDeadSubstatement(ifStmt->elseStmt, elseLive);
+            NameCollector names;
+            names.visit(ifStmt->condition);
+            if (isEmpty(thenStmt) && isEmpty(elseStmt) && !names.impure) {
+                numRemoved++;
+                continue;
+            }
+            live = thenLive;
+            live.insert(elseLive.cbegin(), elseLive.cend());
+            live.insert(names.used.cbegin(), names.used.cend());
+            if (thenStmt != ifStmt->thenStmt || elseStmt != ifStmt->elseStmt)
+                stmt = makeAst<IfStmt>(ifStmt->condition, thenStmt, elseStmt, ifStmt->sourcePos);
+        } else if (stmt->blockStmt()) {
+            stmt = eliminateDeadSubstatement(stmt, live);
+        } else {
+            NameCollector names;
+            names.visit(stmt);
+            if (shared_ptr<ActionBindingStmt> actionBinding = stmt->actionBindingStmt())
+                live.erase(actionBinding->name);
+            live.insert(names.used.cbegin(), names.used.cend());
+        }
+        kept.push_back(stmt);
+    }
+    stmts.assign(kept.rbegin(), kept.rend());
+}
+
+shared_ptr<Stmt> OptimizeAst::eliminateDeadSubstatement(const shared_ptr<Stmt> &stmt, set<string> &live) {
+    if (!stmt)
+        return stmt;
+    set<string> liveAfter = live;
+    vector<shared_ptr<Stmt>> original = substatements(stmt);
+    vector<shared_ptr<Stmt>> stmts = original;
+    eliminateDead(stmts, live);
+    // the bindings of a nested scope end with it
+    vector<string> names;
+    boundNames(original, names);
+    for (size_t i = 0; i < names.size(); i++) {
+        if (liveAfter.count(names[i]))
+            live.insert(names[i]);
+    }
+    if (stmts == original)
+        return stmt;
+    return makeAst<BlockStmt>(stmts, stmt->sourcePos);
+}
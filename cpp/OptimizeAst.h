@@ -0,0 +1,91 @@
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "AstDispatch.h"
+#include "Expr.h"
+#include "Stmt.h"
+#include "Value.h"
+
+using namespace std;
+
+// An expression after folding, with its value if it is constant
+struct FoldedExpr {
+    shared_ptr<Expr> expr;
+    shared_ptr<Value> value;
+};
+
+// Optimizes the rule, method and function bodies of a simplified package,
+// see SimplifyAst, before code generation:
+//
+//  - constant folding of operators, conditional expressions, bit selects
+//    and concatenations, with the Value semantics of the Interpreter;
+//    Int#(n) expressions keep their value but not a literal, which has no sign
+//  - propagation of constants, copies and repeated reads of a register
+//  - pruning of if statements with constant conditions
+//  - removal of bindings and register reads that are never used
+//
+// The first three are a forward pass over each body, the last a backward
+// liveness pass over its result. Loops are left as they are.
+class OptimizeAst : public StmtDispatcher<OptimizeAst, void, vector<shared_ptr<Stmt>> &>,
+                    public ExprDispatcher<OptimizeAst, FoldedExpr> {
+    // while optimizing a body, what the variables in scope are known to hold
+    map<string, shared_ptr<Value>> constants;
+    map<string, string> copies;
+    // register name to the variable holding the value read
+    map<string, string> regReads;
+    // names bound in the enclosing statement lists, to keep splicing from shadowing them
+    vector<string> scopeNames;
+
+    size_t numFolded = 0;
+    size_t numPropagated = 0;
+    size_t numPruned = 0;
+    size_t numRemoved = 0;
+
+public:
+    OptimizeAst() {}
+    ~OptimizeAst() {}
+
+    vector<shared_ptr<Stmt>> optimize(const vector<shared_ptr<Stmt>> &packageStmts);
+    shared_ptr<Stmt> optimizeModule(const shared_ptr<ModuleDefStmt> &moduleDef);
+    vector<shared_ptr<Stmt>> optimizeBody(const vector<shared_ptr<Stmt>> &stmts, const vector<string> &params);
+    FoldedExpr optimize(const shared_ptr<Expr> &expr);
+
+    void defaultStmt(const shared_ptr<Stmt> &stmt, vector<shared_ptr<Stmt>> &result);
+    void visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt, vector<shared_ptr<Stmt>> &result);
+    void visitBlockStmt(const shared_ptr<BlockStmt> &stmt, vector<shared_ptr<Stmt>> &result);
+    void visitCallStmt(const shared_ptr<CallStmt> &stmt, vector<shared_ptr<Stmt>> &result);
+    void visitExprStmt(const shared_ptr<ExprStmt> &stmt, vector<shared_ptr<Stmt>> &result);
+    void visitIfStmt(const shared_ptr<IfStmt> &stmt, vector<shared_ptr<Stmt>> &result);
+    void visitRegReadStmt(const shared_ptr<RegReadStmt> &stmt, vector<shared_ptr<Stmt>> &result);
+    void visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt, vector<shared_ptr<Stmt>> &result);
+    void visitReturnStmt(const shared_ptr<ReturnStmt> &stmt, vector<shared_ptr<Stmt>> &result);
+    void visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt, vector<shared_ptr<Stmt>> &result);
+    void visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt, vector<shared_ptr<Stmt>> &result);
+
+    FoldedExpr defaultExpr(const shared_ptr<Expr> &expr);
+    FoldedExpr visitArraySubExpr(const shared_ptr<ArraySubExpr> &expr);
+    FoldedExpr visitBitConcatExpr(const shared_ptr<BitConcatExpr> &expr);
+    FoldedExpr visitBitSelExpr(const shared_ptr<BitSelExpr> &expr);
+    FoldedExpr visitCallExpr(const shared_ptr<CallExpr> &expr);
+    FoldedExpr visitCondExpr(const shared_ptr<CondExpr> &expr);
+    FoldedExpr visitFieldExpr(const shared_ptr<FieldExpr> &expr);
+    FoldedExpr visitIntConst(const shared_ptr<IntConst> &expr);
+    FoldedExpr visitOperatorExpr(const shared_ptr<OperatorExpr> &expr);
+    FoldedExpr visitVarExpr(const shared_ptr<VarExpr> &expr);
+
+private:
+    void optimizeStmts(const vector<shared_ptr<Stmt>> &stmts, vector<shared_ptr<Stmt>> &result);
+    shared_ptr<Stmt> optimizeSubstatement(const shared_ptr<Stmt> &stmt);
+    FoldedExpr constant(const shared_ptr<Expr> &expr, const shared_ptr<Value> &value);
+    void invalidate(const string &name);
+    void invalidate(const shared_ptr<Stmt> &stmt);
+
+    void eliminateDead(vector<shared_ptr<Stmt>> &stmts, set<string> &live);
+    shared_ptr<Stmt> eliminateDeadSubstatement(const shared_ptr<Stmt> &stmt, set<string> &live);
+};
@@ -10,6 +10,8 @@
 #include <string>
 #include <vector>
 
+#include "AstArena.h"
+
 using namespace std;
 
 enum PatternType {
@@ -51,7 +53,7 @@ public:
 
     virtual shared_ptr<IntPattern> intPattern() override { return static_pointer_cast<IntPattern, Pattern>(shared_from_this()); }
     virtual void prettyPrint(ostream &out, int depth = 0, int precedence = 0) override;
-    static shared_ptr<IntPattern> create(int value) { return shared_ptr<IntPattern>(new IntPattern(value)); }
+    static shared_ptr<IntPattern> create(int value) { return makeAst<IntPattern>(value); }
 };
 
 class TaggedPattern : public Pattern {
@@ -72,7 +74,7 @@ public:
     }
 
     virtual void prettyPrint(ostream &out, int depth = 0, int precedence = 0) override;
-    static shared_ptr<TaggedPattern> create(const string &value) { return shared_ptr<TaggedPattern>(new TaggedPattern(value)); }
+    static shared_ptr<TaggedPattern> create(const string &value) { return makeAst<TaggedPattern>(value); }
 };
 
 class TuplePattern : public Pattern {
@@ -83,7 +85,7 @@ public:
 
     virtual shared_ptr<TuplePattern> tuplePattern() override { return static_pointer_cast<TuplePattern, Pattern>(shared_from_this()); }
     virtual void prettyPrint(ostream &out, int depth = 0, int precedence = 0) override;
-    static shared_ptr<TuplePattern> create(const vector<shared_ptr<Pattern>> &subpatterns) { return shared_ptr<TuplePattern>(new TuplePattern(subpatterns)); }
+    static shared_ptr<TuplePattern> create(const vector<shared_ptr<Pattern>> &subpatterns) { return makeAst<TuplePattern>(subpatterns); }
 
 };
 
@@ -95,7 +97,7 @@ public:
 
     virtual shared_ptr<VarPattern> varPattern() override { return static_pointer_cast<VarPattern, Pattern>(shared_from_this()); }
     virtual void prettyPrint(ostream &out, int depth = 0, int precedence = 0) override;
-    static shared_ptr<VarPattern> create(const string &value) { return shared_ptr<VarPattern>(new VarPattern(value)); }
+    static shared_ptr<VarPattern> create(const string &value) { return makeAst<VarPattern>(value); }
 };
 
 class WildcardPattern : public Pattern {
@@ -105,7 +107,7 @@ public:
 
     virtual shared_ptr<WildcardPattern> wildcardPattern() override { return static_pointer_cast<WildcardPattern, Pattern>(shared_from_this()); }
     virtual void prettyPrint(ostream &out, int depth = 0, int precedence = 0) override;
-    static shared_ptr<WildcardPattern> create() { return shared_ptr<WildcardPattern>(new WildcardPattern()); }
+    static shared_ptr<WildcardPattern> create() { return makeAst<WildcardPattern>(); }
 
 };
 
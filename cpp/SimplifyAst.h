@@ -11,13 +11,15 @@
 #include <string>
 #include <fstream>
 
+#include "AstDispatch.h"
 #include "BSVType.h"
 #include "Expr.h"
 #include "Stmt.h"
 
 using namespace std;
 
-class SimplifyAst {
+class SimplifyAst : public StmtDispatcher<SimplifyAst, void, vector<shared_ptr<struct Stmt>> &>,
+                    public ExprDispatcher<SimplifyAst, shared_ptr<Expr>, vector<shared_ptr<struct Stmt>> &> {
     ofstream logstream;
     map<string, shared_ptr<BSVType>> registers; // maps name to the element type of the register
     bool actionContext = false;
@@ -37,63 +39,77 @@ public:
 
     void simplify(const shared_ptr<BSVType> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<ActionBindingStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void defaultStmt(const shared_ptr<struct Stmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<BlockStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitActionBindingStmt(const shared_ptr<ActionBindingStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<ExprStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitBlockStmt(const shared_ptr<BlockStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<FunctionDefStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitExprStmt(const shared_ptr<ExprStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<IfStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitFunctionDefStmt(const shared_ptr<FunctionDefStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<ImportStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitIfStmt(const shared_ptr<IfStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<InterfaceDeclStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitImportStmt(const shared_ptr<ImportStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<InterfaceDefStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitInterfaceDeclStmt(const shared_ptr<InterfaceDeclStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<MethodDeclStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitInterfaceDefStmt(const shared_ptr<InterfaceDefStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<MethodDefStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitMethodDeclStmt(const shared_ptr<MethodDeclStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<ModuleDefStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitMethodDefStmt(const shared_ptr<MethodDefStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<ModuleInstStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitModuleDefStmt(const shared_ptr<ModuleDefStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<PatternMatchStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitModuleInstStmt(const shared_ptr<ModuleInstStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<RegReadStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitPatternMatchStmt(const shared_ptr<PatternMatchStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<RegWriteStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitRegReadStmt(const shared_ptr<RegReadStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<ReturnStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitRegWriteStmt(const shared_ptr<RegWriteStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<RuleDefStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitReturnStmt(const shared_ptr<ReturnStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<TypedefStructStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitRuleDefStmt(const shared_ptr<RuleDefStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<TypedefSynonymStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitTypedefStructStmt(const shared_ptr<TypedefStructStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<VarAssignStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitTypedefSynonymStmt(const shared_ptr<TypedefSynonymStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    void simplify(const shared_ptr<VarBindingStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitVarAssignStmt(const shared_ptr<VarAssignStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    shared_ptr<Expr>  simplify(const shared_ptr<FieldExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    void visitVarBindingStmt(const shared_ptr<VarBindingStmt> &stmt, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    shared_ptr<Expr>  simplify(const shared_ptr<VarExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    shared_ptr<Expr> defaultExpr(const shared_ptr<Expr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    shared_ptr<Expr>  simplify(const shared_ptr<CallExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    shared_ptr<Expr> visitArraySubExpr(const shared_ptr<ArraySubExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    shared_ptr<Expr>  simplify(const shared_ptr<IntConst> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    shared_ptr<Expr> visitBitConcatExpr(const shared_ptr<BitConcatExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    shared_ptr<Expr> simplify(const shared_ptr<MatchesExpr> &matchesExpr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    shared_ptr<Expr> visitBitSelExpr(const shared_ptr<BitSelExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    shared_ptr<Expr>  simplify(const shared_ptr<OperatorExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    shared_ptr<Expr> visitVarExpr(const shared_ptr<VarExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    shared_ptr<Expr>  simplify(const shared_ptr<ArraySubExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    shared_ptr<Expr> visitOperatorExpr(const shared_ptr<OperatorExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
-    shared_ptr<Expr>  simplify(const shared_ptr<EnumUnionStructExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+    shared_ptr<Expr> visitCallExpr(const shared_ptr<CallExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+
+    shared_ptr<Expr> visitFieldExpr(const shared_ptr<FieldExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+
+    shared_ptr<Expr> visitMethodExpr(const shared_ptr<MethodExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+
+    shared_ptr<Expr> visitSubinterfaceExpr(const shared_ptr<SubinterfaceExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+
+    shared_ptr<Expr> visitCondExpr(const shared_ptr<CondExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+
+    shared_ptr<Expr> visitEnumUnionStructExpr(const shared_ptr<EnumUnionStructExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+
+    shared_ptr<Expr> visitInterfaceExpr(const shared_ptr<InterfaceExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
+
+    shared_ptr<Expr> visitMatchesExpr(const shared_ptr<MatchesExpr> &expr, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
     shared_ptr<Expr>  matchPattern(const shared_ptr<Pattern> &pattern, vector<shared_ptr<struct Stmt>> &simplifiedStmts);
 
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <ctype.h>
+
+#include "SourceText.h"
+
+string SourceText::text(antlr4::ParserRuleContext *ctx, size_t maxLength) {
+    antlr4::Token *start = ctx->getStart();
+    antlr4::Token *stop = ctx->getStop();
+    if (!start || !stop || maxLength == 0)
+        return string();
+    antlr4::CharStream *input = start->getInputStream();
+    if (!input || input != stop->getInputStream()) {
+        // spans an `include, whose tokens come from another stream
+        string result(ctx->getText());
+        return result.size() > maxLength ? result.substr(0, maxLength) : result;
+    }
+    size_t first = start->getStartIndex();
+    size_t last = stop->getStopIndex();
+    if (last == INVALID_INDEX || last < first)
+        return string();
+    if (last - first >= maxLength)
+        last = first + maxLength - 1;
+    return input->getText(antlr4::misc::Interval(first, last));
+}
+
+string SourceText::excerpt(antlr4::ParserRuleContext *ctx, size_t maxLength) {
+    string source(text(ctx, maxLength + 1));
+    string result;
+    result.reserve(source.size());
+    for (char c : source) {
+        if (isspace((unsigned char) c)) {
+            if (!result.empty() && result.back() != ' ')
+                result.push_back(' ');
+        } else {
+            result.push_back(c);
+        }
+    }
+    if (source.size() > maxLength) {
+        result.resize(min(result.size(), maxLength));
+        result += "...";
+    }
+    return result;
+}
+
+const string &SourceText::sourceName(antlr4::Token *token) {
+    antlr4::CharStream *input = token->getInputStream();
+    auto it = sourceNames.find(input);
+    if (it == sourceNames.end())
+        it = sourceNames.emplace(input, token->getTokenSource()->getSourceName()).first;
+    return it->second;
+}
+
+string SourceText::location(antlr4::ParserRuleContext *ctx) {
+    antlr4::Token *start = ctx->getStart();
+    return sourceName(start) + ":" + to_string(start->getLine());
+}
+
+SourcePos SourceText::sourcePos(antlr4::ParserRuleContext *ctx) {
+    antlr4::Token *start = ctx->getStart();
+    return SourcePos(sourceName(start), start->getLine(), start->getCharPositionInLine());
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "antlr4-runtime.h"
+
+using namespace std;
+
+#include "SourcePos.h"
+
+// Source text and positions of parse tree contexts, read from the character streams of
+// their tokens. ParserRuleContext::getText() concatenates the text of every token of the
+// subtree, so calling it on each node of a nested expression is quadratic in its size;
+// text() reads the span of the context from the input instead.
+class SourceText {
+    // source names of the streams seen since clear()
+    map<antlr4::CharStream *, string> sourceNames;
+
+public:
+    // the input from the start of the first token of ctx to the end of its last one, at
+    // most maxLength characters of it
+    static string text(antlr4::ParserRuleContext *ctx, size_t maxLength = string::npos);
+
+    // the start of text(ctx) on a single line, for log messages
+    static string excerpt(antlr4::ParserRuleContext *ctx, size_t maxLength = 64);
+
+    const string &sourceName(antlr4::Token *token);
+
+    // file:line of the first token of ctx
+    string location(antlr4::ParserRuleContext *ctx);
+
+    SourcePos sourcePos(antlr4::ParserRuleContext *ctx);
+
+    // forgets the streams, which must be called before they are freed
+    void clear() { sourceNames.clear(); }
+};
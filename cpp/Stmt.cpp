@@ -10,25 +10,10 @@ void indent(ostream &s, int depth) {
         s << " ";
 }
 
-void uniteSet(map<string,shared_ptr<BSVType>> &to, const map<string,shared_ptr<BSVType>> &from) {
-    for (auto it = from.cbegin(); it != from.cend(); ++it) {
-        to[it->first] = it->second;
-    }
-}
-
-string to_string(const map<string,shared_ptr<BSVType>> &s) {
-    string str;
-    str += "set(" + to_string(s.size());
-    for (auto it = s.cbegin(); it != s.cend(); ++it)
-        str += " " + it->first + "=" + it->second->to_string();
-    str += ")";
-    return str;
-}
-
 void attrUpdate(StmtAttrs &dst, const StmtAttrs &src) {
-    uniteSet(dst.freeVars, src.freeVars);
-    uniteSet(dst.boundVars, src.boundVars);
-    uniteSet(dst.assignedVars, src.assignedVars);
+    dst.freeVars.unite(src.freeVars);
+    dst.boundVars.unite(src.boundVars);
+    dst.assignedVars.unite(src.assignedVars);
 }
 
 Stmt::Stmt(StmtType stmtType, const SourcePos &sourcePos)
@@ -75,7 +60,7 @@ shared_ptr<Stmt> RuleDefStmt::rename(string prefix, shared_ptr<LexicalScope> &pa
     for (size_t i = 0; i < stmts.size(); i++) {
         renamedStmts.push_back(stmts[i]->rename(prefix, scope));
     }
-    return shared_ptr<Stmt>(new RuleDefStmt(prefix + name, renamedGuard, renamedStmts));
+    return makeAst<RuleDefStmt>(prefix + name, renamedGuard, renamedStmts);
 }
 
 void RegisterStmt::prettyPrint(ostream &out, int depth) {
@@ -89,7 +74,9 @@ shared_ptr<RegisterStmt> RegisterStmt::registerStmt() {
 }
 
 shared_ptr<struct Stmt> RegisterStmt::rename(string prefix, shared_ptr<LexicalScope> &scope) {
-    return make_shared<RegisterStmt>(regName, elementType);
+    string renamedRegName = prefix + regName;
+    scope->bind(regName, make_shared<Declaration>(renamedRegName, elementType));
+    return makeAst<RegisterStmt>(renamedRegName, elementType, sourcePos);
 }
 
 RegReadStmt::RegReadStmt(const string &regName, const string &var, const shared_ptr<BSVType> &varType, const SourcePos &sourcePos)
@@ -113,13 +100,13 @@ shared_ptr<Stmt> RegReadStmt::rename(string prefix, shared_ptr<LexicalScope> &sc
     if (decl) {
         renamedRegName = decl->name;
     }
-    shared_ptr<Expr> renamedRHS;
-    //FIXME renamed var
-    return RegReadStmt::create(renamedRegName, var, varType);
+    string renamedVar = prefix + var;
+    scope->bind(var, make_shared<Declaration>(renamedVar, varType));
+    return RegReadStmt::create(renamedRegName, renamedVar, varType);
 }
 
 shared_ptr<RegReadStmt> RegReadStmt::create(const string &regName, const string &var, const shared_ptr<BSVType> &varType) {
-    return make_shared<RegReadStmt>(regName, var, varType);
+    return makeAst<RegReadStmt>(regName, var, varType);
 }
 
 RegWriteStmt::RegWriteStmt(const string &regName, const shared_ptr<BSVType> &elementType, const shared_ptr<Expr> &rhs, const SourcePos &sourcePos)
@@ -149,7 +136,9 @@ shared_ptr<Stmt> RegWriteStmt::rename(string prefix, shared_ptr<LexicalScope> &s
     shared_ptr<Expr> renamedRHS;
     if (rhs)
         renamedRHS = rhs->rename(prefix, scope);
-    return make_shared<RegWriteStmt>(renamedRegName, elementType, renamedRHS);
+    if (renamedRegName == regName && renamedRHS == rhs)
+        return shared_from_this();
+    return makeAst<RegWriteStmt>(renamedRegName, elementType, renamedRHS);
 }
 
 ActionBindingStmt::ActionBindingStmt(const shared_ptr<BSVType> &bsvtype, const string &name,
@@ -174,12 +163,10 @@ ActionBindingStmt::actionBindingStmt() { return static_pointer_cast<ActionBindin
 shared_ptr<Stmt> ActionBindingStmt::rename(string prefix, shared_ptr<LexicalScope> &scope) {
     string renamedVar = prefix + name;
     shared_ptr<Expr> renamedRHS;
-    cerr << "Renaming action binding" << endl;
-    rhs->prettyPrint(cerr, 4);
     if (rhs)
         renamedRHS = rhs->rename(prefix, scope);
     scope->bind(name, make_shared<Declaration>(renamedVar, bsvtype));
-    return shared_ptr<Stmt>(new ActionBindingStmt(bsvtype, renamedVar, renamedRHS));
+    return makeAst<ActionBindingStmt>(bsvtype, renamedVar, renamedRHS);
 }
 
 void PatternMatchStmt::prettyPrint(ostream &out, int depth) {
@@ -203,7 +190,9 @@ shared_ptr<Stmt> PatternMatchStmt::rename(string prefix, shared_ptr<LexicalScope
     if (rhs)
         renamedRHS = rhs->rename(prefix, scope);
     //scope->bind(name, renamedVar);
-    return make_shared<PatternMatchStmt>(pattern, op, renamedRHS);
+    if (renamedRHS == rhs)
+        return shared_from_this();
+    return makeAst<PatternMatchStmt>(pattern, op, renamedRHS);
 }
 
 VarBindingStmt::VarBindingStmt(const shared_ptr<BSVType> &bsvtype, const string &name,
@@ -239,16 +228,19 @@ shared_ptr<Stmt> VarBindingStmt::rename(string prefix, shared_ptr<LexicalScope>
     if (rhs)
         renamedRHS = rhs->rename(prefix, scope);
     scope->bind(name, make_shared<Declaration>(package, renamedVar, bsvtype, bindingType));
-    return shared_ptr<Stmt>(new VarBindingStmt(bsvtype, renamedVar, renamedRHS));
+    return makeAst<VarBindingStmt>(bsvtype, renamedVar, renamedRHS);
 }
 
 VarAssignStmt::VarAssignStmt(const shared_ptr<LValue> &lhs, const string &op, const shared_ptr<Expr> &rhs, const SourcePos &sourcePos)
         : Stmt(VarAssignStmtType, sourcePos), lhs(lhs), op(op), rhs(rhs) {
-    uniteSet(attrs_.assignedVars, lhs->attrs().assignedVars);
+}
+
+void VarAssignStmt::computeAttrs(StmtAttrs &attrs) {
+    attrs.assignedVars.unite(lhs->attrs().assignedVars);
 
-    uniteSet(attrs_.freeVars, lhs->attrs().freeVars);
-    uniteSet(attrs_.freeVars, rhs->attrs().freeVars);
-    //cerr << "var assigned vars " << to_string(attrs_.boundVars) << " at " << sourcePos.toString() << endl;
+    attrs.freeVars.unite(lhs->attrs().freeVars);
+    attrs.freeVars.unite(rhs->attrs().freeVars);
+    //cerr << "var assigned vars " << to_string(attrs.boundVars) << " at " << sourcePos.toString() << endl;
 }
 
 void VarAssignStmt::prettyPrint(ostream &out, int depth)
@@ -265,8 +257,11 @@ shared_ptr<VarAssignStmt> VarAssignStmt::varAssignStmt() {
 }
 
 shared_ptr<struct Stmt> VarAssignStmt::rename(string prefix, shared_ptr<LexicalScope> &scope) {
-    shared_ptr<LValue> newLHS; //FIXME
-    return shared_ptr<Stmt>(new VarAssignStmt(newLHS, op, rhs->rename(prefix, scope)));
+    shared_ptr<LValue> renamedLHS = lhs->rename(prefix, scope);
+    shared_ptr<Expr> renamedRHS = rhs->rename(prefix, scope);
+    if (renamedLHS == lhs && renamedRHS == rhs)
+        return shared_from_this();
+    return makeAst<VarAssignStmt>(renamedLHS, op, renamedRHS);
 }
 
 
@@ -312,11 +307,15 @@ shared_ptr<Stmt> FunctionDefStmt::rename(string prefix, shared_ptr<LexicalScope>
     shared_ptr<Expr> renamedGuard;
     if (guard)
         renamedGuard = guard->rename(prefix, parentScope);
+    bool changed = renamedGuard != guard;
     vector<shared_ptr<Stmt>> renamedStmts;
     for (size_t i = 0; i < stmts.size(); i++) {
         renamedStmts.push_back(stmts[i]->rename(prefix, scope));
+        changed |= renamedStmts.back() != stmts[i];
     }
-    return make_shared<FunctionDefStmt>(package, name, returnType, params, paramTypes, renamedGuard, renamedStmts);
+    if (!changed)
+        return shared_from_this();
+    return makeAst<FunctionDefStmt>(package, name, returnType, params, paramTypes, renamedGuard, renamedStmts);
 }
 
 MethodDeclStmt::MethodDeclStmt(const string &name, const shared_ptr<BSVType> &returnType,
@@ -389,11 +388,15 @@ shared_ptr<Stmt> MethodDefStmt::rename(string prefix, shared_ptr<LexicalScope> &
     shared_ptr<Expr> renamedGuard;
     if (guard)
         renamedGuard = guard->rename(prefix, parentScope);
+    bool changed = renamedGuard != guard;
     vector<shared_ptr<Stmt>> renamedStmts;
     for (size_t i = 0; i < stmts.size(); i++) {
         renamedStmts.push_back(stmts[i]->rename(prefix, scope));
+        changed |= renamedStmts.back() != stmts[i];
     }
-    return shared_ptr<Stmt>(new MethodDefStmt(name, returnType, params, paramTypes, renamedGuard, renamedStmts));
+    if (!changed)
+        return shared_from_this();
+    return makeAst<MethodDefStmt>(name, returnType, params, paramTypes, renamedGuard, renamedStmts);
 }
 
 ModuleDefStmt::ModuleDefStmt(const string &package, const std::string &name,
@@ -449,11 +452,9 @@ shared_ptr<Stmt> ModuleDefStmt::rename(string prefix, shared_ptr<LexicalScope> &
         scope->bind(params[i], make_shared<Declaration>(package, renamedParam, paramTypes[i], ModuleParamBindingType));
     }
     for (size_t i = 0; i < stmts.size(); i++) {
-        cerr << "renaming stmt" << endl;
-        stmts[i]->prettyPrint(cerr, 0);
         renamedStmts.push_back(stmts[i]->rename(prefix, scope));
     }
-    return make_shared<ModuleDefStmt>(package, name, interfaceType, renamedParams, paramTypes, renamedStmts);
+    return makeAst<ModuleDefStmt>(package, name, interfaceType, renamedParams, paramTypes, renamedStmts);
 }
 
 ModuleInstStmt::ModuleInstStmt(const string &name, const shared_ptr<BSVType> &interfaceType,
@@ -476,12 +477,14 @@ shared_ptr<ModuleInstStmt> ModuleInstStmt::moduleInstStmt() {
 }
 
 shared_ptr<Stmt> ModuleInstStmt::rename(string prefix, shared_ptr<LexicalScope> &scope) {
-    //FIXME:
-    return make_shared<ModuleInstStmt>(name, interfaceType, rhs->rename(prefix, scope));
+    string renamedName = prefix + name;
+    shared_ptr<Expr> renamedRHS = rhs->rename(prefix, scope);
+    scope->bind(name, make_shared<Declaration>(renamedName, interfaceType));
+    return makeAst<ModuleInstStmt>(renamedName, interfaceType, renamedRHS, sourcePos);
 }
 
 shared_ptr<ModuleInstStmt> ModuleInstStmt::create(const string &name, const shared_ptr<BSVType> &interfaceType, const shared_ptr<Expr> &rhs) {
-    return shared_ptr<ModuleInstStmt>(new ModuleInstStmt(name, interfaceType, rhs));
+    return makeAst<ModuleInstStmt>(name, interfaceType, rhs);
 }
 
 
@@ -489,9 +492,12 @@ IfStmt::IfStmt(const shared_ptr<Expr> &condition, const shared_ptr<Stmt> &thenSt
                const shared_ptr<Stmt> &elseStmt, const SourcePos &sourcePos) : Stmt(IfStmtType, sourcePos),
                                                                                condition(condition), thenStmt(thenStmt),
                                                                                elseStmt(elseStmt) {
-    attrUpdate(attrs_, thenStmt->attrs());
+}
+
+void IfStmt::computeAttrs(StmtAttrs &attrs) {
+    attrUpdate(attrs, thenStmt->attrs());
     if (elseStmt)
-        attrUpdate(attrs_, elseStmt->attrs());
+        attrUpdate(attrs, elseStmt->attrs());
 }
 
 IfStmt::~IfStmt() {
@@ -515,20 +521,118 @@ void IfStmt::prettyPrint(ostream &out, int depth) {
 shared_ptr<IfStmt> IfStmt::ifStmt() { return static_pointer_cast<IfStmt, Stmt>(shared_from_this()); }
 
 shared_ptr<struct Stmt> IfStmt::rename(string prefix, shared_ptr<LexicalScope> &scope) {
+    shared_ptr<Expr> renamedCondition = condition->rename(prefix, scope);
+    shared_ptr<Stmt> renamedThen = thenStmt->rename(prefix, scope);
+    shared_ptr<Stmt> renamedElse;
     if (elseStmt)
-        return shared_ptr<Stmt>(new IfStmt(condition->rename(prefix, scope),
-                                           thenStmt->rename(prefix, scope),
-                                           elseStmt->rename(prefix, scope)));
-    else
-        return shared_ptr<Stmt>(new IfStmt(condition->rename(prefix, scope),
-                                           thenStmt->rename(prefix, scope),
-                                           shared_ptr<Stmt>()));
+        renamedElse = elseStmt->rename(prefix, scope);
+    if (renamedCondition == condition && renamedThen == thenStmt && renamedElse == elseStmt)
+        return shared_from_this();
+    return makeAst<IfStmt>(renamedCondition, renamedThen, renamedElse);
+}
+
+// prints the init and incr clauses of a for loop header, which are
+// VarBindingStmts and VarAssignStmts without their statement terminators
+static void prettyPrintLoopClauses(ostream &out, const vector<shared_ptr<Stmt>> &stmts) {
+    for (size_t i = 0; i < stmts.size(); i++) {
+        if (i)
+            out << ", ";
+        if (shared_ptr<VarBindingStmt> varBinding = stmts[i]->varBindingStmt()) {
+            if (varBinding->bsvtype) varBinding->bsvtype->prettyPrint(out, 0);
+            out << " " << varBinding->name << " = ";
+            varBinding->rhs->prettyPrint(out, 0);
+        } else if (shared_ptr<VarAssignStmt> varAssign = stmts[i]->varAssignStmt()) {
+            shared_ptr<VarLValue> varLValue = varAssign->lhs->varLValue();
+            out << (varLValue ? varLValue->name : string("?")) << " " << varAssign->op << " ";
+            varAssign->rhs->prettyPrint(out, 0);
+        }
+    }
+}
+
+ForStmt::ForStmt(const vector<shared_ptr<Stmt>> &init, const shared_ptr<Expr> &test,
+                 const vector<shared_ptr<Stmt>> &incr, const shared_ptr<Stmt> &body, const SourcePos &sourcePos)
+        : Stmt(ForStmtType, sourcePos), init(init), test(test), incr(incr), body(body) {
+}
+
+void ForStmt::computeAttrs(StmtAttrs &attrs) {
+    for (size_t i = 0; i < init.size(); i++)
+        attrUpdate(attrs, init[i]->attrs());
+    attrs.freeVars.unite(test->attrs().freeVars);
+    for (size_t i = 0; i < incr.size(); i++)
+        attrUpdate(attrs, incr[i]->attrs());
+    attrUpdate(attrs, body->attrs());
+}
+
+void ForStmt::prettyPrint(ostream &out, int depth) {
+    indent(out, depth);
+    out << "for (";
+    prettyPrintLoopClauses(out, init);
+    out << "; ";
+    test->prettyPrint(out);
+    out << "; ";
+    prettyPrintLoopClauses(out, incr);
+    out << ") ";
+    body->prettyPrint(out, depth + 1);
+    out << endl;
+}
+
+shared_ptr<ForStmt> ForStmt::forStmt() { return static_pointer_cast<ForStmt, Stmt>(shared_from_this()); }
+
+shared_ptr<struct Stmt> ForStmt::rename(string prefix, shared_ptr<LexicalScope> &parentScope) {
+    shared_ptr<LexicalScope> scope(make_shared<LexicalScope>("for", parentScope));
+    bool changed = false;
+    vector<shared_ptr<Stmt>> renamedInit;
+    for (size_t i = 0; i < init.size(); i++) {
+        renamedInit.push_back(init[i]->rename(prefix, scope));
+        changed |= renamedInit.back() != init[i];
+    }
+    shared_ptr<Expr> renamedTest = test->rename(prefix, scope);
+    vector<shared_ptr<Stmt>> renamedIncr;
+    for (size_t i = 0; i < incr.size(); i++) {
+        renamedIncr.push_back(incr[i]->rename(prefix, scope));
+        changed |= renamedIncr.back() != incr[i];
+    }
+    shared_ptr<Stmt> renamedBody = body->rename(prefix, scope);
+    if (!changed && renamedTest == test && renamedBody == body)
+        return shared_from_this();
+    return makeAst<ForStmt>(renamedInit, renamedTest, renamedIncr, renamedBody, sourcePos);
+}
+
+WhileStmt::WhileStmt(const shared_ptr<Expr> &test, const shared_ptr<Stmt> &body, const SourcePos &sourcePos)
+        : Stmt(WhileStmtType, sourcePos), test(test), body(body) {
+}
+
+void WhileStmt::computeAttrs(StmtAttrs &attrs) {
+    attrs.freeVars.unite(test->attrs().freeVars);
+    attrUpdate(attrs, body->attrs());
+}
+
+void WhileStmt::prettyPrint(ostream &out, int depth) {
+    indent(out, depth);
+    out << "while (";
+    test->prettyPrint(out);
+    out << ") ";
+    body->prettyPrint(out, depth + 1);
+    out << endl;
+}
+
+shared_ptr<WhileStmt> WhileStmt::whileStmt() { return static_pointer_cast<WhileStmt, Stmt>(shared_from_this()); }
+
+shared_ptr<struct Stmt> WhileStmt::rename(string prefix, shared_ptr<LexicalScope> &scope) {
+    shared_ptr<Expr> renamedTest = test->rename(prefix, scope);
+    shared_ptr<Stmt> renamedBody = body->rename(prefix, scope);
+    if (renamedTest == test && renamedBody == body)
+        return shared_from_this();
+    return makeAst<WhileStmt>(renamedTest, renamedBody, sourcePos);
 }
 
 BlockStmt::BlockStmt(const std::vector<std::shared_ptr<Stmt>> &stmts, const SourcePos &sourcePos)
         : Stmt(BlockStmtType, sourcePos), stmts(stmts) {
+}
+
+void BlockStmt::computeAttrs(StmtAttrs &attrs) {
     for (int i = 0; i < stmts.size(); i++) {
-        attrUpdate(attrs_, stmts[i]->attrs());
+        attrUpdate(attrs, stmts[i]->attrs());
     }
 }
 
@@ -550,11 +654,15 @@ shared_ptr<BlockStmt> BlockStmt::blockStmt() { return static_pointer_cast<BlockS
 
 shared_ptr<struct Stmt> BlockStmt::rename(string prefix, shared_ptr<LexicalScope> &parentScope) {
     shared_ptr<LexicalScope> scope(make_shared<LexicalScope>("block", parentScope));
+    bool changed = false;
     vector<shared_ptr<Stmt>> renamedStmts;
     for (size_t i = 0; i < stmts.size(); i++) {
         renamedStmts.push_back(stmts[i]->rename(prefix, scope));
+        changed |= renamedStmts.back() != stmts[i];
     }
-    return shared_ptr<Stmt>(new BlockStmt(renamedStmts));
+    if (!changed)
+        return shared_from_this();
+    return makeAst<BlockStmt>(renamedStmts);
 }
 
 void CallStmt::prettyPrint(ostream &out, int depth) {
@@ -570,8 +678,10 @@ shared_ptr<CallStmt> CallStmt::callStmt() { return static_pointer_cast<CallStmt,
 
 shared_ptr<Stmt> CallStmt::rename(string prefix, shared_ptr<LexicalScope> &scope)
 {
-    cerr << "FIXME: unhandled CallStmt::rename" << endl;
-    return make_shared<CallStmt>(name, interfaceType, rhs);
+    string renamedName = prefix + name;
+    shared_ptr<Expr> renamedRHS = rhs->rename(prefix, scope);
+    scope->bind(name, make_shared<Declaration>(renamedName, interfaceType));
+    return makeAst<CallStmt>(renamedName, interfaceType, renamedRHS, sourcePos);
 }
 
 void ReturnStmt::prettyPrint(ostream &out, int depth) {
@@ -584,7 +694,10 @@ void ReturnStmt::prettyPrint(ostream &out, int depth) {
 shared_ptr<ReturnStmt> ReturnStmt::returnStmt() { return static_pointer_cast<ReturnStmt, Stmt>(shared_from_this()); }
 
 shared_ptr<struct Stmt> ReturnStmt::rename(string prefix, shared_ptr<LexicalScope> &scope) {
-    return shared_ptr<Stmt>(new ReturnStmt(value->rename(prefix, scope)));
+    shared_ptr<Expr> renamedValue = value->rename(prefix, scope);
+    if (renamedValue == value)
+        return shared_from_this();
+    return makeAst<ReturnStmt>(renamedValue);
 }
 
 void ExprStmt::prettyPrint(ostream &out, int depth) {
@@ -596,7 +709,10 @@ void ExprStmt::prettyPrint(ostream &out, int depth) {
 shared_ptr<ExprStmt> ExprStmt::exprStmt() { return static_pointer_cast<ExprStmt, Stmt>(shared_from_this()); }
 
 shared_ptr<struct Stmt> ExprStmt::rename(string prefix, shared_ptr<LexicalScope> &scope) {
-    return shared_ptr<Stmt>(new ExprStmt(expr->rename(prefix, scope)));
+    shared_ptr<Expr> renamedExpr = expr->rename(prefix, scope);
+    if (renamedExpr == expr)
+        return shared_from_this();
+    return makeAst<ExprStmt>(renamedExpr);
 }
 
 ImportStmt::ImportStmt(const std::string &name, const SourcePos &sourcePos) : Stmt(ImportStmtType, sourcePos), name(name) {
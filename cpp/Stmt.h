@@ -8,12 +8,14 @@
 
 using namespace std;
 
+#include "AstArena.h"
 #include "BSVType.h"
 #include "Declaration.h"
 #include "Expr.h"
 #include "LValue.h"
 #include "LexicalScope.h"
 #include "SourcePos.h"
+#include "VarSet.h"
 
 void indent(ostream &s, int depth);
 
@@ -43,7 +45,9 @@ enum StmtType {
     TypedefSynonymStmtType,
     VarBindingStmtType,
     VarAssignStmtType,
-    RuleDefStmtType
+    RuleDefStmtType,
+    ForStmtType,
+    WhileStmtType
 };
 
 class ActionBindingStmt;
@@ -54,6 +58,8 @@ class CallStmt;
 
 class ExprStmt;
 
+class ForStmt;
+
 class FunctionDefStmt;
 
 class IfStmt;
@@ -96,15 +102,15 @@ class VarBindingStmt;
 
 class VarAssignStmt;
 
+class WhileStmt;
+
 class StmtAttrs {
 public:
-    map<string,shared_ptr<BSVType>> boundVars;
-    map<string,shared_ptr<BSVType>> assignedVars;
-    map<string,shared_ptr<BSVType>> freeVars;
+    VarSet boundVars;
+    VarSet assignedVars;
+    VarSet freeVars;
 };
 
-void uniteSet(map<string,shared_ptr<BSVType>> &to, const map<string,shared_ptr<BSVType>> &from);
-string to_string(const map<string,shared_ptr<BSVType>> &s);
 
 class Stmt : public enable_shared_from_this<Stmt> {
 
@@ -116,7 +122,14 @@ public:
 
     virtual ~Stmt() {}
 
-    const StmtAttrs &attrs() { return attrs_; }
+    // computed on first use and cached; statements are immutable once built
+    const StmtAttrs &attrs() {
+        if (!attrsValid) {
+            computeAttrs(attrs_);
+            attrsValid = true;
+        }
+        return attrs_;
+    }
 
     virtual void prettyPrint(ostream &out, int depth = 0) = 0;
 
@@ -128,6 +141,8 @@ public:
 
     virtual shared_ptr<ExprStmt> exprStmt() { return shared_ptr<ExprStmt>(); }
 
+    virtual shared_ptr<ForStmt> forStmt() { return shared_ptr<ForStmt>(); }
+
     virtual shared_ptr<FunctionDefStmt> functionDefStmt() { return shared_ptr<FunctionDefStmt>(); }
 
     virtual shared_ptr<IfStmt> ifStmt() { return shared_ptr<IfStmt>(); }
@@ -170,9 +185,16 @@ public:
 
     virtual shared_ptr<VarAssignStmt> varAssignStmt() { return shared_ptr<VarAssignStmt>(); };
 
+    virtual shared_ptr<WhileStmt> whileStmt() { return shared_ptr<WhileStmt>(); }
+
     virtual shared_ptr<struct Stmt> rename(string prefix, shared_ptr<LexicalScope> &parentScope);
 
+protected:
+    virtual void computeAttrs(StmtAttrs &attrs) {}
+
+private:
     StmtAttrs attrs_;
+    bool attrsValid = false;
 };
 
 class ImportStmt : public Stmt {
@@ -477,7 +499,8 @@ public:
     shared_ptr<VarAssignStmt> varAssignStmt() override;
 
     shared_ptr<struct Stmt> rename(string prefix, shared_ptr<LexicalScope> &parentScope) override;
-
+protected:
+    void computeAttrs(StmtAttrs &attrs) override;
 };
 
 class VarBindingStmt : public Stmt {
@@ -597,7 +620,8 @@ public:
     const vector<shared_ptr<Stmt>> stmts;
 
     shared_ptr<struct Stmt> rename(string prefix, shared_ptr<LexicalScope> &parentScope) override;
-
+protected:
+    void computeAttrs(StmtAttrs &attrs) override;
 };
 
 class IfStmt : public Stmt {
@@ -616,7 +640,50 @@ public:
     const shared_ptr<Stmt> elseStmt;
 
     shared_ptr<struct Stmt> rename(string prefix, shared_ptr<LexicalScope> &parentScope) override;
+protected:
+    void computeAttrs(StmtAttrs &attrs) override;
+};
+
+// for (init; test; incr) body
+// init holds the VarBindingStmts of the loop variables and incr their VarAssignStmts
+class ForStmt : public Stmt {
+public:
+    ForStmt(const vector<shared_ptr<Stmt>> &init, const shared_ptr<Expr> &test,
+            const vector<shared_ptr<Stmt>> &incr, const shared_ptr<Stmt> &body,
+            const SourcePos &sourcePos = SourcePos());
+
+    ~ForStmt() override {}
+
+    void prettyPrint(ostream &out, int depth) override;
+
+    virtual shared_ptr<ForStmt> forStmt() override;
+
+    const vector<shared_ptr<Stmt>> init;
+    const shared_ptr<Expr> test;
+    const vector<shared_ptr<Stmt>> incr;
+    const shared_ptr<Stmt> body;
+
+    shared_ptr<struct Stmt> rename(string prefix, shared_ptr<LexicalScope> &parentScope) override;
+protected:
+    void computeAttrs(StmtAttrs &attrs) override;
+};
+
+class WhileStmt : public Stmt {
+public:
+    WhileStmt(const shared_ptr<Expr> &test, const shared_ptr<Stmt> &body, const SourcePos &sourcePos = SourcePos());
 
+    ~WhileStmt() override {}
+
+    void prettyPrint(ostream &out, int depth) override;
+
+    virtual shared_ptr<WhileStmt> whileStmt() override;
+
+    const shared_ptr<Expr> test;
+    const shared_ptr<Stmt> body;
+
+    shared_ptr<struct Stmt> rename(string prefix, shared_ptr<LexicalScope> &parentScope) override;
+protected:
+    void computeAttrs(StmtAttrs &attrs) override;
 };
 
 class ReturnStmt : public Stmt {
@@ -1,84 +1,154 @@
-//
-// Imported by Jamey Hicks on 1/27/20.
-// https://www.geeksforgeeks.org/topological-sorting/
-//
+#include <algorithm>
+#include <functional>
+#include <queue>
 
 #include "TopologicalSort.h"
 
-
-Graph::Graph(int V)
+Graph::Graph(int numVertices)
+    : numVertices(numVertices), compressed(false)
 {
-    this->V = V;
-    adj = new list<int>[V];
 }
 
-Graph::~Graph()
+int Graph::addVertex()
 {
-    delete [] adj;
+    compressed = false;
+    return numVertices++;
 }
 
 void Graph::addEdge(int v, int w)
 {
-    adj[v].push_back(w); // Add w to v’s list.
+    compressed = false;
+    edges.push_back(make_pair(v, w));
 }
 
-// A recursive function used by topologicalSort
-void Graph::topologicalSortUtil(int v, bool visited[],
-                                stack<int> &Stack)
+// a counting sort of the edges by source, keeping the order in which they were added
+void Graph::compress()
 {
-    // Mark the current node as visited.
-    visited[v] = true;
-
-    // Recur for all the vertices adjacent to this vertex
-    list<int>::iterator i;
-    for (i = adj[v].begin(); i != adj[v].end(); ++i)
-        if (!visited[*i])
-            topologicalSortUtil(*i, visited, Stack);
-
-    // Push current vertex to stack which stores result
-    Stack.push(v);
+    if (compressed)
+        return;
+    offsets.assign(numVertices + 1, 0);
+    for (size_t i = 0; i < edges.size(); i++)
+        offsets[edges[i].first + 1]++;
+    for (int v = 0; v < numVertices; v++)
+        offsets[v + 1] += offsets[v];
+    targets.resize(edges.size());
+    vector<int> next(offsets.cbegin(), offsets.cend() - 1);
+    for (size_t i = 0; i < edges.size(); i++)
+        targets[next[edges[i].first]++] = edges[i].second;
+    compressed = true;
 }
 
-// The function to do Topological Sort. It uses recursive
-// topologicalSortUtil()
-void Graph::topologicalSort()
+vector<vector<int>> Graph::stronglyConnectedComponents()
 {
-    stack<int> Stack;
+    compress();
+    vector<vector<int>> components;
+    vector<int> index(numVertices, -1);
+    vector<int> lowlink(numVertices, 0);
+    vector<bool> onStack(numVertices, false);
+    vector<int> stack;
+    // the vertices being visited, with the offset of the next successor to look at
+    vector<pair<int, int>> visiting;
+    int nextIndex = 0;
 
-    // Mark all the vertices as not visited
-    bool *visited = new bool[V];
-    for (int i = 0; i < V; i++)
-        visited[i] = false;
+    for (int s = 0; s < numVertices; s++) {
+        if (index[s] >= 0)
+            continue;
+        index[s] = lowlink[s] = nextIndex++;
+        stack.push_back(s);
+        onStack[s] = true;
+        visiting.push_back(make_pair(s, offsets[s]));
 
-    // Call the recursive helper function to store Topological
-    // Sort starting from all vertices one by one
-    for (int i = 0; i < V; i++)
-        if (visited[i] == false)
-            topologicalSortUtil(i, visited, Stack);
+        while (!visiting.empty()) {
+            int v = visiting.back().first;
+            int next = visiting.back().second;
+            if (next < offsets[v + 1]) {
+                visiting.back().second++;
+                int w = targets[next];
+                if (index[w] < 0) {
+                    index[w] = lowlink[w] = nextIndex++;
+                    stack.push_back(w);
+                    onStack[w] = true;
+                    visiting.push_back(make_pair(w, offsets[w]));
+                } else if (onStack[w]) {
+                    lowlink[v] = min(lowlink[v], index[w]);
+                }
+                continue;
+            }
+
+            visiting.pop_back();
+            if (!visiting.empty()) {
+                int u = visiting.back().first;
+                lowlink[u] = min(lowlink[u], lowlink[v]);
+            }
+            if (lowlink[v] == index[v]) {
+                vector<int> component;
+                int w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    onStack[w] = false;
+                    component.push_back(w);
+                } while (w != v);
+                sort(component.begin(), component.end());
+                components.push_back(component);
+            }
+        }
+    }
+    return components;
+}
 
-    // Print contents of stack
-    while (Stack.empty() == false)
-    {
-        cout << Stack.top() << " ";
-        Stack.pop();
+vector<vector<int>> Graph::cycles()
+{
+    vector<vector<int>> components = stronglyConnectedComponents();
+    vector<vector<int>> result;
+    for (size_t i = 0; i < components.size(); i++) {
+        int v = components[i][0];
+        if (components[i].size() > 1 || find(successorsBegin(v), successorsEnd(v), v) != successorsEnd(v))
+            result.push_back(components[i]);
     }
-    delete visited;
+    return result;
 }
 
-// Driver program to test above functions
-int testTopologicalSort()
+// Kahn's algorithm over the components, taking the ready one with the smallest vertex first
+bool Graph::topologicalSort(vector<int> &order)
 {
-    // Create a graph given in the above diagram
-    Graph g(6);
-    g.addEdge(5, 2);
-    g.addEdge(5, 0);
-    g.addEdge(4, 0);
-    g.addEdge(4, 1);
-    g.addEdge(2, 3);
-    g.addEdge(3, 1);
+    vector<vector<int>> components = stronglyConnectedComponents();
+    vector<int> componentOf(numVertices);
+    for (size_t c = 0; c < components.size(); c++)
+        for (size_t i = 0; i < components[c].size(); i++)
+            componentOf[components[c][i]] = c;
 
-    cout << "Following is a Topological Sort of the given graph \n";
-    g.topologicalSort();
+    bool acyclic = true;
+    vector<int> inDegree(components.size(), 0);
+    for (int v = 0; v < numVertices; v++) {
+        for (const int *w = successorsBegin(v); w != successorsEnd(v); ++w) {
+            if (componentOf[*w] != componentOf[v])
+                inDegree[componentOf[*w]]++;
+            else
+                acyclic = false;
+        }
+    }
 
-    return 0;
+    priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> ready;
+    for (size_t c = 0; c < components.size(); c++)
+        if (inDegree[c] == 0)
+            ready.push(make_pair(components[c][0], c));
+
+    order.clear();
+    order.reserve(numVertices);
+    while (!ready.empty()) {
+        int c = ready.top().second;
+        ready.pop();
+        const vector<int> &component = components[c];
+        for (size_t i = 0; i < component.size(); i++) {
+            int v = component[i];
+            order.push_back(v);
+            for (const int *w = successorsBegin(v); w != successorsEnd(v); ++w) {
+                int d = componentOf[*w];
+                if (d != c && --inDegree[d] == 0)
+                    ready.push(make_pair(components[d][0], d));
+            }
+        }
+    }
+    return acyclic;
 }
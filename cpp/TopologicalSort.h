@@ -1,39 +1,54 @@
-//
-// Imported by Jamey Hicks on 1/27/20.
-// https://www.geeksforgeeks.org/topological-sorting/
-//
-
 #ifndef BSV_PARSER_TOPOLOGICALSORT_H
 #define BSV_PARSER_TOPOLOGICALSORT_H
 
-// A C++ program to print topological sorting of a DAG
-#include<iostream>
-#include <list>
-#include <stack>
+#include <utility>
+#include <vector>
+
 using namespace std;
 
-// Class to represent a graph
+// A directed graph over the vertices 0 .. size() - 1.
+//
+// Edges are collected as they are added and compressed into a CSR layout,
+// successors of v being targets[offsets[v]] .. targets[offsets[v + 1] - 1],
+// the first time the graph is queried. None of the algorithms recurse, so
+// deep graphs with millions of edges do not exhaust the stack.
 class Graph
 {
-    int V; // No. of vertices'
+    int numVertices;
+    vector<pair<int, int>> edges;
+    vector<int> offsets;
+    vector<int> targets;
+    bool compressed;
 
-    // Pointer to an array containing adjacency listsList
-    list<int> *adj;
+    void compress();
 
-    // A function used by topologicalSort
-    void topologicalSortUtil(int v, bool visited[], stack<int> &Stack);
 public:
-    Graph(int V); // Constructor
-    ~Graph();
+    explicit Graph(int numVertices = 0);
+    ~Graph() {}
 
-    // function to add an edge to graph
+    int size() const { return numVertices; }
+    size_t numEdges() const { return edges.size(); }
+
+    // returns the new vertex
+    int addVertex();
+
+    // adds an edge from v to w, meaning v comes before w
     void addEdge(int v, int w);
 
-    // prints a Topological Sort of the complete graph
-    void topologicalSort();
-};
+    const int *successorsBegin(int v) { compress(); return targets.data() + offsets[v]; }
+    const int *successorsEnd(int v) { compress(); return targets.data() + offsets[v + 1]; }
 
+    // Tarjan's algorithm. Each component lists its vertices in increasing order, and a component
+    // comes after every component it has an edge to.
+    vector<vector<int>> stronglyConnectedComponents();
 
+    // the components with more than one vertex or with an edge to itself
+    vector<vector<int>> cycles();
 
+    // computes an order in which v precedes w for each edge (v, w) not on a cycle, unrelated
+    // vertices staying in increasing order. The vertices of a cycle are kept together, in
+    // increasing order. Returns false if the graph has a cycle.
+    bool topologicalSort(vector<int> &order);
+};
 
 #endif //BSV_PARSER_TOPOLOGICALSORT_H
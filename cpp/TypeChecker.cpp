@@ -139,9 +139,9 @@ void PackageContext::visitUnionDeclaration(const shared_ptr<UnionDeclaration> &d
 }
 
 
-BSVParser::PackagedefContext *TypeChecker::analyzePackage(const string &packageName) {
+void TypeChecker::analyzePackage(const string &packageName) {
     if (packageScopes.find(packageName) != packageScopes.cend())
-        return nullptr;
+        return;
 
     currentContext->logstream << "analyze package " << packageName << endl;
 
@@ -175,13 +175,22 @@ BSVParser::PackagedefContext *TypeChecker::analyzePackage(const string &packageN
     packageScopes[packageName] = lexicalScope;
 
     visit(tree);
+    // the tree and its tokens are freed with the parser
+    releaseParseTree();
 
     currentContext->logstream.close();
 
     lexicalScope = previousScope;
     currentContext = previousContext;
     cerr << "returning to package " << currentContext->packageName << endl;
-    return tree;
+}
+
+void TypeChecker::releaseParseTree() {
+    exprs.clear();
+    trackers.clear();
+    varDecls.clear();
+    solvedModel.reset();
+    sourceText.clear();
 }
 
 const vector<string> TypeChecker::visitedPackageNames() const {
@@ -224,6 +233,7 @@ void TypeChecker::setupModuleFunctionConstructors() {
 void TypeChecker::setupZ3Context() {
     currentContext->logstream << "setup Z3 context" << endl;
     exprs.clear();
+    solvedModel.reset();
     trackers.clear();
     typeDecls.clear();
 
@@ -337,7 +347,8 @@ bool TypeChecker::checkSolution(antlr4::ParserRuleContext *ctx, bool displaySolu
                 z3::expr e = it->second;
                 try {
                     z3::expr v = mod.eval(e, true);
-                    currentContext->logstream << e << " evaluates to " << v << " for " << it->first->getText() << " at "
+                    currentContext->logstream << e << " evaluates to " << v << " for "
+                                              << SourceText::excerpt(it->first) << " at "
                                               << sourceLocation(it->first) << endl;
                 } catch (const exception &e) {
                     currentContext->logstream << "exception " << e.what() << " on expr: " << it->second << " @"
@@ -388,14 +399,14 @@ z3::expr TypeChecker::constant(std::string name, z3::sort sort) {
 }
 
 void TypeChecker::insertExpr(antlr4::ParserRuleContext *ctx, z3::expr expr) {
-    currentContext->logstream << "  insert expr " << ctx->getText().c_str() << " @" << ctx->getRuleIndex() << " at "
+    currentContext->logstream << "  insert expr " << SourceText::excerpt(ctx) << " @" << ctx->getRuleIndex() << " at "
                               << sourceLocation(ctx) << endl;
     exprs.insert(std::pair<antlr4::ParserRuleContext *, z3::expr>(ctx, expr));
 }
 
 void TypeChecker::addConstraint(z3::expr constraint, const string &trackerPrefix, antlr4::ParserRuleContext *ctx) {
     string trackerName(freshString(trackerPrefix));
-    currentContext->logstream << "  insert tracker " << ctx->getText().c_str() << " prefix " << trackerName << " at "
+    currentContext->logstream << "  insert tracker " << SourceText::excerpt(ctx) << " prefix " << trackerName << " at "
                               << sourceLocation(ctx) << endl;
 
     solver.add(constraint, trackerName.c_str());
@@ -450,9 +461,18 @@ TypeChecker::~TypeChecker() {}
 
 
 shared_ptr<BSVType> TypeChecker::lookup(antlr4::ParserRuleContext *ctx) {
-    if (exprTypes.find(ctx) != exprTypes.cend())
-        return exprTypes.find(ctx)->second;
-    currentContext->logstream << "no entry for @" << ctx->getRuleIndex() << ": " << ctx->getText() << " at "
+    auto it = exprs.find(ctx);
+    if (solvedModel && it != exprs.cend()) {
+        try {
+            z3::expr v = solvedModel->eval(it->second, true);
+            currentContext->logstream << it->second << " evaluates to " << v << " at " << sourceLocation(ctx) << endl;
+            return bsvtype(v, *solvedModel);
+        } catch (const exception &e) {
+            currentContext->logstream << "exception " << e.what() << " on expr: " << it->second << " @"
+                                      << ctx->getRuleIndex() << " at " << sourceLocation(ctx) << endl;
+        }
+    }
+    currentContext->logstream << "no entry for @" << ctx->getRuleIndex() << ": " << SourceText::excerpt(ctx) << " at "
                               << sourceLocation(ctx) << endl;
     return BSVType::create("NOENT");
 }
@@ -525,15 +545,11 @@ shared_ptr<BSVType> TypeChecker::dereferenceType(const shared_ptr<BSVType> &bsvt
 }
 
 string TypeChecker::sourceLocation(antlr4::ParserRuleContext *ctx) {
-    antlr4::Token *start = ctx->getStart();
-    string filename = start->getTokenSource()->getSourceName();
-    size_t line = start->getLine();
-    return filename + ":" + to_string(line);
+    return sourceText.location(ctx);
 }
 
 SourcePos TypeChecker::sourcePos(antlr4::ParserRuleContext *ctx) {
-    antlr4::Token *start = ctx->getStart();
-    return SourcePos(start->getTokenSource()->getSourceName(), start->getLine(), start->getCharPositionInLine());
+    return sourceText.sourcePos(ctx);
 }
 
 void TypeChecker::addDeclaration(BSVParser::PackagestmtContext *pkgstmt) {
@@ -744,7 +760,7 @@ void TypeChecker::addDeclaration(BSVParser::VarbindingContext *varbinding) {
     }
 }
 
-antlrcpp::Any TypeChecker::visitPackagedef(BSVParser::PackagedefContext *ctx) {
+void TypeChecker::declarePackage(BSVParser::PackagedefContext *ctx) {
     currentContext->logstream << "importing Prelude " << endl;
     analyzePackage("Prelude");
     shared_ptr<LexicalScope> pkgScope = packageScopes["Prelude"];
@@ -756,6 +772,10 @@ antlrcpp::Any TypeChecker::visitPackagedef(BSVParser::PackagedefContext *ctx) {
     for (size_t i = 0; ctx->packagestmt(i); i++) {
         addDeclaration(ctx->packagestmt(i));
     }
+}
+
+antlrcpp::Any TypeChecker::visitPackagedef(BSVParser::PackagedefContext *ctx) {
+    declarePackage(ctx);
 
     for (size_t i = 0; ctx->packagestmt(i); i++) {
         visit(ctx->packagestmt(i));
@@ -1070,22 +1090,10 @@ antlrcpp::Any TypeChecker::visitVarbinding(BSVParser::VarbindingContext *ctx) {
                                   << check_result_name[checked] << endl;
         currentContext->logstream << solver << endl;
         if (checked == z3::sat) {
-            z3::model mod = solver.get_model();
-            currentContext->logstream << "model: " << mod << endl;
+            // the types of the expressions are evaluated when the AST is generated, see lookup(ctx)
+            solvedModel = make_shared<z3::model>(solver.get_model());
+            currentContext->logstream << "model: " << *solvedModel << endl;
             currentContext->logstream << exprs.size() << " exprs" << endl;
-            for (auto it = exprs.cbegin(); it != exprs.cend(); ++it) {
-                z3::expr e = it->second;
-                try {
-                    z3::expr v = mod.eval(e, true);
-                    currentContext->logstream << e << " evaluates to " << v << " for " << it->first->getText() << " at "
-                                              << sourceLocation(it->first) << endl;
-                    exprTypes[it->first] = bsvtype(v, mod);
-                } catch (const exception &e) {
-                    currentContext->logstream << "exception " << e.what() << " on expr: " << it->second << " @"
-                                              << it->first->getRuleIndex()
-                                              << " at " << sourceLocation(it->first) << endl;
-                }
-            }
         } else {
             z3::expr_vector unsat_core = solver.unsat_core();
             currentContext->logstream << "unsat_core " << unsat_core << endl;
@@ -1100,7 +1108,7 @@ antlrcpp::Any TypeChecker::visitActionbinding(BSVParser::ActionbindingContext *c
     auto it = exprs.find(ctx);
     if (it != exprs.end())
         return it->second;
-    currentContext->logstream << "        TypeChecker visiting action binding " << ctx->getText() << endl;
+    currentContext->logstream << "        TypeChecker visiting action binding " << SourceText::excerpt(ctx) << endl;
 
     string varname(ctx->var->getText().c_str());
     BindingType bindingType = lexicalScope->isGlobal() ? GlobalBindingType : LocalBindingType;
@@ -1207,29 +1215,17 @@ antlrcpp::Any TypeChecker::visitModuledef(BSVParser::ModuledefContext *ctx) {
 
     //vector<BSVParser::ModulestmtContext *> stmts = ctx->modulestmt();
     for (int i = 0; ctx->modulestmt(i); i++) {
-        currentContext->logstream << "module stmt " << ctx->modulestmt(i)->getText() << endl;
+        currentContext->logstream << "module stmt " << SourceText::excerpt(ctx->modulestmt(i)) << endl;
         visit(ctx->modulestmt(i));
     }
     z3::check_result checked = solver.check();
     currentContext->logstream << "  Type checking module " << module_name << ": " << check_result_name[checked] << endl;
     currentContext->logstream << solver << endl;
     if (checked == z3::sat) {
-        z3::model mod = solver.get_model();
-        currentContext->logstream << "model: " << mod << endl;
+        // the types of the expressions are evaluated when the AST is generated, see lookup(ctx)
+        solvedModel = make_shared<z3::model>(solver.get_model());
+        currentContext->logstream << "model: " << *solvedModel << endl;
         currentContext->logstream << exprs.size() << " exprs" << endl;
-        for (auto it = exprs.cbegin(); it != exprs.cend(); ++it) {
-            z3::expr e = it->second;
-            try {
-                z3::expr v = mod.eval(e, true);
-                currentContext->logstream << e << " evaluates to " << v << " for " << it->first->getText() << " at "
-                                          << sourceLocation(it->first) << endl;
-                exprTypes[it->first] = bsvtype(v, mod);
-            } catch (const exception &e) {
-                currentContext->logstream << "exception " << e.what() << " on expr: " << it->second << " @"
-                                          << it->first->getRuleIndex()
-                                          << " at " << sourceLocation(it->first) << endl;
-            }
-        }
     } else {
         z3::expr_vector unsat_core = solver.unsat_core();
         currentContext->logstream << "unsat_core " << unsat_core << endl;
@@ -1461,7 +1457,7 @@ antlrcpp::Any TypeChecker::visitExterncfuncarg(BSVParser::ExterncfuncargContext
 }
 
 antlrcpp::Any TypeChecker::visitVarassign(BSVParser::VarassignContext *ctx) {
-    currentContext->logstream << "var assign " << ctx->getText() << endl;
+    currentContext->logstream << "var assign " << SourceText::excerpt(ctx) << endl;
     z3::expr lhsExpr = visit(ctx->lvalue(0));
     z3::expr rhsExpr = visit(ctx->expression());
     if (ctx->op->getText() == "<-") {
@@ -1631,7 +1627,7 @@ antlrcpp::Any TypeChecker::visitOperatorexpr(BSVParser::OperatorexprContext *ctx
 }
 
 antlrcpp::Any TypeChecker::visitCaseexpr(BSVParser::CaseexprContext *ctx) {
-    currentContext->logstream << "visit case expr " << ctx->getText() << endl;
+    currentContext->logstream << "visit case expr " << SourceText::excerpt(ctx) << endl;
     z3::expr casetype = freshConstant("case", typeSort);
     z3::expr exprtype = visit(ctx->expression());
     size_t numitems = ctx->caseexprpatitem().size();
@@ -1640,8 +1636,8 @@ antlrcpp::Any TypeChecker::visitCaseexpr(BSVParser::CaseexprContext *ctx) {
         currentContext->logstream << "item = " << item << endl;
         if (item->body != NULL) {
             currentContext->logstream << "caseexpritem has pattern "
-                                      << item->pattern()->getText()
-                                      << " body " << item->body->getText()
+                                      << SourceText::excerpt(item->pattern())
+                                      << " body " << SourceText::excerpt(item->body)
                                       << endl;
 
             if (item->pattern() != NULL) {
@@ -1654,7 +1650,7 @@ antlrcpp::Any TypeChecker::visitCaseexpr(BSVParser::CaseexprContext *ctx) {
     }
     for (size_t i = 0; ctx->caseexpritem(i); i++) {
         BSVParser::CaseexpritemContext *item = ctx->caseexpritem(i);
-        currentContext->logstream << "caseexpritem has expression " << item->match->getText() << endl;
+        currentContext->logstream << "caseexpritem has expression " << SourceText::excerpt(item->match) << endl;
 
     }
     return casetype;
@@ -1721,7 +1717,7 @@ antlrcpp::Any TypeChecker::visitBinopexpr(BSVParser::BinopexprContext *ctx) {
         return bsvtype_expr;
     }
 
-    currentContext->logstream << "        Visit binop " << ctx->getText() << endl;
+    currentContext->logstream << "        Visit binop " << SourceText::excerpt(ctx) << endl;
 
     z3::expr leftsym = visit(ctx->left);
     z3::expr rightsym = visit(ctx->right);
@@ -1729,9 +1725,10 @@ antlrcpp::Any TypeChecker::visitBinopexpr(BSVParser::BinopexprContext *ctx) {
     addConstraint(leftsym == rightsym, "binop$args", ctx);
     if (0) {
         solver.push();
-        currentContext->logstream << "  checking " << ctx->getText() << endl;
+        currentContext->logstream << "  checking " << SourceText::excerpt(ctx) << endl;
         //currentContext->logstream << solver << endl;
-        currentContext->logstream << "        check(" << ctx->getText() << ") " << check_result_name[solver.check()]
+        currentContext->logstream << "        check(" << SourceText::excerpt(ctx) << ") "
+                                  << check_result_name[solver.check()]
                                   << endl;
         solver.pop();
     }
@@ -1740,7 +1737,7 @@ antlrcpp::Any TypeChecker::visitBinopexpr(BSVParser::BinopexprContext *ctx) {
     string binopstr(freshString(opstr));
     z3::expr binopsym = constant(binopstr, typeSort);
 
-    currentContext->logstream << "Arith expr " << ctx->getText() << endl;
+    currentContext->logstream << "Arith expr " << SourceText::excerpt(ctx) << endl;
     vector<z3::expr> exprs;
     if (opstr == "||" || opstr == "&&") {
         exprs.push_back(leftsym == instantiateType("Bool"));
@@ -1759,7 +1756,7 @@ antlrcpp::Any TypeChecker::visitBinopexpr(BSVParser::BinopexprContext *ctx) {
     }
 
     if (boolops.find(opstr) != boolops.end()) {
-        currentContext->logstream << "Bool expr " << ctx->getText() << endl;
+        currentContext->logstream << "Bool expr " << SourceText::excerpt(ctx) << endl;
         addConstraint(binopsym == instantiateType("Bool"), "binboolop$res", ctx);
     } else {
         addConstraint(binopsym == leftsym, "binop$res", ctx);
@@ -1775,10 +1772,11 @@ antlrcpp::Any TypeChecker::visitUnopexpr(BSVParser::UnopexprContext *ctx) {
         return it->second;
 
     BSVParser::ExprprimaryContext *ep = ctx->exprprimary();
-    currentContext->logstream << " visiting unop " << ctx->getText() << " " << endl;
+    currentContext->logstream << " visiting unop " << SourceText::excerpt(ctx) << " " << endl;
 
     z3::expr unopExpr = visit(ep);
-    currentContext->logstream << " visit unop " << ctx->getText() << " " << unopExpr << " at " << sourceLocation(ctx)
+    currentContext->logstream << " visit unop " << SourceText::excerpt(ctx) << " " << unopExpr << " at "
+                              << sourceLocation(ctx)
                               << endl;
     if (ctx->op == NULL) {
         insertExpr(ctx, unopExpr);
@@ -1823,13 +1821,13 @@ antlrcpp::Any TypeChecker::visitVarexpr(BSVParser::VarexprContext *ctx) {
     auto it = exprs.find(ctx);
     if (it != exprs.end())
         return it->second;
-    currentContext->logstream << "Visiting var expr " << ctx->getText().c_str() << " " << ctx << endl;
+    currentContext->logstream << "Visiting var expr " << SourceText::excerpt(ctx) << " " << ctx << endl;
 
     string varname(ctx->lowerCaseIdentifier()->getText());
     string packageName;
     if (ctx->upperCaseIdentifier(0)) {
         packageName = ctx->upperCaseIdentifier(0)->getText();
-        cerr << "package specifier for " << ctx->getText() << " at " << sourceLocation(ctx) << endl;
+        cerr << "package specifier for " << SourceText::excerpt(ctx) << " at " << sourceLocation(ctx) << endl;
     }
     shared_ptr<Declaration> varDecl = ctx->upperCaseIdentifier(0) ? lookup(varname,
                                                                            ctx->upperCaseIdentifier(0)->getText())
@@ -1886,7 +1884,8 @@ antlrcpp::Any TypeChecker::visitVarexpr(BSVParser::VarexprContext *ctx) {
         addConstraint(varExpr == regExpr || varExpr == rhsExpr, "varexpr", ctx);
     }
     insertExpr(ctx, rhsExpr);
-    currentContext->logstream << "visit var expr " << ctx->getText() << " rhs expr " << rhsExpr << " ctx " << ctx
+    currentContext->logstream << "visit var expr " << SourceText::excerpt(ctx) << " rhs expr " << rhsExpr
+                              << " ctx " << ctx
                               << endl;
     return rhsExpr;
 }
@@ -1915,7 +1914,7 @@ antlrcpp::Any TypeChecker::visitIntliteral(BSVParser::IntliteralContext *ctx) {
     auto it = exprs.find(ctx);
     if (it != exprs.end())
         return it->second;
-    currentContext->logstream << "        Visiting int literal " << ctx->getText() << endl;
+    currentContext->logstream << "        Visiting int literal " << SourceText::excerpt(ctx) << endl;
     z3::expr sym = context.constant(freshName("intlit"), typeSort);
     z3::expr widthExpr = context.constant(freshName("ilitsz"), intSort);
 
@@ -1945,7 +1944,7 @@ antlrcpp::Any TypeChecker::visitCastexpr(BSVParser::CastexprContext *ctx) {
     z3::expr typeExpr = bsvTypeToExpr(type);
     z3::expr expr = visit(ctx->exprprimary());
     //addConstraint(typeExpr == expr, "typeassertion$trk", ctx);
-    currentContext->logstream << "cast expr " << ctx->getText() << " at " << sourceLocation(ctx) << endl;
+    currentContext->logstream << "cast expr " << SourceText::excerpt(ctx) << " at " << sourceLocation(ctx) << endl;
     insertExpr(ctx, typeExpr);
     return typeExpr;
 }
@@ -2144,7 +2143,7 @@ antlrcpp::Any TypeChecker::visitInterfaceexpr(BSVParser::InterfaceexprContext *c
 
 antlrcpp::Any TypeChecker::visitCallexpr(BSVParser::CallexprContext *ctx) {
     vector<BSVParser::ExpressionContext *> args = ctx->expression();
-    currentContext->logstream << "visit call expr " << ctx->getText()
+    currentContext->logstream << "visit call expr " << SourceText::excerpt(ctx)
                               << (actionContext ? " side effect " : " constructor ") << " arity " << args.size()
                               << " at " << sourceLocation(ctx)
                               << endl;
@@ -2175,7 +2174,7 @@ antlrcpp::Any TypeChecker::visitCallexpr(BSVParser::CallexprContext *ctx) {
 
 antlrcpp::Any TypeChecker::visitSyscallexpr(BSVParser::SyscallexprContext *ctx) {
     currentContext->logstream << "visit syscall at " << sourceLocation(ctx) << endl;
-    currentContext->logstream << "      syscall   " << ctx->getText() << endl;
+    currentContext->logstream << "      syscall   " << SourceText::excerpt(ctx) << endl;
     visitChildren(ctx);
     z3::expr expr = freshConstant("syscall", typeSort);
     insertExpr(ctx, expr);
@@ -2240,7 +2239,8 @@ antlrcpp::Any TypeChecker::visitTaggedunionexpr(BSVParser::TaggedunionexprContex
     if (exprs.size())
         addConstraint(orExprs(exprs), tagname + "$trk", ctx);
     else
-        currentContext->logstream << "No enum definitions for expr " << ctx->getText() << " at " << sourceLocation(ctx)
+        currentContext->logstream << "No enum definitions for expr " << SourceText::excerpt(ctx) << " at "
+                                  << sourceLocation(ctx)
                                   << endl;
     solver.push();
     checkSolution(ctx);
@@ -2258,26 +2258,31 @@ antlrcpp::Any TypeChecker::visitArraysub(BSVParser::ArraysubContext *ctx) {
     z3::expr msbExpr = visit(ctx->msb);
     z3::expr bitSelWidth = context.int_val(1);
     if (ctx->widthdown) {
-        currentContext->logstream << "visit arraysub bit slice down " << ctx->getText() << " at " << sourceLocation(ctx)
+        currentContext->logstream << "visit arraysub bit slice down " << SourceText::excerpt(ctx) << " at "
+                                  << sourceLocation(ctx)
                                   << endl;
 
         bitSelWidth = context.int_val((int) strtol(ctx->widthdown->getText().c_str(), 0, 0));
     } else if (ctx->widthup) {
 
-        currentContext->logstream << "visit arraysub bit slice up " << ctx->getText() << " at " << sourceLocation(ctx)
+        currentContext->logstream << "visit arraysub bit slice up " << SourceText::excerpt(ctx) << " at "
+                                  << sourceLocation(ctx)
                                   << endl;
         bitSelWidth = context.int_val((int) strtol(ctx->widthup->getText().c_str(), 0, 0));
     } else if (ctx->lsb) {
         z3::expr lsbExpr = visit(ctx->lsb);
-        currentContext->logstream << "FIXME: bit field selection " << ctx->getText() << " at " << sourceLocation(ctx)
+        currentContext->logstream << "FIXME: bit field selection " << SourceText::excerpt(ctx) << " at "
+                                  << sourceLocation(ctx)
                                   << endl;
         bitSelWidth = freshConstant("bitsel$width", intSort);
     } else {
         // not selecting a slice
-        currentContext->logstream << "visit arraysub index " << ctx->getText() << " at " << sourceLocation(ctx) << endl;
+        currentContext->logstream << "visit arraysub index " << SourceText::excerpt(ctx) << " at "
+                                  << sourceLocation(ctx) << endl;
 
     }
-    currentContext->logstream << "Fixme: array sub " << ctx->getText() << " z3 " << arrayExpr << " lsb expr " << endl;
+    currentContext->logstream << "Fixme: array sub " << SourceText::excerpt(ctx) << " z3 " << arrayExpr
+                              << " lsb expr " << endl;
     // arrayExpr could be Bit#(n)
     // arrayExpr could be Array#(t)
     // arrayExpr could be Vector#(n, t)
@@ -2292,7 +2297,7 @@ antlrcpp::Any TypeChecker::visitArraysub(BSVParser::ArraysubContext *ctx) {
                                    ||
                                    (arrayExpr == instantiateType("Vector", vsizeExpr, eltExpr) && resultExpr == eltExpr)
     );
-    addConstraint(arraysubConstraint, ctx->getText(), ctx);
+    addConstraint(arraysubConstraint, "arraysub$trk", ctx);
     z3::expr result = resultExpr;
     solver.push();
     if (checkSolution(ctx, true, true)) {
@@ -2487,10 +2492,10 @@ antlrcpp::Any TypeChecker::visitPattern(BSVParser::PatternContext *ctx) {
     } else if (ctx->tuplepattern()) {
         return visit(ctx->tuplepattern());
     } else if (ctx->pattern()) {
-        currentContext->logstream << "Visit parenthesized pattern " << ctx->getText() << endl;
+        currentContext->logstream << "Visit parenthesized pattern " << SourceText::excerpt(ctx) << endl;
         return visit(ctx->pattern());
     } else {
-        currentContext->logstream << "Visit pattern wildcard " << ctx->getText() << endl;
+        currentContext->logstream << "Visit pattern wildcard " << SourceText::excerpt(ctx) << endl;
         return freshConstant("wildcard", typeSort);
     }
 }
@@ -2523,7 +2528,7 @@ antlrcpp::Any TypeChecker::visitTaggedunionpattern(BSVParser::Taggedunionpattern
             vector<z3::expr> and_exprs;
             and_exprs.push_back(patsym == bsvTypeToExpr(freshDeclType));
             if (ctx->pattern(0)) {
-                currentContext->logstream << "tag pattern 0 " << ctx->pattern(0)->getText() << endl;
+                currentContext->logstream << "tag pattern 0 " << SourceText::excerpt(ctx->pattern(0)) << endl;
                 shared_ptr<UnionDeclaration> unionDeclaration = decl->unionDeclaration();
                 if (!unionDeclaration) {
                     currentContext->logstream << "Tag " << tagname << " is not a union tagged type" << endl;
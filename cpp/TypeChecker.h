@@ -12,6 +12,7 @@
 #include "BSVBaseVisitor.h"
 #include "Declaration.h"
 #include "LexicalScope.h"
+#include "SourceText.h"
 
 using namespace std;
 
@@ -49,8 +50,10 @@ class TypeChecker : public BSVBaseVisitor {
     z3::solver solver;
     map<antlr4::ParserRuleContext *, z3::expr> exprs;
     map<string, antlr4::ParserRuleContext *> trackers;
-    map<antlr4::ParserRuleContext *, shared_ptr<BSVType>> exprTypes;
+    // the model solved for the module or global binding being checked, applied by lookup(ctx)
+    shared_ptr<z3::model> solvedModel;
     map<antlr4::ParserRuleContext *, shared_ptr<Declaration>> varDecls;
+    SourceText sourceText;
     map<string, z3::func_decl> typeDecls;
     map<string, z3::func_decl> typeRecognizers;
     z3::sort typeSort, intSort, boolSort, stringSort;
@@ -71,6 +74,10 @@ public:
     TypeChecker(const string &packageName, const vector<string> &includePath, const vector<string> &definitions);
     ~TypeChecker();
 
+    // imports the packages of ctx and declares its statements, so that they can be checked one at a time
+    void declarePackage(BSVParser::PackagedefContext *ctx);
+
+    // the type of ctx in the model of the package statement checked last
     shared_ptr<BSVType> lookup(antlr4::ParserRuleContext *ctx);
 
     shared_ptr<Declaration> lookup(const string &name, const string &packageName = string());
@@ -79,7 +86,10 @@ public:
 
     shared_ptr<BSVType> dereferenceType(const shared_ptr<BSVType> &bsvtype);
 
-    BSVParser::PackagedefContext *analyzePackage(const string &packageName);
+    void analyzePackage(const string &packageName);
+
+    // forgets the state keyed by the contexts of the parse tree checked last, so that the tree can be freed
+    void releaseParseTree();
 
     const vector<string> visitedPackageNames() const;
 
@@ -415,8 +425,8 @@ public:
 
     shared_ptr<BSVType> bsvtype(BSVParser::ModuleprotoformalContext *ctx);
 
-    static string sourceLocation(antlr4::ParserRuleContext *pContext);
-    static SourcePos sourcePos(antlr4::ParserRuleContext *pContext);
+    string sourceLocation(antlr4::ParserRuleContext *pContext);
+    SourcePos sourcePos(antlr4::ParserRuleContext *pContext);
 
     z3::expr instantiateType(z3::func_decl type_decl, const z3::expr_vector &params);
 
@@ -0,0 +1,385 @@
+#include <ctype.h>
+#include <stdlib.h>
+
+#include "AstArena.h"
+#include "Value.h"
+
+shared_ptr<Value> ValueContext::lookup(const string &name) const {
+    for (const ValueContext *context = this; context; context = context->parent.get()) {
+        auto it = context->bindings.find(name);
+        if (it != context->bindings.cend())
+            return it->second;
+    }
+    return shared_ptr<Value>();
+}
+
+void ValueContext::bind(const string &name, const shared_ptr<Value> &value) {
+    bindings[name] = value;
+}
+
+void ValueContext::assign(const string &name, const shared_ptr<Value> &value) {
+    bool underCondition = false;
+    for (ValueContext *context = this; context; context = context->parent.get()) {
+        auto it = context->bindings.find(name);
+        if (it != context->bindings.end()) {
+            it->second = underCondition ? shared_ptr<Value>() : value;
+            return;
+        }
+        underCondition |= context->dynamic;
+    }
+    bindings[name] = underCondition ? shared_ptr<Value>() : value;
+}
+
+static long parseWidth(const string &repr, size_t &pos) {
+    long width = 0;
+    while (pos < repr.size() && isdigit(repr[pos]))
+        width = width * 10 + (repr[pos++] - '0');
+    return width;
+}
+
+// the low 64 bits of sized literals are kept, as for Bit#(64)
+static long parseDigits(const string &repr, size_t pos, int base) {
+    string digits;
+    for (; pos < repr.size(); pos++) {
+        if (repr[pos] != '_')
+            digits += repr[pos];
+    }
+    return (long)strtoull(digits.c_str(), 0, base);
+}
+
+shared_ptr<IntValue> IntValue::create(const string &repr) {
+    size_t pos = 0;
+    long width = parseWidth(repr, pos);
+    if (pos == repr.size() || repr[pos] != '\'')
+        return make_shared<IntValue>(parseDigits(repr, 0, 10));
+    pos++;
+    if (pos < repr.size() && (repr[pos] == 's' || repr[pos] == 'S'))
+        pos++;
+    int base = 10;
+    if (pos < repr.size()) {
+        switch (tolower(repr[pos])) {
+            case 'b': base = 2; pos++; break;
+            case 'o': base = 8; pos++; break;
+            case 'd': base = 10; pos++; break;
+            case 'h': base = 16; pos++; break;
+        }
+    }
+    return make_shared<IntValue>(parseDigits(repr, pos, base), width);
+}
+
+shared_ptr<Value> IntValue::unop(const string &op) {
+    if (op == "-")
+        return make_shared<IntValue>(-value, width);
+    if (op == "~")
+        return make_shared<IntValue>(~value, width);
+    if (op == "+")
+        return shared_from_this();
+    return shared_ptr<Value>();
+}
+
+shared_ptr<Value> IntValue::binop(const string &op, const shared_ptr<Value> &other) {
+    if (other && other->bitValue()) {
+        int otherWidth = other->bitValue()->bits.getWidth();
+        return make_shared<BitValue>(BitVector(64, value).signExtend(otherWidth))->binop(op, other);
+    }
+    shared_ptr<IntValue> rhs = other ? other->intValue() : shared_ptr<IntValue>();
+    if (!rhs)
+        return shared_ptr<Value>();
+    long a = value;
+    long b = rhs->value;
+    int resultWidth = max(width, rhs->width);
+    if (resultWidth) {
+        // sized values are unsigned, see signedBinop for Int#(n)
+        uint64_t mask = resultWidth < 64 ? (1UL << resultWidth) - 1 : ~0UL;
+        uint64_t ua = (uint64_t)a & mask;
+        uint64_t ub = (uint64_t)b & mask;
+        if (op == "<")
+            return make_shared<BoolValue>(ua < ub);
+        else if (op == "<=")
+            return make_shared<BoolValue>(ua <= ub);
+        else if (op == ">")
+            return make_shared<BoolValue>(ua > ub);
+        else if (op == ">=")
+            return make_shared<BoolValue>(ua >= ub);
+        else if (op == "/" && ub != 0)
+            return make_shared<IntValue>(ua / ub, resultWidth);
+        else if (op == "%" && ub != 0)
+            return make_shared<IntValue>(ua % ub, resultWidth);
+        else if (op == ">>" && width && b >= 0 && b < 64)
+            return make_shared<IntValue>((uint64_t)a >> b, width);
+        else if (op == "==")
+            return make_shared<BoolValue>(ua == ub);
+        else if (op == "!=")
+            return make_shared<BoolValue>(ua != ub);
+    }
+    if (op == "==")
+        return make_shared<BoolValue>(a == b);
+    else if (op == "!=")
+        return make_shared<BoolValue>(a != b);
+    else if (op == "<")
+        return make_shared<BoolValue>(a < b);
+    else if (op == "<=")
+        return make_shared<BoolValue>(a <= b);
+    else if (op == ">")
+        return make_shared<BoolValue>(a > b);
+    else if (op == ">=")
+        return make_shared<BoolValue>(a >= b);
+    else if (op == "+")
+        return make_shared<IntValue>(a + b, resultWidth);
+    else if (op == "-")
+        return make_shared<IntValue>(a - b, resultWidth);
+    else if (op == "*")
+        return make_shared<IntValue>(a * b, resultWidth);
+    else if (op == "/" && b != 0)
+        return make_shared<IntValue>(a / b, resultWidth);
+    else if (op == "%" && b != 0)
+        return make_shared<IntValue>(a % b, resultWidth);
+    else if (op == "<<" && b >= 0 && b < 64)
+        return make_shared<IntValue>(a << b, width);
+    else if (op == ">>" && b >= 0 && b < 64)
+        return make_shared<IntValue>(a >> b, width);
+    else if (op == "&")
+        return make_shared<IntValue>(a & b, resultWidth);
+    else if (op == "|")
+        return make_shared<IntValue>(a | b, resultWidth);
+    else if (op == "^")
+        return make_shared<IntValue>(a ^ b, resultWidth);
+    return shared_ptr<Value>();
+}
+
+bool isSignedType(const shared_ptr<BSVType> &bsvtype) {
+    return bsvtype && bsvtype->name == "Int";
+}
+
+bool isSignedExpr(const shared_ptr<Expr> &expr) {
+    if (!expr)
+        return false;
+    if (expr->bsvtype)
+        return isSignedType(expr->bsvtype);
+    // the parser leaves operator expressions untyped
+    shared_ptr<OperatorExpr> operatorExpr = expr->operatorExpr();
+    if (!operatorExpr)
+        return false;
+    const string &op = operatorExpr->op;
+    if (!operatorExpr->rhs)
+        return op == "-" || op == "~" || op == "+" ? isSignedExpr(operatorExpr->lhs) : false;
+    if (op == "<<" || op == ">>")
+        return isSignedExpr(operatorExpr->lhs);
+    if (op == "+" || op == "-" || op == "*" || op == "/" || op == "%" || op == "&" || op == "|" || op == "^")
+        return isSignedExpr(operatorExpr->lhs) || isSignedExpr(operatorExpr->rhs);
+    return false;
+}
+
+shared_ptr<Value> signedBinop(const string &op, const shared_ptr<Value> &lhs, const shared_ptr<Value> &rhs) {
+    if (!lhs || !rhs)
+        return shared_ptr<Value>();
+    BitVector a = valueBits(lhs);
+    int width = a.getWidth();
+    bool shift = op == "<<" || op == ">>";
+    if (!width || shift != (op == ">>"))
+        return lhs->binop(op, rhs);
+    if (shift) {
+        shared_ptr<IntValue> amount = rhs->intValue();
+        if (!amount || amount->value < 0)
+            return shared_ptr<Value>();
+        return bitsValue(a.ashr(amount->value < width ? (int)amount->value : width));
+    }
+    BitVector b = valueBits(rhs);
+    if (!b.getWidth() && rhs->intValue())
+        b = BitVector(64, rhs->intValue()->value).signExtend(width);
+    if (b.getWidth() != width)
+        return lhs->binop(op, rhs);
+    if (op == "<")
+        return make_shared<BoolValue>(a.slt(b));
+    else if (op == "<=")
+        return make_shared<BoolValue>(a.sle(b));
+    else if (op == ">")
+        return make_shared<BoolValue>(b.slt(a));
+    else if (op == ">=")
+        return make_shared<BoolValue>(b.sle(a));
+    else if (op == "/" && !b.isZero())
+        return bitsValue(a.sdiv(b));
+    else if (op == "%" && !b.isZero()) {
+        BitVector remainder;
+        a.sdiv(b, &remainder);
+        return bitsValue(remainder);
+    }
+    return lhs->binop(op, rhs);
+}
+
+long signedValue(const shared_ptr<Value> &value) {
+    BitVector bits = valueBits(value);
+    if (bits.getWidth() && bits.getWidth() <= 64)
+        return bits.toInt64();
+    shared_ptr<IntValue> intValue = value ? value->intValue() : shared_ptr<IntValue>();
+    return intValue ? intValue->value : 0;
+}
+
+shared_ptr<Value> IntValue::sub(long index) {
+    return sub(index, index);
+}
+
+shared_ptr<Value> IntValue::sub(long msb, long lsb) {
+    if (lsb < 0 || msb < lsb || msb >= 64)
+        return shared_ptr<Value>();
+    return make_shared<IntValue>(value >> lsb, msb - lsb + 1);
+}
+
+shared_ptr<Expr> IntValue::toExpr() {
+    // IntConst keeps only the value, see GenerateKami::visitIntConst
+    if (value < 0)
+        return makeAst<OperatorExpr>("-", makeAst<IntConst>(std::to_string(-value)));
+    return makeAst<IntConst>(std::to_string(value));
+}
+
+string IntValue::to_string() const {
+    if (width)
+        return std::to_string(width) + "'d" + std::to_string(value);
+    return std::to_string(value);
+}
+
+shared_ptr<Value> literalValue(const string &repr) {
+    size_t pos = 0;
+    if (parseWidth(repr, pos) > 64 && pos < repr.size() && repr[pos] == '\'')
+        return make_shared<BitValue>(BitVector::fromString(repr));
+    return IntValue::create(repr);
+}
+
+BitVector valueBits(const shared_ptr<Value> &value) {
+    if (!value)
+        return BitVector();
+    if (shared_ptr<BitValue> bitValue = value->bitValue())
+        return bitValue->bits;
+    shared_ptr<IntValue> intValue = value->intValue();
+    if (!intValue || !intValue->width)
+        return BitVector();
+    return BitVector(intValue->width, intValue->value);
+}
+
+shared_ptr<Value> bitsValue(const BitVector &bits) {
+    if (bits.getWidth() <= 64)
+        return make_shared<IntValue>(bits.toUInt64(), bits.getWidth());
+    return make_shared<BitValue>(bits);
+}
+
+shared_ptr<Value> BitValue::unop(const string &op) {
+    if (op == "-")
+        return make_shared<BitValue>(-bits);
+    if (op == "~")
+        return make_shared<BitValue>(~bits);
+    if (op == "+")
+        return shared_from_this();
+    return shared_ptr<Value>();
+}
+
+shared_ptr<Value> BitValue::binop(const string &op, const shared_ptr<Value> &other) {
+    if (!other)
+        return shared_ptr<Value>();
+    int width = bits.getWidth();
+    // shift amounts keep their own width
+    if (op == "<<" || op == ">>") {
+        shared_ptr<IntValue> amount = other->intValue();
+        if (!amount || amount->value < 0)
+            return shared_ptr<Value>();
+        int shift = amount->value < width ? (int)amount->value : width;
+        return make_shared<BitValue>(op == "<<" ? bits << shift : bits >> shift);
+    }
+    BitVector rhs;
+    if (other->bitValue())
+        rhs = other->bitValue()->bits;
+    else if (other->intValue())
+        rhs = BitVector(64, other->intValue()->value).signExtend(width);
+    if (rhs.getWidth() != width)
+        return shared_ptr<Value>();
+    if (op == "==")
+        return make_shared<BoolValue>(bits == rhs);
+    else if (op == "!=")
+        return make_shared<BoolValue>(bits != rhs);
+    else if (op == "<")
+        return make_shared<BoolValue>(bits.ult(rhs));
+    else if (op == "<=")
+        return make_shared<BoolValue>(bits.ule(rhs));
+    else if (op == ">")
+        return make_shared<BoolValue>(rhs.ult(bits));
+    else if (op == ">=")
+        return make_shared<BoolValue>(rhs.ule(bits));
+    else if (op == "+")
+        return make_shared<BitValue>(bits + rhs);
+    else if (op == "-")
+        return make_shared<BitValue>(bits - rhs);
+    else if (op == "*")
+        return make_shared<BitValue>(bits * rhs);
+    else if (op == "/" && !rhs.isZero())
+        return make_shared<BitValue>(bits.udiv(rhs));
+    else if (op == "%" && !rhs.isZero()) {
+        BitVector remainder;
+        bits.udiv(rhs, &remainder);
+        return make_shared<BitValue>(remainder);
+    } else if (op == "&")
+        return make_shared<BitValue>(bits & rhs);
+    else if (op == "|")
+        return make_shared<BitValue>(bits | rhs);
+    else if (op == "^")
+        return make_shared<BitValue>(bits ^ rhs);
+    return shared_ptr<Value>();
+}
+
+shared_ptr<Value> BitValue::sub(long index) {
+    return sub(index, index);
+}
+
+shared_ptr<Value> BitValue::sub(long msb, long lsb) {
+    if (lsb < 0 || msb < lsb || msb >= bits.getWidth())
+        return shared_ptr<Value>();
+    return bitsValue(bits.extract(msb, lsb));
+}
+
+string BitValue::to_string() const {
+    return std::to_string(bits.getWidth()) + "'h" + bits.toString(16);
+}
+
+shared_ptr<Value> BoolValue::unop(const string &op) {
+    if (op == "!")
+        return make_shared<BoolValue>(!value);
+    return shared_ptr<Value>();
+}
+
+shared_ptr<Value> BoolValue::binop(const string &op, const shared_ptr<Value> &other) {
+    shared_ptr<BoolValue> rhs = other ? other->boolValue() : shared_ptr<BoolValue>();
+    if (!rhs)
+        return shared_ptr<Value>();
+    if (op == "&&")
+        return make_shared<BoolValue>(value && rhs->value);
+    else if (op == "||")
+        return make_shared<BoolValue>(value || rhs->value);
+    else if (op == "==")
+        return make_shared<BoolValue>(value == rhs->value);
+    else if (op == "!=" || op == "^")
+        return make_shared<BoolValue>(value != rhs->value);
+    return shared_ptr<Value>();
+}
+
+shared_ptr<Expr> BoolValue::toExpr() {
+    return makeAst<VarExpr>(to_string(), make_shared<BSVType>("Bool"));
+}
+
+shared_ptr<Value> VectorValue::sub(long index) {
+    if (index < 0 || index >= (long)values.size())
+        return shared_ptr<Value>();
+    return values[index];
+}
+
+string VectorValue::to_string() const {
+    string str("vector(");
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i)
+            str += ", ";
+        str += values[i] ? values[i]->to_string() : string("?");
+    }
+    str += ")";
+    return str;
+}
+
+shared_ptr<Expr> ModuleInstance::toExpr() {
+    return makeAst<VarExpr>(name, interfaceType);
+}
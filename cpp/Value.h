@@ -1,61 +1,187 @@
-
 #pragma once
 
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
+
+#include "BitVector.h"
+#include "Expr.h"
+#include "Stmt.h"
 
 using namespace std;
 
-class Value {
+class BitValue;
+class BoolValue;
+class FunctionValue;
+class IntValue;
+class ModuleInstance;
+class StringValue;
+class VectorValue;
+
+// Values computed at elaboration time.
+//
+// The operations return null when they are not defined on static values of
+// the operand kinds, which the Elaborator takes to mean the expression has to
+// be left for the generated hardware to compute.
+class Value : public enable_shared_from_this<Value> {
  public:
   Value() {}
   virtual ~Value() {}
+
+  virtual shared_ptr<Value> read() { return shared_from_this(); }
+  virtual shared_ptr<Value> unop(const string &op) { return shared_ptr<Value>(); }
+  virtual shared_ptr<Value> binop(const string &op, const shared_ptr<Value> &other) { return shared_ptr<Value>(); }
+  virtual shared_ptr<Value> sub(long index) { return shared_ptr<Value>(); }
+
+  // the constant expression that denotes this value, null if there is none
+  virtual shared_ptr<Expr> toExpr() { return shared_ptr<Expr>(); }
+  virtual string to_string() const = 0;
+
+  virtual shared_ptr<BitValue> bitValue() { return shared_ptr<BitValue>(); }
+  virtual shared_ptr<BoolValue> boolValue() { return shared_ptr<BoolValue>(); }
+  virtual shared_ptr<FunctionValue> functionValue() { return shared_ptr<FunctionValue>(); }
+  virtual shared_ptr<IntValue> intValue() { return shared_ptr<IntValue>(); }
+  virtual shared_ptr<ModuleInstance> moduleInstance() { return shared_ptr<ModuleInstance>(); }
+  virtual shared_ptr<StringValue> stringValue() { return shared_ptr<StringValue>(); }
+  virtual shared_ptr<VectorValue> vectorValue() { return shared_ptr<VectorValue>(); }
 };
 
 class ValueContext {
   map<string,shared_ptr<Value>> bindings;
   shared_ptr<ValueContext> parent;
+  // statements run in this context only under a condition that is not static
+  const bool dynamic;
  public:
-  LexicalScope() {}
-  LexicalScope(const shared_ptr<LexicalScope> &parent) : parent(parent) {}
-  ~LexicalScope() {}
+  ValueContext() : dynamic(false) {}
+  ValueContext(const shared_ptr<ValueContext> &parent, bool dynamic = false) : parent(parent), dynamic(dynamic) {}
+  ~ValueContext() {}
 
+  // a name bound to null is known not to have a static value
   shared_ptr<Value> lookup(const string &name) const;
   void bind(const string &name, const shared_ptr<Value> &value);
+  // updates the innermost binding of name; from within a dynamic context
+  // the variable is no longer static afterwards
+  void assign(const string &name, const shared_ptr<Value> &value);
+};
+
+class VoidValue : public Value {
+ public:
+  VoidValue() {}
+  ~VoidValue() override {}
+
+  string to_string() const override { return "void"; }
 };
 
 class IntValue : public Value {
  public:
   const long value;
+  // 0 for Integer
   const int width;
-  const string basespec;
 
-  IntValue(long value, int width=0, const string &basespec)
-    value(value), width(width), basespec(basespec) {
+  IntValue(long value, int width = 0)
+    : value(width > 0 && width < 64 ? value & ((1L << width) - 1) : value), width(width) {
   }
   ~IntValue() override {}
+
+  // parses Verilog style literals such as 42, 'h2a or 8'b101010
+  static shared_ptr<IntValue> create(const string &repr);
+
+  shared_ptr<Value> unop(const string &op) override;
+  shared_ptr<Value> binop(const string &op, const shared_ptr<Value> &other) override;
+  // bit select
+  shared_ptr<Value> sub(long index) override;
+  shared_ptr<Value> sub(long msb, long lsb);
+
+  shared_ptr<Expr> toExpr() override;
+  string to_string() const override;
+
+  shared_ptr<IntValue> intValue() override { return static_pointer_cast<IntValue>(shared_from_this()); }
 };
 
+// Sized values wider than an IntValue can hold
+class BitValue : public Value {
+ public:
+  const BitVector bits;
+
+  BitValue(const BitVector &bits)
+    : bits(bits) {
+  }
+  ~BitValue() override {}
+
+  shared_ptr<Value> unop(const string &op) override;
+  shared_ptr<Value> binop(const string &op, const shared_ptr<Value> &other) override;
+  shared_ptr<Value> sub(long index) override;
+  shared_ptr<Value> sub(long msb, long lsb);
+
+  string to_string() const override;
+
+  shared_ptr<BitValue> bitValue() override { return static_pointer_cast<BitValue>(shared_from_this()); }
+};
+
+// IntValue for literals of up to 64 bits, BitValue for wider ones
+shared_ptr<Value> literalValue(const string &repr);
+// the bits of a sized IntValue or BitValue, width 0 if there are none
+BitVector valueBits(const shared_ptr<Value> &value);
+// IntValue if width fits, BitValue otherwise
+shared_ptr<Value> bitsValue(const BitVector &bits);
+
+// Int#(n) values are held as their bits, like Bit#(n) and UInt#(n); only the
+// operators below tell them apart
+bool isSignedType(const shared_ptr<BSVType> &bsvtype);
+// an expression of type Int#(n), looking through operators, which are not typed
+bool isSignedExpr(const shared_ptr<Expr> &expr);
+// binop for operands of type Int#(n): compares, divides and shifts right with the sign
+shared_ptr<Value> signedBinop(const string &op, const shared_ptr<Value> &lhs, const shared_ptr<Value> &rhs);
+// the value of an Int#(n) of up to 64 bits as an Integer
+long signedValue(const shared_ptr<Value> &value);
+
 class BoolValue : public Value {
  public:
   const bool value;
 
   BoolValue(bool value)
-    value(value) {
+    : value(value) {
   }
   ~BoolValue() override {}
 
+  shared_ptr<Value> unop(const string &op) override;
+  shared_ptr<Value> binop(const string &op, const shared_ptr<Value> &other) override;
+
+  shared_ptr<Expr> toExpr() override;
+  string to_string() const override { return value ? "True" : "False"; }
+
+  shared_ptr<BoolValue> boolValue() override { return static_pointer_cast<BoolValue>(shared_from_this()); }
+};
+
+class StringValue : public Value {
+ public:
+  const string value;
+
+  StringValue(const string &value)
+    : value(value) {
+  }
+  ~StringValue() override {}
+
+  string to_string() const override { return value; }
+
+  shared_ptr<StringValue> stringValue() override { return static_pointer_cast<StringValue>(shared_from_this()); }
 };
 
 class VectorValue : public Value {
  public:
- final vector<shared_ptr<Value>> values;
- final int size;
- VectorValue(long size) : values(size) {
-        this.size = (int)size;
- }
- ~VectorValue() override {}
+  const vector<shared_ptr<Value>> values;
+
+  VectorValue(const vector<shared_ptr<Value>> &values)
+    : values(values) {
+  }
+  ~VectorValue() override {}
+
+  shared_ptr<Value> sub(long index) override;
+
+  string to_string() const override;
+
+  shared_ptr<VectorValue> vectorValue() override { return static_pointer_cast<VectorValue>(shared_from_this()); }
 };
 
 class RegValue : public Value {
@@ -66,7 +192,7 @@ class RegValue : public Value {
   shared_ptr<Value> newValue;
 
   RegValue(const string &name, const shared_ptr<Value> &initialValue)
-    : name(name), initialValue(initialValue) {
+    : name(name), value(initialValue) {
   }
 
   RegValue(const string &name)
@@ -74,36 +200,64 @@ class RegValue : public Value {
   }
   ~RegValue() override {}
 
-  void update(shared_ptr<Value> v) {
+  shared_ptr<Value> read() override { return value; }
+  void update(const shared_ptr<Value> &v) {
     newValue = v;
   }
   void commit() {
-    value = newValue;
+    if (newValue)
+      value = newValue;
+    newValue.reset();
+  }
+
+  string to_string() const override { return "reg " + name; }
+};
+
+class FunctionValue : public Value {
+ public:
+  const shared_ptr<FunctionDefStmt> functionDef;
+  // where the function was defined
+  const shared_ptr<ValueContext> context;
+
+  FunctionValue(const shared_ptr<FunctionDefStmt> &functionDef, const shared_ptr<ValueContext> &context)
+    : functionDef(functionDef), context(context) {
   }
+  ~FunctionValue() override {}
+
+  string to_string() const override { return "function " + functionDef->name; }
+
+  shared_ptr<FunctionValue> functionValue() override { return static_pointer_cast<FunctionValue>(shared_from_this()); }
 };
 
 class Rule : public Value {
  public:
-    const string name;
-    const shared_ptr<RuleStmt> ruleStmt;
-    shared_ptr<ValueContext> context;
-
-    Rule (const string &name, const shared_ptr<RuleStmt> &ruleStmt)
-      : name(name), ruleStmt(ruleStmt) {
-    }
-    ~Rule() override {}
+  const string name;
+  const shared_ptr<RuleDefStmt> ruleDef;
+  shared_ptr<ValueContext> context;
+
+  Rule(const string &name, const shared_ptr<RuleDefStmt> &ruleDef)
+    : name(name), ruleDef(ruleDef) {
+  }
+  ~Rule() override {}
+
+  string to_string() const override { return "rule " + name; }
 };
 
 class ModuleInstance : public Value {
  public:
-    const string name;
-    const shared_ptr<ModuleDefStmt> module;
-    shared_ptr<ValueContext> context;
+  const string name;
+  const shared_ptr<BSVType> interfaceType;
+  const shared_ptr<ModuleDefStmt> module;
+  shared_ptr<ValueContext> context;
 
-    ModuleInstance(const string &name, const shared_ptr<ModuleDefStmt> &module)
-      : name(name), module(module) {
-    }
+  ModuleInstance(const string &name, const shared_ptr<BSVType> &interfaceType,
+                 const shared_ptr<ModuleDefStmt> &module = shared_ptr<ModuleDefStmt>())
+    : name(name), interfaceType(interfaceType), module(module) {
+  }
+  ~ModuleInstance() override {}
 
-    ~ModuleInstance() override {}
+  shared_ptr<Expr> toExpr() override;
+  string to_string() const override { return "instance " + name; }
 
+  shared_ptr<ModuleInstance> moduleInstance() override { return static_pointer_cast<ModuleInstance>(shared_from_this()); }
 };
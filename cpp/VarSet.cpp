@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <unordered_map>
+
+#include "VarSet.h"
+
+static unordered_map<string, VarId> varIds;
+static vector<string> varNames;
+
+VarId VarSet::intern(const string &name) {
+    auto it = varIds.find(name);
+    if (it != varIds.end())
+        return it->second;
+    VarId id = varNames.size();
+    varNames.push_back(name);
+    varIds[name] = id;
+    return id;
+}
+
+const string &VarSet::name(VarId id) {
+    return varNames[id];
+}
+
+static bool entryLess(const VarSet::Entry &entry, VarId id) {
+    return entry.id < id;
+}
+
+bool VarSet::contains(const string &name) const {
+    auto it = varIds.find(name);
+    if (it == varIds.end())
+        return false;
+    auto pos = lower_bound(entries.begin(), entries.end(), it->second, entryLess);
+    return pos != entries.end() && pos->id == it->second;
+}
+
+bool VarSet::contains(VarId id) const {
+    auto pos = lower_bound(entries.begin(), entries.end(), id, entryLess);
+    return pos != entries.end() && pos->id == id;
+}
+
+void VarSet::insert(const string &name, const shared_ptr<BSVType> &bsvtype) {
+    VarId id = intern(name);
+    auto pos = lower_bound(entries.begin(), entries.end(), id, entryLess);
+    if (pos != entries.end() && pos->id == id)
+        pos->bsvtype = bsvtype;
+    else
+        entries.insert(pos, Entry{id, bsvtype});
+}
+
+void VarSet::unite(const VarSet &other) {
+    if (other.entries.empty())
+        return;
+    if (entries.empty()) {
+        entries = other.entries;
+        return;
+    }
+    vector<Entry> merged;
+    merged.reserve(entries.size() + other.entries.size());
+    auto a = entries.cbegin();
+    auto b = other.entries.cbegin();
+    while (a != entries.cend() && b != other.entries.cend()) {
+        if (a->id < b->id) {
+            merged.push_back(*a++);
+        } else if (b->id < a->id) {
+            merged.push_back(*b++);
+        } else {
+            merged.push_back(*b++);
+            ++a;
+        }
+    }
+    merged.insert(merged.end(), a, entries.cend());
+    merged.insert(merged.end(), b, other.entries.cend());
+    entries.swap(merged);
+}
+
+map<string, shared_ptr<BSVType>> VarSet::byName() const {
+    map<string, shared_ptr<BSVType>> result;
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it)
+        result[it->name()] = it->bsvtype;
+    return result;
+}
+
+string to_string(const VarSet &s) {
+    map<string, shared_ptr<BSVType>> sorted = s.byName();
+    string str;
+    str += "set(" + to_string(sorted.size());
+    for (auto it = sorted.cbegin(); it != sorted.cend(); ++it)
+        str += " " + it->first + "=" + it->second->to_string();
+    str += ")";
+    return str;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BSVType.h"
+
+using namespace std;
+
+// Variable names are interned once into small integer ids so that the
+// attribute sets of the AST can be kept as sorted vectors of ids and
+// united with a linear merge instead of string-keyed map inserts.
+typedef int VarId;
+
+class VarSet {
+public:
+    struct Entry {
+        VarId id;
+        shared_ptr<BSVType> bsvtype;
+
+        const string &name() const { return VarSet::name(id); }
+    };
+    typedef vector<Entry>::const_iterator const_iterator;
+
+    static VarId intern(const string &name);
+    static const string &name(VarId id);
+
+    bool empty() const { return entries.empty(); }
+    size_t size() const { return entries.size(); }
+    const_iterator begin() const { return entries.cbegin(); }
+    const_iterator end() const { return entries.cend(); }
+
+    bool contains(const string &name) const;
+    bool contains(VarId id) const;
+    void insert(const string &name, const shared_ptr<BSVType> &bsvtype);
+    // like map assignment, types from other replace ours on common ids
+    void unite(const VarSet &other);
+
+    // ordered by name, for generators whose output order depends on it
+    map<string, shared_ptr<BSVType>> byName() const;
+
+private:
+    // sorted by id
+    vector<Entry> entries;
+};
+
+string to_string(const VarSet &s);
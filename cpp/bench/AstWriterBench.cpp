@@ -0,0 +1,82 @@
+// Benchmark for AstWriter on a synthetic package of modules full of rules,
+// reporting the time and the heap allocations of writing the package.
+//
+//   astwriter-bench [modules [rules [iterations]]]
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <stdlib.h>
+
+#include "AstWriter.h"
+#include "Stmt.h"
+
+using namespace std;
+
+static long allocations;
+
+void *operator new(size_t size) {
+    allocations++;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+static shared_ptr<PackageDefStmt> makePackage(int numModules, int numRules) {
+    shared_ptr<BSVType> bit32 = BSVType::create("Bit", vector<shared_ptr<BSVType>>{BSVType::create("32", BSVType_Numeric)});
+    vector<shared_ptr<Stmt>> moduleDefs;
+    for (int m = 0; m < numModules; m++) {
+        vector<shared_ptr<Stmt>> stmts;
+        stmts.push_back(makeAst<RegisterStmt>("count", bit32));
+        for (int r = 0; r < numRules; r++) {
+            SourcePos pos("Bench.bsv", 10 + r, 4);
+            auto var = [&](const string &name) { return makeAst<VarExpr>(name, bit32, pos); };
+            shared_ptr<Expr> sum = makeAst<OperatorExpr>("+", var("count_val"),
+                                                         makeAst<OperatorExpr>("*", var("x"), var("y"), pos), pos);
+            vector<shared_ptr<Stmt>> body{
+                    makeAst<RegReadStmt>("count", "count_val", bit32, pos),
+                    makeAst<VarBindingStmt>(bit32, "x", makeAst<IntConst>(to_string(r), pos), pos),
+                    makeAst<RegWriteStmt>("count", bit32, makeAst<OperatorExpr>("-", var("x"), sum, pos), pos)};
+            shared_ptr<Expr> guard = makeAst<OperatorExpr>("<", var("count_val"), makeAst<IntConst>("32'd100", pos), pos);
+            stmts.push_back(makeAst<RuleDefStmt>("rule" + to_string(r), guard, body, pos));
+        }
+        moduleDefs.push_back(makeAst<ModuleDefStmt>("Bench", "mkModule" + to_string(m), BSVType::create("Empty"),
+                                                    vector<string>(), vector<shared_ptr<BSVType>>(), stmts,
+                                                    SourcePos("Bench.bsv", 1, 0)));
+    }
+    return makeAst<PackageDefStmt>("Bench", moduleDefs, SourcePos("Bench.bsv", 1, 0));
+}
+
+int main(int argc, char **argv) {
+    int numModules = argc > 1 ? atoi(argv[1]) : 50;
+    int numRules = argc > 2 ? atoi(argv[2]) : 100;
+    int iterations = argc > 3 ? atoi(argv[3]) : 10;
+    shared_ptr<PackageDefStmt> packageDef = makePackage(numModules, numRules);
+
+    // AstWriter traces every node it visits
+    cerr.setstate(ios::badbit);
+    AstWriter astWriter;
+    long startAllocations = allocations;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        astWriter.open("astwriter-bench.ast");
+        astWriter.visit(packageDef);
+        astWriter.close();
+    }
+    auto stop = chrono::steady_clock::now();
+    double ms = chrono::duration<double, milli>(stop - start).count() / iterations;
+    cout << numModules << " modules, " << numRules << " rules each" << endl;
+    cout << fixed << setprecision(2) << ms << " ms/package" << endl;
+    cout << (allocations - startAllocations) / iterations << " allocations/package" << endl;
+    return 0;
+}
@@ -0,0 +1,60 @@
+// Microbenchmarks for the BitVector operations used by the elaborator and
+// the interpreter, at the widths of the common data paths.
+//
+//   bitvector-bench [iterations]
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdlib.h>
+
+#include "BitVector.h"
+
+using namespace std;
+
+static volatile uint64_t sink;
+
+static BitVector randomBits(int width, unsigned &seed) {
+    BitVector bits(width);
+    for (int lsb = 0; lsb < width; lsb += 32) {
+        seed = seed * 1103515245 + 12345;
+        bits = bits | (BitVector(width, seed) << lsb);
+    }
+    return bits;
+}
+
+static void bench(const string &name, int width, long iterations, const function<BitVector(long)> &op) {
+    auto start = chrono::steady_clock::now();
+    uint64_t check = 0;
+    for (long i = 0; i < iterations; i++)
+        check ^= op(i).toUInt64();
+    auto stop = chrono::steady_clock::now();
+    sink = check;
+    double ns = chrono::duration<double, nano>(stop - start).count() / iterations;
+    cout << setw(10) << name << setw(8) << width << setw(12) << fixed << setprecision(1) << ns << " ns/op" << endl;
+}
+
+int main(int argc, char **argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+    unsigned seed = 1;
+    cout << setw(10) << "op" << setw(8) << "width" << setw(18) << "time" << endl;
+    for (int width : {32, 64, 128, 256, 512, 4096}) {
+        long n = iterations * 64 / max(64, width);
+        BitVector a = randomBits(width, seed);
+        BitVector b = randomBits(width, seed);
+        BitVector small = randomBits(width / 2, seed);
+        bench("and", width, n, [&](long i) { return a & b; });
+        bench("add", width, n, [&](long i) { return a + b; });
+        bench("sub", width, n, [&](long i) { return a - b; });
+        bench("mul", width, n, [&](long i) { return a * b; });
+        bench("udiv", width, n / 16, [&](long i) { return a.udiv(small.zeroExtend(width)); });
+        bench("shl", width, n, [&](long i) { return a << (int)(i % width); });
+        bench("lshr", width, n, [&](long i) { return a >> (int)(i % width); });
+        bench("concat", width, n, [&](long i) { return small.concat(small); });
+        bench("extract", width, n, [&](long i) { return a.extract(width - 1, width / 4); });
+        bench("ult", width, n, [&](long i) { return BitVector(1, a.ult(b)); });
+        bench("eq", width, n, [&](long i) { return BitVector(1, a == b); });
+    }
+    return 0;
+}
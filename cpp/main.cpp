@@ -7,6 +7,8 @@
 //  main.cpp
 //
 #include <libgen.h>
+#include <fstream>
+#include <getopt.h>
 #include <iostream>
 #include <stdlib.h>
 #include <unistd.h>
@@ -18,15 +20,23 @@
 
 
 #include "antlr4-runtime.h"
+#include "AstArena.h"
+#include "AstReader.h"
 #include "AstWriter.h"
 #include "BSVLexer.h"
 #include "BSVParser.h"
 #include "BSVPreprocessor.h"
+#include "BoundedModelChecker.h"
+#include "ConflictAnalysis.h"
+#include "Elaborator.h"
 #include "GenerateAst.h"
+#include "GenerateCpp.h"
 #include "GenerateKami.h"
 #include "GenerateKoika.h"
 #include "GenerateIR.h"
 #include "Inliner.h"
+#include "Interpreter.h"
+#include "OptimizeAst.h"
 #include "SimplifyAst.h"
 #include "TypeChecker.h"
 
@@ -34,9 +44,19 @@ using namespace antlr4;
 //namespace fs = boost::filesystem;
 
 void usage(char *const argv[]) {
-    fprintf(stderr, "Usage: %s [-I dir]* [-k]\n", argv[0]);
+    fprintf(stderr, "Usage: %s [-I dir]* [-k] file.bsv|file.ast ...\n", argv[0]);
+    fprintf(stderr, "   file.ast   Starts from the AST written to kami/ by an earlier run, without parsing or type checking\n");
     fprintf(stderr, "   -I dir     Adds dir to the search path for imports\n");
+    fprintf(stderr, "   --ast-image  Also writes kami/package.astimg, an AST image tools can mmap\n");
+    fprintf(stderr, "   --bmc N    Checks the dynamicAssert calls of the flattened modules for up to N rule firings\n");
+    fprintf(stderr, "   -c         Writes rule read/write sets and conflict matrices to kami/package.conflicts.json\n");
+    fprintf(stderr, "   -C         Generates a C++ simulator of the flattened package in sim/\n");
+    fprintf(stderr, "   -e         Elaborates static parameters, loops and Vectors of submodules\n");
     fprintf(stderr, "   -k         Enables kami code generation\n");
+    fprintf(stderr, "   -O level   Optimizes the simplified AST unless level is 0 (default 0)\n");
+    fprintf(stderr, "   -s module  Simulates module after flattening it\n");
+    fprintf(stderr, "   --stats    Reports the memory used by the AST of each package\n");
+    fprintf(stderr, "   -n cycles  Stops the simulation after cycles (default 1000)\n");
     exit(-1);
 }
 
@@ -44,20 +64,138 @@ struct BSVOptions {
     bool dumptree;
     bool opt_type_check;
     bool opt_ast;
+    bool opt_ast_image;
+    bool opt_stats;
+    bool opt_conflicts;
+    bool opt_cpp;
+    bool opt_elaborate;
     bool opt_kami;
     bool opt_koika;
     bool opt_ir;
     bool opt_inline;
+    string opt_simulate;
+    long opt_cycles;
+    int opt_bmc;
+    int opt_optimize;
     vector<string> includePath;
     vector<string> definitions;
 };
 
-int processBSVFile(const string &inputFileName, shared_ptr<TypeChecker> typeChecker, const BSVOptions options) {
-    char buffer[4096];
-    strncpy(buffer, inputFileName.c_str(), sizeof(buffer)-1);
-    string packageName(::basename(buffer));
-    packageName = packageName.substr(0, packageName.size() - 4);
-    cerr << "processBSVFile package " << packageName << " filename " << inputFileName << endl;
+// the passes after type checking, for packages parsed from BSV and for those read from .ast files
+int processPackageDef(const string &sourceFileName, const string &packageName, const shared_ptr<PackageDefStmt> &packageDef, const BSVOptions &options) {
+    // elaboration errors, modules that cannot be simulated and assertions that fail in --bmc,
+    // so that the exit status shows them
+    int failedChecks = 0;
+    vector<shared_ptr<Stmt>> stmts = packageDef->stmts;
+    if (options.opt_elaborate) {
+        Elaborator elaborator(stmts);
+        stmts = elaborator.elaboratePackage(stmts);
+        failedChecks += elaborator.numErrors();
+    }
+    SimplifyAst *simplifier = new SimplifyAst(packageName);
+    vector<shared_ptr<Stmt>> simplifiedStmts;
+    simplifier->simplify(stmts, simplifiedStmts);
+    stmts = simplifiedStmts;
+    if (options.opt_optimize) {
+        OptimizeAst optimizer;
+        stmts = optimizer.optimize(stmts);
+    }
+    if (options.opt_kami) {
+        ::mkdir("kami", 0755);
+
+        string kamiFileName("kami/");
+        kamiFileName += packageName;
+        kamiFileName += string(".v");
+        GenerateKami *generateKami = new GenerateKami();
+        generateKami->open(kamiFileName);
+        generateKami->generateStmts(stmts, 0);
+        generateKami->close();
+    }
+    if (options.opt_koika) {
+        ::mkdir("koika", 0775);
+
+        string koikaFileName("koika/");
+        char buffer[4096];
+        strncpy(buffer, sourceFileName.c_str(), sizeof(buffer)-1);
+        koikaFileName += string(::basename(buffer));
+        koikaFileName += string(".koika");
+
+        GenerateKoika *generateKoika = new GenerateKoika();
+        generateKoika->open(koikaFileName);
+        generateKoika->generateStmts(stmts);
+        generateKoika->close();
+    }
+    if (options.opt_ir) {
+        GenerateIR *generateIR = new GenerateIR();
+        generateIR->open("kami/" + packageName + string(".IR"));
+        generateIR->generateIR(stmts);
+        generateIR->close();
+    }
+    if (options.opt_conflicts) {
+        ::mkdir("kami", 0755);
+
+        ConflictAnalysis conflictAnalysis(stmts);
+        conflictAnalysis.analyzePackage();
+        ofstream conflictsFile("kami/" + packageName + string(".conflicts.json"));
+        conflictAnalysis.writeJson(conflictsFile, packageName);
+    }
+    string opt_rename;
+    if (opt_rename.size()) {
+        for (size_t i = 0; i < stmts.size(); i++) {
+            shared_ptr<Stmt> stmt = stmts[i];
+            if (stmt && stmt->moduleDefStmt()) {
+                shared_ptr<LexicalScope> scope(make_shared<LexicalScope>("rename"));
+                shared_ptr<Stmt> renamedStmt = stmt->rename(opt_rename, scope);
+                //renamedStmt->prettyPrint(cout, 0);
+            }
+        }
+    }
+    if (options.opt_inline) {
+        std::unique_ptr<Inliner> inliner = std::make_unique<Inliner>();
+        vector<shared_ptr<Stmt>> inlinedStmts = inliner->processPackage(stmts);
+        for (size_t i = 0; i < inlinedStmts.size(); i++) {
+            //inlinedStmts[i]->prettyPrint(cout, 0);
+        }
+    }
+    if (options.opt_simulate.size()) {
+        Inliner inliner;
+        vector<shared_ptr<Stmt>> inlinedStmts = inliner.processPackage(stmts);
+        Interpreter interpreter(inlinedStmts);
+        if (interpreter.load(options.opt_simulate))
+            interpreter.run(options.opt_cycles);
+        else
+            failedChecks++;
+    }
+    if (options.opt_bmc) {
+        Inliner inliner;
+        vector<shared_ptr<Stmt>> inlinedStmts = inliner.processPackage(stmts);
+        for (size_t i = 0; i < inlinedStmts.size(); i++) {
+            shared_ptr<ModuleDefStmt> moduleDef = inlinedStmts[i]->moduleDefStmt();
+            if (!moduleDef)
+                continue;
+            BoundedModelChecker checker(inlinedStmts);
+            if (checker.load(moduleDef->name) && !checker.check(options.opt_bmc))
+                failedChecks++;
+        }
+    }
+    if (options.opt_cpp) {
+        ::mkdir("sim", 0755);
+
+        Inliner inliner;
+        vector<shared_ptr<Stmt>> inlinedStmts = inliner.processPackage(stmts);
+        GenerateCpp generateCpp;
+        generateCpp.open(string("sim/") + packageName + string(".cpp"));
+        generateCpp.generateStmts(inlinedStmts);
+        generateCpp.close();
+    }
+    return failedChecks;
+}
+
+// preprocesses, parses and type checks inputFileName and generates its AST, which refers to nothing in the
+// parse tree, so that the tokens and the parse tree can be freed on return, before the passes over the AST
+shared_ptr<PackageDefStmt> parseBSVFile(const string &inputFileName, const string &packageName,
+                                        shared_ptr<TypeChecker> typeChecker, const BSVOptions &options,
+                                        int &numberOfSyntaxErrors) {
     BSVPreprocessor preprocessor(inputFileName);
     preprocessor.define(options.definitions);
     CommonTokenStream tokens((TokenSource *) &preprocessor);
@@ -67,73 +205,74 @@ int processBSVFile(const string &inputFileName, shared_ptr<TypeChecker> typeChec
     BSVParser parser(&tokens);
     //parser.addErrorListener(&ConsoleErrorListener::INSTANCE);
     BSVParser::PackagedefContext *tree = parser.packagedef();
-    int numberOfSyntaxErrors = parser.getNumberOfSyntaxErrors();
+    numberOfSyntaxErrors = parser.getNumberOfSyntaxErrors();
     if (options.dumptree) {
         std::cout << tree->toStringTree(&parser) << std::endl << std::endl;
     }
+    shared_ptr<PackageDefStmt> packageDef;
     if (options.opt_ast) {
-        typeChecker->visit(tree);
-        GenerateAst *generateAst = new GenerateAst(packageName, typeChecker);
-        shared_ptr<PackageDefStmt> packageDef = generateAst->generateAst(tree);
+        // type checks the package as it generates the AST
+        GenerateAst generateAst(packageName, typeChecker);
+        packageDef = generateAst.generateAst(tree);
+        typeChecker->releaseParseTree();
+    }
+    return packageDef;
+}
+
+int processBSVFile(const string &inputFileName, shared_ptr<TypeChecker> typeChecker, const BSVOptions options) {
+    char buffer[4096];
+    strncpy(buffer, inputFileName.c_str(), sizeof(buffer)-1);
+    string packageName(::basename(buffer));
+    packageName = packageName.substr(0, packageName.size() - 4);
+    cerr << "processBSVFile package " << packageName << " filename " << inputFileName << endl;
+    // owns every AST node of this package, see AstArena.h
+    AstArena arena;
+    AstArena::Scope arenaScope(arena);
+    int numberOfSyntaxErrors = 0;
+    shared_ptr<PackageDefStmt> packageDef = parseBSVFile(inputFileName, packageName, typeChecker, options,
+                                                         numberOfSyntaxErrors);
+    // elaboration errors, modules that cannot be simulated and assertions that fail in --bmc,
+    // so that the exit status shows them
+    int failedChecks = 0;
+    if (packageDef) {
+        ::mkdir("kami", 0755);
         AstWriter astWriter;
-        astWriter.visit(packageDef);
-        astWriter.writeAst(string("kami/") + packageName + string(".ast"));
-        vector<shared_ptr<Stmt>> stmts = packageDef->stmts;
-        SimplifyAst *simplifier = new SimplifyAst(packageName);
-        vector<shared_ptr<Stmt>> simplifiedStmts;
-        simplifier->simplify(stmts, simplifiedStmts);
-        stmts = simplifiedStmts;
-        if (options.opt_kami) {
-            ::mkdir("kami", 0755);
-
-            string kamiFileName("kami/");
-            kamiFileName += packageName;
-            kamiFileName += string(".v");
-            GenerateKami *generateKami = new GenerateKami();
-            generateKami->open(kamiFileName);
-            generateKami->generateStmts(stmts, 0);
-            generateKami->close();
-        }
-        if (options.opt_koika) {
-            ::mkdir("koika", 0775);
-
-            string koikaFileName("koika/");
-            char buffer[4096];
-	    strncpy(buffer, inputFileName.c_str(), sizeof(buffer)-1);
-            koikaFileName += string(::basename(buffer));
-            koikaFileName += string(".koika");
-
-            GenerateKoika *generateKoika = new GenerateKoika();
-            generateKoika->open(koikaFileName);
-            generateKoika->generateStmts(stmts);
-            generateKoika->close();
-        }
-        if (options.opt_ir) {
-            GenerateIR *generateIR = new GenerateIR();
-            generateIR->open("kami/" + packageName + string(".IR"));
-            generateIR->generateIR(stmts);
-            generateIR->close();
-        }
-        string opt_rename;
-        if (opt_rename.size()) {
-            for (size_t i = 0; i < stmts.size(); i++) {
-                shared_ptr<Stmt> stmt = stmts[i];
-                if (stmt && stmt->moduleDefStmt()) {
-                    shared_ptr<LexicalScope> scope(make_shared<LexicalScope>("rename"));
-                    shared_ptr<Stmt> renamedStmt = stmt->rename(opt_rename, scope);
-                    //renamedStmt->prettyPrint(cout, 0);
-                }
-            }
-        }
-        if (options.opt_inline) {
-            std::unique_ptr<Inliner> inliner = std::make_unique<Inliner>();
-            vector<shared_ptr<Stmt>> inlinedStmts = inliner->processPackage(stmts);
-            for (size_t i = 0; i < inlinedStmts.size(); i++) {
-                //inlinedStmts[i]->prettyPrint(cout, 0);
-            }
+        AstImageWriter imageWriter;
+        astWriter.open(string("kami/") + packageName + string(".ast"));
+        if (options.opt_ast_image) {
+            imageWriter.open(string("kami/") + packageName + string(".astimg"));
+            astWriter.setImageWriter(&imageWriter);
         }
+        astWriter.visit(packageDef);
+        astWriter.close();
+        if (options.opt_ast_image)
+            imageWriter.close();
+        failedChecks = processPackageDef(inputFileName, packageName, packageDef, options);
     }
-    return numberOfSyntaxErrors;
+    if (options.opt_stats)
+        cerr << "AST arena for package " << packageName << ": " << arena.bytesAllocated() << " bytes in "
+             << arena.bytesReserved() << " reserved" << endl;
+    return numberOfSyntaxErrors + failedChecks;
+}
+
+// starts from the AST a previous run wrote to kami/, skipping preprocessing, parsing and type checking
+int processAstFile(const string &inputFileName, const BSVOptions options) {
+    cerr << "processAstFile filename " << inputFileName << endl;
+    AstArena arena;
+    AstArena::Scope arenaScope(arena);
+    AstReader astReader;
+    if (!astReader.open(inputFileName))
+        return 1;
+    shared_ptr<PackageDefStmt> packageDef = astReader.readPackageDef();
+    astReader.close();
+    if (!packageDef)
+        return 1;
+    string sourceFileName = packageDef->sourcePos.sourceName.size() ? packageDef->sourcePos.sourceName : inputFileName;
+    int failedChecks = processPackageDef(sourceFileName, packageDef->name, packageDef, options);
+    if (options.opt_stats)
+        cerr << "AST arena for package " << packageDef->name << ": " << arena.bytesAllocated() << " bytes in "
+             << arena.bytesReserved() << " reserved" << endl;
+    return failedChecks;
 }
 
 int main(int argc, char *const argv[]) {
@@ -146,20 +285,46 @@ int main(int argc, char *const argv[]) {
     options.dumptree = dumptree;
     options.opt_type_check = 1; // mandatory -- used when generating AST
     options.opt_ast = 1;
+    options.opt_ast_image = 0;
+    options.opt_stats = 0;
+    options.opt_conflicts = 0;
+    options.opt_cpp = 0;
+    options.opt_elaborate = 0;
     options.opt_kami = 0;
     options.opt_koika = 0;
     options.opt_ir = 0;
     options.opt_inline = 0;
+    options.opt_cycles = 1000;
+    options.opt_bmc = 0;
+    options.opt_optimize = 0;
     string opt_rename;
 
-    while ((ch = getopt(argc, argv, "D:I:aikr:t")) != -1) {
+    static struct option longOptions[] = {
+            {"bmc", required_argument, 0, 'b'},
+            {"ast-image", no_argument, 0, 'm'},
+            {"stats", no_argument, 0, 'S'},
+            {0, 0, 0, 0}
+    };
+    while ((ch = getopt_long(argc, argv, "CD:I:O:Sab:ceikmn:r:s:t", longOptions, nullptr)) != -1) {
         switch (ch) {
+            case 'b':
+                options.opt_bmc = atoi(optarg);
+                break;
             case 'a':
                 options.opt_ast = 1;
                 break;
+            case 'c':
+                options.opt_conflicts = 1;
+                break;
+            case 'C':
+                options.opt_cpp = 1;
+                break;
             case 'D':
                 options.definitions.push_back(optarg);
                 break;
+            case 'e':
+                options.opt_elaborate = 1;
+                break;
             case 'i':
                 options.opt_ir = 1;
                 break;
@@ -173,6 +338,21 @@ int main(int argc, char *const argv[]) {
                 cerr << "include " << optarg << endl;
                 options.includePath.push_back(optarg);
                 break;
+            case 'O':
+                options.opt_optimize = atoi(optarg);
+                break;
+            case 'm':
+                options.opt_ast_image = 1;
+                break;
+            case 'n':
+                options.opt_cycles = atol(optarg);
+                break;
+            case 's':
+                options.opt_simulate = string(optarg);
+                break;
+            case 'S':
+                options.opt_stats = 1;
+                break;
             case 'r':
                 opt_rename = string(optarg);
                 break;
@@ -192,6 +372,10 @@ int main(int argc, char *const argv[]) {
         string input_basename(::basename(buffer));
         long dotpos = input_basename.find_first_of('.');
         string packageName = input_basename.substr(0, dotpos);
+        if (inputFileName.size() > 4 && inputFileName.substr(inputFileName.size() - 4) == ".ast") {
+            numberOfSyntaxErrors += processAstFile(inputFileName, options);
+            continue;
+        }
         std::cerr << "Parsing file -1- " << inputFileName << " package " << packageName << std::endl;
 
         shared_ptr<TypeChecker> typeChecker = make_shared<TypeChecker>(packageName, options.includePath,
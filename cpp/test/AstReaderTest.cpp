@@ -0,0 +1,175 @@
+// Regression tests for .ast files: a package written by AstWriter reads back
+// the same, and damaged files are rejected instead of read. The image written
+// next to it maps back with the nodes in their slots.
+
+#include <fstream>
+
+#include "AstImage.h"
+#include "AstReader.h"
+#include "AstWriter.h"
+#include "TestSupport.h"
+
+static const string astFile = "astreader-test.ast";
+static const string imageFile = "astreader-test.astimg";
+
+static string prettyPrint(const shared_ptr<Stmt> &stmt) {
+    ostringstream out;
+    stmt->prettyPrint(out, 0);
+    return out.str();
+}
+
+static string readFile(const string &filename) {
+    ifstream input(filename, ios::in | ios::binary);
+    ostringstream contents;
+    contents << input.rdbuf();
+    return contents.str();
+}
+
+static void writeFile(const string &filename, const string &contents) {
+    ofstream output(filename, ios::out | ios::trunc | ios::binary);
+    output.write(contents.data(), contents.size());
+}
+
+static shared_ptr<PackageDefStmt> package() {
+    shared_ptr<BSVType> bit4 = bitType(4);
+    shared_ptr<Expr> count = var("count", bit4);
+    return makeAst<PackageDefStmt>("Test", Stmts{moduleDef("mkTop", Stmts{
+            reg("count", bit4, num("0")),
+            rule("step", op("<", count, num("3")), Stmts{
+                    display("count %d", Exprs{count}),
+                    makeAst<RegWriteStmt>("count", bit4, op("+", count, num("1")))}),
+            rule("done", op("==", count, num("3")), Stmts{finish()})})});
+}
+
+static bool write(const shared_ptr<PackageDefStmt> &packageDef) {
+    AstWriter writer;
+    if (!writer.open(astFile))
+        return false;
+    writer.visit(packageDef);
+    return writer.close();
+}
+
+static void testRoundTrip() {
+    shared_ptr<PackageDefStmt> packageDef = package();
+    CHECK(write(packageDef));
+    AstReader reader;
+    CHECK(reader.open(astFile));
+    shared_ptr<PackageDefStmt> readBack = reader.readPackageDef();
+    reader.close();
+    CHECK(readBack);
+    if (!readBack)
+        return;
+    CHECK_EQUAL(readBack->name, packageDef->name);
+    CHECK_EQUAL(readBack->stmts.size(), packageDef->stmts.size());
+    for (size_t i = 0; i < readBack->stmts.size() && i < packageDef->stmts.size(); i++)
+        CHECK_EQUAL(prettyPrint(readBack->stmts[i]), prettyPrint(packageDef->stmts[i]));
+    CHECK_EQUAL(reader.index().entry_size(), 1);
+}
+
+// a header record claiming 2^62 bytes
+static void testOversizedRecordIsRejected() {
+    string contents("BSVAST02");
+    contents += string(8, '\xff');
+    contents += '\x3f';
+    contents += string(16, '\0');
+    writeFile(astFile, contents);
+    AstReader reader;
+    CHECK(!reader.open(astFile));
+}
+
+// the length of the last statement grows past the index that follows it
+static void testTruncatedStatementIsRejected() {
+    CHECK(write(package()));
+    AstReader reader;
+    CHECK(reader.open(astFile));
+    uint64_t offset = reader.index().entry(0).offset();
+    reader.close();
+    string contents = readFile(astFile);
+    contents[offset] = '\xff';
+    contents[offset + 1] = '\x7f';
+    writeFile(astFile, contents);
+    CHECK(reader.open(astFile));
+    CHECK(!reader.readPackageDef());
+}
+
+// an index offset past the end of the file
+static void testIndexOffsetIsChecked() {
+    CHECK(write(package()));
+    string contents = readFile(astFile);
+    contents[contents.size() - 10] = '\x7f';
+    writeFile(astFile, contents);
+    AstReader reader;
+    CHECK(!reader.open(astFile));
+}
+
+// Bit#(4) limit = 3; and mkTop of package(), at line 7 of Test.bsv
+static bool writeImage() {
+    shared_ptr<BSVType> bit4 = bitType(4);
+    shared_ptr<ModuleDefStmt> mkTop = package()->stmts[0]->moduleDefStmt();
+    shared_ptr<PackageDefStmt> packageDef = makeAst<PackageDefStmt>("Test", Stmts{
+            makeAst<ModuleDefStmt>("Test", mkTop->name, mkTop->interfaceType, mkTop->params, mkTop->paramTypes,
+                                   mkTop->stmts, SourcePos("Test.bsv", 7, 0)),
+            makeAst<VarBindingStmt>(bit4, "limit", num("3"))});
+    AstWriter writer;
+    AstImageWriter imageWriter;
+    if (!writer.open(astFile) || !imageWriter.open(imageFile))
+        return false;
+    writer.setImageWriter(&imageWriter);
+    writer.visit(packageDef);
+    return writer.close() && imageWriter.close();
+}
+
+// slots are fields 2 and up of the proto messages, kinds the field numbers of their oneof cases
+static void testImageRoundTrip() {
+    CHECK(writeImage());
+    AstImage image;
+    CHECK(image.open(imageFile));
+    CHECK_EQUAL(string(image.packageName()), string("Test"));
+    CHECK_EQUAL(image.numStmts(), (uint32_t)2);
+
+    AstImageNode module = image.stmt(0);
+    CHECK(module);
+    CHECK_EQUAL(module.nodeClass(), StmtImageNode);
+    CHECK_EQUAL(module.kind(), (uint32_t)bsvproto::Stmt::kModuleDefStmt);
+    CHECK_EQUAL(string(module.filename()), string("Test.bsv"));
+    CHECK_EQUAL(module.line(), (uint32_t)7);
+    CHECK_EQUAL(string(module.text(1)), string("mkTop"));
+    CHECK_EQUAL(module.listSize(5), (uint32_t)3);
+
+    AstImageNode step = module.listChild(5, 1);
+    CHECK_EQUAL(step.kind(), (uint32_t)bsvproto::Stmt::kRuleDefStmt);
+    CHECK_EQUAL(string(step.text(0)), string("step"));
+    AstImageNode guard = step.child(1);
+    CHECK_EQUAL(guard.nodeClass(), ExprImageNode);
+    CHECK_EQUAL(guard.kind(), (uint32_t)bsvproto::Expr::kOperatorExpr);
+    CHECK_EQUAL(string(guard.text(1)), string("<"));
+    CHECK_EQUAL(guard.child(2).kind(), (uint32_t)bsvproto::Expr::kVarExpr);
+    CHECK_EQUAL(string(guard.child(2).text(1)), string("count"));
+    CHECK_EQUAL(step.listSize(2), (uint32_t)2);
+    AstImageNode regWrite = step.listChild(2, 1);
+    CHECK_EQUAL(regWrite.kind(), (uint32_t)bsvproto::Stmt::kRegWriteStmt);
+    CHECK_EQUAL(string(regWrite.text(0)), string("count"));
+    CHECK_EQUAL(string(regWrite.type(1).name()), string("Bit"));
+    CHECK_EQUAL(regWrite.type(1).numParams(), (uint32_t)1);
+
+    AstImageNode limit = image.stmt(1);
+    CHECK_EQUAL(limit.kind(), (uint32_t)bsvproto::Stmt::kVarBindingStmt);
+    CHECK_EQUAL(string(limit.text(2)), string("limit"));
+
+    CHECK_EQUAL(image.numDeclarations(), (uint32_t)2);
+    CHECK_EQUAL(string(image.declarationName(0)), string("limit"));
+    CHECK_EQUAL(string(image.declarationName(1)), string("mkTop"));
+    CHECK_EQUAL(image.lookup("mkTop").position(), module.position());
+    CHECK_EQUAL(image.lookup("limit").position(), limit.position());
+    CHECK(!image.lookup("mkMissing"));
+    image.close();
+}
+
+int main() {
+    testRoundTrip();
+    testOversizedRecordIsRejected();
+    testTruncatedStatementIsRejected();
+    testIndexOffsetIsChecked();
+    testImageRoundTrip();
+    return failures;
+}
@@ -0,0 +1,85 @@
+// Regression tests for the BoundedModelChecker, including rules it cannot encode.
+
+#include "BoundedModelChecker.h"
+#include "TestSupport.h"
+
+static shared_ptr<Stmt> dynamicAssert(const shared_ptr<Expr> &cond, const string &message) {
+    return makeAst<ExprStmt>(call("dynamicAssert", Exprs{cond, makeAst<StringConst>(message)}));
+}
+
+// checks moduleName of the flattened package for maxSteps rule firings, returning what it printed
+static string bmc(const Stmts &packageStmts, const string &moduleName, int maxSteps, bool &passed) {
+    ostringstream out;
+    BoundedModelChecker checker(flatten(packageStmts), out);
+    passed = checker.load(moduleName) && checker.check(maxSteps);
+    return out.str();
+}
+
+// a counter that stops at 3, asserted to stay below limit
+static Stmts counter(const string &limit) {
+    shared_ptr<BSVType> bit4 = bitType(4);
+    shared_ptr<Expr> count = var("count", bit4);
+    return Stmts{moduleDef("mkTop", Stmts{
+            reg("count", bit4, num("0")),
+            rule("step", op("<", count, num("3")), Stmts{
+                    makeAst<RegWriteStmt>("count", bit4, op("+", count, num("1")))}),
+            rule("check", shared_ptr<Expr>(), Stmts{
+                    dynamicAssert(op("<", count, num(limit)), "count is below " + limit)})})};
+}
+
+static void testAssertionHolds() {
+    bool passed = false;
+    string out = bmc(counter("4"), "mkTop", 8, passed);
+    CHECK(passed);
+    CHECK(out.find("no assertion fails") != string::npos);
+}
+
+static void testAssertionFails() {
+    bool passed = true;
+    string out = bmc(counter("3"), "mkTop", 8, passed);
+    CHECK(!passed);
+    CHECK(out.find("assertion fails after 4 rule firings") != string::npos);
+}
+
+// the loop in spin has a symbolic bound, so the rule is not encoded, but it
+// may still write 5 to r, which check asserts never happens
+static void testUnencodedRuleWritesAreUnconstrained() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    shared_ptr<Expr> n = var("n", bit8), r = var("r", bit8);
+    Stmts stmts{moduleDef("mkTop", Stmts{
+            reg("n", bit8, num("0")),
+            reg("r", bit8, num("0")),
+            rule("spin", shared_ptr<Expr>(), Stmts{
+                    makeAst<WhileStmt>(op("<", n, num("3")), makeAst<BlockStmt>(Stmts{
+                            makeAst<RegWriteStmt>("r", bit8, num("5"))}))}),
+            rule("check", shared_ptr<Expr>(), Stmts{dynamicAssert(op("!=", r, num("5")), "r is never 5")})})};
+    bool passed = true;
+    string out = bmc(stmts, "mkTop", 4, passed);
+    CHECK(!passed);
+    CHECK(out.find("rule spin (not encoded)") != string::npos);
+}
+
+// spin is not encoded, so its assertion is not checked, and the check cannot pass
+static void testUnencodedAssertionsAreReported() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    shared_ptr<Expr> n = var("n", bit8);
+    Stmts stmts{moduleDef("mkTop", Stmts{
+            reg("n", bit8, num("0")),
+            rule("spin", shared_ptr<Expr>(), Stmts{
+                    makeAst<WhileStmt>(op("<", n, num("3")), makeAst<BlockStmt>(Stmts{display("spin")})),
+                    dynamicAssert(op("==", n, num("1")), "n is 1"),
+                    finish()})})};
+    bool passed = true;
+    string out = bmc(stmts, "mkTop", 4, passed);
+    CHECK(!passed);
+    CHECK(out.find("incomplete") != string::npos);
+    CHECK(out.find("rule spin are not checked") != string::npos);
+}
+
+int main() {
+    testAssertionHolds();
+    testAssertionFails();
+    testUnencodedRuleWritesAreUnconstrained();
+    testUnencodedAssertionsAreReported();
+    return failures;
+}
@@ -0,0 +1,108 @@
+// Regression tests for CommonSubexprs: repeated subexpressions are bound with
+// LET, and those with side effects or of different types are not merged.
+
+#include <fstream>
+
+#include "CommonSubexprs.h"
+#include "GenerateKami.h"
+#include "TestSupport.h"
+
+static shared_ptr<Stmt> let(const shared_ptr<BSVType> &bsvtype, const string &name, const shared_ptr<Expr> &rhs) {
+    return makeAst<VarBindingStmt>(bsvtype, name, rhs);
+}
+
+static string prettyPrint(const shared_ptr<Expr> &expr) {
+    ostringstream out;
+    expr->prettyPrint(out, 0);
+    return out.str();
+}
+
+// Bit#(8) x = (a + b) * 2; Bit#(8) y = (a + b) * 3;
+static void testRepeatedSubexprIsShared() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    shared_ptr<Expr> a = var("a", bit8), b = var("b", bit8);
+    shared_ptr<Expr> sum1 = op("+", a, b), sum2 = op("+", var("a", bit8), var("b", bit8));
+    Stmts stmts{let(bit8, "x", op("*", sum1, num("2"))), let(bit8, "y", op("*", sum2, num("3")))};
+    CommonSubexprs subexprs;
+    subexprs.analyze(shared_ptr<Expr>(), stmts);
+    CHECK_EQUAL(subexprs.numShared(), (size_t)1);
+    vector<CommonSubexprs::Shared> bindings = subexprs.bindingsBefore(1);
+    CHECK_EQUAL(bindings.size(), (size_t)1);
+    if (bindings.size() == 1) {
+        CHECK_EQUAL(bindings[0].name, string("cse'0"));
+        CHECK_EQUAL(prettyPrint(bindings[0].expr), prettyPrint(sum1));
+        CHECK_EQUAL(bindings[0].last, (size_t)2);
+    }
+    subexprs.enterStmt(2);
+    CHECK_EQUAL(subexprs.sharedName(sum2), string("cse'0"));
+    CHECK(subexprs.bindingsBefore(2).empty());
+}
+
+// a = a + 1 in between: the second a + b reads another a
+static void testAssignmentBetweenKillsSharing() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    shared_ptr<Expr> a = var("a", bit8), b = var("b", bit8);
+    Stmts stmts{let(bit8, "x", op("+", a, b)),
+                makeAst<VarAssignStmt>(makeAst<VarLValue>("a", bit8), "=", op("+", a, num("1"))),
+                let(bit8, "y", op("+", a, b))};
+    CommonSubexprs subexprs;
+    subexprs.analyze(shared_ptr<Expr>(), stmts);
+    CHECK_EQUAL(subexprs.numShared(), (size_t)0);
+}
+
+// f(a) + 1, twice: each call may have effects of its own
+static void testCallsAreNotMerged() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    shared_ptr<Expr> a = var("a", bit8);
+    Stmts stmts{let(bit8, "x", op("+", call("f", Exprs{a}, bit8), num("1"))),
+                let(bit8, "y", op("+", call("f", Exprs{a}, bit8), num("1")))};
+    CommonSubexprs subexprs;
+    subexprs.analyze(shared_ptr<Expr>(), stmts);
+    CHECK_EQUAL(subexprs.numShared(), (size_t)0);
+}
+
+// a + 1 with a literal typed Bit#(4) and one typed Bit#(8)
+static void testDifferentTypesAreNotMerged() {
+    shared_ptr<BSVType> bit4 = bitType(4), bit8 = bitType(8);
+    shared_ptr<Expr> a = var("a", bit4);
+    Stmts stmts{let(bit4, "x", op("+", a, makeAst<IntConst>("1", bit4))),
+                let(bit8, "y", op("+", var("a", bit8), makeAst<IntConst>("1", bit8)))};
+    CommonSubexprs subexprs;
+    subexprs.analyze(shared_ptr<Expr>(), stmts);
+    CHECK_EQUAL(subexprs.numShared(), (size_t)0);
+}
+
+// the shared expression of a rule is bound once with LET and used by name
+static void testKamiRuleBindsWithLet() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    shared_ptr<Expr> a = var("a", bit8), b = var("b", bit8);
+    Stmts stmts{moduleDef("mkTop", Stmts{
+            reg("r", bit8, num("0")),
+            rule("run", shared_ptr<Expr>(), Stmts{
+                    let(bit8, "a", num("3")),
+                    let(bit8, "b", num("4")),
+                    let(bit8, "x", op("*", op("+", a, b), num("2"))),
+                    let(bit8, "y", op("*", op("+", a, b), num("3"))),
+                    makeAst<RegWriteStmt>("r", bit8, op("+", var("x", bit8), var("y", bit8)))})})};
+    GenerateKami generator;
+    generator.open("csetest.v");
+    generator.generateStmts(flatten(stmts), 0);
+    generator.close();
+    ifstream input("csetest_mkTop.v");
+    ostringstream contents;
+    contents << input.rdbuf();
+    string kami = contents.str();
+    size_t let = kami.find("LET cse'0 <- ");
+    CHECK(let != string::npos);
+    CHECK(kami.find("LET cse'1") == string::npos);
+    CHECK(kami.find("cse'0", let + 1) != string::npos);
+}
+
+int main() {
+    testRepeatedSubexprIsShared();
+    testAssignmentBetweenKillsSharing();
+    testCallsAreNotMerged();
+    testDifferentTypesAreNotMerged();
+    testKamiRuleBindsWithLet();
+    return failures;
+}
@@ -0,0 +1,142 @@
+// Regression tests for the footprints and conflict matrix of ConflictAnalysis,
+// and the JSON it writes.
+
+#include "ConflictAnalysis.h"
+#include "TestSupport.h"
+
+// the package after SimplifyAst, as the conflict analysis sees it
+static Stmts simplify(const Stmts &packageStmts) {
+    Stmts stmts(packageStmts), simplifiedStmts;
+    SimplifyAst simplifier("Test");
+    simplifier.simplify(stmts, simplifiedStmts);
+    return simplifiedStmts;
+}
+
+static shared_ptr<BSVType> fifoType() { return BSVType::create("FIFO", vector<shared_ptr<BSVType>>{bitType(8)}); }
+
+// f.enq(value);
+static shared_ptr<Stmt> enq(const shared_ptr<Expr> &value) {
+    shared_ptr<BSVType> methodType = BSVType::create("Function", vector<shared_ptr<BSVType>>{
+            bitType(8), BSVType::create("Action")});
+    return makeAst<ExprStmt>(makeAst<CallExpr>(makeAst<FieldExpr>(var("f", fifoType()), "enq", methodType),
+                                               Exprs{value}));
+}
+
+static bool has(const vector<uint64_t> &bits, const ModuleConflicts &conflicts, const string &resource) {
+    for (size_t id = 0; id < conflicts.resources.size(); id++) {
+        if (conflicts.resources[id] == resource)
+            return bits[id / 64] & ((uint64_t)1 << (id % 64));
+    }
+    return false;
+}
+
+static size_t count(const vector<uint64_t> &bits) {
+    size_t n = 0;
+    for (size_t w = 0; w < bits.size(); w++)
+        n += __builtin_popcountll(bits[w]);
+    return n;
+}
+
+// registers a and b and a FIFO f of a module outside the package:
+// rule copy: a <= b;  rule bump: b <= b + 1;  rule putA: f.enq(a);  rule putB: f.enq(b);
+// method getA = a;
+static Stmts package() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    shared_ptr<Expr> a = var("a", bit8), b = var("b", bit8);
+    return Stmts{
+            moduleDef("mkTop", BSVType::create("Top"), Stmts{
+                    reg("a", bit8, num("0")),
+                    reg("b", bit8, num("0")),
+                    makeAst<ModuleInstStmt>("f", fifoType(), call("mkFIFO", Exprs(), fifoType())),
+                    rule("copy", shared_ptr<Expr>(), Stmts{makeAst<RegWriteStmt>("a", bit8, b)}),
+                    rule("bump", shared_ptr<Expr>(), Stmts{makeAst<RegWriteStmt>("b", bit8, op("+", b, num("1")))}),
+                    rule("putA", shared_ptr<Expr>(), Stmts{enq(a)}),
+                    rule("putB", shared_ptr<Expr>(), Stmts{enq(b)}),
+                    makeAst<MethodDefStmt>("getA", bit8, vector<string>(), vector<shared_ptr<BSVType>>(),
+                                           shared_ptr<Expr>(), Stmts{makeAst<ReturnStmt>(a)})}),
+            moduleDef("mkIdle", Stmts{reg("idle", bit8, num("0"))})};
+}
+
+static void testFootprints() {
+    Stmts stmts = simplify(package());
+    ConflictAnalysis analysis(stmts);
+    size_t index = analysis.analyzeModule(stmts[0]->moduleDefStmt());
+    const ModuleConflicts &conflicts = analysis.results()[index];
+    CHECK_EQUAL(conflicts.moduleName, string("mkTop"));
+    CHECK_EQUAL(conflicts.numRegisters, (size_t)2);
+    CHECK_EQUAL(conflicts.resources.size(), (size_t)3);
+    CHECK_EQUAL(conflicts.footprints.size(), (size_t)5);
+    if (conflicts.footprints.size() != 5)
+        return;
+
+    const Footprint &copy = conflicts.footprints[0];
+    CHECK_EQUAL(copy.name, string("copy"));
+    CHECK(copy.isRule);
+    CHECK(has(copy.reads, conflicts, "b") && count(copy.reads) == 1);
+    CHECK(has(copy.writes, conflicts, "a") && count(copy.writes) == 1);
+
+    const Footprint &putA = conflicts.footprints[2];
+    CHECK(has(putA.reads, conflicts, "a") && count(putA.reads) == 1);
+    CHECK(has(putA.writes, conflicts, "f") && count(putA.writes) == 1);
+    CHECK(putA.actionCalls == set<string>{"f.enq"});
+    CHECK(putA.valueCalls.empty());
+
+    const Footprint &getA = conflicts.footprints[4];
+    CHECK(!getA.isRule);
+    CHECK(has(getA.reads, conflicts, "a") && count(getA.reads) == 1);
+    CHECK_EQUAL(count(getA.writes), (size_t)0);
+}
+
+// rows and columns in the order copy, bump, putA, putB, getA
+static const char *expectedMatrix[] = {"-<>F>", ">-F>F", "<F-CF", "F<C-F", "<FFF-"};
+
+static void testConflictMatrix() {
+    Stmts stmts = simplify(package());
+    ConflictAnalysis analysis(stmts);
+    const ModuleConflicts &conflicts = analysis.results()[analysis.analyzeModule(stmts[0]->moduleDefStmt())];
+    size_t n = conflicts.footprints.size();
+    CHECK_EQUAL(n, (size_t)5);
+    for (size_t a = 0; a < n && a < 5; a++) {
+        string row;
+        for (size_t b = 0; b < n; b++)
+            row += (char)conflicts.conflict(a, b);
+        CHECK_EQUAL(row, string(expectedMatrix[a]));
+    }
+}
+
+// the index of an earlier module stays valid as more are analyzed
+static void testAnalyzeModuleIndex() {
+    Stmts stmts = simplify(package());
+    ConflictAnalysis analysis(stmts);
+    size_t top = analysis.analyzeModule(stmts[0]->moduleDefStmt());
+    size_t idle = analysis.analyzeModule(stmts[1]->moduleDefStmt());
+    CHECK_EQUAL(analysis.results()[top].moduleName, string("mkTop"));
+    CHECK_EQUAL(analysis.results()[idle].moduleName, string("mkIdle"));
+    CHECK_EQUAL(analysis.results()[top].footprints.size(), (size_t)5);
+}
+
+static void testJson() {
+    Stmts stmts = simplify(package());
+    ConflictAnalysis analysis(stmts);
+    analysis.analyzePackage();
+    ostringstream out;
+    analysis.writeJson(out, "Test");
+    string json = out.str();
+    CHECK(json.find("\"package\": \"Test\"") != string::npos);
+    CHECK(json.find("\"name\": \"mkIdle\"") != string::npos);
+    CHECK(json.find("\"registers\": [\"a\", \"b\"],") != string::npos);
+    CHECK(json.find("\"instances\": [\"f\"],") != string::npos);
+    CHECK(json.find("{\"name\": \"putA\", \"kind\": \"rule\", \"reads\": [\"a\"], \"writes\": [\"f\"], "
+                    "\"valueCalls\": [], \"actionCalls\": [\"f.enq\"]}") != string::npos);
+    CHECK(json.find("{\"name\": \"getA\", \"kind\": \"method\", \"reads\": [\"a\"], \"writes\": []") != string::npos);
+    CHECK(json.find("\"-<>F>\",") != string::npos);
+    CHECK(json.find("\"<FFF-\"\n") != string::npos);
+}
+
+int main() {
+    testFootprints();
+    testConflictMatrix();
+    testAnalyzeModuleIndex();
+    testJson();
+    return failures;
+}
@@ -0,0 +1,152 @@
+// Regression tests for loop unrolling and module specialization in the Elaborator.
+
+#include <set>
+
+#include "Elaborator.h"
+#include "TestSupport.h"
+
+static shared_ptr<BSVType> integerType() { return BSVType::create("Integer"); }
+
+// for (Integer i = 0; i < n; i = i + 1) body
+static shared_ptr<Stmt> countedLoop(int n, const shared_ptr<Stmt> &body) {
+    shared_ptr<Expr> i = var("i", integerType());
+    return makeAst<ForStmt>(Stmts{makeAst<VarBindingStmt>(integerType(), "i", num("0"))},
+                            op("<", i, num(to_string(n))),
+                            Stmts{makeAst<VarAssignStmt>(makeAst<VarLValue>("i", integerType()), "=",
+                                                         op("+", i, num("1")))},
+                            body);
+}
+
+static int count(const Stmts &stmts, StmtType stmtType) {
+    int n = 0;
+    for (size_t i = 0; i < stmts.size(); i++)
+        n += stmts[i]->stmtType == stmtType;
+    return n;
+}
+
+// the rules of a loop at module level end up at module level, one per iteration
+static void testModuleLoopIsSpliced() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    Stmts stmts{moduleDef("mkTop", Stmts{
+            reg("r", bit8, num("0")),
+            countedLoop(3, makeAst<BlockStmt>(Stmts{rule("bump", shared_ptr<Expr>(), Stmts{
+                    makeAst<RegWriteStmt>("r", bit8, op("+", var("r", bit8), var("i", integerType())))})}))})};
+    Elaborator elaborator(stmts);
+    shared_ptr<ModuleDefStmt> module = elaborator.elaborate("mkTop");
+    CHECK(module);
+    if (!module)
+        return;
+    CHECK_EQUAL(count(module->stmts, RuleDefStmtType), 3);
+    CHECK_EQUAL(count(module->stmts, BlockStmtType), 0);
+    set<string> ruleNames;
+    for (size_t i = 0; i < module->stmts.size(); i++) {
+        if (shared_ptr<RuleDefStmt> ruleDef = module->stmts[i]->ruleDefStmt())
+            ruleNames.insert(ruleDef->name);
+    }
+    CHECK_EQUAL(ruleNames.size(), (size_t)3);
+    CHECK(ruleNames.count("bump_0") && ruleNames.count("bump_1") && ruleNames.count("bump_2"));
+}
+
+// the first iteration binding t is spliced, the others keep their blocks
+static void testIterationsBindingNamesKeepTheirBlocks() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    Stmts stmts{moduleDef("mkTop", Stmts{rule("run", shared_ptr<Expr>(), Stmts{
+            makeAst<VarBindingStmt>(bit8, "x", num("0")),
+            countedLoop(3, makeAst<BlockStmt>(Stmts{
+                    makeAst<VarBindingStmt>(bit8, "t", var("i", integerType())),
+                    makeAst<VarAssignStmt>(makeAst<VarLValue>("x", bit8), "=",
+                                           op("+", var("x", bit8), var("t", bit8)))})),
+            display("%d", Exprs{var("x", bit8)})})})};
+    Elaborator elaborator(stmts);
+    shared_ptr<ModuleDefStmt> module = elaborator.elaborate("mkTop");
+    CHECK(module && module->stmts.size() == 1 && module->stmts[0]->ruleDefStmt());
+    if (!module || module->stmts.empty() || !module->stmts[0]->ruleDefStmt())
+        return;
+    const Stmts &ruleStmts = module->stmts[0]->ruleDefStmt()->stmts;
+    CHECK_EQUAL(count(ruleStmts, VarBindingStmtType), 2);
+    CHECK_EQUAL(count(ruleStmts, VarAssignStmtType), 1);
+    CHECK_EQUAL(count(ruleStmts, BlockStmtType), 2);
+}
+
+// arguments that differ only in punctuation specialize different modules
+static void testSpecializedNamesAreDistinct() {
+    Stmts stmts{makeAst<ModuleDefStmt>("Test", "mkSub", BSVType::create("Empty"), vector<string>{"a", "b"},
+                                       vector<shared_ptr<BSVType>>{BSVType::create("String"), BSVType::create("String")},
+                                       Stmts())};
+    Elaborator elaborator(stmts);
+    shared_ptr<Value> ab = make_shared<StringValue>("a_b");
+    shared_ptr<Value> aMinusB = make_shared<StringValue>("a-b");
+    shared_ptr<Value> a = make_shared<StringValue>("a");
+    shared_ptr<Value> b = make_shared<StringValue>("b");
+    shared_ptr<ModuleDefStmt> first = elaborator.elaborate("mkSub", vector<shared_ptr<Value>>{ab});
+    shared_ptr<ModuleDefStmt> second = elaborator.elaborate("mkSub", vector<shared_ptr<Value>>{aMinusB});
+    shared_ptr<ModuleDefStmt> third = elaborator.elaborate("mkSub", vector<shared_ptr<Value>>{a, b});
+    CHECK(first && second && third);
+    if (!first || !second || !third)
+        return;
+    CHECK(first->name != second->name);
+    CHECK(first->name != third->name);
+    CHECK(second->name != third->name);
+    CHECK_EQUAL(elaborator.elaborate("mkSub", vector<shared_ptr<Value>>{ab})->name, first->name);
+}
+
+// while (True) cannot be unrolled and is reported
+static void testUnrollLimitIsAnError() {
+    Stmts stmts{moduleDef("mkTop", Stmts{rule("run", shared_ptr<Expr>(), Stmts{
+            makeAst<WhileStmt>(var("True", boolType()), makeAst<BlockStmt>(Stmts()))})})};
+    Elaborator elaborator(stmts);
+    elaborator.elaborate("mkTop");
+    CHECK_EQUAL(elaborator.numErrors(), 1);
+}
+
+// sized literals keep all 64 bits instead of saturating
+static void testWideLiterals() {
+    Elaborator elaborator(Stmts{});
+    shared_ptr<Value> allOnes = elaborator.eval(op("==", num("64'hFFFFFFFFFFFFFFFF"), num("64'h7FFFFFFFFFFFFFFF")));
+    CHECK(allOnes && allOnes->boolValue() && !allOnes->boolValue()->value);
+    shared_ptr<Value> greater = elaborator.eval(op(">", num("64'hFFFFFFFFFFFFFFFF"), num("64'h1")));
+    CHECK(greater && greater->boolValue() && greater->boolValue()->value);
+}
+
+static shared_ptr<Expr> boundValue(const Stmts &stmts, const string &name) {
+    for (size_t i = 0; i < stmts.size(); i++) {
+        shared_ptr<VarBindingStmt> varBinding = stmts[i]->varBindingStmt();
+        if (varBinding && varBinding->name == name)
+            return varBinding->rhs;
+    }
+    return shared_ptr<Expr>();
+}
+
+// Integer k = 1; function Integer addK(Integer x); return x + k; endfunction
+// Integer a = addK(1); k = 5; Integer b = addK(1);
+// the second call sees the new k rather than the result of the first
+static void testNestedFunctionCallsAreNotCached() {
+    shared_ptr<Expr> k = var("k", integerType());
+    shared_ptr<Expr> addK = var("addK", integerType());
+    Stmts stmts{moduleDef("mkTop", Stmts{
+            makeAst<VarBindingStmt>(integerType(), "k", num("1")),
+            makeAst<FunctionDefStmt>("Test", "addK", integerType(), vector<string>{"x"},
+                                     vector<shared_ptr<BSVType>>{integerType()}, shared_ptr<Expr>(),
+                                     Stmts{makeAst<ReturnStmt>(op("+", var("x", integerType()), k))}),
+            makeAst<VarBindingStmt>(integerType(), "a", makeAst<CallExpr>(addK, Exprs{num("1")})),
+            makeAst<VarAssignStmt>(makeAst<VarLValue>("k", integerType()), "=", num("5")),
+            makeAst<VarBindingStmt>(integerType(), "b", makeAst<CallExpr>(addK, Exprs{num("1")}))})};
+    Elaborator elaborator(stmts);
+    shared_ptr<ModuleDefStmt> module = elaborator.elaborate("mkTop");
+    CHECK(module);
+    if (!module)
+        return;
+    shared_ptr<Expr> a = boundValue(module->stmts, "a"), b = boundValue(module->stmts, "b");
+    CHECK(a && a->intConst() && a->intConst()->value == 2);
+    CHECK(b && b->intConst() && b->intConst()->value == 6);
+}
+
+int main() {
+    testModuleLoopIsSpliced();
+    testIterationsBindingNamesKeepTheirBlocks();
+    testSpecializedNamesAreDistinct();
+    testUnrollLimitIsAnError();
+    testWideLiterals();
+    testNestedFunctionCallsAreNotCached();
+    return failures;
+}
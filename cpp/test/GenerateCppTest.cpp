@@ -0,0 +1,73 @@
+// Regression tests for the widths and signs of the values in the C++ simulator,
+// which is compiled with the compiler given as the first argument and checked
+// against the Interpreter.
+
+#include <stdio.h>
+
+#include "GenerateCpp.h"
+#include "TestSupport.h"
+
+static string compiler = "c++";
+
+static shared_ptr<Stmt> let(const shared_ptr<BSVType> &bsvtype, const string &name, const shared_ptr<Expr> &rhs) {
+    return makeAst<VarBindingStmt>(bsvtype, name, rhs);
+}
+
+static shared_ptr<Expr> neg(const shared_ptr<Expr> &expr) { return makeAst<OperatorExpr>("-", expr); }
+
+// generates, compiles and runs moduleName, returning what it displayed
+static string runCpp(const Stmts &packageStmts, const string &moduleName) {
+    GenerateCpp generator;
+    generator.open("generatecpp-test-sim.cpp");
+    generator.generateStmts(flatten(packageStmts));
+    generator.close();
+    string command = compiler + " -std=c++14 -o generatecpp-test-sim -DBSVSIM_TOP=" + moduleName
+                     + " generatecpp-test-sim.cpp";
+    if (system(command.c_str()) != 0) {
+        cerr << "GenerateCppTest: " << command << " failed" << endl;
+        return string();
+    }
+    string output;
+    FILE *sim = popen("./generatecpp-test-sim 10", "r");
+    if (!sim)
+        return output;
+    char buffer[256];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), sim)) > 0)
+        output.append(buffer, n);
+    pclose(sim);
+    return output;
+}
+
+static void testWidthsAndSigns() {
+    shared_ptr<BSVType> bit8 = bitType(8), bit12 = bitType(12), int8 = intType(8), int12 = intType(12);
+    shared_ptr<Expr> a = var("a", bit8), b = var("b", bit8), x = var("x", int8), y = var("y", int12);
+    shared_ptr<Expr> z = var("z", bit12);
+    Stmts stmts{moduleDef("mkTop", Stmts{rule("run", shared_ptr<Expr>(), Stmts{
+            let(bit8, "a", num("200")),
+            let(bit8, "b", num("100")),
+            display("%d %d %d %d", Exprs{op("+", a, b), op(">", op("+", a, b), num("250")),
+                                         makeAst<OperatorExpr>("~", a), op("-", op("-", a, b), op("+", b, b))}),
+            let(int8, "x", neg(num("3"))),
+            display("%d %d %d %d", Exprs{x, op("<", x, num("0")), op(">>", x, num("1")), op("/", x, num("2"))}),
+            let(int12, "y", neg(num("5"))),
+            display("%d %d %d %h", Exprs{y, op("<", y, num("0")), op("+", y, num("1")), y}),
+            let(bit12, "z", num("4095")),
+            display("%d %d", Exprs{op("+", z, num("1")), op("<<", z, num("4"))}),
+            display("%s %d", Exprs{makeAst<StringConst>("str"), a}),
+            finish()})})};
+    string expected = "44 0 55 156\n"
+                      "-3 1 -2 -1\n"
+                      "-5 1 -4 ffb\n"
+                      "0 4080\n"
+                      "str 200\n";
+    CHECK_EQUAL(simulate(stmts, "mkTop"), expected);
+    CHECK_EQUAL(runCpp(stmts, "mkTop"), expected);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1)
+        compiler = argv[1];
+    testWidthsAndSigns();
+    return failures;
+}
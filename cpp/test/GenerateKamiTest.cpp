@@ -0,0 +1,106 @@
+// Regression tests for how GenerateKami splits a package into Coq files:
+// the names each definition uses, the order of the definitions in a file,
+// and the Require edges between the files.
+
+#include <fstream>
+
+#include "GenerateKami.h"
+#include "TestSupport.h"
+
+static string readFile(const string &filename) {
+    ifstream input(filename);
+    ostringstream contents;
+    contents << input.rdbuf();
+    return contents.str();
+}
+
+static bool contains(const string &text, const string &part) {
+    return text.find(part) != string::npos;
+}
+
+static KamiDecl decl(const string &name, const set<string> &uses) {
+    return KamiDecl{"Definition " + name + ".\n", set<string>{name}, uses};
+}
+
+static void testReferencedNames() {
+    GenerateKami generator;
+    set<string> names = generator.referencedNames(
+            "Definition foo := bar (* baz (* nested *) quux *) \"str ing\" 8'b1 module'mkTop x_1.");
+    set<string> expected{"Definition", "foo", "bar", "module'mkTop", "x_1"};
+    CHECK(names == expected);
+}
+
+// each definition comes after the ones it uses, and otherwise stays where it was
+static void testSortDecls() {
+    GenerateKami generator;
+    vector<KamiDecl> sorted = generator.sortDecls(vector<KamiDecl>{
+            decl("a", set<string>{"b"}), decl("b", set<string>{"Bit"}), decl("c", set<string>()),
+            decl("d", set<string>{"a", "c"})});
+    CHECK_EQUAL(sorted.size(), (size_t)4);
+    string order;
+    for (size_t i = 0; i < sorted.size(); i++)
+        order += *sorted[i].defines.cbegin();
+    CHECK_EQUAL(order, string("bacd"));
+}
+
+// definitions that use each other are all kept
+static void testSortDeclsKeepsCycles() {
+    GenerateKami generator;
+    vector<KamiDecl> sorted = generator.sortDecls(vector<KamiDecl>{
+            decl("x", set<string>{"y"}), decl("y", set<string>{"x"}), decl("z", set<string>{"x"})});
+    CHECK_EQUAL(sorted.size(), (size_t)3);
+    if (sorted.size() == 3)
+        CHECK_EQUAL(*sorted[2].defines.cbegin(), string("z"));
+}
+
+// Bit#(8) limit = 3; mkTop counts to limit, and mkIdle uses nothing from the package
+static void testRequireEdges() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    shared_ptr<Expr> count = var("count", bit8);
+    Stmts stmts{
+            makeAst<VarBindingStmt>(bit8, "limit", num("3")),
+            moduleDef("mkTop", Stmts{
+                    reg("count", bit8, num("0")),
+                    rule("step", op("<", count, var("limit", bit8)), Stmts{
+                            makeAst<RegWriteStmt>("count", bit8, op("+", count, num("1")))})}),
+            moduleDef("mkIdle", Stmts{reg("idle", bit8, num("0"))})};
+    GenerateKami generator;
+    generator.open("kamitest.v");
+    generator.generateStmts(flatten(stmts), 0);
+    generator.close();
+
+    string defs = readFile("kamitest_Defs.v"), top = readFile("kamitest_mkTop.v");
+    string idle = readFile("kamitest_mkIdle.v"), package = readFile("kamitest.v");
+    CHECK(contains(defs, "limit"));
+    CHECK(!contains(defs, "Require Import kamitest_"));
+    CHECK(contains(top, "Require Import kamitest_Defs."));
+    CHECK(!contains(idle, "Require Import kamitest_Defs."));
+    CHECK(contains(package, "Require Export kamitest_Defs."));
+    CHECK(contains(package, "Require Export kamitest_mkTop."));
+    CHECK(contains(package, "Require Export kamitest_mkIdle."));
+    CHECK(package.find("Require Export kamitest_Defs.") < package.find("Require Export kamitest_mkTop."));
+
+    string makefile = readFile("kamitest.mk");
+    CHECK(contains(makefile, "kamitest_mkTop.vo: kamitest_Defs.vo\n"));
+    CHECK(contains(makefile, "kamitest.vo: kamitest_Defs.vo"));
+    CHECK(!contains(makefile, "kamitest_mkIdle.vo:"));
+}
+
+// a package without modules stays in one file
+static void testPackageWithoutModules() {
+    GenerateKami generator;
+    generator.open("kamitest2.v");
+    generator.generateStmts(flatten(Stmts{makeAst<VarBindingStmt>(bitType(8), "limit", num("3"))}), 0);
+    generator.close();
+    CHECK(contains(readFile("kamitest2.v"), "limit"));
+    CHECK(!ifstream("kamitest2_Defs.v").good());
+}
+
+int main() {
+    testReferencedNames();
+    testSortDecls();
+    testSortDeclsKeepsCycles();
+    testRequireEdges();
+    testPackageWithoutModules();
+    return failures;
+}
@@ -0,0 +1,198 @@
+// Regression tests for inlining methods whose bodies return early, that are
+// called under a condition or in a loop, or that cannot be inlined.
+
+#include "TestSupport.h"
+
+static shared_ptr<BSVType> subType() { return BSVType::create("Sub"); }
+
+// mkSub has a register cnt and the methods, mkTop has an instance s of mkSub and the rules
+static Stmts package(const Stmts &methods, const Stmts &rules) {
+    Stmts subStmts{reg("cnt", bitType(8), num("0"))};
+    subStmts.insert(subStmts.end(), methods.begin(), methods.end());
+    Stmts topStmts{makeAst<ModuleInstStmt>("s", subType(), call("mkSub", Exprs(), subType()))};
+    topStmts.insert(topStmts.end(), rules.begin(), rules.end());
+    return Stmts{moduleDef("mkSub", subType(), subStmts), moduleDef("mkTop", topStmts)};
+}
+
+static shared_ptr<Expr> method(const string &name, const shared_ptr<BSVType> &resultType) {
+    return makeAst<FieldExpr>(var("s", subType()), name, resultType);
+}
+
+static shared_ptr<Stmt> method(const string &name, const shared_ptr<BSVType> &returnType, const string &param,
+                               const Stmts &stmts) {
+    return makeAst<MethodDefStmt>(name, returnType, vector<string>{param}, vector<shared_ptr<BSVType>>{bitType(8)},
+                                  shared_ptr<Expr>(), stmts);
+}
+
+// method Bit#(8) pick(Bit#(8) v); if (v < 5) return 1; return 2; endmethod
+static void testValueMethodReturnsEarly() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    Stmts methods{method("pick", bit8, "v", Stmts{
+            makeAst<IfStmt>(op("<", var("v", bit8), num("5")), makeAst<ReturnStmt>(num("1")), shared_ptr<Stmt>()),
+            makeAst<ReturnStmt>(num("2"))})};
+    Stmts rules{rule("run", shared_ptr<Expr>(), Stmts{
+            display("%d %d", Exprs{makeAst<CallExpr>(method("pick", bit8), Exprs{num("3")}),
+                                   makeAst<CallExpr>(method("pick", bit8), Exprs{num("7")})}),
+            finish()})};
+    CHECK_EQUAL(simulate(package(methods, rules), "mkTop"), string("1 2\n"));
+}
+
+// method ActionValue#(Bit#(8)) take(Bit#(8) v); if (v == 0) return 9; cnt <= v; return v + 1; endmethod
+static void testActionAfterEarlyReturnIsSkipped() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    shared_ptr<BSVType> actionValue = BSVType::create("ActionValue", vector<shared_ptr<BSVType>>{bit8});
+    Stmts methods{method("take", actionValue, "v", Stmts{
+            makeAst<IfStmt>(op("==", var("v", bit8), num("0")), makeAst<ReturnStmt>(num("9")), shared_ptr<Stmt>()),
+            makeAst<RegWriteStmt>("cnt", bit8, var("v", bit8)),
+            makeAst<ReturnStmt>(op("+", var("v", bit8), num("1")))}),
+                  makeAst<MethodDefStmt>("cnt", bit8, vector<string>(), vector<shared_ptr<BSVType>>(), shared_ptr<Expr>(),
+                                         Stmts{makeAst<ReturnStmt>(var("cnt", bit8))})};
+    Stmts rules{
+            reg("step", bit8, num("0")),
+            rule("take4", op("==", var("step", bit8), num("0")), Stmts{
+                    makeAst<ActionBindingStmt>(bit8, "x", makeAst<CallExpr>(method("take", actionValue), Exprs{num("4")})),
+                    display("x %d", Exprs{var("x", bit8)}),
+                    makeAst<RegWriteStmt>("step", bit8, num("1"))}),
+            rule("take0", op("==", var("step", bit8), num("1")), Stmts{
+                    makeAst<ActionBindingStmt>(bit8, "y", makeAst<CallExpr>(method("take", actionValue), Exprs{num("0")})),
+                    display("y %d", Exprs{var("y", bit8)}),
+                    makeAst<RegWriteStmt>("step", bit8, num("2"))}),
+            rule("show", op("==", var("step", bit8), num("2")), Stmts{
+                    display("cnt %d", Exprs{method("cnt", bit8)}),
+                    finish()})};
+    CHECK_EQUAL(simulate(package(methods, rules), "mkTop"), string("x 5\ny 9\ncnt 4\n"));
+}
+
+// method Bit#(8) find(Bit#(8) v); while (v < 9) begin if (v == 5) return v; v = v + 1; end return 0; endmethod
+// has no equivalent without the return, so the call is left alone
+static void testReturnFromLoopIsNotInlined() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    shared_ptr<Expr> v = var("v", bit8);
+    Stmts methods{method("find", bit8, "v", Stmts{
+            makeAst<WhileStmt>(op("<", v, num("9")), makeAst<BlockStmt>(Stmts{
+                    makeAst<IfStmt>(op("==", v, num("5")), makeAst<ReturnStmt>(v), shared_ptr<Stmt>()),
+                    makeAst<VarAssignStmt>(makeAst<VarLValue>("v", bit8), "=", op("+", v, num("1")))})),
+            makeAst<ReturnStmt>(num("0"))})};
+    Stmts rules{rule("run", shared_ptr<Expr>(), Stmts{
+            display("%d", Exprs{makeAst<CallExpr>(method("find", bit8), Exprs{num("3")})}),
+            finish()})};
+    ostringstream out;
+    Stmts stmts = flatten(package(methods, rules));
+    for (size_t i = 0; i < stmts.size(); i++)
+        stmts[i]->prettyPrint(out, 0);
+    CHECK(out.str().find("s$find$") == string::npos);
+    CHECK(out.str().find("find") != string::npos);
+}
+
+// the flattened module moduleName of the package
+static shared_ptr<ModuleDefStmt> flattenedModule(const Stmts &packageStmts, const string &moduleName) {
+    Stmts stmts = flatten(packageStmts);
+    for (size_t i = 0; i < stmts.size(); i++) {
+        shared_ptr<ModuleDefStmt> moduleDef = stmts[i] ? stmts[i]->moduleDefStmt() : shared_ptr<ModuleDefStmt>();
+        if (moduleDef && moduleDef->name == moduleName)
+            return moduleDef;
+    }
+    return shared_ptr<ModuleDefStmt>();
+}
+
+static bool hasInstance(const shared_ptr<ModuleDefStmt> &moduleDef, const string &instanceName) {
+    for (size_t i = 0; moduleDef && i < moduleDef->stmts.size(); i++) {
+        shared_ptr<ModuleInstStmt> instStmt = moduleDef->stmts[i] ? moduleDef->stmts[i]->moduleInstStmt() : shared_ptr<ModuleInstStmt>();
+        if (instStmt && instStmt->name == instanceName)
+            return true;
+    }
+    return false;
+}
+
+static shared_ptr<RuleDefStmt> findRule(const shared_ptr<ModuleDefStmt> &moduleDef, const string &ruleName) {
+    for (size_t i = 0; moduleDef && i < moduleDef->stmts.size(); i++) {
+        shared_ptr<RuleDefStmt> ruleDef = moduleDef->stmts[i] ? moduleDef->stmts[i]->ruleDefStmt() : shared_ptr<RuleDefStmt>();
+        if (ruleDef && ruleDef->name == ruleName)
+            return ruleDef;
+    }
+    return shared_ptr<RuleDefStmt>();
+}
+
+// method Action put(Bit#(8) v) if (v < 5); cnt <= v; endmethod
+// cannot be inlined, as its guard depends on its argument, so s stays an instance
+static void testInstanceIsKeptForCallsNotInlined() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    shared_ptr<BSVType> action = BSVType::create("Action");
+    Stmts methods{makeAst<MethodDefStmt>("put", action, vector<string>{"v"}, vector<shared_ptr<BSVType>>{bit8},
+                                         op("<", var("v", bit8), num("5")),
+                                         Stmts{makeAst<RegWriteStmt>("cnt", bit8, var("v", bit8))})};
+    Stmts rules{rule("run", shared_ptr<Expr>(), Stmts{
+            makeAst<ExprStmt>(makeAst<CallExpr>(method("put", action), Exprs{num("3")}))})};
+    shared_ptr<ModuleDefStmt> top = flattenedModule(package(methods, rules), "mkTop");
+    CHECK(top);
+    CHECK(hasInstance(top, "s"));
+}
+
+// method Bit#(8) val; return cnt + 1; endmethod
+// only computes a value, so it is inlined under ?:
+static void testPureMethodIsInlinedUnderCondition() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    Stmts methods{makeAst<MethodDefStmt>("val", bit8, vector<string>(), vector<shared_ptr<BSVType>>(), shared_ptr<Expr>(),
+                                         Stmts{makeAst<ReturnStmt>(op("+", var("cnt", bit8), num("1")))})};
+    Stmts rules{rule("run", shared_ptr<Expr>(), Stmts{
+            display("%d", Exprs{makeAst<CondExpr>(op("==", num("0"), num("0")), method("val", bit8), num("7"))}),
+            finish()})};
+    Stmts stmts = package(methods, rules);
+    CHECK(!hasInstance(flattenedModule(stmts, "mkTop"), "s"));
+    CHECK_EQUAL(simulate(stmts, "mkTop"), string("1\n"));
+}
+
+// method Bit#(8) get if (cnt > 0); return cnt; endmethod
+// under ?: or on the right of && its guard would block the rule even when get is not evaluated
+static void testGuardedMethodIsNotHoistedFromCondition() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    Stmts methods{makeAst<MethodDefStmt>("get", bit8, vector<string>(), vector<shared_ptr<BSVType>>(),
+                                         op(">", var("cnt", bit8), num("0")),
+                                         Stmts{makeAst<ReturnStmt>(var("cnt", bit8))})};
+    shared_ptr<Expr> no = op("==", num("0"), num("1"));
+    Stmts rules{
+            rule("cond", shared_ptr<Expr>(), Stmts{
+                    display("%d", Exprs{makeAst<CondExpr>(no, method("get", bit8), num("7"))})}),
+            rule("and", shared_ptr<Expr>(), Stmts{
+                    display("%d", Exprs{op("&&", no, op("==", method("get", bit8), num("2")))})})};
+    shared_ptr<ModuleDefStmt> top = flattenedModule(package(methods, rules), "mkTop");
+    CHECK(hasInstance(top, "s"));
+    shared_ptr<RuleDefStmt> condRule = findRule(top, "cond"), andRule = findRule(top, "and");
+    CHECK(condRule && !condRule->guard);
+    CHECK(andRule && !andRule->guard);
+}
+
+// Bit#(8) x = 0; Bit#(8) i = 0; while (i < 3) begin x = x + s.val; i = i + 1; end $display("%d", x);
+static void testCallInLoopIsInlined() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    shared_ptr<Expr> i = var("i", bit8), x = var("x", bit8);
+    Stmts methods{makeAst<MethodDefStmt>("val", bit8, vector<string>(), vector<shared_ptr<BSVType>>(), shared_ptr<Expr>(),
+                                         Stmts{makeAst<ReturnStmt>(op("+", var("cnt", bit8), num("1")))})};
+    Stmts rules{rule("run", shared_ptr<Expr>(), Stmts{
+            makeAst<VarBindingStmt>(bit8, "x", num("0")),
+            makeAst<VarBindingStmt>(bit8, "i", num("0")),
+            makeAst<WhileStmt>(op("<", i, num("3")), makeAst<BlockStmt>(Stmts{
+                    makeAst<VarAssignStmt>(makeAst<VarLValue>("x", bit8), "=", op("+", x, method("val", bit8))),
+                    makeAst<VarAssignStmt>(makeAst<VarLValue>("i", bit8), "=", op("+", i, num("1")))})),
+    display("%d", Exprs{x}),
+            finish()})};
+    Stmts stmts = package(methods, rules);
+    shared_ptr<ModuleDefStmt> top = flattenedModule(stmts, "mkTop");
+    CHECK(!hasInstance(top, "s"));
+    ostringstream out;
+    if (top)
+        top->prettyPrint(out, 0);
+    CHECK(out.str().find(".val") == string::npos);
+    CHECK_EQUAL(simulate(stmts, "mkTop"), string("3\n"));
+}
+
+int main() {
+    testValueMethodReturnsEarly();
+    testActionAfterEarlyReturnIsSkipped();
+    testReturnFromLoopIsNotInlined();
+    testInstanceIsKeptForCallsNotInlined();
+    testPureMethodIsInlinedUnderCondition();
+    testGuardedMethodIsNotHoistedFromCondition();
+    testCallInLoopIsInlined();
+    return failures;
+}
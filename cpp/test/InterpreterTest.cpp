@@ -0,0 +1,75 @@
+// Regression tests for the Interpreter: sized arithmetic, Int#(n) and modules it cannot run.
+
+#include "TestSupport.h"
+
+static shared_ptr<Expr> neg(const shared_ptr<Expr> &expr) { return makeAst<OperatorExpr>("-", expr); }
+
+// Int#(8) x = -3; $display("%d %d %d %d", x, x < 0, x >> 1, x / 2);
+static void testSignedOperators() {
+    shared_ptr<BSVType> int8 = intType(8);
+    shared_ptr<Expr> x = var("x", int8);
+    Stmts stmts{moduleDef("mkTop", Stmts{rule("run", shared_ptr<Expr>(), Stmts{
+            makeAst<VarBindingStmt>(int8, "x", neg(num("3"))),
+            display("%d %d %d %d", Exprs{x, op("<", x, num("0")), op(">>", x, num("1")), op("/", x, num("2"))}),
+            finish()})})};
+    CHECK_EQUAL(simulate(stmts, "mkTop"), string("-3 1 -2 -1\n"));
+}
+
+// the same bits as a Bit#(8) are 253, which is not below 0 and shifts in zeros
+static void testUnsignedOperators() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    shared_ptr<Expr> y = var("y", bit8);
+    Stmts stmts{moduleDef("mkTop", Stmts{rule("run", shared_ptr<Expr>(), Stmts{
+            makeAst<VarBindingStmt>(bit8, "y", neg(num("3"))),
+            display("%d %d %d %d %d", Exprs{y, op("<", y, num("0")), op(">>", y, num("1")), op("/", y, num("2")),
+                                            op("+", y, num("5"))}),
+            finish()})})};
+    CHECK_EQUAL(simulate(stmts, "mkTop"), string("253 0 126 126 2\n"));
+}
+
+// a counter register, incremented by one rule until another one finishes the run
+static void testRulesAndRegisters() {
+    shared_ptr<BSVType> bit4 = bitType(4);
+    shared_ptr<Expr> count = var("count", bit4);
+    Stmts stmts{moduleDef("mkTop", Stmts{
+            reg("count", bit4, num("0")),
+            rule("step", op("<", count, num("3")), Stmts{
+                    display("count %d", Exprs{count}),
+                    makeAst<RegWriteStmt>("count", bit4, op("+", count, num("1")))}),
+            rule("done", op("==", count, num("3")), Stmts{finish()})})};
+    CHECK_EQUAL(simulate(stmts, "mkTop"), string("count 0\ncount 1\ncount 2\n"));
+}
+
+// Bit#(8) v; as the Inliner declares method results, binds zero rather than failing the rule
+static void testDeclarationWithoutValue() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    Stmts stmts{moduleDef("mkTop", Stmts{rule("run", shared_ptr<Expr>(), Stmts{
+            makeAst<VarBindingStmt>(bit8, "v", shared_ptr<Expr>()),
+            display("%d", Exprs{var("v", bit8)}),
+            finish()})})};
+    ostringstream out;
+    Interpreter interpreter(stmts, out);
+    CHECK(interpreter.load("mkTop"));
+    interpreter.run(1);
+    CHECK_EQUAL(out.str(), string("0\n"));
+}
+
+// nothing drives the methods of the top module, so there is nothing to run
+static void testModuleWithOnlyMethods() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    Stmts stmts{moduleDef("mkTop", BSVType::create("Sub"), Stmts{
+            makeAst<MethodDefStmt>("get", bit8, vector<string>(), vector<shared_ptr<BSVType>>(), shared_ptr<Expr>(),
+                                   Stmts{makeAst<ReturnStmt>(num("1"))})})};
+    ostringstream out;
+    Interpreter interpreter(flatten(stmts), out);
+    CHECK(!interpreter.load("mkTop"));
+}
+
+int main() {
+    testSignedOperators();
+    testUnsignedOperators();
+    testRulesAndRegisters();
+    testDeclarationWithoutValue();
+    testModuleWithOnlyMethods();
+    return failures;
+}
@@ -0,0 +1,67 @@
+// Regression tests for constant folding in OptimizeAst, which has to agree with the Interpreter.
+
+#include "OptimizeAst.h"
+#include "TestSupport.h"
+
+static shared_ptr<Expr> neg(const shared_ptr<Expr> &expr) { return makeAst<OperatorExpr>("-", expr); }
+
+// runs moduleName of the flattened and optimized package and returns what it displayed
+static string simulateOptimized(const Stmts &packageStmts, const string &moduleName) {
+    ostringstream out;
+    OptimizeAst optimizer;
+    Interpreter interpreter(optimizer.optimize(flatten(packageStmts)), out);
+    if (interpreter.load(moduleName))
+        interpreter.run(100);
+    return out.str();
+}
+
+// Int#(8) x = -1; if (x < 0) $display("negative"); else $display("not negative");
+// $display("%d %d %d", x, x >> 1, x / 2);
+static void testSignedFolding() {
+    shared_ptr<BSVType> int8 = intType(8);
+    shared_ptr<Expr> x = var("x", int8);
+    Stmts stmts{moduleDef("mkTop", Stmts{rule("run", shared_ptr<Expr>(), Stmts{
+            makeAst<VarBindingStmt>(int8, "x", neg(num("1"))),
+            makeAst<IfStmt>(op("<", x, num("0")), display("negative"), display("not negative")),
+            display("%d %d %d", Exprs{x, op(">>", x, num("1")), op("/", x, num("2"))}),
+            finish()})})};
+    string expected = "negative\n-1 -1 0\n";
+    CHECK_EQUAL(simulate(stmts, "mkTop"), expected);
+    CHECK_EQUAL(simulateOptimized(stmts, "mkTop"), expected);
+}
+
+// the same bits as a Bit#(8) are 255
+static void testUnsignedFolding() {
+    shared_ptr<BSVType> bit8 = bitType(8);
+    shared_ptr<Expr> y = var("y", bit8);
+    Stmts stmts{moduleDef("mkTop", Stmts{rule("run", shared_ptr<Expr>(), Stmts{
+            makeAst<VarBindingStmt>(bit8, "y", neg(num("1"))),
+            makeAst<IfStmt>(op("<", y, num("0")), display("negative"), display("not negative")),
+            display("%d %d %d", Exprs{y, op(">>", y, num("1")), op("/", y, num("2"))}),
+            finish()})})};
+    string expected = "not negative\n255 127 127\n";
+    CHECK_EQUAL(simulate(stmts, "mkTop"), expected);
+    CHECK_EQUAL(simulateOptimized(stmts, "mkTop"), expected);
+}
+
+// Bit#(8) b = 8'd3; $display("%d", {b, r}); with a Bit#(4) register r, which starts at 0:
+// b is propagated into the concatenation with its width
+static void testPropagatedConstantKeepsItsWidth() {
+    shared_ptr<BSVType> bit4 = bitType(4), bit8 = bitType(8);
+    Stmts stmts{moduleDef("mkTop", Stmts{
+            reg("r", bit4, num("0")),
+            rule("run", shared_ptr<Expr>(), Stmts{
+                    makeAst<VarBindingStmt>(bit8, "b", num("8'd3")),
+                    display("%d", Exprs{makeAst<BitConcatExpr>(Exprs{var("b", bit8), var("r", bit4)}, bitType(12))}),
+                    finish()})})};
+    string expected = "48\n";
+    CHECK_EQUAL(simulate(stmts, "mkTop"), expected);
+    CHECK_EQUAL(simulateOptimized(stmts, "mkTop"), expected);
+}
+
+int main() {
+    testSignedFolding();
+    testUnsignedFolding();
+    testPropagatedConstantKeepsItsWidth();
+    return failures;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+// Helpers for the regression tests, which build their input ASTs directly
+// since the passes under test do not need the parser.
+
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Expr.h"
+#include "Inliner.h"
+#include "Interpreter.h"
+#include "SimplifyAst.h"
+#include "Stmt.h"
+
+using namespace std;
+
+typedef vector<shared_ptr<Stmt>> Stmts;
+typedef vector<shared_ptr<Expr>> Exprs;
+
+// each test returns the number of failed checks as its exit status
+static int failures = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond << endl; \
+            failures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQUAL(actual, expected) do { \
+        auto actualValue = (actual); \
+        auto expectedValue = (expected); \
+        if (!(actualValue == expectedValue)) { \
+            cerr << __FILE__ << ":" << __LINE__ << ": " #actual " is \"" << actualValue << "\", expected \"" \
+                 << expectedValue << "\"" << endl; \
+            failures++; \
+        } \
+    } while (0)
+
+inline shared_ptr<BSVType> sizedType(const string &name, int width) {
+    return BSVType::create(name, vector<shared_ptr<BSVType>>{BSVType::create(to_string(width), BSVType_Numeric)});
+}
+
+inline shared_ptr<BSVType> bitType(int width) { return sizedType("Bit", width); }
+
+inline shared_ptr<BSVType> intType(int width) { return sizedType("Int", width); }
+
+inline shared_ptr<BSVType> boolType() { return BSVType::create("Bool"); }
+
+inline shared_ptr<BSVType> regType(const shared_ptr<BSVType> &elementType) {
+    return BSVType::create("Reg", vector<shared_ptr<BSVType>>{elementType});
+}
+
+inline shared_ptr<Expr> var(const string &name, const shared_ptr<BSVType> &bsvtype) {
+    return makeAst<VarExpr>(name, bsvtype);
+}
+
+inline shared_ptr<Expr> num(const string &repr) { return makeAst<IntConst>(repr); }
+
+inline shared_ptr<Expr> op(const string &op, const shared_ptr<Expr> &lhs, const shared_ptr<Expr> &rhs) {
+    return makeAst<OperatorExpr>(op, lhs, rhs);
+}
+
+inline shared_ptr<Expr> call(const string &function, const Exprs &args,
+                             const shared_ptr<BSVType> &resultType = BSVType::create("Void")) {
+    return makeAst<CallExpr>(makeAst<VarExpr>(function, resultType), args);
+}
+
+// Reg#(elementType) name <- mkReg(init);
+inline shared_ptr<Stmt> reg(const string &name, const shared_ptr<BSVType> &elementType, const shared_ptr<Expr> &init) {
+    return makeAst<ModuleInstStmt>(name, regType(elementType), call("mkReg", Exprs{init}, regType(elementType)));
+}
+
+// $display(format, args...);
+inline shared_ptr<Stmt> display(const string &format, const Exprs &args = Exprs()) {
+    Exprs displayArgs{makeAst<StringConst>(format)};
+    displayArgs.insert(displayArgs.end(), args.begin(), args.end());
+    return makeAst<ExprStmt>(call("$display", displayArgs));
+}
+
+inline shared_ptr<Stmt> finish() { return makeAst<ExprStmt>(call("$finish", Exprs())); }
+
+inline shared_ptr<Stmt> rule(const string &name, const shared_ptr<Expr> &guard, const Stmts &stmts) {
+    return makeAst<RuleDefStmt>(name, guard, stmts);
+}
+
+inline shared_ptr<ModuleDefStmt> moduleDef(const string &name, const shared_ptr<BSVType> &interfaceType,
+                                           const Stmts &stmts) {
+    return makeAst<ModuleDefStmt>("Test", name, interfaceType, vector<string>(), vector<shared_ptr<BSVType>>(), stmts);
+}
+
+inline shared_ptr<ModuleDefStmt> moduleDef(const string &name, const Stmts &stmts) {
+    return moduleDef(name, BSVType::create("Empty"), stmts);
+}
+
+// the package after SimplifyAst and the Inliner, as the backends see it
+inline Stmts flatten(const Stmts &packageStmts) {
+    Stmts stmts(packageStmts), simplifiedStmts;
+    SimplifyAst simplifier("Test");
+    simplifier.simplify(stmts, simplifiedStmts);
+    Inliner inliner;
+    return inliner.processPackage(simplifiedStmts);
+}
+
+// runs moduleName of the flattened package and returns what it displayed
+inline string simulate(const Stmts &packageStmts, const string &moduleName, long maxCycles = 100) {
+    ostringstream out;
+    Interpreter interpreter(flatten(packageStmts), out);
+    if (interpreter.load(moduleName))
+        interpreter.run(maxCycles);
+    return out.str();
+}
@@ -0,0 +1,109 @@
+// Regression tests for Graph: strongly connected components, the cycles
+// reported, and the topological order, on a graph with cycles and on a DAG.
+
+#include <algorithm>
+
+#include "TestSupport.h"
+#include "TopologicalSort.h"
+
+static string toString(const vector<int> &vertices) {
+    ostringstream out;
+    for (size_t i = 0; i < vertices.size(); i++)
+        out << (i ? " " : "") << vertices[i];
+    return out.str();
+}
+
+static string toString(const vector<vector<int>> &components) {
+    ostringstream out;
+    for (size_t i = 0; i < components.size(); i++)
+        out << (i ? ", " : "") << "{" << toString(components[i]) << "}";
+    return out.str();
+}
+
+// the index in components of the one holding v
+static size_t componentOf(const vector<vector<int>> &components, int v) {
+    for (size_t i = 0; i < components.size(); i++) {
+        if (find(components[i].cbegin(), components[i].cend(), v) != components[i].cend())
+            return i;
+    }
+    return components.size();
+}
+
+// 5 -> 2 -> 3 -> 1, 5 -> 0, 4 -> 0, 4 -> 1
+static void testDag() {
+    Graph g(6);
+    g.addEdge(5, 2);
+    g.addEdge(5, 0);
+    g.addEdge(4, 0);
+    g.addEdge(4, 1);
+    g.addEdge(2, 3);
+    g.addEdge(3, 1);
+    CHECK_EQUAL(g.stronglyConnectedComponents().size(), (size_t)6);
+    CHECK(g.cycles().empty());
+    vector<int> order;
+    CHECK(g.topologicalSort(order));
+    // the ready vertex with the smallest number goes first
+    CHECK_EQUAL(toString(order), string("4 5 0 2 3 1"));
+}
+
+// 3 -> 4 -> 5 -> 3 and 4 -> 0, 1 -> 1, 2 on its own
+static void testCycles() {
+    Graph g(6);
+    g.addEdge(4, 5);
+    g.addEdge(5, 3);
+    g.addEdge(3, 4);
+    g.addEdge(4, 0);
+    g.addEdge(1, 1);
+
+    vector<vector<int>> components = g.stronglyConnectedComponents();
+    CHECK_EQUAL(components.size(), (size_t)4);
+    size_t cycle = componentOf(components, 3);
+    CHECK(cycle < components.size());
+    if (cycle < components.size())
+        CHECK_EQUAL(toString(components[cycle]), string("3 4 5"));
+    CHECK(componentOf(components, 0) != cycle);
+    // a component comes after the ones it has an edge to
+    CHECK(componentOf(components, 0) < cycle);
+
+    CHECK_EQUAL(toString(g.cycles()), string("{1}, {3 4 5}"));
+
+    vector<int> order;
+    CHECK(!g.topologicalSort(order));
+    // the cycle stays together and before 0, which it has an edge to
+    CHECK_EQUAL(toString(order), string("1 2 3 4 5 0"));
+}
+
+// edges added after a query are seen by the next one
+static void testAddAfterQuery() {
+    Graph g(2);
+    g.addEdge(1, 0);
+    vector<int> order;
+    CHECK(g.topologicalSort(order));
+    CHECK_EQUAL(toString(order), string("1 0"));
+    int v = g.addVertex();
+    g.addEdge(0, v);
+    g.addEdge(v, 1);
+    CHECK(!g.topologicalSort(order));
+    CHECK_EQUAL(toString(g.cycles()), string("{0 1 2}"));
+}
+
+// a chain deep enough to overflow the stack of a recursive search
+static void testLongChain() {
+    const int n = 1000000;
+    Graph g(n);
+    for (int v = n - 1; v > 0; v--)
+        g.addEdge(v, v - 1);
+    CHECK_EQUAL(g.stronglyConnectedComponents().size(), (size_t)n);
+    vector<int> order;
+    CHECK(g.topologicalSort(order));
+    CHECK_EQUAL(order.size(), (size_t)n);
+    CHECK(order.size() == (size_t)n && order.front() == n - 1 && order.back() == 0);
+}
+
+int main() {
+    testDag();
+    testCycles();
+    testAddAfterQuery();
+    testLongChain();
+    return failures;
+}
@@ -2,6 +2,8 @@
 
 import argparse
 import os
+import pprint
+import struct
 import sys
 
 sys.path.insert(0, os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(__name__))), 'cpp', 'build', 'protobuf'))
@@ -12,21 +14,119 @@ import pattern_pb2
 import source_pos_pb2
 import stmt_pb2
 
+# see AstIndex in cpp/protobuf/stmt.proto for the layout of .ast files
+AST_MAGIC = b'BSVAST02'
+INDEX_MAGIC = b'BSVASTIX'
+
+def read_varint(f):
+    value = 0
+    shift = 0
+    while True:
+        b = f.read(1)
+        if not b:
+            raise EOFError('truncated varint')
+        value |= (b[0] & 0x7f) << shift
+        shift += 7
+        if not (b[0] & 0x80):
+            return value
+
+def read_record(f, message):
+    size = read_varint(f)
+    message.ParseFromString(f.read(size))
+    return message
+
+def read_header(f):
+    """Returns the package, without its stmts, and the index of its records."""
+    f.seek(0)
+    if f.read(len(AST_MAGIC)) != AST_MAGIC:
+        raise ValueError('not a streamed AST file')
+    packagedef = read_record(f, stmt_pb2.PackageDef())
+    f.seek(-16, os.SEEK_END)
+    (index_offset,) = struct.unpack('<Q', f.read(8))
+    if f.read(len(INDEX_MAGIC)) != INDEX_MAGIC:
+        raise ValueError('AST file has no index')
+    f.seek(index_offset)
+    index = read_record(f, stmt_pb2.AstIndex())
+    return packagedef, index
+
+def read_stmt(f, entry):
+    f.seek(entry.offset)
+    return read_record(f, stmt_pb2.Stmt())
+
+def find_stmts(f, index, name):
+    return [read_stmt(f, entry) for entry in index.entry if entry.name == name]
+
+# uint32 fields holding numbers rather than table indices
+NUMERIC_FIELDS = {('IntConst', 'value'), ('IntConst', 'base'), ('IntConst', 'width'),
+                  ('IntPattern', 'value'), ('SourcePos', 'lineNumber')}
+TYPE_FIELDS = {'bsvtype', 'argtype', 'elementType', 'enumType', 'interfaceType', 'memberType',
+               'paramType', 'returnType', 'structType', 'synonymType', 'type', 'varType'}
+
+def type_string(index, tables):
+    if not index:
+        return None
+    bsvtype = tables.type[index]
+    name = tables.identifier[bsvtype.name]
+    if bsvtype.param:
+        name += '#(' + ', '.join(type_string(param, tables) for param in bsvtype.param) + ')'
+    return name
+
+def is_repeated(field):
+    if hasattr(field, 'is_repeated'):
+        return field.is_repeated
+    return field.label == field.LABEL_REPEATED
+
+def resolve(message, tables):
+    """Returns message as a dict, with the table indices it holds replaced by the entries."""
+    result = {}
+    for field, value in message.ListFields():
+        if field.type == field.TYPE_MESSAGE:
+            if is_repeated(field):
+                value = [resolve(v, tables) for v in value]
+            else:
+                value = resolve(value, tables)
+        elif field.type == field.TYPE_UINT32 and (message.DESCRIPTOR.name, field.name) not in NUMERIC_FIELDS:
+            if message.DESCRIPTOR.name == 'SourcePos':
+                lookup = lambda i: tables.filename[i]
+            elif field.name in TYPE_FIELDS:
+                lookup = lambda i: type_string(i, tables)
+            else:
+                lookup = lambda i: tables.identifier[i]
+            if is_repeated(field):
+                value = [lookup(v) for v in value]
+            else:
+                value = lookup(value)
+        elif is_repeated(field):
+            value = list(value)
+        result[field.name] = value
+    return result
+
 def parse_packagedef(filename):
     with open(filename, 'rb') as f:
-        packagedef_bytes = f.read()
-        packagedef = stmt_pb2.PackageDef()
-        packagedef.ParseFromString(packagedef_bytes)
+        packagedef, index = read_header(f)
+        for entry in index.entry:
+            packagedef.stmt.append(read_stmt(f, entry))
         return packagedef
 
 
 argparser = argparse.ArgumentParser('read bsvtokami AST files')
-argparser.add_argument('ast_files', help='AST files', action='append')
+argparser.add_argument('ast_files', help='AST files', nargs='+')
+argparser.add_argument('--decl', help='print only the declarations with this name', action='append')
+argparser.add_argument('--index', help='print the index of each file', action='store_true')
 
 if __name__ == '__main__':
     args = argparser.parse_args()
-    ast_files = args.ast_files
-    for ast_file in ast_files:
+    for ast_file in args.ast_files:
         print(ast_file)
-        packagedef = parse_packagedef(ast_file)
-        print(packagedef)
+        with open(ast_file, 'rb') as f:
+            packagedef, index = read_header(f)
+            if args.index:
+                for entry in index.entry:
+                    print(entry.name, entry.stmtKind, entry.offset, entry.size)
+            if args.decl:
+                for name in args.decl:
+                    for stmt in find_stmts(f, index, name):
+                        pprint.pprint(resolve(stmt, index))
+            elif not args.index:
+                for entry in index.entry:
+                    pprint.pprint(resolve(read_stmt(f, entry), index))